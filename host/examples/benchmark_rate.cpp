@@ -18,12 +18,18 @@
 #include <uhd/utils/thread_priority.hpp>
 #include <uhd/utils/safe_main.hpp>
 #include <uhd/usrp/multi_usrp.hpp>
+#include <uhd/property_tree.hpp>
+#include <uhd/convert.hpp>
 #include <boost/program_options.hpp>
 #include <boost/format.hpp>
 #include <boost/thread/thread.hpp>
 #include <boost/math/special_functions/round.hpp>
+#include <boost/foreach.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
 #include <iostream>
 #include <complex>
+#include <ctime>
 
 namespace po = boost::program_options;
 
@@ -40,30 +46,38 @@ unsigned long long num_seq_errors = 0;
 /***********************************************************************
  * Benchmark RX Rate
  **********************************************************************/
-void benchmark_rx_rate(uhd::usrp::multi_usrp::sptr usrp){
+void benchmark_rx_rate(
+    uhd::usrp::multi_usrp::sptr usrp, const std::string &rx_cpu, const std::string &rx_otw,
+    const std::vector<size_t> &channels, const size_t convert_threads
+){
     uhd::set_thread_priority_safe();
 
     //create a receive streamer
-    uhd::stream_args_t stream_args("fc32"); //complex floats
+    uhd::stream_args_t stream_args(rx_cpu, rx_otw);
+    stream_args.channels = channels;
+    stream_args.args["convert_threads"] = boost::lexical_cast<std::string>(convert_threads);
     uhd::rx_streamer::sptr rx_stream = usrp->get_rx_stream(stream_args);
 
     //print pre-test summary
     std::cout << boost::format(
-        "Testing receive rate %f Msps"
-    ) % (usrp->get_rx_rate()/1e6) << std::endl;
+        "Testing receive rate %f Msps on %u channels (%s host, %s wire, %u convert threads)"
+    ) % (usrp->get_rx_rate()/1e6) % channels.size() % rx_cpu % rx_otw % convert_threads << std::endl;
 
-    //setup variables and allocate buffer
+    //setup variables and allocate buffers
     uhd::rx_metadata_t md;
     const size_t max_samps_per_packet = rx_stream->get_max_num_samps();
-    std::vector<std::complex<float> > buff(max_samps_per_packet);
+    const size_t bytes_per_samp = uhd::convert::get_bytes_per_item(rx_cpu);
+    std::vector<std::vector<char> > mem(channels.size(), std::vector<char>(max_samps_per_packet*bytes_per_samp));
+    std::vector<void *> buffs;
+    for (size_t ch = 0; ch < mem.size(); ch++) buffs.push_back(&mem[ch].front());
     bool had_an_overflow = false;
     uhd::time_spec_t last_time;
     const double rate = usrp->get_rx_rate();
 
     usrp->issue_stream_cmd(uhd::stream_cmd_t::STREAM_MODE_START_CONTINUOUS);
     while (not boost::this_thread::interruption_requested()){
-        num_rx_samps += rx_stream->recv(
-            &buff.front(), buff.size(), md
+        num_rx_samps += channels.size()*rx_stream->recv(
+            buffs, max_samps_per_packet, md
         );
 
         //handle the error codes
@@ -94,31 +108,39 @@ void benchmark_rx_rate(uhd::usrp::multi_usrp::sptr usrp){
 /***********************************************************************
  * Benchmark TX Rate
  **********************************************************************/
-void benchmark_tx_rate(uhd::usrp::multi_usrp::sptr usrp){
+void benchmark_tx_rate(
+    uhd::usrp::multi_usrp::sptr usrp, const std::string &tx_cpu, const std::string &tx_otw,
+    const std::vector<size_t> &channels, const size_t convert_threads
+){
     uhd::set_thread_priority_safe();
 
     //create a transmit streamer
-    uhd::stream_args_t stream_args("fc32"); //complex floats
+    uhd::stream_args_t stream_args(tx_cpu, tx_otw);
+    stream_args.channels = channels;
+    stream_args.args["convert_threads"] = boost::lexical_cast<std::string>(convert_threads);
     uhd::tx_streamer::sptr tx_stream = usrp->get_tx_stream(stream_args);
 
     //print pre-test summary
     std::cout << boost::format(
-        "Testing transmit rate %f Msps"
-    ) % (usrp->get_tx_rate()/1e6) << std::endl;
+        "Testing transmit rate %f Msps on %u channels (%s host, %s wire, %u convert threads)"
+    ) % (usrp->get_tx_rate()/1e6) % channels.size() % tx_cpu % tx_otw % convert_threads << std::endl;
 
-    //setup variables and allocate buffer
+    //setup variables and allocate buffers
     uhd::tx_metadata_t md;
     md.has_time_spec = false;
     const size_t max_samps_per_packet = tx_stream->get_max_num_samps();
-    std::vector<std::complex<float> > buff(max_samps_per_packet);
+    const size_t bytes_per_samp = uhd::convert::get_bytes_per_item(tx_cpu);
+    std::vector<std::vector<char> > mem(channels.size(), std::vector<char>(max_samps_per_packet*bytes_per_samp));
+    std::vector<const void *> buffs;
+    for (size_t ch = 0; ch < mem.size(); ch++) buffs.push_back(&mem[ch].front());
 
     while (not boost::this_thread::interruption_requested()){
-        num_tx_samps += tx_stream->send(&buff.front(), buff.size(), md);
+        num_tx_samps += channels.size()*tx_stream->send(buffs, max_samps_per_packet, md);
     }
 
     //send a mini EOB packet
     md.end_of_burst = true;
-    tx_stream->send("", 0, md);
+    tx_stream->send(buffs, 0, md);
 }
 
 void benchmark_tx_rate_async_helper(uhd::usrp::multi_usrp::sptr usrp){
@@ -152,6 +174,43 @@ void benchmark_tx_rate_async_helper(uhd::usrp::multi_usrp::sptr usrp){
     }
 }
 
+/***********************************************************************
+ * Transport counters: sum over all dsps that provide them
+ **********************************************************************/
+void get_xport_counters(
+    uhd::usrp::multi_usrp::sptr usrp,
+    const std::string &dsps, const std::string &dir,
+    unsigned long long &num_syscalls,
+    unsigned long long &num_packets
+){
+    num_syscalls = 0;
+    num_packets = 0;
+    uhd::property_tree::sptr tree = usrp->get_device()->get_tree();
+    BOOST_FOREACH(const std::string &mb, tree->list("/mboards")){
+        const uhd::fs_path dsps_path = "/mboards/" + mb + "/" + dsps;
+        if (not tree->exists(dsps_path)) continue;
+        BOOST_FOREACH(const std::string &dsp, tree->list(dsps_path)){
+            const uhd::fs_path xport_path = dsps_path / dsp / "xport";
+            if (not tree->exists(xport_path / (dir + "_syscalls"))) continue;
+            num_syscalls += tree->access<size_t>(xport_path / (dir + "_syscalls")).get();
+            num_packets += tree->access<size_t>(xport_path / (dir + "_packets")).get();
+        }
+    }
+}
+
+/***********************************************************************
+ * Parse a comma separated list of numbers
+ **********************************************************************/
+std::vector<size_t> parse_list(const std::string &str){
+    std::vector<std::string> strs;
+    boost::split(strs, str, boost::is_any_of(", "), boost::token_compress_on);
+    std::vector<size_t> nums;
+    BOOST_FOREACH(const std::string &s, strs){
+        if (not s.empty()) nums.push_back(boost::lexical_cast<size_t>(s));
+    }
+    return nums;
+}
+
 /***********************************************************************
  * Main code + dispatcher
  **********************************************************************/
@@ -162,6 +221,8 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
     std::string args;
     double duration;
     double rx_rate, tx_rate;
+    std::string rx_cpu, rx_otw, tx_cpu, tx_otw;
+    std::string channel_list, convert_threads_list;
 
     //setup the program options
     po::options_description desc("Allowed options");
@@ -171,6 +232,12 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         ("duration", po::value<double>(&duration)->default_value(10.0), "duration for the test in seconds")
         ("rx_rate", po::value<double>(&rx_rate), "specify to perform a RX rate test (sps)")
         ("tx_rate", po::value<double>(&tx_rate), "specify to perform a TX rate test (sps)")
+        ("rx_cpu", po::value<std::string>(&rx_cpu)->default_value("fc32"), "host sample format for RX: fc64, fc32 or sc16")
+        ("rx_otw", po::value<std::string>(&rx_otw)->default_value("sc16"), "wire sample format for RX: sc16 or sc8")
+        ("tx_cpu", po::value<std::string>(&tx_cpu)->default_value("fc32"), "host sample format for TX: fc64, fc32 or sc16")
+        ("tx_otw", po::value<std::string>(&tx_otw)->default_value("sc16"), "wire sample format for TX, if the device supports it")
+        ("channels", po::value<std::string>(&channel_list)->default_value("0"), "which channels to use (specify \"0\", \"1\", \"0,1\", etc)")
+        ("convert_threads", po::value<std::string>(&convert_threads_list)->default_value("1"), "converting threads per streamer, a list (ex: \"1,2,4\") runs the test for each")
     ;
     po::variables_map vm;
     po::store(po::parse_command_line(argc, argv, desc), vm);
@@ -183,9 +250,14 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         "    Specify --rx_rate for a receive-only test.\n"
         "    Specify --tx_rate for a transmit-only test.\n"
         "    Specify both options for a full-duplex test.\n"
+        "    Specify several --convert_threads for a scaling curve.\n"
+        "    Pass transport hints in --args, ex: recv_spin_time=50,recv_busy_poll=50 (both in us).\n"
         << std::endl;
         return ~0;
     }
+    const std::vector<size_t> channels = parse_list(channel_list);
+    const std::vector<size_t> convert_threads = parse_list(convert_threads_list);
+    if (channels.empty() or convert_threads.empty()) throw std::runtime_error("no channels or convert threads given");
 
     //create a usrp device
     std::cout << std::endl;
@@ -198,29 +270,49 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
     uhd::usrp::multi_usrp::sptr usrp = uhd::usrp::multi_usrp::make(args);
     std::cout << boost::format("Using Device: %s") % usrp->get_pp_string() << std::endl;
 
-    boost::thread_group thread_group;
+    unsigned long long num_recv_syscalls_start, num_recv_packets_start;
+    unsigned long long num_send_syscalls_start, num_send_packets_start;
+    get_xport_counters(usrp, "rx_dsps", "recv", num_recv_syscalls_start, num_recv_packets_start);
+    get_xport_counters(usrp, "tx_dsps", "send", num_send_syscalls_start, num_send_packets_start);
+
+    if (vm.count("rx_rate")) usrp->set_rx_rate(rx_rate);
+    if (vm.count("tx_rate")) usrp->set_tx_rate(tx_rate);
+
+    std::string scaling_summary;
+    double cpu_secs = 0;
+    BOOST_FOREACH(const size_t num_threads, convert_threads){
+        const unsigned long long rx_start = num_rx_samps, tx_start = num_tx_samps;
+        const unsigned long long overflows_start = num_overflows, underflows_start = num_underflows;
+        boost::thread_group thread_group;
+        const std::clock_t cpu_start = std::clock();
+
+        //spawn the receive test thread
+        if (vm.count("rx_rate")){
+            thread_group.create_thread(boost::bind(&benchmark_rx_rate, usrp, rx_cpu, rx_otw, channels, num_threads));
+        }
 
-    //spawn the receive test thread
-    if (vm.count("rx_rate")){
-        usrp->set_rx_rate(rx_rate);
-        thread_group.create_thread(boost::bind(&benchmark_rx_rate, usrp));
-    }
+        //spawn the transmit test thread
+        if (vm.count("tx_rate")){
+            thread_group.create_thread(boost::bind(&benchmark_tx_rate, usrp, tx_cpu, tx_otw, channels, num_threads));
+            thread_group.create_thread(boost::bind(&benchmark_tx_rate_async_helper, usrp));
+        }
 
-    //spawn the transmit test thread
-    if (vm.count("tx_rate")){
-        usrp->set_tx_rate(tx_rate);
-        thread_group.create_thread(boost::bind(&benchmark_tx_rate, usrp));
-        thread_group.create_thread(boost::bind(&benchmark_tx_rate_async_helper, usrp));
-    }
+        //sleep for the required duration
+        const long secs = long(duration);
+        const long usecs = long((duration - secs)*1e6);
+        boost::this_thread::sleep(boost::posix_time::seconds(secs) + boost::posix_time::microseconds(usecs));
 
-    //sleep for the required duration
-    const long secs = long(duration);
-    const long usecs = long((duration - secs)*1e6);
-    boost::this_thread::sleep(boost::posix_time::seconds(secs) + boost::posix_time::microseconds(usecs));
+        //interrupt and join the threads
+        thread_group.interrupt_all();
+        thread_group.join_all();
+        const double run_cpu_secs = double(std::clock() - cpu_start)/CLOCKS_PER_SEC;
+        cpu_secs += run_cpu_secs;
 
-    //interrupt and join the threads
-    thread_group.interrupt_all();
-    thread_group.join_all();
+        scaling_summary += str(boost::format("  %7u %10.3f %10.3f %10u %10u %8.1f%%\n")
+            % num_threads % ((num_rx_samps - rx_start)/duration/1e6) % ((num_tx_samps - tx_start)/duration/1e6)
+            % (num_overflows - overflows_start) % (num_underflows - underflows_start) % (100*run_cpu_secs/duration)
+        );
+    }
 
     //print summary
     std::cout << std::endl << boost::format(
@@ -233,6 +325,41 @@ int UHD_SAFE_MAIN(int argc, char *argv[]){
         "  Num underflows detected: %u\n"
     ) % num_rx_samps % num_dropped_samps % num_overflows % num_tx_samps % num_seq_errors % num_underflows << std::endl;
 
+    //print the host cpu cost, this is where the wire formats differ
+    const double total_duration = duration*convert_threads.size();
+    if (num_rx_samps + num_tx_samps > 0) std::cout << boost::format(
+        "  Host CPU time:           %.3f s (%.1f%% of one core)\n"
+        "  CPU time per sample:     %.1f ns\n"
+    ) % cpu_secs % (100*cpu_secs/total_duration) % (1e9*cpu_secs/(num_rx_samps + num_tx_samps)) << std::endl;
+
+    //print the scaling curve over the convert threads
+    if (convert_threads.size() > 1) std::cout << boost::format(
+        "Convert thread scaling (%u channels):\n"
+        "  %7s %10s %10s %10s %10s %9s\n"
+        "%s"
+    ) % channels.size() % "threads" % "RX Msps" % "TX Msps" % "overflows" % "underflows" % "CPU" % scaling_summary << std::endl;
+
+    //print the transport syscall overhead when available
+    unsigned long long num_recv_syscalls, num_recv_packets;
+    get_xport_counters(usrp, "rx_dsps", "recv", num_recv_syscalls, num_recv_packets);
+    num_recv_syscalls = (num_recv_syscalls - num_recv_syscalls_start) & 0xffffffffULL; //the counters wrap at 2^32
+    num_recv_packets = (num_recv_packets - num_recv_packets_start) & 0xffffffffULL;
+    if (num_recv_packets > 0) std::cout << boost::format(
+        "  Num recv syscalls:       %u\n"
+        "  Num recv packets:        %u\n"
+        "  Recv syscalls/packet:    %.3f\n"
+    ) % num_recv_syscalls % num_recv_packets % (double(num_recv_syscalls)/num_recv_packets) << std::endl;
+
+    unsigned long long num_send_syscalls, num_send_packets;
+    get_xport_counters(usrp, "tx_dsps", "send", num_send_syscalls, num_send_packets);
+    num_send_syscalls = (num_send_syscalls - num_send_syscalls_start) & 0xffffffffULL;
+    num_send_packets = (num_send_packets - num_send_packets_start) & 0xffffffffULL;
+    if (num_send_packets > 0) std::cout << boost::format(
+        "  Num send syscalls:       %u\n"
+        "  Num send packets:        %u\n"
+        "  Send syscalls/packet:    %.3f\n"
+    ) % num_send_syscalls % num_send_packets % (double(num_send_syscalls)/num_send_packets) << std::endl;
+
     //finished
     std::cout << std::endl << "Done!" << std::endl << std::endl;
 
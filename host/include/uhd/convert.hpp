@@ -23,10 +23,30 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/function.hpp>
 #include <boost/operators.hpp>
+#include <complex>
 #include <string>
+#include <vector>
 
 namespace uhd{ namespace convert{
 
+    /*!
+     * A correction of complex samples applied while converting:
+     *   out = gain * matrix * (in - dc_offset)
+     * The input is the scaled sample, the matrix rows map its I and Q
+     * to the corrected I and Q (IQ balance) and the dc offset
+     * is in the units of the scaled samples.
+     * The default correction changes nothing.
+     */
+    struct correction_type{
+        correction_type(void): dc_offset(0.0), gain(1.0){
+            matrix[0][0] = 1.0; matrix[0][1] = 0.0;
+            matrix[1][0] = 0.0; matrix[1][1] = 1.0;
+        }
+        std::complex<double> dc_offset;
+        double matrix[2][2];
+        double gain;
+    };
+
     //! A conversion class that implements a conversion from inputs -> outputs.
     class converter{
     public:
@@ -37,6 +57,13 @@ namespace uhd{ namespace convert{
         //! Set the scale factor (used in floating point conversions)
         virtual void set_scalar(const double) = 0;
 
+        /*!
+         * Set a correction applied while converting, see correction_type.
+         * Only the converters from get_correcting_converter() implement it.
+         * \return true when this converter applies the correction
+         */
+        virtual bool set_correction(const correction_type &){return false;}
+
         //! The public conversion method to convert inputs -> outputs
         UHD_INLINE void conv(const input_type &in, const output_type &out, const size_t num){
             if (num != 0) (*this)(in, out, num);
@@ -79,11 +106,66 @@ namespace uhd{ namespace convert{
 
     /*!
      * Get a converter factory function.
+     *
+     * When the environment variable UHD_CONVERT_AUTOTUNE is set,
+     * the best converter is the fastest one measured on this machine
+     * instead of the one with the highest priority.
+     * The decision is cached in $HOME/.uhd/convert_autotune.txt.
+     *
      * \param id identify the conversion
      * \return the converter factory function
      */
     UHD_API function_type get_converter(const id_type &id);
 
+    /*!
+     * Get the factory function of a specific converter.
+     * Useful to test and benchmark every implementation of a conversion.
+     * \param id identify the conversion
+     * \param prio the priority of the converter
+     * \return the converter factory function
+     */
+    UHD_API function_type get_converter(const id_type &id, const priority_type prio);
+
+    /*!
+     * Get the priorities of all the converters registered for a conversion.
+     * Useful to test and benchmark every implementation of a conversion.
+     * \param id identify the conversion
+     * \return a list of priorities, empty when there is no converter
+     */
+    UHD_API std::vector<priority_type> get_converter_priorities(const id_type &id);
+
+    /*!
+     * Get the identifiers of all the registered conversions.
+     * \return a list of conversion ids
+     */
+    UHD_API std::vector<id_type> get_converter_ids(void);
+
+    /*!
+     * Register a converter that applies a correction while converting.
+     * They are kept apart from the regular converters,
+     * so that get_converter() never picks one.
+     * \param id identify the conversion
+     * \param fcn makes a new converter
+     * \param prio the function priority
+     */
+    UHD_API void register_correcting_converter(
+        const id_type &id,
+        const function_type &fcn,
+        const priority_type prio
+    );
+
+    /*!
+     * Get the factory function of a correcting converter.
+     * \param id identify the conversion
+     * \param prio the priority of a specific converter (-1 for the best)
+     * \return the converter factory function
+     * \throw uhd::key_error when no converter can correct this conversion
+     */
+    UHD_API function_type get_correcting_converter(const id_type &id, const priority_type prio = -1);
+
+    //! Get the priorities of the correcting converters for a conversion
+    UHD_API std::vector<priority_type> get_correcting_converter_priorities(const id_type &id);
+
     /*!
      * Register the size of a particular item.
      * \param format the item format
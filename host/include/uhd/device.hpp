@@ -92,6 +92,38 @@ public:
         async_metadata_t &async_metadata, double timeout = 0.1
     ) = 0;
 
+    /*!
+     * Receive an asynchronous message of one channel.
+     * The first call for a channel gives it a queue of its own,
+     * from then on its messages go into that queue and the common one.
+     * A full queue drops its oldest message and counts the drop.
+     * \param channel the channel as in async_metadata_t::channel
+     * \param async_metadata the metadata to be filled in
+     * \param timeout the timeout in seconds to wait for a message
+     * \return true when the async_metadata is valid, false for timeout
+     * \throw uhd::not_implemented_error when the device has no channel queues
+     */
+    virtual bool recv_chan_async_msg(
+        size_t, async_metadata_t &, double = 0.1
+    ){
+        throw uhd::not_implemented_error("recv_chan_async_msg is not supported by this device");
+    }
+
+    //! A callback for asynchronous messages
+    typedef boost::function<void(const async_metadata_t &)> async_msg_callback_t;
+
+    /*!
+     * Register a callback for asynchronous messages.
+     * The callback runs on the thread that receives the message,
+     * as soon as it arrives, and sees every message of every channel.
+     * It holds up the messages after it, so it should return quickly.
+     * \param callback the function to call with each message
+     * \throw uhd::not_implemented_error when the device has no callbacks
+     */
+    virtual void register_async_msg_callback(const async_msg_callback_t &){
+        throw uhd::not_implemented_error("register_async_msg_callback is not supported by this device");
+    }
+
     //! Get access to the underlying property structure
     virtual boost::shared_ptr<property_tree> get_tree(void) const = 0;
 
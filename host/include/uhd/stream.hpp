@@ -22,6 +22,8 @@
 #include <uhd/types/metadata.hpp>
 #include <uhd/types/device_addr.hpp>
 #include <uhd/types/ref_vector.hpp>
+#include <uhd/transport/zero_copy.hpp>
+#include <uhd/exception.hpp>
 #include <boost/utility.hpp>
 #include <boost/shared_ptr.hpp>
 #include <vector>
@@ -67,6 +69,7 @@ struct UHD_API stream_args_t{
      * The OTW format is a string that describes the format over-the-wire.
      * The following over-the-wire formats have been implemented:
      *  - sc16 - Q16 I16
+     *  - sc12 - I12_0 Q12_0 I12_1 Q12_1 I12_2 Q12_2 I12_3 Q12_3, msb first over 3 items
      *  - sc8 - Q8_1 I8_1 Q8_0 I8_0
      *
      * The following are not implemented, but are listed to demonstrate naming convention:
@@ -88,6 +91,24 @@ struct UHD_API stream_args_t{
      * In the "next_burst" mode, the DSP drops incoming packets until a new burst is started.
      * In the "next_packet" mode, the DSP starts transmitting again at the next packet.
      *
+     * - convert_threads: the number of threads converting the channels of a packet.
+     * With more than one, the channels are converted in parallel by a pool of
+     * worker threads and the calling thread. Only useful with several channels.
+     *
+     * - capture_samps: capture into a ring of this many samples per channel.
+     * A background thread receives from the device while the application
+     * reads from the rings at its own pace. When the application falls behind
+     * the whole ring, recv() reports ERROR_CODE_CAPTURE_OVERFLOW, not a device overflow.
+     * - capture_cpu: the processor core to pin the capture thread to.
+     * - capture_huge_pages: back the rings with huge pages when available.
+     * - sender_samps: queue sent samples in a ring of this many samples per channel.
+     * send() copies into the ring and returns, a background thread converts,
+     * waits on flow control and sends. tx_streamer::get_send_room() tells the room left.
+     * - sender_cpu: the processor core to pin the sender thread to.
+     *
+     * - latency_us: the most samples in flight to the device, in microseconds.
+     * By default flow control lets the whole device buffer fill up.
+     *
      * The following are not implemented, but are listed for conceptual purposes:
      * - function: magnitude or phase/magnitude
      * - units: numeric units like counts or dBm
@@ -158,6 +179,61 @@ public:
         const double timeout = 0.1,
         const bool one_packet = false
     ) = 0;
+
+    /*!
+     * The samples of a received packet, left in the transport frames.
+     * The samples are in the over-the-wire item format,
+     * use uhd::convert to convert them when that is not the one wanted.
+     * The frames are held until release() is called
+     * or the object is passed to recv_direct() again;
+     * they may be released from any thread.
+     */
+    struct direct_buffs_type{
+        direct_buffs_type(void): nsamps(0){}
+
+        //! Pointers to the samples, one per channel
+        std::vector<const void *> buffs;
+
+        //! The number of samples in each buffer
+        size_t nsamps;
+
+        //! The item format of the samples, ex: sc16_item32_be
+        std::string format;
+
+        //! The transport frames holding the samples, one per channel
+        std::vector<transport::managed_recv_buffer::sptr> frames;
+
+        //! Give the frames back to the transport
+        void release(void){
+            buffs.clear();
+            frames.clear();
+            nsamps = 0;
+        }
+    };
+
+    /*!
+     * Receive a packet without copying its samples.
+     *
+     * The buffers point into the transport frames of one packet per channel,
+     * the metadata is filled like for a one packet recv().
+     * When a previous recv() left part of a packet, the rest is returned
+     * as a fragment. The transport has a limited number of frames,
+     * holding on to too many of them stalls the receive.
+     *
+     * \param buffs filled with the samples and the frames holding them
+     * \param metadata data to fill describing the buffer
+     * \param timeout the timeout in seconds to wait for a packet
+     * \return the number of samples per channel or 0 on error
+     * \throw uhd::not_implemented_error when the streamer cannot do it
+     */
+    virtual size_t recv_direct(
+        direct_buffs_type &buffs,
+        rx_metadata_t &,
+        const double = 0.1
+    ){
+        buffs.release();
+        throw uhd::not_implemented_error("recv_direct is not supported by this streamer");
+    }
 };
 
 /*!
@@ -205,6 +281,19 @@ public:
         const tx_metadata_t &metadata,
         const double timeout = 0.1
     ) = 0;
+
+    /*!
+     * Get the number of samples per buffer that send() takes right now.
+     * A streamer that sends from a background thread queues the samples,
+     * this is the room left in its queue and does not block.
+     * Use it to produce only what fits or to back off when falling behind.
+     *
+     * \return the room per channel in number of samples
+     * \throw uhd::not_implemented_error when send() does not queue samples
+     */
+    virtual size_t get_send_room(void){
+        throw uhd::not_implemented_error("get_send_room is not supported by this streamer");
+    }
 };
 
 } //namespace uhd
@@ -0,0 +1,175 @@
+//
+// Copyright 2013 Fairwaves LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_UHD_TRANSPORT_BOUNDED_SPSC_BUFFER_IPP
+#define INCLUDED_UHD_TRANSPORT_BOUNDED_SPSC_BUFFER_IPP
+
+#include <uhd/config.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/utility.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace uhd{ namespace transport{ namespace{ /*anon*/
+
+    /*!
+     * One side of the spsc buffer blocks on a waiter
+     * once spinning did not make the buffer ready.
+     * The waiting flag is only set while the mutex is held,
+     * so the other side locks the mutex before it notifies.
+     */
+    struct bounded_spsc_buffer_waiter{
+        boost::mutex mutex;
+        boost::condition cond;
+        atomic_uint32_t waiting;
+
+        UHD_INLINE void notify(void){
+            if (waiting.read() == 0) return;
+            boost::mutex::scoped_lock lock(mutex);
+            cond.notify_one();
+        }
+    };
+
+    template <typename elem_type> class bounded_spsc_buffer_detail : boost::noncopyable{
+    public:
+
+        bounded_spsc_buffer_detail(size_t capacity):
+            _buffer(capacity), _head(0), _tail(0),
+            _push_spins(INITIAL_SPINS), _pop_spins(INITIAL_SPINS)
+        {
+            /* NOP */
+        }
+
+        UHD_INLINE bool push_with_haste(const elem_type &elem){
+            if (not this->try_push(elem)) return false;
+            _pop_waiter.notify();
+            return true;
+        }
+
+        UHD_INLINE void push_with_wait(const elem_type &elem){
+            if (this->push_with_haste(elem)) return;
+            this->wait(&bounded_spsc_buffer_detail::try_push, elem, _push_spins, _push_waiter, _pop_waiter, NULL);
+        }
+
+        UHD_INLINE bool push_with_timed_wait(const elem_type &elem, double timeout){
+            if (this->push_with_haste(elem)) return true;
+            const boost::system_time deadline = boost::get_system_time() + to_time_dur(timeout);
+            return this->wait(&bounded_spsc_buffer_detail::try_push, elem, _push_spins, _push_waiter, _pop_waiter, &deadline);
+        }
+
+        UHD_INLINE bool pop_with_haste(elem_type &elem){
+            if (not this->try_pop(elem)) return false;
+            _push_waiter.notify();
+            return true;
+        }
+
+        UHD_INLINE void pop_with_wait(elem_type &elem){
+            if (this->pop_with_haste(elem)) return;
+            this->wait(&bounded_spsc_buffer_detail::try_pop, elem, _pop_spins, _pop_waiter, _push_waiter, NULL);
+        }
+
+        UHD_INLINE bool pop_with_timed_wait(elem_type &elem, double timeout){
+            if (this->pop_with_haste(elem)) return true;
+            const boost::system_time deadline = boost::get_system_time() + to_time_dur(timeout);
+            return this->wait(&bounded_spsc_buffer_detail::try_pop, elem, _pop_spins, _pop_waiter, _push_waiter, &deadline);
+        }
+
+    private:
+        std::vector<elem_type> _buffer;
+        atomic_uint32_t _size;
+
+        //the head is only touched by the producer, the tail by the consumer
+        size_t _head, _tail;
+
+        //spin budgets adapt to how often spinning succeeds
+        enum{INITIAL_SPINS = 256, MIN_SPINS = 16, MAX_SPINS = 4096, YIELD_SPINS = 64};
+        size_t _push_spins, _pop_spins;
+
+        bounded_spsc_buffer_waiter _push_waiter, _pop_waiter;
+
+        UHD_INLINE bool try_push(const elem_type &elem){
+            if (_size.read() == _buffer.size()) return false;
+            _buffer[_head] = elem;
+            _head = (_head + 1) % _buffer.size();
+            _size.inc(); //full barrier: publishes the element
+            return true;
+        }
+
+        UHD_INLINE bool try_pop(elem_type &elem){
+            if (_size.read() == 0) return false;
+            elem = _buffer[_tail];
+            _buffer[_tail] = elem_type();
+            _tail = (_tail + 1) % _buffer.size();
+            _size.dec(); //full barrier: frees the slot
+            return true;
+        }
+
+        /*!
+         * Retry the operation until it succeeds or the deadline passes:
+         * 1) spin on the operation for the current spin budget,
+         *    yielding the processor after the first few spins
+         * 2) block on the waiter until the other side notifies
+         * Spinning grows the budget when it succeeds and shrinks it when not.
+         * The other side is notified only after our waiter mutex is released,
+         * so that the two sides never hold both mutexes at once.
+         */
+        template <typename arg_type> UHD_INLINE bool wait(
+            bool (bounded_spsc_buffer_detail::*op)(arg_type &),
+            arg_type &arg, size_t &spins,
+            bounded_spsc_buffer_waiter &waiter,
+            bounded_spsc_buffer_waiter &other,
+            const boost::system_time *deadline
+        ){
+            for (size_t i = 0; i < spins; i++){
+                if (i >= YIELD_SPINS) boost::this_thread::yield(); //let the other side run
+                if ((this->*op)(arg)){
+                    spins = std::min<size_t>(spins*2, MAX_SPINS);
+                    other.notify();
+                    return true;
+                }
+            }
+            spins = std::max<size_t>(spins/2, MIN_SPINS);
+
+            bool success = true;
+            {
+                boost::mutex::scoped_lock lock(waiter.mutex);
+                waiter.waiting.swp(1); //full barrier: the other side sees the flag or we see its update
+                while (not (this->*op)(arg)){
+                    if (deadline == NULL) waiter.cond.wait(lock);
+                    else if (not waiter.cond.timed_wait(lock, *deadline)){
+                        success = (this->*op)(arg);
+                        break;
+                    }
+                }
+                waiter.waiting.swp(0);
+            }
+            if (success) other.notify();
+            return success;
+        }
+
+        static UHD_INLINE boost::posix_time::time_duration to_time_dur(double timeout){
+            return boost::posix_time::microseconds(long(timeout*1e6));
+        }
+
+    };
+}}} //namespace
+
+#endif /* INCLUDED_UHD_TRANSPORT_BOUNDED_SPSC_BUFFER_IPP */
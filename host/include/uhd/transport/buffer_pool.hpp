@@ -38,12 +38,14 @@ namespace uhd{ namespace transport{
          * \param num_buffs the number of buffers to allocate
          * \param buff_size the size of each buffer in bytes
          * \param alignment the alignment boundary in bytes
+         * \param huge_pages true to back the pool with huge pages when available
          * \return a new buffer pool buff_size X num_buffs
          */
         static sptr make(
             const size_t num_buffs,
             const size_t buff_size,
-            const size_t alignment = 16
+            const size_t alignment = 16,
+            const bool huge_pages = false
         );
 
         //! Get a pointer to the buffer start at the specified index
@@ -22,6 +22,7 @@
 #include <uhd/transport/zero_copy.hpp>
 #include <uhd/types/device_addr.hpp>
 #include <boost/shared_ptr.hpp>
+#include <string>
 
 namespace uhd{ namespace transport{
 
@@ -58,6 +59,70 @@ public:
         const std::string &port,
         const device_addr_t &hints = device_addr_t()
     );
+
+    /*
+     * The statistics below default to zero for implementations without them.
+     * The counts are kept in 32 bits and wrap around after 2^32,
+     * take the difference of two readings modulo 2^32.
+     */
+
+    /*!
+     * Get the number of receive system calls made so far.
+     * This counts the recv calls and the waits for a ready socket.
+     * Compare with the number of received packets to measure
+     * the syscall overhead, ex: when the recv_batch hint is used.
+     * \return the number of receive syscalls
+     */
+    virtual size_t get_num_recv_syscalls(void) const{return 0;}
+
+    /*!
+     * Get the number of packets received so far.
+     * \return the number of received packets
+     */
+    virtual size_t get_num_recv_packets(void) const{return 0;}
+
+    /*!
+     * Get the receive mode chosen from the transport hints.
+     * The mode is "socket", "batch" (recv_batch) or "ring" (recv_ring),
+     * followed by "+spin" (recv_spin_time) and "+busy_poll" (recv_busy_poll).
+     * \return the receive mode string
+     */
+    virtual std::string get_recv_mode(void) const{return "socket";}
+
+    /*!
+     * Get the number of receives which found a packet while spinning.
+     * Only the low latency mode (recv_spin_time hint) spins.
+     * \return the number of spin hits
+     */
+    virtual size_t get_num_recv_spin_hits(void) const{return 0;}
+
+    /*!
+     * Get the number of receives which spun without a packet
+     * and fell back to a blocking wait.
+     * \return the number of spin misses
+     */
+    virtual size_t get_num_recv_spin_misses(void) const{return 0;}
+
+    /*!
+     * Send all committed buffers that are still queued.
+     * When the send_batch hint is used, committed buffers
+     * are queued and sent together with one syscall.
+     * Call flush to send them immediately, ex: at end of burst.
+     * Without batching, this call does nothing.
+     */
+    virtual void flush_send(void){}
+
+    /*!
+     * Get the number of send system calls made so far.
+     * \return the number of send syscalls
+     */
+    virtual size_t get_num_send_syscalls(void) const{return 0;}
+
+    /*!
+     * Get the number of packets sent so far.
+     * \return the number of sent packets
+     */
+    virtual size_t get_num_send_packets(void) const{return 0;}
 };
 
 }} //namespace
@@ -69,6 +69,7 @@ namespace uhd{
          * - late command
          * - broken chain
          * - overflow
+         * - capture overflow
          */
         enum error_code_t {
             //! No error associated with this metadata.
@@ -84,7 +85,9 @@ namespace uhd{
             //! Multi-channel alignment failed.
             ERROR_CODE_ALIGNMENT    = 0xc,
             //! The packet could not be parsed.
-            ERROR_CODE_BAD_PACKET   = 0xf
+            ERROR_CODE_BAD_PACKET   = 0xf,
+            //! The application fell behind a capture streamer.
+            ERROR_CODE_CAPTURE_OVERFLOW = 0x10
         } error_code;
     };
 
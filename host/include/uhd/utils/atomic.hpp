@@ -0,0 +1,95 @@
+//
+// Copyright 2013 Fairwaves LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_UHD_UTILS_ATOMIC_HPP
+#define INCLUDED_UHD_UTILS_ATOMIC_HPP
+
+#include <uhd/config.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/version.hpp>
+#include <boost/interprocess/detail/atomic.hpp>
+
+#if BOOST_VERSION >= 104800
+#  define BOOST_IPC_DETAIL boost::interprocess::ipcdetail
+#else
+#  define BOOST_IPC_DETAIL boost::interprocess::detail
+#endif
+
+namespace uhd{
+
+    /*!
+     * A 32-bit integer that can be atomically accessed across threads.
+     * The read-modify-write operations (cas, swp, inc, dec, add)
+     * are full memory barriers on all supported platforms.
+     */
+    class atomic_uint32_t{
+    public:
+
+        //! Create a new atomic 32-bit integer, initially zero
+        UHD_INLINE atomic_uint32_t(void){
+            this->write(0);
+        }
+
+        //! Compare with cmp, swap with newval if same, return old value
+        UHD_INLINE boost::uint32_t cas(boost::uint32_t newval, boost::uint32_t cmp){
+            return BOOST_IPC_DETAIL::atomic_cas32(&_num, newval, cmp);
+        }
+
+        //! Sets the atomic integer to a new value, return old value
+        UHD_INLINE boost::uint32_t swp(boost::uint32_t newval){
+            boost::uint32_t oldval;
+            do{
+                oldval = this->read();
+            } while (this->cas(newval, oldval) != oldval);
+            return oldval;
+        }
+
+        //! Increment by 1 and return the old value
+        UHD_INLINE boost::uint32_t inc(void){
+            return BOOST_IPC_DETAIL::atomic_inc32(&_num);
+        }
+
+        //! Decrement by 1 and return the old value
+        UHD_INLINE boost::uint32_t dec(void){
+            return BOOST_IPC_DETAIL::atomic_dec32(&_num);
+        }
+
+        //! Add a value and return the old value
+        UHD_INLINE boost::uint32_t add(boost::uint32_t val){
+            boost::uint32_t oldval;
+            do{
+                oldval = this->read();
+            } while (this->cas(oldval + val, oldval) != oldval);
+            return oldval;
+        }
+
+        //! Get the current value of the atomic integer
+        UHD_INLINE boost::uint32_t read(void){
+            return BOOST_IPC_DETAIL::atomic_read32(&_num);
+        }
+
+        //! Set the atomic integer to a new value
+        UHD_INLINE void write(boost::uint32_t newval){
+            BOOST_IPC_DETAIL::atomic_write32(&_num, newval);
+        }
+
+    private: volatile boost::uint32_t _num;
+    };
+
+} //namespace uhd
+
+#endif /* INCLUDED_UHD_UTILS_ATOMIC_HPP */
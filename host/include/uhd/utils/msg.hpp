@@ -59,6 +59,23 @@ namespace uhd{ namespace msg{
      */
     UHD_API void register_handler(const handler_t &handler);
 
+    /*!
+     * Post a fast-path event character, Ex: "O" for an overflow.
+     * The streaming threads only count the character, without locking.
+     * A reporter thread with normal priority hands the characters
+     * to the message handler as fastpath messages, every few milliseconds.
+     * \param ch the event character
+     */
+    UHD_API void post_fastpath(const char ch);
+
+    /*!
+     * Turn the fast-path character reports on or off.
+     * Off, post_fastpath() does nothing and the reporter thread is not started.
+     * They are on by default.
+     * \param enb true to report the fast-path characters
+     */
+    UHD_API void set_fastpath_enabled(const bool enb);
+
     //! Internal message object (called by UHD_MSG macro)
     class UHD_API _msg{
     public:
@@ -23,7 +23,7 @@
 #include <boost/cstdint.hpp>
 #include <complex>
 
-#define _DECLARE_CONVERTER(name, in_form, num_in, out_form, num_out, prio) \
+#define _DECLARE_CONVERTER(name, in_form, num_in, out_form, num_out, prio, cond) \
     struct name : public uhd::convert::converter{ \
         static sptr make(void){return sptr(new name());} \
         double scale_factor; \
@@ -31,6 +31,7 @@
         void operator()(const input_type&, const output_type&, const size_t); \
     }; \
     UHD_STATIC_BLOCK(__register_##name##_##prio){ \
+        if (not (cond)) return; \
         uhd::convert::id_type id; \
         id.input_format = #in_form; \
         id.num_inputs = num_in; \
@@ -43,7 +44,75 @@
     )
 
 #define DECLARE_CONVERTER(in_form, num_in, out_form, num_out, prio) \
-    _DECLARE_CONVERTER(__convert_##in_form##_##num_in##_##out_form##_##num_out##_##prio, in_form, num_in, out_form, num_out, prio)
+    _DECLARE_CONVERTER(__convert_##in_form##_##num_in##_##out_form##_##num_out##_##prio, in_form, num_in, out_form, num_out, prio, true)
+
+//! Declare a converter that is only registered when cond holds at runtime (ex: a cpu feature)
+#define DECLARE_CONVERTER_IF(in_form, num_in, out_form, num_out, prio, cond) \
+    _DECLARE_CONVERTER(__convert_##in_form##_##num_in##_##out_form##_##num_out##_##prio, in_form, num_in, out_form, num_out, prio, cond)
+
+/***********************************************************************
+ * Correcting converters (see uhd::convert::correction_type)
+ *   The scale factor, gain, IQ matrix and dc offset fold into
+ *   one affine map of the integer samples, applied in the same pass:
+ *     out_i = ii*i + iq*q + off_i
+ *     out_q = qi*i + qq*q + off_q
+ **********************************************************************/
+struct correcting_converter : public uhd::convert::converter{
+    correcting_converter(void): scale_factor(1.0){
+        this->update();
+    }
+
+    void set_scalar(const double s){
+        scale_factor = s;
+        this->update();
+    }
+
+    bool set_correction(const uhd::convert::correction_type &c){
+        correction = c;
+        this->update();
+        return true;
+    }
+
+    void update(void){
+        const double g = correction.gain;
+        const double (&m)[2][2] = correction.matrix;
+        const std::complex<double> &dc = correction.dc_offset;
+        ii = float(g*m[0][0]*scale_factor);
+        iq = float(g*m[0][1]*scale_factor);
+        qi = float(g*m[1][0]*scale_factor);
+        qq = float(g*m[1][1]*scale_factor);
+        off_i = float(-g*(m[0][0]*dc.real() + m[0][1]*dc.imag()));
+        off_q = float(-g*(m[1][0]*dc.real() + m[1][1]*dc.imag()));
+    }
+
+    double scale_factor;
+    uhd::convert::correction_type correction;
+    float ii, iq, qi, qq, off_i, off_q;
+};
+
+#define _DECLARE_CORRECTING_CONVERTER(name, in_form, out_form, prio, cond) \
+    struct name : public correcting_converter{ \
+        static sptr make(void){return sptr(new name());} \
+        void operator()(const input_type&, const output_type&, const size_t); \
+    }; \
+    UHD_STATIC_BLOCK(__register_##name##_##prio){ \
+        if (not (cond)) return; \
+        uhd::convert::id_type id; \
+        id.input_format = #in_form; \
+        id.num_inputs = 1; \
+        id.output_format = #out_form; \
+        id.num_outputs = 1; \
+        uhd::convert::register_correcting_converter(id, &name::make, prio); \
+    } \
+    void name::operator()( \
+        const input_type &inputs, const output_type &outputs, const size_t nsamps \
+    )
+
+#define DECLARE_CORRECTING_CONVERTER(in_form, out_form, prio) \
+    _DECLARE_CORRECTING_CONVERTER(__correct_##in_form##_##out_form##_##prio, in_form, out_form, prio, true)
+
+#define DECLARE_CORRECTING_CONVERTER_IF(in_form, out_form, prio, cond) \
+    _DECLARE_CORRECTING_CONVERTER(__correct_##in_form##_##out_form##_##prio, in_form, out_form, prio, cond)
 
 /***********************************************************************
  * Setup priorities
@@ -55,10 +124,37 @@ static const int PRIORITY_EMPTY = -1;
 static const int PRIORITY_LIBORC = 3;
 static const int PRIORITY_SIMD = 1; //neon conversions could be implemented better, orc wins
 static const int PRIORITY_TABLE = 2; //tables require large cache, so they are slower on arm
+static const int PRIORITY_TABLE_SC8 = PRIORITY_TABLE;
 #else
 static const int PRIORITY_LIBORC = 1;
 static const int PRIORITY_SIMD = 2;
 static const int PRIORITY_TABLE = 3;
+static const int PRIORITY_TABLE_SC8 = 1; //512 KiB and up, the sse2 unpack wins (no orc sc8)
+#endif
+
+//wider x86 SIMD, only registered when the cpu supports it
+static const int PRIORITY_SIMD_AVX2 = 4;
+static const int PRIORITY_SIMD_AVX512 = 5;
+
+/***********************************************************************
+ * Runtime cpu feature checks (cpuid + enabled OS register state)
+ **********************************************************************/
+bool convert_cpu_has_avx2(void);
+bool convert_cpu_has_avx512bw(void);
+
+/***********************************************************************
+ * Instruction sets for the avx2 and avx-512 kernels:
+ *   Only the kernel functions are built for the wider instructions,
+ *   the converters around them, their registration and the inline
+ *   helpers they share with other files run on any cpu.
+ *   MSVC takes the intrinsics without an attribute.
+ **********************************************************************/
+#if defined(__GNUG__)
+    #define CONVERT_TARGET_AVX2     __attribute__((target("avx2")))
+    #define CONVERT_TARGET_AVX512BW __attribute__((target("avx512f,avx512bw")))
+#else
+    #define CONVERT_TARGET_AVX2
+    #define CONVERT_TARGET_AVX512BW
 #endif
 
 /***********************************************************************
@@ -115,6 +211,12 @@ static UHD_INLINE fc32_t item32_sc16_to_fc32(item32_t item, double scale_factor)
     );
 }
 
+static UHD_INLINE fc32_t item32_sc16_to_fc32(item32_t item, const correcting_converter &c){
+    const float i = float(boost::int16_t(item >> 16));
+    const float q = float(boost::int16_t(item >> 0));
+    return fc32_t(c.ii*i + c.iq*q + c.off_i, c.qi*i + c.qq*q + c.off_q);
+}
+
 /***********************************************************************
  * Convert complex double buffer to items32 sc16
  **********************************************************************/
@@ -181,13 +283,162 @@ static UHD_INLINE void item32_sc8_to_fc32(item32_t item, fc32_t &out0, fc32_t &o
  **********************************************************************/
 static UHD_INLINE void item32_sc8_to_fc64(item32_t item, fc64_t &out0, fc64_t &out1, double scale_factor){
     out0 = fc64_t(
-        float(boost::int8_t(item >> 8)*scale_factor),
-        float(boost::int8_t(item >> 0)*scale_factor)
+        boost::int8_t(item >> 8)*scale_factor,
+        boost::int8_t(item >> 0)*scale_factor
     );
     out1 = fc64_t(
-        float(boost::int8_t(item >> 24)*scale_factor),
-        float(boost::int8_t(item >> 16)*scale_factor)
+        boost::int8_t(item >> 24)*scale_factor,
+        boost::int8_t(item >> 16)*scale_factor
     );
 }
 
+/***********************************************************************
+ * Convert complex char buffer to items32 sc8
+ **********************************************************************/
+static UHD_INLINE item32_t sc8_to_item32_sc8(sc8_t in0, sc8_t in1, double){
+    boost::uint8_t real0 = boost::int8_t(in0.real());
+    boost::uint8_t imag0 = boost::int8_t(in0.imag());
+    boost::uint8_t real1 = boost::int8_t(in1.real());
+    boost::uint8_t imag1 = boost::int8_t(in1.imag());
+    return
+        (item32_t(real0) << 8) | (item32_t(imag0) << 0) |
+        (item32_t(real1) << 24) | (item32_t(imag1) << 16)
+    ;
+}
+
+/***********************************************************************
+ * Convert complex short buffer to items32 sc8
+ **********************************************************************/
+static UHD_INLINE item32_t sc16_to_item32_sc8(sc16_t in0, sc16_t in1, double){
+    boost::uint8_t real0 = boost::int8_t(in0.real());
+    boost::uint8_t imag0 = boost::int8_t(in0.imag());
+    boost::uint8_t real1 = boost::int8_t(in1.real());
+    boost::uint8_t imag1 = boost::int8_t(in1.imag());
+    return
+        (item32_t(real0) << 8) | (item32_t(imag0) << 0) |
+        (item32_t(real1) << 24) | (item32_t(imag1) << 16)
+    ;
+}
+
+/***********************************************************************
+ * Convert complex float buffer to items32 sc8
+ **********************************************************************/
+static UHD_INLINE item32_t fc32_to_item32_sc8(fc32_t in0, fc32_t in1, double scale_factor){
+    boost::uint8_t real0 = boost::int8_t(in0.real()*float(scale_factor));
+    boost::uint8_t imag0 = boost::int8_t(in0.imag()*float(scale_factor));
+    boost::uint8_t real1 = boost::int8_t(in1.real()*float(scale_factor));
+    boost::uint8_t imag1 = boost::int8_t(in1.imag()*float(scale_factor));
+    return
+        (item32_t(real0) << 8) | (item32_t(imag0) << 0) |
+        (item32_t(real1) << 24) | (item32_t(imag1) << 16)
+    ;
+}
+
+/***********************************************************************
+ * Convert complex double buffer to items32 sc8
+ **********************************************************************/
+static UHD_INLINE item32_t fc64_to_item32_sc8(fc64_t in0, fc64_t in1, double scale_factor){
+    boost::uint8_t real0 = boost::int8_t(in0.real()*scale_factor);
+    boost::uint8_t imag0 = boost::int8_t(in0.imag()*scale_factor);
+    boost::uint8_t real1 = boost::int8_t(in1.real()*scale_factor);
+    boost::uint8_t imag1 = boost::int8_t(in1.imag()*scale_factor);
+    return
+        (item32_t(real0) << 8) | (item32_t(imag0) << 0) |
+        (item32_t(real1) << 24) | (item32_t(imag1) << 16)
+    ;
+}
+
+/***********************************************************************
+ * sc12 packs 4 samples in 3 items, msb first: I0 Q0 I1 | Q1 I2 Q2 | I3 Q3
+ *   The values are the upper 12 bits of sc16 samples, so sc12 uses the
+ *   sc16 scaling and sc16 host samples keep their range.
+ *   Samples are 3 bytes apart from the word aligned start of a group,
+ *   so the address of a sample gives its position in the group.
+ **********************************************************************/
+static UHD_INLINE size_t sc12_phase(const void *p){
+    return (4 - (size_t(p) & 0x3)) & 0x3;
+}
+
+static UHD_INLINE void item32_sc12_unpack(const item32_t line[3], boost::int16_t iq[8]){
+    iq[0] = boost::int16_t((line[0] >> 16) & 0xfff0);
+    iq[1] = boost::int16_t((line[0] >> 4) & 0xfff0);
+    iq[2] = boost::int16_t(((line[0] << 8) | (line[1] >> 24)) & 0xfff0);
+    iq[3] = boost::int16_t((line[1] >> 12) & 0xfff0);
+    iq[4] = boost::int16_t((line[1] >> 0) & 0xfff0);
+    iq[5] = boost::int16_t(((line[1] << 12) | (line[2] >> 20)) & 0xfff0);
+    iq[6] = boost::int16_t((line[2] >> 8) & 0xfff0);
+    iq[7] = boost::int16_t((line[2] << 4) & 0xfff0);
+}
+
+static UHD_INLINE void item32_sc12_pack(const boost::int16_t iq[8], item32_t line[3]){
+    item32_t v[8];
+    for (size_t j = 0; j < 8; j++) v[j] = item32_t(boost::uint16_t(iq[j]) >> 4);
+    line[0] = (v[0] << 20) | (v[1] << 8) | (v[2] >> 4);
+    line[1] = (v[2] << 28) | (v[3] << 16) | (v[4] << 4) | (v[5] >> 8);
+    line[2] = (v[5] << 24) | (v[6] << 12) | (v[7] << 0);
+}
+
+static UHD_INLINE void sc12_to_cpu(boost::int16_t i, boost::int16_t q, sc16_t &out, double){
+    out = sc16_t(i, q);
+}
+
+static UHD_INLINE void sc12_to_cpu(boost::int16_t i, boost::int16_t q, fc32_t &out, double scale_factor){
+    out = fc32_t(float(i*float(scale_factor)), float(q*float(scale_factor)));
+}
+
+static UHD_INLINE void sc12_to_cpu(boost::int16_t i, boost::int16_t q, fc64_t &out, double scale_factor){
+    out = fc64_t(i*scale_factor, q*scale_factor);
+}
+
+static UHD_INLINE void cpu_to_sc12(const sc16_t &in, boost::int16_t &i, boost::int16_t &q, double){
+    i = in.real();
+    q = in.imag();
+}
+
+static UHD_INLINE void cpu_to_sc12(const fc32_t &in, boost::int16_t &i, boost::int16_t &q, double scale_factor){
+    i = boost::int16_t(in.real()*float(scale_factor));
+    q = boost::int16_t(in.imag()*float(scale_factor));
+}
+
+static UHD_INLINE void cpu_to_sc12(const fc64_t &in, boost::int16_t &i, boost::int16_t &q, double scale_factor){
+    i = boost::int16_t(in.real()*scale_factor);
+    q = boost::int16_t(in.imag()*scale_factor);
+}
+
+typedef item32_t (*swap32_type)(item32_t);
+
+//! Convert the samples k to k+n of a group, only reading the items that hold them
+template <typename type, swap32_type to_host>
+static UHD_INLINE void item32_sc12_group_to_cpu(
+    const item32_t *group, const size_t k, const size_t n, type *output, const double scale_factor
+){
+    item32_t line[3] = {0, 0, 0};
+    for (size_t j = (3*k)/4; j < (3*(k+n) + 3)/4; j++) line[j] = to_host(group[j]);
+    boost::int16_t iq[8];
+    item32_sc12_unpack(line, iq);
+    for (size_t j = 0; j < n; j++) sc12_to_cpu(iq[2*(k+j)], iq[2*(k+j)+1], output[j], scale_factor);
+}
+
+//! Write the samples k to k+n of a group, keeping the other samples in the same items
+template <typename type, swap32_type to_host, swap32_type to_wire>
+static UHD_INLINE void cpu_to_item32_sc12_group(
+    const type *input, const size_t k, const size_t n, item32_t *group, const double scale_factor
+){
+    boost::int16_t iq[8];
+    item32_t line[3] = {0, 0, 0};
+    if (n == 4){ //whole group, nothing to keep
+        for (size_t j = 0; j < 4; j++) cpu_to_sc12(input[j], iq[2*j], iq[2*j+1], scale_factor);
+        item32_sc12_pack(iq, line);
+        for (size_t j = 0; j < 3; j++) group[j] = to_wire(line[j]);
+        return;
+    }
+
+    const size_t first = (3*k)/4, last = (3*(k+n) + 3)/4;
+    for (size_t j = first; j < last; j++) line[j] = to_host(group[j]);
+    item32_sc12_unpack(line, iq);
+    for (size_t j = 0; j < n; j++) cpu_to_sc12(input[j], iq[2*(k+j)], iq[2*(k+j)+1], scale_factor);
+    item32_sc12_pack(iq, line);
+    for (size_t j = first; j < last; j++) group[j] = to_wire(line[j]);
+}
+
 #endif /* INCLUDED_LIBUHD_CONVERT_COMMON_HPP */
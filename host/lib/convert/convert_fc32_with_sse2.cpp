@@ -194,3 +194,70 @@ DECLARE_CONVERTER(sc16_item32_be, 1, fc32, 1, PRIORITY_SIMD){
         output[i] = item32_sc16_to_fc32(uhd::byteswap(input[i]), float(scale_factor));
     }
 }
+
+/***********************************************************************
+ * sc16 item32 -> fc32 with a correction (see convert_common.hpp)
+ *   The samples are converted as in the converters above, the affine
+ *   map then takes a multiply by the I,Q coefficients, a multiply by
+ *   the swapped Q,I coefficients on the swapped samples and an add.
+ **********************************************************************/
+#define convert_item32_1_to_fc32_1_correct_guts(_al_, _swap_)          \
+    for (; i+4 < nsamps; i+=4){                                         \
+        /* load from input */                                           \
+        __m128i tmpi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)); \
+                                                                        \
+        /* unpack to host order 16 bit words */                         \
+        tmpi = _swap_(tmpi);                                            \
+        __m128i tmpilo = _mm_unpacklo_epi16(zeroi, tmpi); /* value in upper 16 bits */ \
+        __m128i tmpihi = _mm_unpackhi_epi16(zeroi, tmpi);               \
+                                                                        \
+        /* convert and correct */                                       \
+        __m128 tmplo = _mm_cvtepi32_ps(tmpilo);                         \
+        __m128 tmphi = _mm_cvtepi32_ps(tmpihi);                         \
+        tmplo = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tmplo, diag),          \
+            _mm_mul_ps(_mm_shuffle_ps(tmplo, tmplo, _MM_SHUFFLE(2, 3, 0, 1)), cross)), offset); \
+        tmphi = _mm_add_ps(_mm_add_ps(_mm_mul_ps(tmphi, diag),          \
+            _mm_mul_ps(_mm_shuffle_ps(tmphi, tmphi, _MM_SHUFFLE(2, 3, 0, 1)), cross)), offset); \
+                                                                        \
+        /* store to output */                                           \
+        _mm_store ## _al_ ## ps(reinterpret_cast<float *>(output+i+0), tmplo); \
+        _mm_store ## _al_ ## ps(reinterpret_cast<float *>(output+i+2), tmphi); \
+    }                                                                   \
+
+static UHD_INLINE __m128i sse2_swap_nswap(const __m128i tmpi){
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(tmpi, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+static UHD_INLINE __m128i sse2_swap_bswap(const __m128i tmpi){
+    return _mm_or_si128(_mm_srli_epi16(tmpi, 8), _mm_slli_epi16(tmpi, 8));
+}
+
+#define DECLARE_SSE2_CORRECTING(end, to_host, swap) \
+    DECLARE_CORRECTING_CONVERTER(sc16_item32_ ## end, fc32, PRIORITY_SIMD){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]); \
+        fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]); \
+        \
+        /* the samples come in the upper 16 bits */ \
+        const float u = 1.0f/(1 << 16); \
+        const __m128 diag = _mm_setr_ps(ii*u, qq*u, ii*u, qq*u); \
+        const __m128 cross = _mm_setr_ps(iq*u, qi*u, iq*u, qi*u); \
+        const __m128 offset = _mm_setr_ps(off_i, off_q, off_i, off_q); \
+        const __m128i zeroi = _mm_setzero_si128(); \
+        \
+        size_t i = 0; \
+        switch (size_t(output) & 0xf){ \
+        case 0x8: \
+            output[i] = item32_sc16_to_fc32(to_host(input[i]), *this); i++; \
+        case 0x0: \
+            convert_item32_1_to_fc32_1_correct_guts(_, swap) \
+            break; \
+        default: convert_item32_1_to_fc32_1_correct_guts(u_, swap) \
+        } \
+        \
+        for (; i < nsamps; i++){ \
+            output[i] = item32_sc16_to_fc32(to_host(input[i]), *this); \
+        } \
+    }
+
+DECLARE_SSE2_CORRECTING(le, uhd::wtohx, sse2_swap_nswap)
+DECLARE_SSE2_CORRECTING(be, uhd::ntohx, sse2_swap_bswap)
@@ -15,13 +15,26 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+#include "convert_common.hpp"
 #include <uhd/convert.hpp>
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/static.hpp>
+#include <uhd/utils/paths.hpp>
 #include <uhd/types/dict.hpp>
+#include <uhd/types/time_spec.hpp>
 #include <uhd/exception.hpp>
 #include <boost/cstdint.hpp>
 #include <boost/format.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstdio>
 #include <complex>
 
 using namespace uhd;
@@ -50,19 +63,15 @@ std::string convert::id_type::to_pp_string(void) const{
     );
 }
 
-/***********************************************************************
- * Define types for the function tables
- **********************************************************************/
-struct fcn_table_entry_type{
-    convert::priority_type prio;
-    convert::function_type fcn;
-};
-
 /***********************************************************************
  * Setup the table registry
+ *   Every registered priority is kept so that a specific
+ *   implementation can be requested (tests and benchmarks).
  **********************************************************************/
-typedef uhd::dict<convert::id_type, fcn_table_entry_type> fcn_table_type;
+typedef uhd::dict<convert::priority_type, convert::function_type> fcn_prio_table_type;
+typedef uhd::dict<convert::id_type, fcn_prio_table_type> fcn_table_type;
 UHD_SINGLETON_FCN(fcn_table_type, get_table);
+UHD_SINGLETON_FCN(fcn_table_type, get_correcting_table);
 
 /***********************************************************************
  * The registry functions
@@ -75,11 +84,9 @@ void uhd::convert::register_converter(
     //get a reference to the function table
     fcn_table_type &table = get_table();
 
-    //register the function if higher priority
-    if (not table.has_key(id) or table[id].prio < prio){
-        table[id].fcn = fcn;
-        table[id].prio = prio;
-    }
+    //register the function for this priority
+    if (not table.has_key(id)) table[id] = fcn_prio_table_type();
+    table[id][prio] = fcn;
 
     //----------------------------------------------------------------//
     UHD_LOGV(always) << "register_converter: " << id.to_pp_string() << std::endl
@@ -89,12 +96,348 @@ void uhd::convert::register_converter(
     //----------------------------------------------------------------//
 }
 
+void uhd::convert::register_correcting_converter(
+    const id_type &id,
+    const function_type &fcn,
+    const priority_type prio
+){
+    fcn_table_type &table = get_correcting_table();
+    if (not table.has_key(id)) table[id] = fcn_prio_table_type();
+    table[id][prio] = fcn;
+
+    //----------------------------------------------------------------//
+    UHD_LOGV(always) << "register_correcting_converter: " << id.to_pp_string() << std::endl
+        << "    prio: " << prio << std::endl
+        << std::endl
+    ;
+    //----------------------------------------------------------------//
+}
+
+static bool autotune_enabled(void);
+static convert::priority_type autotune_priority(const convert::id_type &id);
+
 /***********************************************************************
  * The converter functions
  **********************************************************************/
+convert::function_type convert::get_converter(const id_type &id, const priority_type prio){
+    if (not get_table().has_key(id)) throw uhd::key_error(
+        "Cannot find a conversion routine for " + id.to_pp_string());
+    const fcn_prio_table_type &prios = get_table()[id];
+    if (prios.has_key(prio)) return prios[prio];
+    throw uhd::key_error(str(boost::format(
+        "Cannot find a conversion routine with priority %d for %s"
+    ) % prio % id.to_pp_string()));
+}
+
 convert::function_type convert::get_converter(const id_type &id){
-    if (get_table().has_key(id)) return get_table()[id].fcn;
-    throw uhd::key_error("Cannot find a conversion routine for " + id.to_pp_string());
+    if (not get_table().has_key(id)) throw uhd::key_error(
+        "Cannot find a conversion routine for " + id.to_pp_string());
+    const fcn_prio_table_type &prios = get_table()[id];
+
+    //the fastest measured converter when autotuning
+    if (autotune_enabled() and prios.size() > 1){
+        return prios[autotune_priority(id)];
+    }
+
+    //otherwise find the highest priority
+    priority_type best = prios.keys().front();
+    BOOST_FOREACH(const priority_type p, prios.keys()){
+        if (p > best) best = p;
+    }
+    return prios[best];
+}
+
+std::vector<convert::priority_type> convert::get_converter_priorities(const id_type &id){
+    if (not get_table().has_key(id)) return std::vector<priority_type>();
+    return get_table()[id].keys();
+}
+
+convert::function_type convert::get_correcting_converter(const id_type &id, const priority_type prio){
+    if (not get_correcting_table().has_key(id)) throw uhd::key_error(
+        "Cannot find a correcting conversion routine for " + id.to_pp_string());
+    const fcn_prio_table_type &prios = get_correcting_table()[id];
+
+    //a specific priority was requested
+    if (prio != -1){
+        if (prios.has_key(prio)) return prios[prio];
+        throw uhd::key_error(str(boost::format(
+            "Cannot find a correcting conversion routine with priority %d for %s"
+        ) % prio % id.to_pp_string()));
+    }
+
+    priority_type best = prios.keys().front();
+    BOOST_FOREACH(const priority_type p, prios.keys()){
+        if (p > best) best = p;
+    }
+    return prios[best];
+}
+
+std::vector<convert::priority_type> convert::get_correcting_converter_priorities(const id_type &id){
+    if (not get_correcting_table().has_key(id)) return std::vector<priority_type>();
+    return get_correcting_table()[id].keys();
+}
+
+std::vector<convert::id_type> convert::get_converter_ids(void){
+    return get_table().keys();
+}
+
+/***********************************************************************
+ * Runtime cpu feature checks
+ *   The instruction set is only usable when the OS saves the wider
+ *   registers on context switch, so XCR0 is checked as well.
+ **********************************************************************/
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+
+static void convert_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]){
+    if (__get_cpuid_max(leaf & 0x80000000, 0) < leaf){
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+        return;
+    }
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static boost::uint64_t convert_xgetbv(void){
+    unsigned lo, hi;
+    __asm__ __volatile__ (".byte 0x0f, 0x01, 0xd0" : "=a"(lo), "=d"(hi) : "c"(0));
+    return (boost::uint64_t(hi) << 32) | lo;
+}
+#define HAVE_CONVERT_CPUID
+
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+
+static void convert_cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]){
+    int r[4];
+    __cpuid(r, int(leaf & 0x80000000));
+    if (unsigned(r[0]) < leaf){
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+        return;
+    }
+    __cpuidex(r, leaf, subleaf);
+    for (size_t i = 0; i < 4; i++) regs[i] = unsigned(r[i]);
+}
+
+static boost::uint64_t convert_xgetbv(void){
+    return _xgetbv(0);
+}
+#define HAVE_CONVERT_CPUID
+#endif
+
+#ifdef HAVE_CONVERT_CPUID
+//bits of XCR0 for the SSE, AVX and AVX-512 register state
+static const boost::uint64_t XCR0_YMM = 0x06;
+static const boost::uint64_t XCR0_ZMM = 0xe6;
+
+static bool convert_os_saves(const boost::uint64_t mask){
+    unsigned regs[4];
+    convert_cpuid(1, 0, regs);
+    if ((regs[2] & (1 << 27)) == 0) return false; //OSXSAVE
+    return (convert_xgetbv() & mask) == mask;
+}
+
+bool convert_cpu_has_avx2(void){
+    unsigned regs[4];
+    convert_cpuid(7, 0, regs);
+    return (regs[1] & (1 << 5)) != 0 and convert_os_saves(XCR0_YMM);
+}
+
+bool convert_cpu_has_avx512bw(void){
+    unsigned regs[4];
+    convert_cpuid(7, 0, regs);
+    const unsigned avx512f = 1 << 16, avx512bw = 1 << 30;
+    return (regs[1] & (avx512f | avx512bw)) == (avx512f | avx512bw) and convert_os_saves(XCR0_ZMM);
+}
+
+//the brand string identifies the machine in the autotune cache
+static std::string convert_cpu_name(void){
+    unsigned regs[4];
+    convert_cpuid(0x80000000, 0, regs);
+    if (regs[0] < 0x80000004) return "unknown";
+    std::string name;
+    for (unsigned leaf = 0x80000002; leaf <= 0x80000004; leaf++){
+        convert_cpuid(leaf, 0, regs);
+        name.append(reinterpret_cast<const char *>(regs), sizeof(regs));
+    }
+    name = name.c_str(); //strip the padding nulls
+    boost::algorithm::trim(name);
+    return name;
+}
+
+#else
+bool convert_cpu_has_avx2(void){return false;}
+bool convert_cpu_has_avx512bw(void){return false;}
+static std::string convert_cpu_name(void){return "unknown";}
+#endif
+
+/***********************************************************************
+ * Converter autotuning
+ *   Every candidate for a conversion is timed on first use,
+ *   and the fastest is remembered for the process and on disk.
+ *   The disk cache is a text file with a line for the cpu name
+ *   followed by one line per conversion:
+ *   <in format> <num in> <out format> <num out> <candidates> <choice>
+ *   Entries are measured again when the candidates change.
+ **********************************************************************/
+static const size_t AUTOTUNE_MAX_PACKET_BYTES = 65536; //more than any udp packet
+static const size_t AUTOTUNE_RUNS = 5;
+
+struct autotune_entry{
+    std::string candidates;
+    convert::priority_type choice;
+};
+typedef uhd::dict<convert::id_type, autotune_entry> autotune_table_type;
+
+static bool autotune_enabled(void){
+    const char *env = std::getenv("UHD_CONVERT_AUTOTUNE");
+    return env != NULL and std::string(env) != "0";
+}
+
+#ifdef UHD_PLATFORM_WIN32
+#include <process.h>
+static unsigned long autotune_process_id(void){return _getpid();}
+#else
+#include <unistd.h>
+static unsigned long autotune_process_id(void){return getpid();}
+#endif
+
+static boost::filesystem::path autotune_cache_path(void){
+    return boost::filesystem::path(uhd::get_app_path()) / ".uhd" / "convert_autotune.txt";
+}
+
+static std::string autotune_candidates(const convert::id_type &id){
+    std::vector<convert::priority_type> prios = convert::get_converter_priorities(id);
+    std::sort(prios.begin(), prios.end());
+    std::string candidates;
+    BOOST_FOREACH(const convert::priority_type p, prios){
+        if (not candidates.empty()) candidates += ",";
+        candidates += boost::lexical_cast<std::string>(p);
+    }
+    return candidates;
+}
+
+static autotune_table_type autotune_load(void){
+    autotune_table_type table;
+    std::ifstream file(autotune_cache_path().string().c_str());
+    std::string line;
+    if (not std::getline(file, line) or line != "cpu " + convert_cpu_name()) return table;
+    while (std::getline(file, line)){
+        std::istringstream ss(line);
+        convert::id_type id;
+        autotune_entry entry;
+        if (ss >> id.input_format >> id.num_inputs >> id.output_format
+               >> id.num_outputs >> entry.candidates >> entry.choice
+        ) table[id] = entry;
+    }
+    return table;
+}
+
+//written to a file of this process and renamed, so a reader never sees a partial cache
+static void autotune_save(autotune_table_type &table){
+    const std::string path = autotune_cache_path().string();
+    const std::string tmp_path = path + ".tmp" + boost::lexical_cast<std::string>(autotune_process_id());
+    try{
+        boost::filesystem::create_directories(autotune_cache_path().parent_path());
+        {
+            std::ofstream file(tmp_path.c_str());
+            file << "cpu " << convert_cpu_name() << std::endl;
+            BOOST_FOREACH(const convert::id_type &id, table.keys()){
+                file << id.input_format << " " << id.num_inputs << " "
+                     << id.output_format << " " << id.num_outputs << " "
+                     << table[id].candidates << " " << table[id].choice << std::endl;
+            }
+            file.close();
+            if (file.fail()) throw uhd::io_error("cannot write " + tmp_path);
+        }
+        if (std::rename(tmp_path.c_str(), path.c_str()) != 0){
+            std::remove(path.c_str()); //windows does not replace an existing file
+            if (std::rename(tmp_path.c_str(), path.c_str()) != 0) throw uhd::io_error("cannot rename " + tmp_path);
+        }
+    }
+    catch(const std::exception &e){
+        std::remove(tmp_path.c_str());
+        UHD_LOG << "convert autotune: cannot save the cache: " << e.what() << std::endl;
+    }
+}
+
+//random samples, floats are kept in [-1, 1) so no slow denormal or nan path is timed
+static void autotune_fill(const std::string &format, std::vector<char> &mem){
+    if (format.find("fc32") == 0){
+        float *p = reinterpret_cast<float *>(&mem.front());
+        for (size_t i = 0; i < mem.size()/sizeof(float); i++) p[i] = std::rand()/float(RAND_MAX/2) - 1;
+    }
+    else if (format.find("fc64") == 0){
+        double *p = reinterpret_cast<double *>(&mem.front());
+        for (size_t i = 0; i < mem.size()/sizeof(double); i++) p[i] = std::rand()/double(RAND_MAX/2) - 1;
+    }
+    else{
+        for (size_t i = 0; i < mem.size(); i++) mem[i] = char(std::rand());
+    }
+}
+
+//the best time per sample over several runs of a converter
+static double autotune_time(const convert::id_type &id, const convert::priority_type prio){
+    //as many samples as the largest packet holds, so any device's spp is covered
+    const size_t in_item_bytes = convert::get_bytes_per_item(id.input_format);
+    const size_t out_item_bytes = convert::get_bytes_per_item(id.output_format);
+    const size_t nsamps = AUTOTUNE_MAX_PACKET_BYTES/std::min(in_item_bytes, out_item_bytes);
+
+    //interleaved formats hold every channel in one buffer,
+    //plus some slack for converters that read past an odd tail
+    const size_t nchans = std::max(id.num_inputs, id.num_outputs);
+    const size_t in_bytes = in_item_bytes*nsamps*nchans + 16;
+    const size_t out_bytes = out_item_bytes*nsamps*nchans + 16;
+    std::vector<std::vector<char> > in_mem(id.num_inputs, std::vector<char>(in_bytes));
+    std::vector<std::vector<char> > out_mem(id.num_outputs, std::vector<char>(out_bytes));
+    std::vector<const void *> inputs;
+    std::vector<void *> outputs;
+    for (size_t i = 0; i < id.num_inputs; i++){
+        autotune_fill(id.input_format, in_mem[i]);
+        inputs.push_back(&in_mem[i].front());
+    }
+    for (size_t i = 0; i < id.num_outputs; i++) outputs.push_back(&out_mem[i].front());
+
+    convert::converter::sptr c = get_table()[id][prio]();
+    c->set_scalar(1.0);
+    c->conv(inputs, outputs, nsamps); //warm up the caches
+
+    double best = 0;
+    for (size_t run = 0; run < AUTOTUNE_RUNS; run++){
+        const time_spec_t start = time_spec_t::get_system_time();
+        c->conv(inputs, outputs, nsamps);
+        const double secs = (time_spec_t::get_system_time() - start).get_real_secs();
+        if (run == 0 or secs < best) best = secs;
+    }
+    return best/nsamps;
+}
+
+UHD_SINGLETON_FCN(boost::mutex, get_autotune_mutex);
+
+static convert::priority_type autotune_priority(const convert::id_type &id){
+    boost::mutex::scoped_lock lock(get_autotune_mutex());
+    static autotune_table_type table = autotune_load();
+
+    const std::string candidates = autotune_candidates(id);
+    if (table.has_key(id) and table[id].candidates == candidates){
+        return table[id].choice;
+    }
+
+    autotune_entry entry;
+    entry.candidates = candidates;
+    entry.choice = -1;
+    double best = 0;
+    BOOST_FOREACH(const convert::priority_type p, convert::get_converter_priorities(id)){
+        const double t = autotune_time(id, p);
+        UHD_LOG << boost::format("convert autotune: %s -> %s prio %d: %.3f ns/sample")
+            % id.input_format % id.output_format % p % (t*1e9) << std::endl;
+        if (entry.choice == -1 or t < best){
+            entry.choice = p;
+            best = t;
+        }
+    }
+    table[id] = entry;
+    autotune_save(table);
+    return entry.choice;
 }
 
 /***********************************************************************
@@ -131,6 +474,7 @@ UHD_STATIC_BLOCK(convert_register_item_sizes){
     convert::register_bytes_per_item("sc64", sizeof(std::complex<boost::int64_t>));
     convert::register_bytes_per_item("sc32", sizeof(std::complex<boost::int32_t>));
     convert::register_bytes_per_item("sc16", sizeof(std::complex<boost::int16_t>));
+    convert::register_bytes_per_item("sc12", 3); //packed across items, see convert_common.hpp
     convert::register_bytes_per_item("sc8", sizeof(std::complex<boost::int8_t>));
 
     //register standard real types
@@ -140,4 +484,7 @@ UHD_STATIC_BLOCK(convert_register_item_sizes){
     convert::register_bytes_per_item("s32", sizeof(boost::int32_t));
     convert::register_bytes_per_item("s16", sizeof(boost::int16_t));
     convert::register_bytes_per_item("s8", sizeof(boost::int8_t));
+
+    //register the raw wire item
+    convert::register_bytes_per_item("item32", sizeof(boost::uint32_t));
 }
@@ -0,0 +1,223 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_common.hpp"
+#include <uhd/utils/byteswap.hpp>
+#include <emmintrin.h>
+
+using namespace uhd::convert;
+
+/***********************************************************************
+ * sc8 items in 16-bit words, as loaded on a little endian host
+ *   le: words hold Q0|I0<<8, Q1|I1<<8 in sample order
+ *   be: words hold I1|Q1<<8, I0|Q0<<8, so the pairs are swapped first
+ **********************************************************************/
+template <bool be> static UHD_INLINE __m128i sc8_swap_pairs(__m128i tmpi){
+    if (not be) return tmpi;
+    tmpi = _mm_shufflelo_epi16(tmpi, _MM_SHUFFLE(2, 3, 0, 1));
+    return _mm_shufflehi_epi16(tmpi, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+//16 wire bytes -> 8 samples as interleaved int16 IQ in lo and hi
+template <bool be> static UHD_INLINE void sc8_unpack(__m128i tmpi, __m128i &lo, __m128i &hi){
+    tmpi = sc8_swap_pairs<be>(tmpi);
+    const __m128i hi8 = _mm_srai_epi16(tmpi, 8);
+    const __m128i lo8 = _mm_srai_epi16(_mm_slli_epi16(tmpi, 8), 8);
+    lo = _mm_unpacklo_epi16(be? lo8 : hi8, be? hi8 : lo8);
+    hi = _mm_unpackhi_epi16(be? lo8 : hi8, be? hi8 : lo8);
+}
+
+//8 samples as interleaved int16 IQ in lo and hi -> 16 wire bytes
+template <bool be> static UHD_INLINE __m128i sc8_pack(const __m128i lo, const __m128i hi){
+    __m128i tmpi = _mm_packs_epi16(lo, hi); //bytes I0,Q0,I1,Q1...
+    if (not be) return _mm_or_si128(_mm_srli_epi16(tmpi, 8), _mm_slli_epi16(tmpi, 8));
+    return sc8_swap_pairs<be>(tmpi);
+}
+
+/***********************************************************************
+ * Vector kernels, 4 items (8 samples) per iteration
+ *   The int16 values are unpacked into the upper half of each int32,
+ *   so the scalar is divided by 2^16 as in convert_fc32_with_sse2.cpp.
+ **********************************************************************/
+template <bool be> static UHD_INLINE size_t sse2_item32_sc8_to_fc32(
+    const item32_t *input, fc32_t *output, const size_t num_items, const double scale_factor
+){
+    const __m128 scalar = _mm_set_ps1(float(scale_factor)/(1 << 16));
+    const __m128i zeroi = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        __m128i lo, hi;
+        sc8_unpack<be>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), lo, hi);
+        float *out = reinterpret_cast<float *>(output+2*i);
+        _mm_storeu_ps(out+0,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zeroi, lo)), scalar));
+        _mm_storeu_ps(out+4,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zeroi, lo)), scalar));
+        _mm_storeu_ps(out+8,  _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(zeroi, hi)), scalar));
+        _mm_storeu_ps(out+12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(zeroi, hi)), scalar));
+    }
+    return i;
+}
+
+template <bool be> static UHD_INLINE size_t sse2_item32_sc8_to_fc64(
+    const item32_t *input, fc64_t *output, const size_t num_items, const double scale_factor
+){
+    const __m128d scalar = _mm_set1_pd(scale_factor/(1 << 16));
+    const __m128i zeroi = _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        __m128i iq[2];
+        sc8_unpack<be>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), iq[0], iq[1]);
+        double *out = reinterpret_cast<double *>(output+2*i);
+        for (size_t j = 0; j < 2; j++){
+            const __m128i tmplo = _mm_unpacklo_epi16(zeroi, iq[j]);
+            const __m128i tmphi = _mm_unpackhi_epi16(zeroi, iq[j]);
+            _mm_storeu_pd(out+8*j+0, _mm_mul_pd(_mm_cvtepi32_pd(tmplo), scalar));
+            _mm_storeu_pd(out+8*j+2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(tmplo, 8)), scalar));
+            _mm_storeu_pd(out+8*j+4, _mm_mul_pd(_mm_cvtepi32_pd(tmphi), scalar));
+            _mm_storeu_pd(out+8*j+6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(tmphi, 8)), scalar));
+        }
+    }
+    return i;
+}
+
+template <bool be> static UHD_INLINE size_t sse2_item32_sc8_to_sc16(
+    const item32_t *input, sc16_t *output, const size_t num_items, const double
+){
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        __m128i lo, hi;
+        sc8_unpack<be>(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+2*i+0), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+2*i+4), hi);
+    }
+    return i;
+}
+
+template <bool be> static UHD_INLINE size_t sse2_fc32_to_item32_sc8(
+    const fc32_t *input, item32_t *output, const size_t num_items, const double scale_factor
+){
+    const __m128 scalar = _mm_set_ps1(float(scale_factor));
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        const float *in = reinterpret_cast<const float *>(input+2*i);
+        __m128i tmpi[4];
+        for (size_t j = 0; j < 4; j++){
+            tmpi[j] = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in+4*j), scalar));
+        }
+        const __m128i lo = _mm_packs_epi32(tmpi[0], tmpi[1]);
+        const __m128i hi = _mm_packs_epi32(tmpi[2], tmpi[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i), sc8_pack<be>(lo, hi));
+    }
+    return i;
+}
+
+template <bool be> static UHD_INLINE size_t sse2_fc64_to_item32_sc8(
+    const fc64_t *input, item32_t *output, const size_t num_items, const double scale_factor
+){
+    const __m128d scalar = _mm_set1_pd(scale_factor);
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        const double *in = reinterpret_cast<const double *>(input+2*i);
+        __m128i tmpi[4];
+        for (size_t j = 0; j < 4; j++){
+            //each conversion yields one sample in the lower 64 bits
+            const __m128i s0 = _mm_cvtpd_epi32(_mm_mul_pd(_mm_loadu_pd(in+4*j+0), scalar));
+            const __m128i s1 = _mm_cvtpd_epi32(_mm_mul_pd(_mm_loadu_pd(in+4*j+2), scalar));
+            tmpi[j] = _mm_unpacklo_epi64(s0, s1);
+        }
+        const __m128i lo = _mm_packs_epi32(tmpi[0], tmpi[1]);
+        const __m128i hi = _mm_packs_epi32(tmpi[2], tmpi[3]);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i), sc8_pack<be>(lo, hi));
+    }
+    return i;
+}
+
+template <bool be> static UHD_INLINE size_t sse2_sc16_to_item32_sc8(
+    const sc16_t *input, item32_t *output, const size_t num_items, const double
+){
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input+2*i+0));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input+2*i+4));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i), sc8_pack<be>(lo, hi));
+    }
+    return i;
+}
+
+/***********************************************************************
+ * Converters, the odd head and tail are handled like the general ones
+ **********************************************************************/
+#define DECLARE_SSE2_SC8(cpu_type, end, is_be, to_host, to_wire) \
+    DECLARE_CONVERTER(sc8_item32_ ## end, 1, cpu_type, 1, PRIORITY_SIMD){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3); \
+        cpu_type ## _t *output = reinterpret_cast<cpu_type ## _t *>(outputs[0]); \
+        cpu_type ## _t dummy; \
+        size_t num_samps = nsamps; \
+        \
+        /* a misaligned start begins at the second sample of an item */ \
+        if ((size_t(inputs[0]) & 0x3) != 0){ \
+            const item32_t item0 = to_host(*input++); \
+            item32_sc8_to_ ## cpu_type(item0, dummy, *output++, scale_factor); \
+            num_samps--; \
+        } \
+        \
+        const size_t num_pairs = num_samps/2; \
+        size_t i = sse2_item32_sc8_to_ ## cpu_type<is_be>(input, output, num_pairs, scale_factor); \
+        for (; i < num_pairs; i++){ \
+            const item32_t item_i = to_host(input[i]); \
+            item32_sc8_to_ ## cpu_type(item_i, output[2*i], output[2*i+1], scale_factor); \
+        } \
+        \
+        if (num_samps != num_pairs*2){ \
+            const item32_t item_n = to_host(input[num_pairs]); \
+            item32_sc8_to_ ## cpu_type(item_n, output[num_samps-1], dummy, scale_factor); \
+        } \
+    } \
+    DECLARE_CONVERTER(cpu_type, 1, sc8_item32_ ## end, 1, PRIORITY_SIMD){ \
+        const cpu_type ## _t *input = reinterpret_cast<const cpu_type ## _t *>(inputs[0]); \
+        item32_t *output = reinterpret_cast<item32_t *>(size_t(outputs[0]) & ~0x3); \
+        const cpu_type ## _t dummy; \
+        size_t num_samps = nsamps; \
+        \
+        /* a misaligned start fills the second sample of an item */ \
+        if ((size_t(outputs[0]) & 0x3) != 0){ \
+            const item32_t item0 = cpu_type ## _to_item32_sc8(dummy, *input++, scale_factor); \
+            *output = to_wire((to_host(*output) & 0xffff) | (item0 & 0xffff0000)); \
+            output++; \
+            num_samps--; \
+        } \
+        \
+        const size_t num_pairs = num_samps/2; \
+        size_t i = sse2_ ## cpu_type ## _to_item32_sc8<is_be>(input, output, num_pairs, scale_factor); \
+        for (; i < num_pairs; i++){ \
+            output[i] = to_wire(cpu_type ## _to_item32_sc8(input[2*i], input[2*i+1], scale_factor)); \
+        } \
+        \
+        if (num_samps != num_pairs*2){ \
+            output[num_pairs] = to_wire(cpu_type ## _to_item32_sc8(input[num_samps-1], dummy, scale_factor)); \
+        } \
+    }
+
+DECLARE_SSE2_SC8(fc32, le, false, uhd::wtohx, uhd::htowx)
+DECLARE_SSE2_SC8(fc32, be, true,  uhd::ntohx, uhd::htonx)
+DECLARE_SSE2_SC8(fc64, le, false, uhd::wtohx, uhd::htowx)
+DECLARE_SSE2_SC8(fc64, be, true,  uhd::ntohx, uhd::htonx)
+DECLARE_SSE2_SC8(sc16, le, false, uhd::wtohx, uhd::htowx)
+DECLARE_SSE2_SC8(sc16, be, true,  uhd::ntohx, uhd::htonx)
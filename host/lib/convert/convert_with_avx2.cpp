@@ -0,0 +1,627 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_common.hpp"
+#include <uhd/utils/byteswap.hpp>
+#include <immintrin.h>
+#include <algorithm>
+
+using namespace uhd::convert;
+
+/***********************************************************************
+ * Byte shuffles between the wire order and host interleaved IQ
+ *   sc16: le items hold Q,I as 16-bit words, be items hold I,Q byteswapped
+ *   sc8:  le items hold Q0,I0,Q1,I1, be items hold I1,Q1,I0,Q0
+ * Each shuffle is its own inverse, so it serves both directions.
+ **********************************************************************/
+static UHD_INLINE __m128i sc16_le_shuffle(void){
+    return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+}
+
+static UHD_INLINE __m128i sc16_be_shuffle(void){
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+}
+
+static UHD_INLINE __m128i sc8_le_shuffle(void){
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+}
+
+static UHD_INLINE __m128i sc8_be_shuffle(void){
+    return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+}
+
+static CONVERT_TARGET_AVX2 UHD_INLINE __m256i broadcast_shuffle(const __m128i shuf){
+    return _mm256_insertf128_si256(_mm256_castsi128_si256(shuf), shuf, 1);
+}
+
+/***********************************************************************
+ * fc32 <-> sc16 item32, 8 samples per iteration
+ **********************************************************************/
+static CONVERT_TARGET_AVX2 size_t avx2_fc32_to_item32_sc16(
+    const fc32_t *input, item32_t *output, const size_t nsamps, const float scale, const __m128i shuf
+){
+    const __m256 scalar = _mm256_set1_ps(scale);
+    const __m256i shuf256 = broadcast_shuffle(shuf);
+
+    size_t i = 0;
+    for (; i+8 <= nsamps; i+=8){
+        //load and scale 16 floats
+        __m256 tmplo = _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+0));
+        __m256 tmphi = _mm256_loadu_ps(reinterpret_cast<const float *>(input+i+4));
+        __m256i tmpilo = _mm256_cvtps_epi32(_mm256_mul_ps(tmplo, scalar));
+        __m256i tmpihi = _mm256_cvtps_epi32(_mm256_mul_ps(tmphi, scalar));
+
+        //pack works per 128-bit lane, put the 64-bit quarters back in order
+        __m256i tmpi = _mm256_packs_epi32(tmpilo, tmpihi);
+        tmpi = _mm256_permute4x64_epi64(tmpi, _MM_SHUFFLE(3, 1, 2, 0));
+
+        //to wire order and store
+        tmpi = _mm256_shuffle_epi8(tmpi, shuf256);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i), tmpi);
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc16_to_fc32(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const float scale, const __m128i shuf
+){
+    const __m256 scalar = _mm256_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i+8 <= nsamps; i+=8){
+        //load 8 items and put them in host IQ order
+        __m128i tmp0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i+0)), shuf);
+        __m128i tmp1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i+4)), shuf);
+
+        //sign extend, convert and scale
+        __m256 tmplo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(tmp0)), scalar);
+        __m256 tmphi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(tmp1)), scalar);
+
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+i+0), tmplo);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+i+4), tmphi);
+    }
+    return i;
+}
+
+#define DECLARE_AVX2_FC32_SC16(end, to_host, to_wire, shuf) \
+    DECLARE_CONVERTER_IF(fc32, 1, sc16_item32_ ## end, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]); \
+        item32_t *output = reinterpret_cast<item32_t *>(outputs[0]); \
+        size_t i = avx2_fc32_to_item32_sc16(input, output, nsamps, float(scale_factor), shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = to_wire(fc32_to_item32_sc16(input[i], scale_factor)); \
+        } \
+    } \
+    DECLARE_CONVERTER_IF(sc16_item32_ ## end, 1, fc32, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]); \
+        fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]); \
+        size_t i = avx2_item32_sc16_to_fc32(input, output, nsamps, float(scale_factor), shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = item32_sc16_to_fc32(to_host(input[i]), scale_factor); \
+        } \
+    }
+
+DECLARE_AVX2_FC32_SC16(le, uhd::wtohx, uhd::htowx, sc16_le_shuffle)
+DECLARE_AVX2_FC32_SC16(be, uhd::ntohx, uhd::htonx, sc16_be_shuffle)
+
+/***********************************************************************
+ * sc16 item32 -> fc32 with a correction, 8 samples per iteration
+ **********************************************************************/
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc16_to_fc32_correct(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const correcting_converter &c, const __m128i shuf
+){
+    const __m256 diag = _mm256_setr_ps(c.ii, c.qq, c.ii, c.qq, c.ii, c.qq, c.ii, c.qq);
+    const __m256 cross = _mm256_setr_ps(c.iq, c.qi, c.iq, c.qi, c.iq, c.qi, c.iq, c.qi);
+    const __m256 offset = _mm256_setr_ps(c.off_i, c.off_q, c.off_i, c.off_q, c.off_i, c.off_q, c.off_i, c.off_q);
+
+    size_t i = 0;
+    for (; i+8 <= nsamps; i+=8){
+        //load 8 items and put them in host IQ order
+        __m128i tmp0 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i+0)), shuf);
+        __m128i tmp1 = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i+4)), shuf);
+
+        //sign extend and convert
+        __m256 tmplo = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(tmp0));
+        __m256 tmphi = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(tmp1));
+
+        //the affine map, the cross terms use the swapped Q,I pairs
+        tmplo = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tmplo, diag),
+            _mm256_mul_ps(_mm256_permute_ps(tmplo, _MM_SHUFFLE(2, 3, 0, 1)), cross)), offset);
+        tmphi = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(tmphi, diag),
+            _mm256_mul_ps(_mm256_permute_ps(tmphi, _MM_SHUFFLE(2, 3, 0, 1)), cross)), offset);
+
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+i+0), tmplo);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+i+4), tmphi);
+    }
+    return i;
+}
+
+#define DECLARE_AVX2_CORRECTING(end, to_host, shuf) \
+    DECLARE_CORRECTING_CONVERTER_IF(sc16_item32_ ## end, fc32, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]); \
+        fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]); \
+        size_t i = avx2_item32_sc16_to_fc32_correct(input, output, nsamps, *this, shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = item32_sc16_to_fc32(to_host(input[i]), *this); \
+        } \
+    }
+
+DECLARE_AVX2_CORRECTING(le, uhd::wtohx, sc16_le_shuffle)
+DECLARE_AVX2_CORRECTING(be, uhd::ntohx, sc16_be_shuffle)
+
+/***********************************************************************
+ * fc64 <-> sc16 item32, 8 samples per iteration
+ **********************************************************************/
+static CONVERT_TARGET_AVX2 size_t avx2_fc64_to_item32_sc16(
+    const fc64_t *input, item32_t *output, const size_t nsamps, const double scale, const __m128i shuf
+){
+    const __m256d scalar = _mm256_set1_pd(scale);
+
+    size_t i = 0;
+    for (; i+8 <= nsamps; i+=8){
+        //convert and scale 2 samples per register (truncating like the sse2 converter)
+        __m128i tmpi0 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(reinterpret_cast<const double *>(input+i+0)), scalar));
+        __m128i tmpi1 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(reinterpret_cast<const double *>(input+i+2)), scalar));
+        __m128i tmpi2 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(reinterpret_cast<const double *>(input+i+4)), scalar));
+        __m128i tmpi3 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(reinterpret_cast<const double *>(input+i+6)), scalar));
+
+        //pack, to wire order and store
+        __m128i tmplo = _mm_shuffle_epi8(_mm_packs_epi32(tmpi0, tmpi1), shuf);
+        __m128i tmphi = _mm_shuffle_epi8(_mm_packs_epi32(tmpi2, tmpi3), shuf);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i+0), tmplo);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i+4), tmphi);
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc16_to_fc64(
+    const item32_t *input, fc64_t *output, const size_t nsamps, const double scale, const __m128i shuf
+){
+    const __m256d scalar = _mm256_set1_pd(scale);
+
+    size_t i = 0;
+    for (; i+4 <= nsamps; i+=4){
+        //load 4 items and put them in host IQ order
+        __m128i tmpi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), shuf);
+
+        //sign extend, convert and scale 2 samples per register
+        __m256d tmplo = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepi16_epi32(tmpi)), scalar);
+        __m256d tmphi = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_srli_si128(tmpi, 8))), scalar);
+
+        _mm256_storeu_pd(reinterpret_cast<double *>(output+i+0), tmplo);
+        _mm256_storeu_pd(reinterpret_cast<double *>(output+i+2), tmphi);
+    }
+    return i;
+}
+
+#define DECLARE_AVX2_FC64_SC16(end, to_host, to_wire, shuf) \
+    DECLARE_CONVERTER_IF(fc64, 1, sc16_item32_ ## end, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const fc64_t *input = reinterpret_cast<const fc64_t *>(inputs[0]); \
+        item32_t *output = reinterpret_cast<item32_t *>(outputs[0]); \
+        size_t i = avx2_fc64_to_item32_sc16(input, output, nsamps, scale_factor, shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = to_wire(fc64_to_item32_sc16(input[i], scale_factor)); \
+        } \
+    } \
+    DECLARE_CONVERTER_IF(sc16_item32_ ## end, 1, fc64, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]); \
+        fc64_t *output = reinterpret_cast<fc64_t *>(outputs[0]); \
+        size_t i = avx2_item32_sc16_to_fc64(input, output, nsamps, scale_factor, shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = item32_sc16_to_fc64(to_host(input[i]), scale_factor); \
+        } \
+    }
+
+DECLARE_AVX2_FC64_SC16(le, uhd::wtohx, uhd::htowx, sc16_le_shuffle)
+DECLARE_AVX2_FC64_SC16(be, uhd::ntohx, uhd::htonx, sc16_be_shuffle)
+
+/***********************************************************************
+ * sc8 item32 -> fc32/fc64/sc16, 4 items (8 samples) per iteration
+ **********************************************************************/
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc8_to_fc32(
+    const item32_t *input, fc32_t *output, const size_t num_items, const float scale, const __m128i shuf
+){
+    const __m256 scalar = _mm256_set1_ps(scale);
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        //load 4 items and put them in host IQ order
+        __m128i tmpi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), shuf);
+
+        //sign extend, convert and scale 4 samples per register
+        __m256 tmplo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(tmpi)), scalar);
+        __m256 tmphi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi8_epi32(_mm_srli_si128(tmpi, 8))), scalar);
+
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+2*i+0), tmplo);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+2*i+4), tmphi);
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc8_to_fc64(
+    const item32_t *input, fc64_t *output, const size_t num_items, const double scale, const __m128i shuf
+){
+    const __m256d scalar = _mm256_set1_pd(scale);
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        //load 4 items and put them in host IQ order
+        __m128i tmpi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), shuf);
+
+        //sign extend, convert and scale 2 samples per register
+        for (size_t j = 0; j < 4; j++){
+            __m256d tmp = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepi8_epi32(tmpi)), scalar);
+            _mm256_storeu_pd(reinterpret_cast<double *>(output+2*(i+j)), tmp);
+            tmpi = _mm_srli_si128(tmpi, 4);
+        }
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc8_to_sc16(
+    const item32_t *input, sc16_t *output, const size_t num_items, const double, const __m128i shuf
+){
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        //load 4 items, put them in host IQ order and sign extend
+        __m128i tmpi = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(input+i)), shuf);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+2*i), _mm256_cvtepi8_epi16(tmpi));
+    }
+    return i;
+}
+
+/***********************************************************************
+ * fc32/fc64/sc16 -> sc8 item32
+ **********************************************************************/
+static CONVERT_TARGET_AVX2 size_t avx2_fc32_to_item32_sc8(
+    const fc32_t *input, item32_t *output, const size_t num_items, const float scale, const __m128i shuf
+){
+    const __m256 scalar = _mm256_set1_ps(scale);
+    const __m256i shuf256 = broadcast_shuffle(shuf);
+    //both packs work per 128-bit lane, this puts the sample pairs back in order
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+    size_t i = 0;
+    for (; i+8 <= num_items; i+=8){
+        //load, scale and convert 16 samples
+        const float *in = reinterpret_cast<const float *>(input+2*i);
+        __m256i tmpi0 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in+0), scalar));
+        __m256i tmpi1 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in+8), scalar));
+        __m256i tmpi2 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in+16), scalar));
+        __m256i tmpi3 = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in+24), scalar));
+
+        //pack to bytes, to wire order and store
+        __m256i tmpi = _mm256_packs_epi16(_mm256_packs_epi32(tmpi0, tmpi1), _mm256_packs_epi32(tmpi2, tmpi3));
+        tmpi = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(tmpi, order), shuf256);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+i), tmpi);
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_fc64_to_item32_sc8(
+    const fc64_t *input, item32_t *output, const size_t num_items, const double scale, const __m128i shuf
+){
+    const __m256d scalar = _mm256_set1_pd(scale);
+
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        //convert and scale 2 samples per register (truncating like the general converter)
+        const double *in = reinterpret_cast<const double *>(input+2*i);
+        __m128i tmpi0 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+0), scalar));
+        __m128i tmpi1 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+4), scalar));
+        __m128i tmpi2 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+8), scalar));
+        __m128i tmpi3 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+12), scalar));
+
+        //pack to bytes, to wire order and store
+        __m128i tmpi = _mm_packs_epi16(_mm_packs_epi32(tmpi0, tmpi1), _mm_packs_epi32(tmpi2, tmpi3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i), _mm_shuffle_epi8(tmpi, shuf));
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_sc16_to_item32_sc8(
+    const sc16_t *input, item32_t *output, const size_t num_items, const double, const __m128i shuf
+){
+    size_t i = 0;
+    for (; i+4 <= num_items; i+=4){
+        //load 8 samples, pack to bytes, to wire order and store
+        __m256i tmp = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+2*i));
+        __m128i tmpi = _mm_packs_epi16(_mm256_castsi256_si128(tmp), _mm256_extracti128_si256(tmp, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output+i), _mm_shuffle_epi8(tmpi, shuf));
+    }
+    return i;
+}
+
+#define DECLARE_AVX2_SC8(cpu_type, end, to_host, to_wire, shuf) \
+    DECLARE_CONVERTER_IF(sc8_item32_ ## end, 1, cpu_type, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3); \
+        cpu_type ## _t *output = reinterpret_cast<cpu_type ## _t *>(outputs[0]); \
+        cpu_type ## _t dummy; \
+        size_t num_samps = nsamps; \
+        \
+        /* a misaligned start begins at the second sample of an item */ \
+        if ((size_t(inputs[0]) & 0x3) != 0){ \
+            const item32_t item0 = to_host(*input++); \
+            item32_sc8_to_ ## cpu_type(item0, dummy, *output++, scale_factor); \
+            num_samps--; \
+        } \
+        \
+        const size_t num_pairs = num_samps/2; \
+        size_t i = avx2_item32_sc8_to_ ## cpu_type(input, output, num_pairs, scale_factor, shuf()); \
+        for (; i < num_pairs; i++){ \
+            const item32_t item_i = to_host(input[i]); \
+            item32_sc8_to_ ## cpu_type(item_i, output[2*i], output[2*i+1], scale_factor); \
+        } \
+        \
+        if (num_samps != num_pairs*2){ \
+            const item32_t item_n = to_host(input[num_pairs]); \
+            item32_sc8_to_ ## cpu_type(item_n, output[num_samps-1], dummy, scale_factor); \
+        } \
+    } \
+    DECLARE_CONVERTER_IF(cpu_type, 1, sc8_item32_ ## end, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        const cpu_type ## _t *input = reinterpret_cast<const cpu_type ## _t *>(inputs[0]); \
+        item32_t *output = reinterpret_cast<item32_t *>(size_t(outputs[0]) & ~0x3); \
+        const cpu_type ## _t dummy; \
+        size_t num_samps = nsamps; \
+        \
+        /* a misaligned start fills the second sample of an item */ \
+        if ((size_t(outputs[0]) & 0x3) != 0){ \
+            const item32_t item0 = cpu_type ## _to_item32_sc8(dummy, *input++, scale_factor); \
+            *output = to_wire((to_host(*output) & 0xffff) | (item0 & 0xffff0000)); \
+            output++; \
+            num_samps--; \
+        } \
+        \
+        const size_t num_pairs = num_samps/2; \
+        size_t i = avx2_ ## cpu_type ## _to_item32_sc8(input, output, num_pairs, scale_factor, shuf()); \
+        for (; i < num_pairs; i++){ \
+            output[i] = to_wire(cpu_type ## _to_item32_sc8(input[2*i], input[2*i+1], scale_factor)); \
+        } \
+        \
+        if (num_samps != num_pairs*2){ \
+            output[num_pairs] = to_wire(cpu_type ## _to_item32_sc8(input[num_samps-1], dummy, scale_factor)); \
+        } \
+    }
+
+DECLARE_AVX2_SC8(fc32, le, uhd::wtohx, uhd::htowx, sc8_le_shuffle)
+DECLARE_AVX2_SC8(fc32, be, uhd::ntohx, uhd::htonx, sc8_be_shuffle)
+DECLARE_AVX2_SC8(fc64, le, uhd::wtohx, uhd::htowx, sc8_le_shuffle)
+DECLARE_AVX2_SC8(fc64, be, uhd::ntohx, uhd::htonx, sc8_be_shuffle)
+DECLARE_AVX2_SC8(sc16, le, uhd::wtohx, uhd::htowx, sc8_le_shuffle)
+DECLARE_AVX2_SC8(sc16, be, uhd::ntohx, uhd::htonx, sc8_be_shuffle)
+
+/***********************************************************************
+ * sc12 item32 <-> fc32/fc64/sc16, 2 groups (8 samples) per iteration
+ *   The unpack shuffle puts the two bytes holding each 12-bit value
+ *   in a 16-bit lane, I values sit in the upper bits, Q values need a
+ *   shift left. The pack shuffles do the reverse on I masked and Q
+ *   shifted right, or-ing the bytes shared by I and Q.
+ **********************************************************************/
+static UHD_INLINE __m128i sc12_le_unpack_shuffle(void){
+    return _mm_setr_epi8(2, 3, 1, 2, 7, 0, 6, 7, 4, 5, 11, 4, 9, 10, 8, 9);
+}
+
+static UHD_INLINE __m128i sc12_be_unpack_shuffle(void){
+    return _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+}
+
+static UHD_INLINE __m128i sc12_le_pack_shuffle(const int which){
+    if (which == 0) return _mm_setr_epi8(5, 2, 0, 1, 8, 9, 6, 4, 14, 12, 13, 10, -1, -1, -1, -1);
+    return _mm_setr_epi8(-1, -1, 3, -1, 11, -1, -1, 7, -1, 15, -1, -1, -1, -1, -1, -1);
+}
+
+static UHD_INLINE __m128i sc12_be_pack_shuffle(const int which){
+    if (which == 0) return _mm_setr_epi8(1, 0, 2, 5, 4, 6, 9, 8, 10, 13, 12, 14, -1, -1, -1, -1);
+    return _mm_setr_epi8(-1, 3, -1, -1, 7, -1, -1, 11, -1, -1, 15, -1, -1, -1, -1, -1);
+}
+
+//8 samples as 16-bit IQ from 2 groups, each load reads 4 bytes past its group
+static CONVERT_TARGET_AVX2 UHD_INLINE __m256i avx2_sc12_load(const item32_t *input, const __m256i shuf){
+    __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input+0));
+    __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(input+3));
+    __m256i tmpi = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuf);
+    return _mm256_and_si256(_mm256_blend_epi16(tmpi, _mm256_slli_epi16(tmpi, 4), 0xaa), _mm256_set1_epi16(short(0xfff0)));
+}
+
+//2 groups from 8 samples as 16-bit IQ, the first store spills into the second group
+static CONVERT_TARGET_AVX2 UHD_INLINE void avx2_sc12_store(item32_t *output, const __m256i iq, const __m256i shuf0, const __m256i shuf1){
+    __m256i tmpi = _mm256_blend_epi16(
+        _mm256_and_si256(iq, _mm256_set1_epi16(short(0xfff0))), _mm256_srli_epi16(iq, 4), 0xaa);
+    tmpi = _mm256_or_si256(_mm256_shuffle_epi8(tmpi, shuf0), _mm256_shuffle_epi8(tmpi, shuf1));
+    const __m128i hi = _mm256_extracti128_si256(tmpi, 1);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(output+0), _mm256_castsi256_si128(tmpi));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(output+3), hi);
+    output[5] = item32_t(_mm_cvtsi128_si32(_mm_srli_si128(hi, 8)));
+}
+
+//the loads read ahead, so the last whole group is left to the caller
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc12_to_cpu(
+    const item32_t *input, sc16_t *output, const size_t num_groups, const double, const __m128i shuf
+){
+    const __m256i shuf256 = broadcast_shuffle(shuf);
+    size_t g = 0;
+    for (; g+3 <= num_groups; g+=2){
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output+4*g), avx2_sc12_load(input+3*g, shuf256));
+    }
+    return g;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc12_to_cpu(
+    const item32_t *input, fc32_t *output, const size_t num_groups, const double scale, const __m128i shuf
+){
+    const __m256i shuf256 = broadcast_shuffle(shuf);
+    const __m256 scalar = _mm256_set1_ps(float(scale));
+    size_t g = 0;
+    for (; g+3 <= num_groups; g+=2){
+        __m256i tmpi = avx2_sc12_load(input+3*g, shuf256);
+
+        //sign extend, convert and scale 4 samples per register
+        __m256 tmplo = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(tmpi))), scalar);
+        __m256 tmphi = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(tmpi, 1))), scalar);
+
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+4*g+0), tmplo);
+        _mm256_storeu_ps(reinterpret_cast<float *>(output+4*g+4), tmphi);
+    }
+    return g;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_item32_sc12_to_cpu(
+    const item32_t *input, fc64_t *output, const size_t num_groups, const double scale, const __m128i shuf
+){
+    const __m256i shuf256 = broadcast_shuffle(shuf);
+    const __m256d scalar = _mm256_set1_pd(scale);
+    size_t g = 0;
+    for (; g+3 <= num_groups; g+=2){
+        __m256i tmpi = avx2_sc12_load(input+3*g, shuf256);
+
+        //sign extend, convert and scale 2 samples per register
+        __m128i parts[2] = {_mm256_castsi256_si128(tmpi), _mm256_extracti128_si256(tmpi, 1)};
+        for (size_t j = 0; j < 4; j++){
+            __m256d tmp = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_cvtepi16_epi32(parts[j/2])), scalar);
+            _mm256_storeu_pd(reinterpret_cast<double *>(output+4*g+2*j), tmp);
+            parts[j/2] = _mm_srli_si128(parts[j/2], 8);
+        }
+    }
+    return g;
+}
+
+//the stores spill into the next group, so the last whole group is left to the caller
+static CONVERT_TARGET_AVX2 size_t avx2_cpu_to_item32_sc12(
+    const sc16_t *input, item32_t *output, const size_t num_groups, const double, const __m128i shuf0, const __m128i shuf1
+){
+    const __m256i shuf256_0 = broadcast_shuffle(shuf0), shuf256_1 = broadcast_shuffle(shuf1);
+    size_t g = 0;
+    for (; g+3 <= num_groups; g+=2){
+        __m256i tmpi = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input+4*g));
+        avx2_sc12_store(output+3*g, tmpi, shuf256_0, shuf256_1);
+    }
+    return g;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_cpu_to_item32_sc12(
+    const fc32_t *input, item32_t *output, const size_t num_groups, const double scale, const __m128i shuf0, const __m128i shuf1
+){
+    const __m256i shuf256_0 = broadcast_shuffle(shuf0), shuf256_1 = broadcast_shuffle(shuf1);
+    const __m256 scalar = _mm256_set1_ps(float(scale));
+    size_t g = 0;
+    for (; g+3 <= num_groups; g+=2){
+        //scale and convert 8 samples (truncating like the general converter)
+        const float *in = reinterpret_cast<const float *>(input+4*g);
+        __m256i tmpi0 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in+0), scalar));
+        __m256i tmpi1 = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in+8), scalar));
+
+        //pack works per 128-bit lane, this puts the samples back in order
+        __m256i tmpi = _mm256_permute4x64_epi64(_mm256_packs_epi32(tmpi0, tmpi1), 0xd8);
+        avx2_sc12_store(output+3*g, tmpi, shuf256_0, shuf256_1);
+    }
+    return g;
+}
+
+static CONVERT_TARGET_AVX2 size_t avx2_cpu_to_item32_sc12(
+    const fc64_t *input, item32_t *output, const size_t num_groups, const double scale, const __m128i shuf0, const __m128i shuf1
+){
+    const __m256i shuf256_0 = broadcast_shuffle(shuf0), shuf256_1 = broadcast_shuffle(shuf1);
+    const __m256d scalar = _mm256_set1_pd(scale);
+    size_t g = 0;
+    for (; g+3 <= num_groups; g+=2){
+        //scale and convert 2 samples per register (truncating like the general converter)
+        const double *in = reinterpret_cast<const double *>(input+4*g);
+        __m128i tmpi0 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+0), scalar));
+        __m128i tmpi1 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+4), scalar));
+        __m128i tmpi2 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+8), scalar));
+        __m128i tmpi3 = _mm256_cvttpd_epi32(_mm256_mul_pd(_mm256_loadu_pd(in+12), scalar));
+
+        __m256i tmpi = _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_packs_epi32(tmpi0, tmpi1)), _mm_packs_epi32(tmpi2, tmpi3), 1);
+        avx2_sc12_store(output+3*g, tmpi, shuf256_0, shuf256_1);
+    }
+    return g;
+}
+
+/***********************************************************************
+ * sc12 converters: general group code for a partial first group
+ * and the tail, the kernels above for whole groups in between
+ **********************************************************************/
+template <typename type, swap32_type to_host>
+static UHD_INLINE void avx2_convert_item32_sc12_to_cpu(
+    const void *in, void *out, const size_t nsamps, const double scale_factor, const __m128i shuf
+){
+    const size_t phase = sc12_phase(in);
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(in) - 3*phase);
+    type *output = reinterpret_cast<type *>(out);
+
+    size_t i = 0;
+    if (phase != 0){
+        i = std::min(4 - phase, nsamps);
+        item32_sc12_group_to_cpu<type, to_host>(input, phase, i, output, scale_factor);
+        input += 3;
+    }
+
+    const size_t g = avx2_item32_sc12_to_cpu(input, output+i, (nsamps - i)/4, scale_factor, shuf);
+    i += 4*g;
+    input += 3*g;
+
+    for (; i < nsamps; input += 3){
+        const size_t n = std::min<size_t>(4, nsamps - i);
+        item32_sc12_group_to_cpu<type, to_host>(input, 0, n, output+i, scale_factor);
+        i += n;
+    }
+}
+
+template <typename type, swap32_type to_host, swap32_type to_wire>
+static UHD_INLINE void avx2_convert_cpu_to_item32_sc12(
+    const void *in, void *out, const size_t nsamps, const double scale_factor, const __m128i shuf0, const __m128i shuf1
+){
+    const type *input = reinterpret_cast<const type *>(in);
+    const size_t phase = sc12_phase(out);
+    item32_t *output = reinterpret_cast<item32_t *>(size_t(out) - 3*phase);
+
+    size_t i = 0;
+    if (phase != 0){
+        i = std::min(4 - phase, nsamps);
+        cpu_to_item32_sc12_group<type, to_host, to_wire>(input, phase, i, output, scale_factor);
+        output += 3;
+    }
+
+    const size_t g = avx2_cpu_to_item32_sc12(input+i, output, (nsamps - i)/4, scale_factor, shuf0, shuf1);
+    i += 4*g;
+    output += 3*g;
+
+    for (; i < nsamps; output += 3){
+        const size_t n = std::min<size_t>(4, nsamps - i);
+        cpu_to_item32_sc12_group<type, to_host, to_wire>(input+i, 0, n, output, scale_factor);
+        i += n;
+    }
+}
+
+#define DECLARE_AVX2_SC12(cpu_type, end, to_host, to_wire) \
+    DECLARE_CONVERTER_IF(sc12_item32_ ## end, 1, cpu_type, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        avx2_convert_item32_sc12_to_cpu<cpu_type ## _t, to_host>( \
+            inputs[0], outputs[0], nsamps, scale_factor, sc12_ ## end ## _unpack_shuffle()); \
+    } \
+    DECLARE_CONVERTER_IF(cpu_type, 1, sc12_item32_ ## end, 1, PRIORITY_SIMD_AVX2, convert_cpu_has_avx2()){ \
+        avx2_convert_cpu_to_item32_sc12<cpu_type ## _t, to_host, to_wire>( \
+            inputs[0], outputs[0], nsamps, scale_factor, \
+            sc12_ ## end ## _pack_shuffle(0), sc12_ ## end ## _pack_shuffle(1)); \
+    }
+
+DECLARE_AVX2_SC12(fc32, le, uhd::wtohx, uhd::htowx)
+DECLARE_AVX2_SC12(fc32, be, uhd::ntohx, uhd::htonx)
+DECLARE_AVX2_SC12(fc64, le, uhd::wtohx, uhd::htowx)
+DECLARE_AVX2_SC12(fc64, be, uhd::ntohx, uhd::htonx)
+DECLARE_AVX2_SC12(sc16, le, uhd::wtohx, uhd::htowx)
+DECLARE_AVX2_SC12(sc16, be, uhd::ntohx, uhd::htonx)
@@ -0,0 +1,117 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "convert_common.hpp"
+#include <uhd/utils/byteswap.hpp>
+
+//the gcc 12 avx-512 intrinsics start from an undefined register and warn about it
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ == 12
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+#include <immintrin.h>
+
+using namespace uhd::convert;
+
+/***********************************************************************
+ * Byte shuffles between the sc16 wire order and host interleaved IQ,
+ * repeated for every 128-bit lane (see convert_with_avx2.cpp)
+ **********************************************************************/
+static UHD_INLINE __m128i sc16_le_shuffle(void){
+    return _mm_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+}
+
+static UHD_INLINE __m128i sc16_be_shuffle(void){
+    return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+}
+
+static CONVERT_TARGET_AVX512BW UHD_INLINE __m512i broadcast_shuffle(const __m128i shuf){
+    return _mm512_set4_epi32(
+        _mm_extract_epi32(shuf, 3), _mm_extract_epi32(shuf, 2),
+        _mm_extract_epi32(shuf, 1), _mm_extract_epi32(shuf, 0)
+    );
+}
+
+/***********************************************************************
+ * fc32 <-> sc16 item32, 16 samples per iteration
+ **********************************************************************/
+static CONVERT_TARGET_AVX512BW size_t avx512_fc32_to_item32_sc16(
+    const fc32_t *input, item32_t *output, const size_t nsamps, const float scale, const __m128i shuf
+){
+    const __m512 scalar = _mm512_set1_ps(scale);
+    const __m512i shuf512 = broadcast_shuffle(shuf);
+    //pack works per 128-bit lane, this puts the 64-bit pieces back in order
+    const __m512i order = _mm512_setr_epi64(0, 2, 4, 6, 1, 3, 5, 7);
+
+    size_t i = 0;
+    for (; i+16 <= nsamps; i+=16){
+        //load and scale 32 floats
+        __m512 tmplo = _mm512_loadu_ps(reinterpret_cast<const float *>(input+i+0));
+        __m512 tmphi = _mm512_loadu_ps(reinterpret_cast<const float *>(input+i+8));
+        __m512i tmpilo = _mm512_cvtps_epi32(_mm512_mul_ps(tmplo, scalar));
+        __m512i tmpihi = _mm512_cvtps_epi32(_mm512_mul_ps(tmphi, scalar));
+
+        //pack, to wire order and store
+        __m512i tmpi = _mm512_permutexvar_epi64(order, _mm512_packs_epi32(tmpilo, tmpihi));
+        tmpi = _mm512_shuffle_epi8(tmpi, shuf512);
+        _mm512_storeu_si512(reinterpret_cast<void *>(output+i), tmpi);
+    }
+    return i;
+}
+
+static CONVERT_TARGET_AVX512BW size_t avx512_item32_sc16_to_fc32(
+    const item32_t *input, fc32_t *output, const size_t nsamps, const float scale, const __m128i shuf
+){
+    const __m512 scalar = _mm512_set1_ps(scale);
+    const __m512i shuf512 = broadcast_shuffle(shuf);
+
+    size_t i = 0;
+    for (; i+16 <= nsamps; i+=16){
+        //load 16 items and put them in host IQ order
+        __m512i tmpi = _mm512_shuffle_epi8(_mm512_loadu_si512(reinterpret_cast<const void *>(input+i)), shuf512);
+
+        //sign extend, convert and scale 8 samples per register
+        __m512 tmplo = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm512_castsi512_si256(tmpi))), scalar);
+        __m512 tmphi = _mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_cvtepi16_epi32(_mm512_extracti64x4_epi64(tmpi, 1))), scalar);
+
+        _mm512_storeu_ps(reinterpret_cast<float *>(output+i+0), tmplo);
+        _mm512_storeu_ps(reinterpret_cast<float *>(output+i+8), tmphi);
+    }
+    return i;
+}
+
+#define DECLARE_AVX512_FC32_SC16(end, to_host, to_wire, shuf) \
+    DECLARE_CONVERTER_IF(fc32, 1, sc16_item32_ ## end, 1, PRIORITY_SIMD_AVX512, convert_cpu_has_avx512bw()){ \
+        const fc32_t *input = reinterpret_cast<const fc32_t *>(inputs[0]); \
+        item32_t *output = reinterpret_cast<item32_t *>(outputs[0]); \
+        size_t i = avx512_fc32_to_item32_sc16(input, output, nsamps, float(scale_factor), shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = to_wire(fc32_to_item32_sc16(input[i], scale_factor)); \
+        } \
+    } \
+    DECLARE_CONVERTER_IF(sc16_item32_ ## end, 1, fc32, 1, PRIORITY_SIMD_AVX512, convert_cpu_has_avx512bw()){ \
+        const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]); \
+        fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]); \
+        size_t i = avx512_item32_sc16_to_fc32(input, output, nsamps, float(scale_factor), shuf()); \
+        for (; i < nsamps; i++){ \
+            output[i] = item32_sc16_to_fc32(to_host(input[i]), scale_factor); \
+        } \
+    }
+
+DECLARE_AVX512_FC32_SC16(le, uhd::wtohx, uhd::htowx, sc16_le_shuffle)
+DECLARE_AVX512_FC32_SC16(be, uhd::ntohx, uhd::htonx, sc16_be_shuffle)
@@ -24,6 +24,7 @@ TMPL_HEADER = """
 
 \#include "convert_common.hpp"
 \#include <uhd/utils/byteswap.hpp>
+\#include <algorithm>
 
 using namespace uhd::convert;
 """
@@ -69,6 +70,29 @@ DECLARE_CONVERTER(sc16_item32_$(end), 1, $(cpu_type), 1, PRIORITY_GENERAL){
 """
 
 TMPL_CONV_GEN2_SC8 = """
+DECLARE_CONVERTER($(cpu_type), 1, sc8_item32_$(end), 1, PRIORITY_GENERAL){
+    const $(cpu_type)_t *input = reinterpret_cast<const $(cpu_type)_t *>(inputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(size_t(outputs[0]) & ~0x3);
+    const $(cpu_type)_t dummy;
+    size_t num_samps = nsamps;
+
+    if ((size_t(outputs[0]) & 0x3) != 0){
+        const item32_t item0 = $(cpu_type)_to_item32_sc8(dummy, *input++, scale_factor);
+        *output = $(to_wire)(($(to_host)(*output) & 0xffff) | (item0 & 0xffff0000));
+        output++;
+        num_samps--;
+    }
+
+    const size_t num_pairs = num_samps/2;
+    for (size_t i = 0, j = 0; i < num_pairs; i++, j+=2){
+        output[i] = $(to_wire)($(cpu_type)_to_item32_sc8(input[j], input[j+1], scale_factor));
+    }
+
+    if (num_samps != num_pairs*2){
+        output[num_pairs] = $(to_wire)($(cpu_type)_to_item32_sc8(input[num_samps-1], dummy, scale_factor));
+    }
+}
+
 DECLARE_CONVERTER(sc8_item32_$(end), 1, $(cpu_type), 1, PRIORITY_GENERAL){
     const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) & ~0x3);
     $(cpu_type)_t *output = reinterpret_cast<$(cpu_type)_t *>(outputs[0]);
@@ -94,6 +118,43 @@ DECLARE_CONVERTER(sc8_item32_$(end), 1, $(cpu_type), 1, PRIORITY_GENERAL){
 }
 """
 
+TMPL_CONV_GEN2_SC12 = """
+DECLARE_CONVERTER($(cpu_type), 1, sc12_item32_$(end), 1, PRIORITY_GENERAL){
+    const $(cpu_type)_t *input = reinterpret_cast<const $(cpu_type)_t *>(inputs[0]);
+    const size_t phase = sc12_phase(outputs[0]);
+    item32_t *output = reinterpret_cast<item32_t *>(size_t(outputs[0]) - 3*phase);
+
+    for (size_t i = 0, k = phase; i < nsamps; k = 0, output += 3){
+        const size_t n = std::min(4 - k, nsamps - i);
+        cpu_to_item32_sc12_group<$(cpu_type)_t, $(to_host), $(to_wire)>(input + i, k, n, output, scale_factor);
+        i += n;
+    }
+}
+
+DECLARE_CONVERTER(sc12_item32_$(end), 1, $(cpu_type), 1, PRIORITY_GENERAL){
+    const size_t phase = sc12_phase(inputs[0]);
+    const item32_t *input = reinterpret_cast<const item32_t *>(size_t(inputs[0]) - 3*phase);
+    $(cpu_type)_t *output = reinterpret_cast<$(cpu_type)_t *>(outputs[0]);
+
+    for (size_t i = 0, k = phase; i < nsamps; k = 0, input += 3){
+        const size_t n = std::min(4 - k, nsamps - i);
+        item32_sc12_group_to_cpu<$(cpu_type)_t, $(to_host)>(input, k, n, output + i, scale_factor);
+        i += n;
+    }
+}
+"""
+
+TMPL_CONV_GEN2_CORRECT = """
+DECLARE_CORRECTING_CONVERTER(sc16_item32_$(end), fc32, PRIORITY_GENERAL){
+    const item32_t *input = reinterpret_cast<const item32_t *>(inputs[0]);
+    fc32_t *output = reinterpret_cast<fc32_t *>(outputs[0]);
+
+    for (size_t i = 0; i < nsamps; i++){
+        output[i] = item32_sc16_to_fc32($(to_host)(input[i]), *this);
+    }
+}
+"""
+
 TMPL_CONV_USRP1_COMPLEX = """
 DECLARE_CONVERTER($(cpu_type), $(width), sc16_item16_usrp1, 1, PRIORITY_GENERAL){
     #for $w in range($width)
@@ -170,10 +231,19 @@ if __name__ == '__main__':
                 TMPL_CONV_GEN2_SC8,
                 end=end, to_host=to_host, to_wire=to_wire, cpu_type=cpu_type
             )
+        for cpu_type in 'fc64', 'fc32', 'sc16':
+            output += parse_tmpl(
+                TMPL_CONV_GEN2_SC12,
+                end=end, to_host=to_host, to_wire=to_wire, cpu_type=cpu_type
+            )
         output += parse_tmpl(
                 TMPL_CONV_GEN2_ITEM32,
                 end=end, to_host=to_host, to_wire=to_wire
             )
+        output += parse_tmpl(
+                TMPL_CONV_GEN2_CORRECT,
+                end=end, to_host=to_host, to_wire=to_wire
+            )
 
     #generate complex converters for usrp1 format
     for width in 1, 2, 4:
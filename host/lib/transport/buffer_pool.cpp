@@ -16,8 +16,13 @@
 //
 
 #include <uhd/transport/buffer_pool.hpp>
+#include <uhd/utils/msg.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/bind.hpp>
 #include <vector>
+#ifdef HAVE_MAP_HUGETLB
+#include <sys/mman.h>
+#endif
 
 using namespace uhd::transport;
 
@@ -26,6 +31,30 @@ static size_t pad_to_boundary(const size_t bytes, const size_t alignment){
     return bytes + (alignment - bytes)%alignment;
 }
 
+/***********************************************************************
+ * Huge page memory:
+ * A large pool backed by huge pages takes fewer TLB entries.
+ * Returns an empty array when the system has no huge pages to give.
+ **********************************************************************/
+#ifdef HAVE_MAP_HUGETLB
+static const size_t huge_page_size = 2*1024*1024;
+
+static void free_huge_pages(char *mem, const size_t len){
+    ::munmap(mem, len);
+}
+
+static boost::shared_array<char> alloc_huge_pages(const size_t bytes){
+    const size_t len = pad_to_boundary(bytes, huge_page_size);
+    void *mem = ::mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (mem == MAP_FAILED) return boost::shared_array<char>();
+    return boost::shared_array<char>(static_cast<char *>(mem), boost::bind(&free_huge_pages, _1, len));
+}
+#else
+static boost::shared_array<char> alloc_huge_pages(const size_t){
+    return boost::shared_array<char>();
+}
+#endif /* HAVE_MAP_HUGETLB */
+
 /***********************************************************************
  * Buffer pool implementation
  **********************************************************************/
@@ -57,13 +86,20 @@ private:
 buffer_pool::sptr buffer_pool::make(
     const size_t num_buffs,
     const size_t buff_size,
-    const size_t alignment
+    const size_t alignment,
+    const bool huge_pages
 ){
     //1) pad the buffer size to be a multiple of alignment
     //2) pad the overall memory size for room after alignment
     //3) allocate the memory in one block of sufficient size
     const size_t padded_buff_size = pad_to_boundary(buff_size, alignment);
-    boost::shared_array<char> mem(new char[padded_buff_size*num_buffs + alignment-1]);
+    const size_t mem_size = padded_buff_size*num_buffs + alignment-1;
+    boost::shared_array<char> mem;
+    if (huge_pages){
+        mem = alloc_huge_pages(mem_size);
+        if (mem.get() == NULL) UHD_MSG(warning) << "Huge pages are not available, the buffer pool uses regular memory." << std::endl;
+    }
+    if (mem.get() == NULL) mem.reset(new char[mem_size]);
 
     //Fill a vector with boundary-aligned points in the memory
     const size_t mem_start = pad_to_boundary(size_t(mem.get()), alignment);
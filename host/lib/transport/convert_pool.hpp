@@ -0,0 +1,130 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_CONVERT_POOL_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_CONVERT_POOL_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <boost/bind.hpp>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+/***********************************************************************
+ * Convert pool
+ *
+ * A pool of worker threads that run the conversion of the channels
+ * of one packet set in parallel. The calling thread takes a share,
+ * channel i is converted by thread i modulo the number of threads,
+ * so a channel always lands on the same thread.
+ *
+ * Every worker acknowledges every run, so no worker can still be busy
+ * with a previous run when the next one starts. Idle workers spin for
+ * a while before they block, packets usually come faster than that.
+ **********************************************************************/
+class convert_pool : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<convert_pool> sptr;
+    typedef boost::function<void(const size_t)> task_type;
+
+    /*!
+     * Make a new convert pool.
+     * \param num_threads the number of converting threads with the caller
+     */
+    convert_pool(const size_t num_threads):
+        _num_workers(num_threads - 1), _task(NULL), _num_tasks(0)
+    {
+        for (size_t i = 0; i < _num_workers; i++){
+            _threads.create_thread(boost::bind(&convert_pool::worker, this, i + 1));
+        }
+    }
+
+    ~convert_pool(void){
+        _stop.write(1);
+        this->start_run();
+        _threads.join_all();
+    }
+
+    //! The number of converting threads, with the caller
+    size_t size(void) const{
+        return _num_workers + 1;
+    }
+
+    /*!
+     * Run task(i) for every i in [0, num_tasks).
+     * Returns when all of them have completed.
+     */
+    UHD_INLINE void run(const task_type &task, const size_t num_tasks){
+        _task = &task;
+        _num_tasks = num_tasks;
+        _num_done.write(0);
+        this->start_run();
+
+        //the caller's share
+        for (size_t i = 0; i < num_tasks; i += this->size()) task(i);
+
+        //wait on the workers
+        for (size_t spins = 0; _num_done.read() != _num_workers; spins++){
+            if (spins > _spins_before_yield) boost::this_thread::yield();
+        }
+    }
+
+private:
+    static const size_t _spins_before_yield = 1000;
+    static const size_t _spins_before_block = 100000;
+
+    const size_t _num_workers;
+    boost::thread_group _threads;
+    boost::mutex _mutex;
+    boost::condition_variable _cond;
+    atomic_uint32_t _generation, _num_done, _stop;
+    const task_type *_task;
+    size_t _num_tasks;
+
+    void start_run(void){
+        _generation.inc();
+        boost::mutex::scoped_lock lock(_mutex);
+        _cond.notify_all();
+    }
+
+    void worker(const size_t which){
+        boost::uint32_t seen = 0; //the generation before the first run
+        while (true){
+            //spin, then block until the next run
+            for (size_t spins = 0; _generation.read() == seen; spins++){
+                if (spins < _spins_before_block) continue;
+                boost::mutex::scoped_lock lock(_mutex);
+                while (_generation.read() == seen) _cond.wait(lock);
+            }
+            seen = _generation.read();
+            if (_stop.read() != 0) return;
+
+            for (size_t i = which; i < _num_tasks; i += this->size()) (*_task)(i);
+            _num_done.inc();
+        }
+    }
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_CONVERT_POOL_HPP */
@@ -0,0 +1,70 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_STREAM_EVENT_COUNTERS_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_STREAM_EVENT_COUNTERS_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+/***********************************************************************
+ * Stream event counters
+ *
+ * The events the host sees on the stream of one device channel.
+ * The device keeps them across streamers and publishes them in the
+ * property tree, the packet handlers count them with an atomic add.
+ **********************************************************************/
+class stream_event_counters{
+public:
+    typedef boost::shared_ptr<stream_event_counters> sptr;
+
+    enum event_type{
+        EVENT_OVERFLOW = 0,
+        EVENT_SEQ_ERROR,
+        EVENT_LATE_PACKET,
+        EVENT_TIMEOUT,
+        EVENT_ALIGNMENT,
+        NUM_EVENTS
+    };
+
+    //! The tree name of an event
+    static std::string get_name(const event_type event){
+        static const char *names[NUM_EVENTS] = {
+            "overflow", "seq_error", "late_packet", "timeout", "alignment"
+        };
+        return names[event];
+    }
+
+    UHD_INLINE void inc(const event_type event){
+        _counts[event].inc();
+    }
+
+    size_t get(const event_type event){
+        return _counts[event].read();
+    }
+
+private:
+    atomic_uint32_t _counts[NUM_EVENTS];
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_STREAM_EVENT_COUNTERS_HPP */
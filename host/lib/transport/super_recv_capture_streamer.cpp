@@ -0,0 +1,44 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "super_recv_capture_streamer.hpp"
+#include <uhd/transport/bounded_buffer.hpp>
+
+using namespace uhd::transport;
+using namespace uhd::transport::sph;
+
+class recv_capture_streamer::chunk_queue_impl : public recv_capture_streamer::chunk_queue{
+public:
+    chunk_queue_impl(const size_t capacity): _buff(capacity){
+        /* NOP */
+    }
+
+    bool push_with_haste(const chunk_type &chunk){
+        return _buff.push_with_haste(chunk);
+    }
+
+    bool pop_with_timed_wait(chunk_type &chunk, const double timeout){
+        return _buff.pop_with_timed_wait(chunk, timeout);
+    }
+
+private:
+    bounded_buffer<chunk_type> _buff;
+};
+
+recv_capture_streamer::chunk_queue::sptr recv_capture_streamer::chunk_queue::make(const size_t capacity){
+    return sptr(new chunk_queue_impl(capacity));
+}
@@ -0,0 +1,271 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_SUPER_RECV_CAPTURE_STREAMER_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_SUPER_RECV_CAPTURE_STREAMER_HPP
+
+#include "super_recv_packet_handler.hpp"
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/transport/buffer_pool.hpp>
+#include <uhd/utils/thread_priority.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+/***********************************************************************
+ * Receive capture streamer
+ *
+ * A capture task receives from a packet streamer into a large ring
+ * per channel, so the application reads at its own pace and a late
+ * recv() no longer backs up into the transport and the device.
+ * The task queues a chunk for every packet it received: where the
+ * samples sit in the rings and the packet metadata.
+ *
+ * When the application falls so far behind that the rings are full,
+ * the task keeps draining the transport but throws the samples away.
+ * The application gets ERROR_CODE_CAPTURE_OVERFLOW at the time of the
+ * first lost sample, device overflows still come as ERROR_CODE_OVERFLOW.
+ **********************************************************************/
+class recv_capture_streamer : public rx_streamer{
+public:
+    /*!
+     * Make a new capture streamer and start the capture task.
+     * \param streamer the packet streamer to receive from
+     * \param bytes_per_samp the size of a sample in the cpu format
+     * \param ring_samps the number of samples in each ring
+     * \param cpu the core to pin the capture task to, negative for none
+     * \param huge_pages true to back the rings with huge pages
+     */
+    recv_capture_streamer(
+        boost::shared_ptr<recv_packet_streamer> streamer,
+        const size_t bytes_per_samp,
+        const size_t ring_samps,
+        const int cpu = -1,
+        const bool huge_pages = false
+    ):
+        _streamer(streamer),
+        _bytes_per_samp(bytes_per_samp),
+        _ring_samps(std::max(ring_samps, 2*streamer->get_max_num_samps())),
+        _rings(buffer_pool::make(streamer->get_num_channels(), _ring_samps*bytes_per_samp, 64, huge_pages)),
+        _chunks(chunk_queue::make(4*_ring_samps/streamer->get_max_num_samps() + 64)),
+        _chunk_valid(false), _chunk_used(0),
+        _cpu(cpu), _write_pos(0), _num_written(0), _dropping(false), _overflow(false),
+        _scratch(streamer->get_num_channels()*streamer->get_max_num_samps()*bytes_per_samp),
+        _capture_buffs(streamer->get_num_channels())
+    {
+        _task = task::make(boost::bind(&recv_capture_streamer::capture, this));
+    }
+
+    ~recv_capture_streamer(void){
+        _task.reset(); //stops the capture before the rings go
+    }
+
+    size_t get_num_channels(void) const{
+        return _streamer->get_num_channels();
+    }
+
+    size_t get_max_num_samps(void) const{
+        return _streamer->get_max_num_samps();
+    }
+
+    size_t recv(
+        const rx_streamer::buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        uhd::rx_metadata_t &metadata,
+        const double timeout,
+        const bool one_packet
+    ){
+        size_t accum_num_samps = 0;
+        while (accum_num_samps < nsamps_per_buff){
+
+            //get the next chunk, a timeout returns what is there
+            if (not _chunk_valid){
+                if (not _chunks->pop_with_timed_wait(_chunk, timeout)){
+                    if (accum_num_samps != 0) break;
+                    metadata.has_time_spec = false;
+                    metadata.more_fragments = false;
+                    metadata.fragment_offset = 0;
+                    metadata.start_of_burst = false;
+                    metadata.end_of_burst = false;
+                    metadata.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
+                    return 0;
+                }
+                _chunk_valid = true;
+                _chunk_used = 0;
+            }
+
+            //errors come on their own, after the samples before them
+            if (_chunk.metadata.error_code != rx_metadata_t::ERROR_CODE_NONE){
+                if (accum_num_samps != 0) break;
+                metadata = _chunk.metadata;
+                this->release_chunk();
+                return 0;
+            }
+
+            //copy out of the rings
+            const size_t nsamps = std::min(_chunk.nsamps - _chunk_used, nsamps_per_buff - accum_num_samps);
+            for (size_t ch = 0; ch < buffs.size(); ch++){
+                std::memcpy(
+                    reinterpret_cast<char *>(buffs[ch]) + accum_num_samps*_bytes_per_samp,
+                    reinterpret_cast<const char *>(_rings->at(ch)) + (_chunk.offset + _chunk_used)*_bytes_per_samp,
+                    nsamps*_bytes_per_samp
+                );
+            }
+
+            //the metadata of the first chunk, a fragment when a previous recv took a part of it
+            if (accum_num_samps == 0){
+                metadata = _chunk.metadata;
+                if (_chunk_used != 0) metadata.time_spec += time_spec_t(0, _chunk_used, _chunk.samp_rate);
+                metadata.fragment_offset = _chunk_used;
+                metadata.more_fragments = _chunk_used + nsamps != _chunk.nsamps;
+            }
+            accum_num_samps += nsamps;
+            _chunk_used += nsamps;
+            if (_chunk_used == _chunk.nsamps) this->release_chunk();
+            if (one_packet) break;
+        }
+        return accum_num_samps;
+    }
+
+private:
+    //! samples in the rings and the metadata of a received packet
+    struct chunk_type{
+        size_t offset; //first sample in the rings
+        size_t nsamps; //samples in the rings
+        size_t skip; //samples skipped at the end of the rings before it
+        double samp_rate; //used to interpolate fragment times
+        rx_metadata_t metadata;
+    };
+
+    /*!
+     * A bounded_buffer of chunks, made in super_recv_capture_streamer.cpp:
+     * the buffer type has internal linkage, so a header cannot hold one.
+     */
+    class chunk_queue{
+    public:
+        typedef boost::shared_ptr<chunk_queue> sptr;
+        static sptr make(const size_t capacity);
+        virtual ~chunk_queue(void){}
+        virtual bool push_with_haste(const chunk_type &chunk) = 0;
+        virtual bool pop_with_timed_wait(chunk_type &chunk, const double timeout) = 0;
+    };
+    class chunk_queue_impl;
+
+    boost::shared_ptr<recv_packet_streamer> _streamer;
+    const size_t _bytes_per_samp;
+    const size_t _ring_samps;
+    buffer_pool::sptr _rings;
+    chunk_queue::sptr _chunks;
+    task::sptr _task;
+
+    //read side
+    chunk_type _chunk;
+    bool _chunk_valid;
+    size_t _chunk_used;
+    atomic_uint32_t _num_read; //samples given back to the capture task
+
+    //capture side
+    int _cpu;
+    size_t _write_pos;
+    boost::uint32_t _num_written;
+    bool _dropping; //samples lost since the last stored chunk
+    bool _overflow; //the overflow chunk still has to go
+    chunk_type _overflow_chunk;
+    std::vector<char> _scratch;
+    std::vector<void *> _capture_buffs;
+
+    void release_chunk(void){
+        _num_read.add(boost::uint32_t(_chunk.skip + _chunk.nsamps));
+        _chunk_valid = false;
+    }
+
+    /*******************************************************************
+     * Capture one packet:
+     * Called over and over by the capture task.
+     * Receive into the rings when a whole packet fits,
+     * otherwise into the scratch buffers to drop it.
+     ******************************************************************/
+    void capture(void){
+        if (_cpu >= 0){
+            set_thread_affinity_safe(size_t(_cpu));
+            _cpu = -1;
+        }
+
+        //a packet does not wrap, skip a ring end too short for one
+        const size_t spp = _streamer->get_max_num_samps();
+        const size_t skip = (_ring_samps - _write_pos < spp)? _ring_samps - _write_pos : 0;
+        const size_t num_free = _ring_samps - (_num_written - _num_read.read());
+        const bool has_room = num_free >= skip + spp;
+        const size_t offset = (_write_pos + skip)%_ring_samps;
+        for (size_t ch = 0; ch < _capture_buffs.size(); ch++){
+            _capture_buffs[ch] = (has_room)?
+                reinterpret_cast<char *>(_rings->at(ch)) + offset*_bytes_per_samp :
+                &_scratch[ch*spp*_bytes_per_samp];
+        }
+
+        chunk_type chunk;
+        chunk.nsamps = _streamer->recv(_capture_buffs, spp, chunk.metadata, 0.1, true);
+        chunk.samp_rate = _streamer->get_samp_rate();
+
+        //the rings are full: drop the samples, report from the first lost one
+        const bool dropped = not has_room and chunk.nsamps != 0;
+        if (dropped) this->mark_overflow(chunk);
+
+        //a pending overflow goes before anything that came after it
+        if (_overflow){
+            if (not _chunks->push_with_haste(_overflow_chunk)) return;
+            _overflow = false;
+        }
+        if (dropped or chunk.metadata.error_code == rx_metadata_t::ERROR_CODE_TIMEOUT) return;
+
+        //errors and empty packets take no room in the rings
+        chunk.offset = (chunk.nsamps == 0)? 0 : offset;
+        chunk.skip = (chunk.nsamps == 0)? 0 : skip;
+        if (not _chunks->push_with_haste(chunk)){
+            if (chunk.nsamps != 0) this->mark_overflow(chunk);
+            return;
+        }
+        _num_written += boost::uint32_t(chunk.skip + chunk.nsamps);
+        if (chunk.nsamps != 0) _write_pos = offset + chunk.nsamps;
+        if (chunk.nsamps != 0) _dropping = false;
+    }
+
+    void mark_overflow(const chunk_type &chunk){
+        if (_dropping) return;
+        _dropping = true;
+        _overflow = true;
+        _overflow_chunk = chunk;
+        _overflow_chunk.offset = _overflow_chunk.nsamps = _overflow_chunk.skip = 0;
+        _overflow_chunk.metadata.error_code = rx_metadata_t::ERROR_CODE_CAPTURE_OVERFLOW;
+        _overflow_chunk.metadata.more_fragments = false;
+        _overflow_chunk.metadata.fragment_offset = 0;
+        _overflow_chunk.metadata.start_of_burst = false;
+        _overflow_chunk.metadata.end_of_burst = false;
+    }
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_SUPER_RECV_CAPTURE_STREAMER_HPP */
@@ -24,13 +24,17 @@
 #include <uhd/stream.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/byteswap.hpp>
+#include <uhd/utils/atomic.hpp>
 #include <uhd/types/metadata.hpp>
 #include <uhd/transport/vrt_if_packet.hpp>
 #include <uhd/transport/zero_copy.hpp>
-#include <boost/dynamic_bitset.hpp>
+#include "convert_pool.hpp"
+#include "tick_time.hpp"
+#include "stream_event_counters.hpp"
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
 #include <boost/format.hpp>
+#include <boost/thread/mutex.hpp>
 #include <iostream>
 #include <vector>
 
@@ -66,8 +70,9 @@ public:
      * \param size the number of transport channels
      */
     recv_packet_handler(const size_t size = 1):
+        _tick_rate(1.0), _samp_rate(1.0),
         _queue_error_for_next_call(false),
-        _buffers_infos_index(0)
+        _buffers_info(0)
     {
         this->resize(size);
         set_alignment_failure_threshold(1000);
@@ -77,8 +82,9 @@ public:
     void resize(const size_t size){
         if (this->size() == size) return;
         _props.resize(size);
-        //re-initialize all buffers infos by re-creating the vector
-        _buffers_infos = std::vector<buffers_info_type>(4, buffers_info_type(size));
+        BOOST_FOREACH(xport_chan_props_type &props, _props) props.io_buffs.resize(_io_buffs.size());
+        //re-initialize the buffers info by re-creating it
+        _buffers_info = buffers_info_type(size);
     }
 
     //! Get the channel width of this handler
@@ -104,11 +110,18 @@ public:
     //! Set the rate of ticks per second
     void set_tick_rate(const double rate){
         _tick_rate = rate;
+        _timebase.set_rates(_tick_rate, _samp_rate);
     }
 
     //! Set the rate of samples per second
     void set_samp_rate(const double rate){
         _samp_rate = rate;
+        _timebase.set_rates(_tick_rate, _samp_rate);
+    }
+
+    //! Get the rate of samples per second
+    double get_samp_rate(void) const{
+        return _samp_rate;
     }
 
     /*!
@@ -127,6 +140,16 @@ public:
     void set_converter(const uhd::convert::id_type &id){
         _io_buffs.resize(id.num_outputs);
         _converter = uhd::convert::get_converter(id)();
+        _converter_id = id;
+        //corrections are made for the previous conversion
+        boost::mutex::scoped_lock lock(_correction_mutex);
+        BOOST_FOREACH(xport_chan_props_type &props, _props){
+            props.converter.reset();
+            props.pending_converter.reset();
+            props.correction_pending = false;
+            props.io_buffs.resize(id.num_outputs);
+        }
+        lock.unlock();
         this->set_scale_factor(1/32767.); //update after setting converter
         _bytes_per_otw_item = uhd::convert::get_bytes_per_item(id.input_format);
         _bytes_per_cpu_item = uhd::convert::get_bytes_per_item(id.output_format);
@@ -137,9 +160,53 @@ public:
         _props.at(xport_chan).handle_overflow = handle_overflow;
     }
 
+    //! Set the event counters of the device channel behind a transport channel
+    void set_event_counters(const size_t xport_chan, stream_event_counters::sptr events){
+        _props.at(xport_chan).events = events;
+    }
+
     //! Set the scale factor used in float conversion
     void set_scale_factor(const double scale_factor){
+        boost::mutex::scoped_lock lock(_correction_mutex);
+        _scale_factor = scale_factor;
         _converter->set_scalar(scale_factor);
+        BOOST_FOREACH(xport_chan_props_type &props, _props){
+            if (props.converter) props.converter->set_scalar(scale_factor);
+            if (props.pending_converter) props.pending_converter->set_scalar(scale_factor);
+        }
+    }
+
+    /*!
+     * Correct the samples of a transport channel while converting.
+     * The channel switches to a correcting converter,
+     * the other channels keep the regular converter.
+     * Safe to call while another thread receives:
+     * the receiving thread swaps the converter in before its next packet.
+     * \param xport_chan which transport channel
+     * \param correction the dc offset, iq balance and gain
+     * \throw uhd::key_error when the conversion cannot correct
+     */
+    void set_correction(const size_t xport_chan, const uhd::convert::correction_type &correction){
+        //a new converter, the one in use is never touched from here
+        uhd::convert::converter::sptr converter = uhd::convert::get_correcting_converter(_converter_id)();
+        converter->set_correction(correction);
+        this->post_correction(xport_chan, converter);
+    }
+
+    //! Convert a transport channel's samples without correction
+    void clear_correction(const size_t xport_chan){
+        this->post_correction(xport_chan, uhd::convert::converter::sptr());
+    }
+
+    /*!
+     * Convert the transport channels of a packet in parallel.
+     * A single channel is always converted by the calling thread.
+     * \param num_threads the number of converting threads (1 for none)
+     */
+    void set_convert_threads(const size_t num_threads){
+        _convert_pool.reset();
+        if (num_threads > 1) _convert_pool.reset(new convert_pool(num_threads));
+        _convert_task = boost::bind(&recv_packet_handler::convert_xport_chan, this, _1);
     }
 
     /*******************************************************************
@@ -189,62 +256,132 @@ public:
         return accum_num_samps;
     }
 
+    /*******************************************************************
+     * Receive direct:
+     * Hand the samples left in the current buffers to the caller
+     * without a copy, the caller now holds the transport frames.
+     ******************************************************************/
+    UHD_INLINE size_t recv_direct(
+        uhd::rx_streamer::direct_buffs_type &buffs,
+        uhd::rx_metadata_t &metadata,
+        const double timeout
+    ){
+        buffs.release(); //previous frames go back before waiting on new ones
+
+        //handle metadata queued from a previous receive
+        if (_queue_error_for_next_call){
+            _queue_error_for_next_call = false;
+            metadata = _queue_metadata;
+            if (_queue_metadata.error_code != rx_metadata_t::ERROR_CODE_TIMEOUT) return 0;
+        }
+
+        buffers_info_type &info = get_unexpired_buffer_info(timeout);
+        metadata = info.metadata;
+
+        //the rest of the packet, a fragment when recv() took a part of it
+        metadata.time_spec = _timebase.to_time_spec(info.time + _timebase.samps_to_ticks(info.fragment_offset_in_samps));
+        metadata.more_fragments = false;
+        metadata.fragment_offset = info.fragment_offset_in_samps;
+        const size_t nsamps = info.data_bytes_to_copy/_bytes_per_otw_item;
+        if (nsamps == 0) return 0;
+
+        buffs.nsamps = nsamps;
+        buffs.format = _converter_id.input_format;
+        BOOST_FOREACH(per_buffer_info_type &buff_info, info){
+            buffs.buffs.push_back(buff_info.copy_buff);
+            buffs.frames.push_back(buff_info.buff);
+            buff_info.buff.reset(); //the caller releases it
+        }
+        info.fragment_offset_in_samps += nsamps;
+        info.data_bytes_to_copy = 0;
+        return nsamps;
+    }
+
 private:
 
     vrt_unpacker_type _vrt_unpacker;
     size_t _header_offset_words32;
     double _tick_rate, _samp_rate;
+    tick_timebase _timebase;
     bool _queue_error_for_next_call;
     size_t _alignment_faulure_threshold;
     rx_metadata_t _queue_metadata;
+
+    //! information stored for a received buffer
+    struct per_buffer_info_type{
+        managed_recv_buffer::sptr buff;
+        const boost::uint32_t *vrt_hdr;
+        vrt::if_packet_info_t ifpi;
+        tick_time_type time;
+        const char *copy_buff;
+    };
+
     struct xport_chan_props_type{
         xport_chan_props_type(void):
             packet_count(0),
-            handle_overflow(&handle_overflow_nop)
+            handle_overflow(&handle_overflow_nop),
+            correction_pending(false),
+            packet_nsamps(0),
+            packet_offset(0),
+            last_time(0),
+            next_time(0),
+            next_time_valid(false)
         {}
         get_buff_type get_buff;
         size_t packet_count;
         handle_overflow_type handle_overflow;
+        stream_event_counters::sptr events; //of the device channel, when set
+        uhd::convert::converter::sptr converter; //set when correcting, owned by the receiving thread
+        uhd::convert::converter::sptr pending_converter; //the next converter, under the correction mutex
+        bool correction_pending;
+        std::vector<void *> io_buffs; //used in conversion
+
+        //the packet held for alignment until all of its samples are used
+        per_buffer_info_type packet;
+        size_t packet_nsamps; //samples in the held packet
+        size_t packet_offset; //samples already used or skipped
+        tick_time_type packet_pos; //time of the first unused sample
+        tick_time_type last_time; //time of the last data packet, checks the order
+        tick_time_type next_time; //time after the last data packet, reported on overflow
+        bool next_time_valid;
+
+        bool has_packet(void) const{return packet.buff.get() != NULL;}
+        void release_packet(void){
+            packet.buff.reset();
+            packet_nsamps = packet_offset = 0;
+        }
     };
     std::vector<xport_chan_props_type> _props;
     std::vector<void *> _io_buffs; //used in conversion
     size_t _bytes_per_otw_item; //used in conversion
     size_t _bytes_per_cpu_item; //used in conversion
     uhd::convert::converter::sptr _converter; //used in conversion
-
-    //! information stored for a received buffer
-    struct per_buffer_info_type{
-        managed_recv_buffer::sptr buff;
-        const boost::uint32_t *vrt_hdr;
-        vrt::if_packet_info_t ifpi;
-        time_spec_t time;
-        const char *copy_buff;
-    };
+    uhd::convert::id_type _converter_id;
+    double _scale_factor;
+    boost::mutex _correction_mutex; //guards the pending converters and the scale factor
+    atomic_uint32_t _corrections_pending; //non-zero when a pending converter waits
+    convert_pool::sptr _convert_pool;
+    convert_pool::task_type _convert_task;
+    const uhd::rx_streamer::buffs_type *_convert_buffs; //used in conversion
+    size_t _convert_offset_bytes, _convert_nsamps; //used in conversion
 
     //!information stored for a set of aligned buffers
     struct buffers_info_type : std::vector<per_buffer_info_type> {
         buffers_info_type(const size_t size):
             std::vector<per_buffer_info_type>(size),
-            indexes_todo(size, true),
-            alignment_time_valid(false),
             data_bytes_to_copy(0),
-            fragment_offset_in_samps(0)
+            fragment_offset_in_samps(0),
+            time(0)
         {/* NOP */}
-        boost::dynamic_bitset<> indexes_todo; //used in alignment logic
-        time_spec_t alignment_time; //used in alignment logic
-        bool alignment_time_valid; //used in alignment logic
         size_t data_bytes_to_copy; //keeps track of state
         size_t fragment_offset_in_samps; //keeps track of state
+        tick_time_type time; //time of the first sample
         rx_metadata_t metadata; //packet description
     };
 
-    //! a circular queue of buffer infos
-    std::vector<buffers_info_type> _buffers_infos;
-    size_t _buffers_infos_index;
-    buffers_info_type &get_curr_buffer_info(void){return _buffers_infos[_buffers_infos_index];}
-    buffers_info_type &get_prev_buffer_info(void){return _buffers_infos[(_buffers_infos_index + 3)%4];}
-    buffers_info_type &get_next_buffer_info(void){return _buffers_infos[(_buffers_infos_index + 1)%4];}
-    void increment_buffer_info(void){_buffers_infos_index = (_buffers_infos_index + 1)%4;}
+    //! the aligned set of buffers being copied out
+    buffers_info_type _buffers_info;
+    buffers_info_type &get_curr_buffer_info(void){return _buffers_info;}
 
     //! possible return options for the packet receiver
     enum packet_type{
@@ -263,12 +400,11 @@ private:
      ******************************************************************/
     UHD_INLINE packet_type get_and_process_single_packet(
         const size_t index,
-        buffers_info_type &prev_buffer_info,
-        buffers_info_type &curr_buffer_info,
         double timeout
     ){
         //get a single packet from the transport layer
-        managed_recv_buffer::sptr &buff = curr_buffer_info[index].buff;
+        per_buffer_info_type &info = _props[index].packet;
+        managed_recv_buffer::sptr &buff = info.buff;
         buff = _props[index].get_buff(timeout);
         if (buff.get() == NULL) return PACKET_TIMEOUT_ERROR;
 
@@ -279,11 +415,10 @@ private:
         }
 
         //extract packet info
-        per_buffer_info_type &info = curr_buffer_info[index];
         info.ifpi.num_packet_words32 = num_packet_words32 - _header_offset_words32;
         info.vrt_hdr = buff->cast<const boost::uint32_t *>() + _header_offset_words32;
         _vrt_unpacker(info.vrt_hdr, info.ifpi);
-        info.time = time_spec_t(time_t(info.ifpi.tsi), size_t(info.ifpi.tsf), _tick_rate); //assumes has_tsi and has_tsf are true
+        info.time = _timebase.from_vrt(info.ifpi.tsi, info.ifpi.tsf); //assumes has_tsi and has_tsf are true
         info.copy_buff = reinterpret_cast<const char *>(info.vrt_hdr + info.ifpi.num_header_words32);
 
         //--------------------------------------------------------------
@@ -306,7 +441,7 @@ private:
         #endif
 
         //3) check for out of order timestamps
-        if (info.ifpi.has_tsi and info.ifpi.has_tsf and prev_buffer_info[index].time > info.time){
+        if (info.ifpi.has_tsi and info.ifpi.has_tsf and _props[index].last_time > info.time){
             return PACKET_TIMESTAMP_ERROR;
         }
 
@@ -315,168 +450,267 @@ private:
     }
 
     /*******************************************************************
-     * Alignment check:
-     * Check the received packet for alignment and mark accordingly.
+     * Hold a received data packet for alignment:
+     * Record where its samples sit in time.
      ******************************************************************/
-    UHD_INLINE void alignment_check(
-        const size_t index, buffers_info_type &info
-    ){
-        //if alignment time was not valid or if the sequence id is newer:
-        //  use this index's time as the alignment time
-        //  reset the indexes list and remove this index
-        if (not info.alignment_time_valid or info[index].time > info.alignment_time){
-            info.alignment_time_valid = true;
-            info.alignment_time = info[index].time;
-            info.indexes_todo.set();
-            info.indexes_todo.reset(index);
-            info.data_bytes_to_copy = info[index].ifpi.num_payload_bytes;
-        }
+    UHD_INLINE void hold_packet(const size_t index){
+        xport_chan_props_type &props = _props[index];
+        props.packet_nsamps = props.packet.ifpi.num_payload_bytes/_bytes_per_otw_item;
+        props.packet_offset = 0;
+        props.packet_pos = props.packet.time;
+        props.last_time = props.packet.time;
+        props.next_time = props.packet.time + _timebase.samps_to_ticks(props.packet_nsamps);
+        props.next_time_valid = props.packet.ifpi.has_tsi and props.packet.ifpi.has_tsf;
+    }
 
-        //if the sequence id matches:
-        //  remove this index from the list and continue
-        else if (info[index].time == info.alignment_time){
-            info.indexes_todo.reset(index);
-        }
+    //! Fill in the metadata for a receive that yields no samples
+    UHD_INLINE void set_error_metadata(
+        rx_metadata_t::error_code_t error_code,
+        const bool has_time_spec = false,
+        const tick_time_type time = 0
+    ){
+        buffers_info_type &info = get_curr_buffer_info();
+        info.data_bytes_to_copy = 0;
+        info.time = time;
+        info.metadata.has_time_spec = has_time_spec;
+        info.metadata.time_spec = _timebase.to_time_spec(time);
+        info.metadata.more_fragments = false;
+        info.metadata.fragment_offset = 0;
+        info.metadata.start_of_burst = false;
+        info.metadata.end_of_burst = false;
+        info.metadata.error_code = error_code;
+    }
 
-        //if the sequence id is older:
-        //  continue with the same index to try again
-        //else if (info[index].time < info.alignment_time)...
+    //! Count an event of a channel, when the channel has counters
+    UHD_INLINE void count_event(const size_t index, const stream_event_counters::event_type event){
+        if (_props[index].events.get() != NULL) _props[index].events->inc(event);
     }
 
     /*******************************************************************
      * Get aligned buffers:
-     * Iterate through each index and try to accumulate aligned buffers.
+     * Every channel holds its next packet and the position in time
+     * of the first unused sample. Channels without samples receive,
+     * then the channels behind the latest of them catch up:
+     * packets that end before it are dropped, the packet that
+     * spans it is cut at the matching sample. So channels that came
+     * apart after an overflow line up again in a single pass over
+     * the channels, even when the packets do not start together.
      * Handle all of the edge cases like inline messages and errors.
-     * The logic will throw out older packets until it finds a match.
      ******************************************************************/
     UHD_INLINE void get_aligned_buffs(double timeout){
 
-        increment_buffer_info(); //increment to next buffer
-        buffers_info_type &prev_info = get_prev_buffer_info();
-        buffers_info_type &curr_info = get_curr_buffer_info();
-        buffers_info_type &next_info = get_next_buffer_info();
+        buffers_info_type &info = get_curr_buffer_info();
 
-        //Loop until we get a message of an aligned set of buffers:
-        // - Receive a single packet and extract its info.
+        //Loop until we get a message or an aligned set of buffers:
+        // - Receive a packet on the channels that have no samples.
         // - Handle the packet type yielded by the receive.
-        // - Check the timestamps for alignment conditions.
+        // - Catch the channels up with the latest one.
         size_t iterations = 0;
-        while (curr_info.indexes_todo.any()){
-
-            //get the index to process for this iteration
-            const size_t index = curr_info.indexes_todo.find_first();
-            packet_type packet;
+        while (true){
 
-            //receive a single packet from the transport
-            try{
-                packet = get_and_process_single_packet(
-                    index, prev_info, curr_info, timeout
-                );
-            }
+            bool restart = false;
+            for (size_t index = 0; index < this->size(); index++){
+                xport_chan_props_type &props = _props[index];
+                if (props.has_packet()) continue;
+                packet_type packet;
 
-            //handle the case when the get packet throws
-            catch(const std::exception &e){
-                UHD_MSG(error) << boost::format(
-                    "The receive packet handler caught an exception.\n%s"
-                ) % e.what() << std::endl;
-                std::swap(curr_info, next_info); //save progress from curr -> next
-                curr_info.metadata.has_time_spec = false;
-                curr_info.metadata.time_spec = time_spec_t(0.0);
-                curr_info.metadata.more_fragments = false;
-                curr_info.metadata.fragment_offset = 0;
-                curr_info.metadata.start_of_burst = false;
-                curr_info.metadata.end_of_burst = false;
-                curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_BAD_PACKET;
-                return;
-            }
-
-            switch(packet){
-            case PACKET_IF_DATA:
-                alignment_check(index, curr_info);
-                break;
-
-            case PACKET_TIMESTAMP_ERROR:
-                //If the user changes the device time while streaming or without flushing,
-                //we can receive a packet that comes before the previous packet in time.
-                //This could cause the alignment logic to discard future received packets.
-                //Therefore, when this occurs, we reset the info to restart from scratch.
-                if (curr_info.alignment_time_valid and curr_info.alignment_time != curr_info[index].time){
-                    curr_info.alignment_time_valid = false;
+                //receive a single packet from the transport
+                try{
+                    packet = get_and_process_single_packet(index, timeout);
                 }
-                alignment_check(index, curr_info);
-                break;
 
-            case PACKET_INLINE_MESSAGE:
-                std::swap(curr_info, next_info); //save progress from curr -> next
-                curr_info.metadata.has_time_spec = next_info[index].ifpi.has_tsi and next_info[index].ifpi.has_tsf;
-                curr_info.metadata.time_spec = next_info[index].time;
-                curr_info.metadata.more_fragments = false;
-                curr_info.metadata.fragment_offset = 0;
-                curr_info.metadata.start_of_burst = false;
-                curr_info.metadata.end_of_burst = false;
-                curr_info.metadata.error_code = rx_metadata_t::error_code_t(get_context_code(next_info[index].vrt_hdr, next_info[index].ifpi));
-                if (curr_info.metadata.error_code == rx_metadata_t::ERROR_CODE_OVERFLOW){
-                    _props[index].handle_overflow();
-                    UHD_MSG(fastpath) << "O";
+                //handle the case when the get packet throws
+                catch(const std::exception &e){
+                    UHD_MSG(error) << boost::format(
+                        "The receive packet handler caught an exception.\n%s"
+                    ) % e.what() << std::endl;
+                    props.release_packet();
+                    set_error_metadata(rx_metadata_t::ERROR_CODE_BAD_PACKET);
+                    return;
                 }
-                return;
 
-            case PACKET_TIMEOUT_ERROR:
-                std::swap(curr_info, next_info); //save progress from curr -> next
-                curr_info.metadata.has_time_spec = false;
-                curr_info.metadata.time_spec = time_spec_t(0.0);
-                curr_info.metadata.more_fragments = false;
-                curr_info.metadata.fragment_offset = 0;
-                curr_info.metadata.start_of_burst = false;
-                curr_info.metadata.end_of_burst = false;
-                curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_TIMEOUT;
-                return;
+                switch(packet){
+                case PACKET_IF_DATA:
+                    hold_packet(index);
+                    break;
+
+                case PACKET_TIMESTAMP_ERROR:
+                    //If the user changes the device time while streaming or without flushing,
+                    //we can receive a packet that comes before the previous packet in time.
+                    //The packets held on the other channels are from before the change,
+                    //so drop them and restart the alignment from this packet.
+                    for (size_t i = 0; i < this->size(); i++){
+                        if (i == index) continue;
+                        _props[i].release_packet();
+                        _props[i].last_time = props.packet.time;
+                    }
+                    hold_packet(index);
+                    restart = true;
+                    break;
+
+                case PACKET_INLINE_MESSAGE:
+                    set_error_metadata(
+                        rx_metadata_t::error_code_t(get_context_code(props.packet.vrt_hdr, props.packet.ifpi)),
+                        props.packet.ifpi.has_tsi and props.packet.ifpi.has_tsf, props.packet.time
+                    );
+                    props.release_packet();
+                    if (info.metadata.error_code == rx_metadata_t::ERROR_CODE_OVERFLOW){
+                        props.handle_overflow();
+                        count_event(index, stream_event_counters::EVENT_OVERFLOW);
+                        uhd::msg::post_fastpath('O');
+                    }
+                    if (info.metadata.error_code == rx_metadata_t::ERROR_CODE_LATE_COMMAND){
+                        count_event(index, stream_event_counters::EVENT_LATE_PACKET);
+                    }
+                    return;
+
+                case PACKET_TIMEOUT_ERROR:
+                    set_error_metadata(rx_metadata_t::ERROR_CODE_TIMEOUT);
+                    count_event(index, stream_event_counters::EVENT_TIMEOUT);
+                    return;
+
+                case PACKET_SEQUENCE_ERROR:
+                    //the samples were lost from the end of the previous packet on,
+                    //the new packet stays held and is aligned on the next call
+                    set_error_metadata(rx_metadata_t::ERROR_CODE_OVERFLOW, props.next_time_valid, props.next_time);
+                    hold_packet(index);
+                    count_event(index, stream_event_counters::EVENT_SEQ_ERROR);
+                    uhd::msg::post_fastpath('O');
+                    return;
 
-            case PACKET_SEQUENCE_ERROR:
-                alignment_check(index, curr_info);
-                std::swap(curr_info, next_info); //save progress from curr -> next
-                curr_info.metadata.has_time_spec = prev_info.metadata.has_time_spec;
-                curr_info.metadata.time_spec = prev_info.metadata.time_spec + time_spec_t(0,
-                    prev_info[index].ifpi.num_payload_words32*sizeof(boost::uint32_t)/_bytes_per_otw_item, _samp_rate);
-                curr_info.metadata.more_fragments = false;
-                curr_info.metadata.fragment_offset = 0;
-                curr_info.metadata.start_of_burst = false;
-                curr_info.metadata.end_of_burst = false;
-                curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_OVERFLOW;
-                UHD_MSG(fastpath) << "O";
-                return;
+                }
+            }
+            if (restart) continue;
+
+            //the alignment position is the latest first sample
+            tick_time_type align_pos = _props[0].packet_pos;
+            for (size_t index = 1; index < this->size(); index++){
+                align_pos = std::max(align_pos, _props[index].packet_pos);
+            }
 
+            //catch up the channels behind it, half a sample is aligned
+            bool aligned = true;
+            BOOST_FOREACH(xport_chan_props_type &props, _props){
+                if (props.packet_pos == align_pos) continue;
+                const double nsamps_behind = _timebase.ticks_to_samps(align_pos - props.packet_pos) + 0.5;
+                if (nsamps_behind < 1.0) continue;
+                aligned = false;
+                if (nsamps_behind >= props.packet_nsamps - props.packet_offset){
+                    props.release_packet();
+                    iterations++;
+                }
+                else{
+                    props.packet_offset += size_t(nsamps_behind);
+                    props.packet_pos = props.packet.time + _timebase.samps_to_ticks(props.packet_offset);
+                }
             }
+            if (aligned) break;
 
-            //too many iterations: detect alignment failure
-            if (iterations++ > _alignment_faulure_threshold){
+            //too many packets dropped: detect alignment failure
+            if (iterations > _alignment_faulure_threshold){
                 UHD_MSG(error) << boost::format(
                     "The receive packet handler failed to time-align packets.\n"
                     "%u received packets were processed by the handler.\n"
                     "However, a timestamp match could not be determined.\n"
                 ) % iterations << std::endl;
-                std::swap(curr_info, next_info); //save progress from curr -> next
-                curr_info.metadata.has_time_spec = false;
-                curr_info.metadata.time_spec = time_spec_t(0.0);
-                curr_info.metadata.more_fragments = false;
-                curr_info.metadata.fragment_offset = 0;
-                curr_info.metadata.start_of_burst = false;
-                curr_info.metadata.end_of_burst = false;
-                curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_ALIGNMENT;
+                set_error_metadata(rx_metadata_t::ERROR_CODE_ALIGNMENT);
+                for (size_t index = 0; index < this->size(); index++){
+                    count_event(index, stream_event_counters::EVENT_ALIGNMENT);
+                }
                 return;
             }
 
         }
 
+        //the set spans the samples all channels have
+        size_t nsamps = _props[0].packet_nsamps - _props[0].packet_offset;
+        BOOST_FOREACH(const xport_chan_props_type &props, _props){
+            nsamps = std::min(nsamps, props.packet_nsamps - props.packet_offset);
+        }
+
         //set the metadata from the buffer information at index zero
-        curr_info.metadata.has_time_spec = curr_info[0].ifpi.has_tsi and curr_info[0].ifpi.has_tsf;
-        curr_info.metadata.time_spec = curr_info[0].time;
-        curr_info.metadata.more_fragments = false;
-        curr_info.metadata.fragment_offset = 0;
-        curr_info.metadata.start_of_burst = curr_info[0].ifpi.sob;
-        curr_info.metadata.end_of_burst = curr_info[0].ifpi.eob;
-        curr_info.metadata.error_code = rx_metadata_t::ERROR_CODE_NONE;
+        const xport_chan_props_type &props0 = _props[0];
+        info.metadata.has_time_spec = props0.packet.ifpi.has_tsi and props0.packet.ifpi.has_tsf;
+        info.time = props0.packet_pos;
+        info.metadata.time_spec = _timebase.to_time_spec(info.time);
+        info.metadata.more_fragments = false;
+        info.metadata.fragment_offset = 0;
+        info.metadata.start_of_burst = props0.packet.ifpi.sob and props0.packet_offset == 0;
+        info.metadata.end_of_burst = props0.packet.ifpi.eob and props0.packet_offset + nsamps == props0.packet_nsamps;
+        info.metadata.error_code = rx_metadata_t::ERROR_CODE_NONE;
+        info.data_bytes_to_copy = nsamps*_bytes_per_otw_item;
+
+        //take the samples from the held packets, used up packets go to the set
+        for (size_t index = 0; index < this->size(); index++){
+            xport_chan_props_type &props = _props[index];
+            info[index].buff = props.packet.buff;
+            info[index].copy_buff = props.packet.copy_buff + props.packet_offset*_bytes_per_otw_item;
+            props.packet_offset += nsamps;
+            props.packet_pos = props.packet.time + _timebase.samps_to_ticks(props.packet_offset);
+            if (props.packet_offset == props.packet_nsamps) props.release_packet();
+        }
+    }
+
+    /*******************************************************************
+     * Get the current buffer info with samples left in it:
+     * When the current one has expired, get the next aligned buffers.
+     ******************************************************************/
+    UHD_INLINE buffers_info_type &get_unexpired_buffer_info(const double timeout){
+        if (get_curr_buffer_info().data_bytes_to_copy == 0){
+
+            //release the expired buffers and reset for reuse
+            BOOST_FOREACH(per_buffer_info_type &buff_info, get_curr_buffer_info()){
+                buff_info.buff.reset();
+            }
+            get_curr_buffer_info().fragment_offset_in_samps = 0;
 
+            //perform receive with alignment logic
+            get_aligned_buffs(timeout);
+        }
+        return get_curr_buffer_info();
+    }
+
+    /*******************************************************************
+     * Corrections:
+     * Set from any thread into a pending slot,
+     * swapped in by the receiving thread between packets.
+     ******************************************************************/
+    void post_correction(const size_t xport_chan, uhd::convert::converter::sptr converter){
+        boost::mutex::scoped_lock lock(_correction_mutex);
+        if (converter) converter->set_scalar(_scale_factor);
+        xport_chan_props_type &props = _props.at(xport_chan);
+        props.pending_converter = converter;
+        props.correction_pending = true;
+        _corrections_pending.write(1);
+    }
+
+    UHD_INLINE void apply_corrections(void){
+        if (_corrections_pending.read() == 0) return;
+        boost::mutex::scoped_lock lock(_correction_mutex);
+        _corrections_pending.write(0);
+        BOOST_FOREACH(xport_chan_props_type &props, _props){
+            if (not props.correction_pending) continue;
+            props.converter.swap(props.pending_converter);
+            props.pending_converter.reset(); //the old one goes here, nothing converts with it
+            props.correction_pending = false;
+        }
+    }
+
+    /*******************************************************************
+     * Copy-convert the samples of one transport channel:
+     * Called from the convert pool when there is one.
+     ******************************************************************/
+    UHD_INLINE void convert_xport_chan(const size_t index){
+        xport_chan_props_type &props = _props[index];
+
+        //fill a vector with pointers to the io buffers
+        size_t buff_index = index*props.io_buffs.size();
+        BOOST_FOREACH(void *&io_buff, props.io_buffs){
+            io_buff = reinterpret_cast<char *>((*_convert_buffs)[buff_index++]) + _convert_offset_bytes;
+        }
+
+        const uhd::convert::converter::sptr &converter = props.converter? props.converter : _converter;
+        converter->conv(get_curr_buffer_info()[index].copy_buff, props.io_buffs, _convert_nsamps);
     }
 
     /*******************************************************************
@@ -492,23 +726,14 @@ private:
         const double timeout,
         const size_t buffer_offset_bytes = 0
     ){
-        //get the next buffer if the current one has expired
-        if (get_curr_buffer_info().data_bytes_to_copy == 0){
-
-            //reset current buffer info members for reuse
-            get_curr_buffer_info().fragment_offset_in_samps = 0;
-            get_curr_buffer_info().alignment_time_valid = false;
-            get_curr_buffer_info().indexes_todo.set();
-
-            //perform receive with alignment logic
-            get_aligned_buffs(timeout);
-        }
-
-        buffers_info_type &info = get_curr_buffer_info();
+        this->apply_corrections(); //no conversion runs at this point
+        buffers_info_type &info = get_unexpired_buffer_info(timeout);
         metadata = info.metadata;
 
         //interpolate the time spec (useful when this is a fragment)
-        metadata.time_spec += time_spec_t(0, info.fragment_offset_in_samps, _samp_rate);
+        if (info.fragment_offset_in_samps != 0){
+            metadata.time_spec = _timebase.to_time_spec(info.time + _timebase.samps_to_ticks(info.fragment_offset_in_samps));
+        }
 
         //extract the number of samples available to copy
         const size_t nsamps_available = info.data_bytes_to_copy/_bytes_per_otw_item;
@@ -516,18 +741,19 @@ private:
         const size_t bytes_to_copy = nsamps_to_copy*_bytes_per_otw_item;
         const size_t nsamps_to_copy_per_io_buff = nsamps_to_copy/_io_buffs.size();
 
-        size_t buff_index = 0;
-        BOOST_FOREACH(per_buffer_info_type &buff_info, info){
-
-            //fill a vector with pointers to the io buffers
-            BOOST_FOREACH(void *&io_buff, _io_buffs){
-                io_buff = reinterpret_cast<char *>(buffs[buff_index++]) + buffer_offset_bytes;
-            }
-
-            //copy-convert the samples from the recv buffer
-            _converter->conv(buff_info.copy_buff, _io_buffs, nsamps_to_copy_per_io_buff);
+        //copy-convert the samples from the recv buffers
+        _convert_buffs = &buffs;
+        _convert_offset_bytes = buffer_offset_bytes;
+        _convert_nsamps = nsamps_to_copy_per_io_buff;
+        if (_convert_pool.get() != NULL and info.size() > 1){
+            _convert_pool->run(_convert_task, info.size());
+        }
+        else for (size_t index = 0; index < info.size(); index++){
+            this->convert_xport_chan(index);
+        }
 
-            //update the rx copy buffer to reflect the bytes copied
+        //update the rx copy buffers to reflect the bytes copied
+        BOOST_FOREACH(per_buffer_info_type &buff_info, info){
             buff_info.copy_buff += bytes_to_copy;
         }
         //update the copy buffer's availability
@@ -573,6 +799,14 @@ public:
         return recv_packet_handler::recv(buffs, nsamps_per_buff, metadata, timeout, one_packet);
     }
 
+    size_t recv_direct(
+        rx_streamer::direct_buffs_type &buffs,
+        uhd::rx_metadata_t &metadata,
+        const double timeout
+    ){
+        return recv_packet_handler::recv_direct(buffs, metadata, timeout);
+    }
+
 private:
     size_t _max_num_samps;
 };
@@ -27,6 +27,8 @@
 #include <uhd/types/metadata.hpp>
 #include <uhd/transport/vrt_if_packet.hpp>
 #include <uhd/transport/zero_copy.hpp>
+#include "convert_pool.hpp"
+#include "tick_time.hpp"
 #include <boost/thread/thread_time.hpp>
 #include <boost/foreach.hpp>
 #include <boost/function.hpp>
@@ -35,6 +37,9 @@
 
 namespace uhd{ namespace transport{ namespace sph{
 
+typedef boost::function<void(void)> handle_flush_type;
+static inline void handle_flush_nop(void){}
+
 /***********************************************************************
  * Super send packet handler
  *
@@ -53,7 +58,7 @@ public:
      * \param size the number of transport channels
      */
     send_packet_handler(const size_t size = 1):
-        _next_packet_seq(0)
+        _has_tlr(false), _tick_rate(1.0), _samp_rate(1.0), _next_packet_seq(0)
     {
         this->resize(size);
     }
@@ -62,6 +67,7 @@ public:
     void resize(const size_t size){
         if (this->size() == size) return;
         _props.resize(size);
+        BOOST_FOREACH(xport_chan_props_type &props, _props) props.io_buffs.resize(_io_buffs.size());
         static const boost::uint64_t zero = 0;
         _zero_buffs.resize(size, &zero);
     }
@@ -77,14 +83,26 @@ public:
         _header_offset_words32 = header_offset_words32;
     }
 
+    /*!
+     * Append a trailer to every packet.
+     * The trailer holds the occupancy of the last payload word,
+     * needed by formats whose samples do not fill whole words.
+     * \param enb true to send the trailer
+     */
+    void set_enable_trailer(const bool enb){
+        _has_tlr = enb;
+    }
+
     //! Set the rate of ticks per second
     void set_tick_rate(const double rate){
         _tick_rate = rate;
+        _timebase.set_rates(_tick_rate, _samp_rate);
     }
 
     //! Set the rate of samples per second
     void set_samp_rate(const double rate){
         _samp_rate = rate;
+        _timebase.set_rates(_tick_rate, _samp_rate);
     }
 
     /*!
@@ -96,9 +114,32 @@ public:
         _props.at(xport_chan).get_buff = get_buff;
     }
 
+    /*!
+     * Set the transport channel's flush handler.
+     * The handler is called after committing an end of burst packet,
+     * so that a transport which defers its commits sends them right away.
+     * \param xport_chan which transport channel
+     * \param handle_flush the flush function
+     */
+    void set_xport_chan_flush(const size_t xport_chan, const handle_flush_type &handle_flush){
+        _props.at(xport_chan).handle_flush = handle_flush;
+    }
+
+    /*!
+     * Convert the transport channels of a packet in parallel.
+     * A single channel is always converted by the calling thread.
+     * \param num_threads the number of converting threads (1 for none)
+     */
+    void set_convert_threads(const size_t num_threads){
+        _convert_pool.reset();
+        if (num_threads > 1) _convert_pool.reset(new convert_pool(num_threads));
+        _convert_task = boost::bind(&send_packet_handler::convert_xport_chan, this, _1);
+    }
+
     //! Set the conversion routine for all channels
     void set_converter(const uhd::convert::id_type &id){
         _io_buffs.resize(id.num_inputs);
+        BOOST_FOREACH(xport_chan_props_type &props, _props) props.io_buffs.resize(id.num_inputs);
         _converter = uhd::convert::get_converter(id)();
         this->set_scale_factor(32767.); //update after setting converter
         _bytes_per_otw_item = uhd::convert::get_bytes_per_item(id.output_format);
@@ -134,11 +175,11 @@ public:
         vrt::if_packet_info_t if_packet_info;
         if_packet_info.has_sid = false;
         if_packet_info.has_cid = false;
-        if_packet_info.has_tlr = false;
+        if_packet_info.has_tlr = _has_tlr;
         if_packet_info.has_tsi = metadata.has_time_spec;
         if_packet_info.has_tsf = metadata.has_time_spec;
-        if_packet_info.tsi     = boost::uint32_t(metadata.time_spec.get_full_secs());
-        if_packet_info.tsf     = boost::uint64_t(metadata.time_spec.get_tick_count(_tick_rate));
+        const tick_time_type time = _timebase.from_time_spec(metadata.time_spec);
+        _timebase.to_vrt(time, if_packet_info.tsi, if_packet_info.tsf);
         if_packet_info.sob     = metadata.start_of_burst;
         if_packet_info.eob     = metadata.end_of_burst;
 
@@ -174,9 +215,7 @@ public:
             if (num_samps_sent == 0) return total_num_samps_sent;
 
             //setup metadata for the next fragment
-            const time_spec_t time_spec = metadata.time_spec + time_spec_t(0, total_num_samps_sent, _samp_rate);
-            if_packet_info.tsi = boost::uint32_t(time_spec.get_full_secs());
-            if_packet_info.tsf = boost::uint64_t(time_spec.get_tick_count(_tick_rate));
+            _timebase.to_vrt(time + _timebase.samps_to_ticks(total_num_samps_sent), if_packet_info.tsi, if_packet_info.tsf);
             if_packet_info.sob = false;
 
         }
@@ -194,15 +233,28 @@ private:
 
     vrt_packer_type _vrt_packer;
     size_t _header_offset_words32;
+    bool _has_tlr;
     double _tick_rate, _samp_rate;
+    tick_timebase _timebase;
     struct xport_chan_props_type{
+        xport_chan_props_type(void):
+            handle_flush(&handle_flush_nop)
+        {}
         get_buff_type get_buff;
+        handle_flush_type handle_flush;
+        managed_send_buffer::sptr buff; //held while converting in parallel, kept over a timeout
+        boost::uint32_t *otw_mem; //used in conversion
+        std::vector<const void *> io_buffs; //used in conversion
     };
     std::vector<xport_chan_props_type> _props;
     std::vector<const void *> _io_buffs; //used in conversion
     size_t _bytes_per_otw_item; //used in conversion
     size_t _bytes_per_cpu_item; //used in conversion
     uhd::convert::converter::sptr _converter; //used in conversion
+    convert_pool::sptr _convert_pool;
+    convert_pool::task_type _convert_task;
+    const uhd::tx_streamer::buffs_type *_convert_buffs; //used in conversion
+    size_t _convert_offset_bytes, _convert_nsamps; //used in conversion
     size_t _max_samples_per_packet;
     std::vector<const void *> _zero_buffs;
     size_t _next_packet_seq;
@@ -221,6 +273,11 @@ private:
         if_packet_info.num_payload_bytes = nsamps_per_buff*_io_buffs.size()*_bytes_per_otw_item;
         if_packet_info.num_payload_words32 = (if_packet_info.num_payload_bytes + 3/*round up*/)/sizeof(boost::uint32_t);
         if_packet_info.packet_count = _next_packet_seq;
+        if_packet_info.tlr = 0; //the packer adds the occupancy bits
+
+        if (_convert_pool.get() != NULL and _props.size() > 1) return send_one_packet_parallel(
+            buffs, nsamps_per_buff, if_packet_info, timeout, buffer_offset_bytes
+        );
 
         size_t buff_index = 0;
         BOOST_FOREACH(xport_chan_props_type &props, _props){
@@ -244,10 +301,67 @@ private:
             size_t num_bytes_total = (_header_offset_words32+if_packet_info.num_packet_words32)*sizeof(boost::uint32_t);
             buff->commit(num_bytes_total);
 
+            //the burst is over: dont leave the last packet queued
+            if (if_packet_info.eob) props.handle_flush();
+        }
+        _next_packet_seq++; //increment sequence after commits
+        return nsamps_per_buff;
+    }
+
+    /*******************************************************************
+     * Send a single packet, converting the channels in parallel:
+     * All send buffers are held before converting into them,
+     * then committed in channel order.
+     * On a timeout the buffers already held are kept for the next call,
+     * a buffer released without a commit would waste a flow control slot.
+     ******************************************************************/
+    size_t send_one_packet_parallel(
+        const uhd::tx_streamer::buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        vrt::if_packet_info_t &if_packet_info,
+        const double timeout,
+        const size_t buffer_offset_bytes
+    ){
+        BOOST_FOREACH(xport_chan_props_type &props, _props){
+            if (props.buff.get() == NULL) props.buff = props.get_buff(timeout);
+            if (props.buff.get() == NULL) return 0; //timeout
+
+            //pack metadata into a vrt header
+            props.otw_mem = props.buff->cast<boost::uint32_t *>() + _header_offset_words32;
+            _vrt_packer(props.otw_mem, if_packet_info);
+            props.otw_mem += if_packet_info.num_header_words32;
+        }
+
+        //copy-convert the samples into the send buffers
+        _convert_buffs = &buffs;
+        _convert_offset_bytes = buffer_offset_bytes;
+        _convert_nsamps = nsamps_per_buff;
+        _convert_pool->run(_convert_task, _props.size());
+
+        //commit the samples to the zero-copy interfaces
+        const size_t num_bytes_total = (_header_offset_words32+if_packet_info.num_packet_words32)*sizeof(boost::uint32_t);
+        BOOST_FOREACH(xport_chan_props_type &props, _props){
+            props.buff->commit(num_bytes_total);
+            props.buff.reset();
+
+            //the burst is over: dont leave the last packet queued
+            if (if_packet_info.eob) props.handle_flush();
         }
         _next_packet_seq++; //increment sequence after commits
         return nsamps_per_buff;
     }
+
+    //! Copy-convert the samples of one transport channel, called from the convert pool
+    void convert_xport_chan(const size_t index){
+        xport_chan_props_type &props = _props[index];
+
+        //fill a vector with pointers to the io buffers
+        size_t buff_index = index*props.io_buffs.size();
+        BOOST_FOREACH(const void *&io_buff, props.io_buffs){
+            io_buff = reinterpret_cast<const char *>((*_convert_buffs)[buff_index++]) + _convert_offset_bytes;
+        }
+        _converter->conv(props.io_buffs, props.otw_mem, _convert_nsamps);
+    }
 };
 
 class send_packet_streamer : public send_packet_handler, public tx_streamer{
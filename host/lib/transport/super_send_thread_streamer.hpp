@@ -0,0 +1,238 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_SUPER_SEND_THREAD_STREAMER_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_SUPER_SEND_THREAD_STREAMER_HPP
+
+#include "super_send_packet_handler.hpp"
+#include <uhd/config.hpp>
+#include <uhd/stream.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/transport/buffer_pool.hpp>
+#include <uhd/utils/thread_priority.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/utils/safe_call.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+/***********************************************************************
+ * Send thread streamer
+ *
+ * send() copies the samples into a ring per channel and returns,
+ * a sender task feeds them to a packet streamer, which converts,
+ * packs, waits on flow control and sends on the sender's thread.
+ * The ring absorbs network jitter and a full device window,
+ * get_send_room() tells the producers how much the ring takes
+ * without blocking. Several threads may call send(), each call
+ * goes into the ring in one piece. Destruction sends what is still
+ * queued and ends a burst that was left open.
+ **********************************************************************/
+class send_thread_streamer : public tx_streamer{
+public:
+    /*!
+     * Make a new send thread streamer and start the sender task.
+     * \param streamer the packet streamer to send with
+     * \param bytes_per_samp the size of a sample in the cpu format
+     * \param ring_samps the number of samples in each ring
+     * \param cpu the core to pin the sender task to, negative for none
+     */
+    send_thread_streamer(
+        boost::shared_ptr<send_packet_streamer> streamer,
+        const size_t bytes_per_samp,
+        const size_t ring_samps,
+        const int cpu = -1
+    ):
+        _streamer(streamer),
+        _bytes_per_samp(bytes_per_samp),
+        _ring_samps(std::max<size_t>(ring_samps, streamer->get_max_num_samps())),
+        _rings(buffer_pool::make(streamer->get_num_channels(), _ring_samps*bytes_per_samp, 64)),
+        _chunks(chunk_queue::make(std::min<size_t>(_ring_samps, 4096))),
+        _write_pos(0),
+        _cpu(cpu), _burst_open(false),
+        _send_buffs(streamer->get_num_channels())
+    {
+        _task = task::make(boost::bind(&send_thread_streamer::sender, this));
+    }
+
+    ~send_thread_streamer(void){
+        //let the sender drain the queued chunks for as long as it makes progress
+        {
+            const boost::uint32_t num_written = _num_written.read();
+            boost::mutex::scoped_lock lock(_room_mutex);
+            while (_num_sent.read() != num_written){
+                const boost::uint32_t num_sent = _num_sent.read();
+                const boost::system_time exit_time = boost::get_system_time() + boost::posix_time::milliseconds(500);
+                while (_num_sent.read() == num_sent and _room_cond.timed_wait(lock, exit_time)){}
+                if (_num_sent.read() == num_sent) break; //stuck, drop the rest
+            }
+        }
+        _stop.write(1);
+        _task.reset(); //stops the sender before the rings go
+
+        //end a burst the producers left open
+        if (_burst_open){
+            tx_metadata_t metadata;
+            metadata.end_of_burst = true;
+            UHD_SAFE_CALL(_streamer->send(_send_buffs, 0, metadata, 0.1);)
+        }
+    }
+
+    size_t get_num_channels(void) const{
+        return _streamer->get_num_channels();
+    }
+
+    size_t get_max_num_samps(void) const{
+        return _streamer->get_max_num_samps();
+    }
+
+    size_t get_send_room(void){
+        return _ring_samps - (_num_written.read() - _num_sent.read());
+    }
+
+    size_t send(
+        const tx_streamer::buffs_type &buffs,
+        const size_t nsamps_per_buff,
+        const uhd::tx_metadata_t &metadata,
+        const double timeout
+    ){
+        boost::mutex::scoped_lock lock(_send_mutex); //one call at a time into the ring
+        const boost::system_time exit_time = boost::get_system_time() + boost::posix_time::microseconds(long(timeout*1e6));
+
+        //the ring may free up in pieces, the burst flags go on the first and last
+        chunk_type chunk;
+        chunk.metadata = metadata;
+        chunk.metadata.end_of_burst = false;
+        size_t num_samps_queued = 0;
+        do{
+            //wait on room, or just the queue for a call without samples
+            size_t room = 0;
+            while ((room = std::min(this->get_send_room(), _ring_samps - _write_pos)) == 0 and nsamps_per_buff != 0){
+                boost::mutex::scoped_lock room_lock(_room_mutex);
+                if (this->get_send_room() != 0) continue;
+                if (not _room_cond.timed_wait(room_lock, exit_time)) return num_samps_queued;
+            }
+
+            chunk.offset = _write_pos;
+            chunk.nsamps = std::min(room, nsamps_per_buff - num_samps_queued);
+            if (num_samps_queued + chunk.nsamps == nsamps_per_buff) chunk.metadata.end_of_burst = metadata.end_of_burst;
+            for (size_t ch = 0; ch < buffs.size(); ch++){
+                std::memcpy(
+                    reinterpret_cast<char *>(_rings->at(ch)) + chunk.offset*_bytes_per_samp,
+                    reinterpret_cast<const char *>(buffs[ch]) + num_samps_queued*_bytes_per_samp,
+                    chunk.nsamps*_bytes_per_samp
+                );
+            }
+            if (not _chunks->push_with_timed_wait(chunk, timeout)) return num_samps_queued;
+
+            _num_written.add(boost::uint32_t(chunk.nsamps));
+            _write_pos = (_write_pos + chunk.nsamps)%_ring_samps;
+            num_samps_queued += chunk.nsamps;
+
+            //a continuation of the burst
+            chunk.metadata.start_of_burst = false;
+            chunk.metadata.has_time_spec = false;
+        } while (num_samps_queued < nsamps_per_buff);
+
+        return num_samps_queued;
+    }
+
+private:
+    //! samples in the rings and the metadata to send them with
+    struct chunk_type{
+        size_t offset; //first sample in the rings
+        size_t nsamps; //samples in the rings
+        tx_metadata_t metadata;
+    };
+
+    /*!
+     * A bounded_buffer of chunks, made in super_send_thread_streamer.cpp:
+     * the buffer type has internal linkage, so a header cannot hold one.
+     */
+    class chunk_queue{
+    public:
+        typedef boost::shared_ptr<chunk_queue> sptr;
+        static sptr make(const size_t capacity);
+        virtual ~chunk_queue(void){}
+        virtual bool push_with_timed_wait(const chunk_type &chunk, const double timeout) = 0;
+        virtual bool pop_with_timed_wait(chunk_type &chunk, const double timeout) = 0;
+    };
+    class chunk_queue_impl;
+
+    boost::shared_ptr<send_packet_streamer> _streamer;
+    const size_t _bytes_per_samp;
+    const size_t _ring_samps;
+    buffer_pool::sptr _rings;
+    chunk_queue::sptr _chunks;
+    task::sptr _task;
+    atomic_uint32_t _stop;
+
+    //producer side
+    boost::mutex _send_mutex;
+    size_t _write_pos;
+    atomic_uint32_t _num_written; //read by get_send_room() without the lock
+
+    //sender side
+    int _cpu;
+    atomic_uint32_t _num_sent; //samples given back to the producers
+    bool _burst_open; //the last chunk sent had no end of burst
+    boost::mutex _room_mutex;
+    boost::condition_variable _room_cond;
+    std::vector<const void *> _send_buffs;
+
+    /*******************************************************************
+     * Send one chunk:
+     * Called over and over by the sender task.
+     * A chunk is sent whole, flow control waits as long as it takes.
+     ******************************************************************/
+    void sender(void){
+        if (_cpu >= 0){
+            set_thread_affinity_safe(size_t(_cpu));
+            _cpu = -1;
+        }
+
+        chunk_type chunk;
+        if (not _chunks->pop_with_timed_wait(chunk, 0.1)) return;
+
+        size_t num_samps_sent = 0;
+        do{
+            for (size_t ch = 0; ch < _send_buffs.size(); ch++){
+                _send_buffs[ch] = reinterpret_cast<const char *>(_rings->at(ch)) + (chunk.offset + num_samps_sent)*_bytes_per_samp;
+            }
+            num_samps_sent += _streamer->send(_send_buffs, chunk.nsamps - num_samps_sent, chunk.metadata, 0.1);
+            chunk.metadata.start_of_burst = false;
+            chunk.metadata.has_time_spec = false;
+        } while (num_samps_sent < chunk.nsamps and _stop.read() == 0);
+        _burst_open = not (chunk.metadata.end_of_burst and num_samps_sent == chunk.nsamps);
+
+        //give the room back and wake up a waiting producer
+        _num_sent.add(boost::uint32_t(chunk.nsamps));
+        boost::mutex::scoped_lock lock(_room_mutex);
+        _room_cond.notify_all();
+    }
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_SUPER_SEND_THREAD_STREAMER_HPP */
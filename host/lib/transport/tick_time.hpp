@@ -0,0 +1,94 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_TICK_TIME_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_TICK_TIME_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <boost/math/special_functions/round.hpp>
+#include <boost/cstdint.hpp>
+#include <cmath>
+
+namespace uhd{ namespace transport{ namespace sph{
+
+/*!
+ * A time in ticks since time zero: the seconds and ticks of a vrt
+ * packet in a single integer. Packet times compare and add exactly,
+ * the packet handlers convert to a time spec only for the caller.
+ */
+typedef boost::int64_t tick_time_type;
+
+/***********************************************************************
+ * Tick timebase
+ *
+ * Converts between tick times, vrt packet times, time specs and
+ * sample counts for one tick rate and sample rate. The sample rate
+ * is a whole fraction of the tick rate on all devices, then a sample
+ * count converts with an integer multiply, otherwise it is rounded.
+ **********************************************************************/
+class tick_timebase{
+public:
+    tick_timebase(void){
+        this->set_rates(1.0, 1.0);
+    }
+
+    //! Set the rate of ticks and samples per second
+    void set_rates(const double tick_rate, const double samp_rate){
+        _tick_rate = tick_rate;
+        _ticks_per_sec = boost::math::llround(tick_rate);
+        _ticks_per_samp = tick_rate/samp_rate;
+        _whole_ticks_per_samp = boost::math::llround(_ticks_per_samp);
+        if (std::abs(_ticks_per_samp - _whole_ticks_per_samp) > 1e-6) _whole_ticks_per_samp = 0;
+    }
+
+    UHD_INLINE tick_time_type from_vrt(const boost::uint32_t tsi, const boost::uint64_t tsf) const{
+        return tick_time_type(tsi)*_ticks_per_sec + tick_time_type(tsf);
+    }
+
+    UHD_INLINE void to_vrt(const tick_time_type time, boost::uint32_t &tsi, boost::uint64_t &tsf) const{
+        tsi = boost::uint32_t(time/_ticks_per_sec);
+        tsf = boost::uint64_t(time%_ticks_per_sec);
+    }
+
+    UHD_INLINE tick_time_type from_time_spec(const time_spec_t &time_spec) const{
+        return tick_time_type(time_spec.get_full_secs())*_ticks_per_sec + time_spec.get_tick_count(_tick_rate);
+    }
+
+    UHD_INLINE time_spec_t to_time_spec(const tick_time_type time) const{
+        return time_spec_t(time_t(time/_ticks_per_sec), long(time%_ticks_per_sec), _tick_rate);
+    }
+
+    //! The ticks spanned by a number of samples
+    UHD_INLINE tick_time_type samps_to_ticks(const size_t nsamps) const{
+        if (_whole_ticks_per_samp != 0) return tick_time_type(nsamps)*_whole_ticks_per_samp;
+        return boost::math::llround(nsamps*_ticks_per_samp);
+    }
+
+    //! The samples spanned by a number of ticks
+    UHD_INLINE double ticks_to_samps(const tick_time_type ticks) const{
+        return ticks/_ticks_per_samp;
+    }
+
+private:
+    double _tick_rate, _ticks_per_samp;
+    tick_time_type _ticks_per_sec, _whole_ticks_per_samp;
+};
+
+}}} //namespace uhd::transport::sph
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_TICK_TIME_HPP */
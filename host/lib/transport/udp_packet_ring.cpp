@@ -0,0 +1,453 @@
+//
+// Copyright 2013 Fairwaves LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "udp_packet_ring.hpp"
+#include <uhd/transport/bounded_spsc_buffer.hpp>
+#include <uhd/exception.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/log.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <boost/cstdint.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <list>
+#include <vector>
+#include <unistd.h>
+#include <poll.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+
+using namespace uhd;
+using namespace uhd::transport;
+
+//Payloads per block are limited by the block size, not by the frame size.
+//The frame size is only used by the kernel to sanity check the request.
+static const size_t RING_FRAME_SIZE = 2048;
+static const size_t DEFAULT_RING_BLOCK_SIZE = 1 << 16;
+static const size_t DEFAULT_RING_NUM_BLOCKS = 64;
+static const size_t DEFAULT_NUM_FRAMES = 32;
+
+static std::string errno_str(const std::string &what){
+    return str(boost::format("%s: %s") % what % std::strerror(errno));
+}
+
+/***********************************************************************
+ * Socket filters:
+ *  - The ring filter only accepts unfragmented IPv4/UDP datagrams
+ *    from the remote address and port to the local address and port.
+ *    The packet socket is SOCK_DGRAM, so offsets start at the IP header.
+ *  - The drop filter keeps the UDP socket from buffering a second copy.
+ **********************************************************************/
+static void attach_filter(int sock_fd, std::vector<sock_filter> &code){
+    sock_fprog prog;
+    prog.len = code.size();
+    prog.filter = &code.front();
+    if (::setsockopt(sock_fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) < 0){
+        throw uhd::os_error(errno_str("udp_packet_ring: cannot attach socket filter"));
+    }
+}
+
+static sock_filter bpf_insn(unsigned short code, unsigned char jt, unsigned char jf, boost::uint32_t k){
+    sock_filter insn;
+    insn.code = code;
+    insn.jt = jt;
+    insn.jf = jf;
+    insn.k = k;
+    return insn;
+}
+
+static std::vector<sock_filter> make_flow_filter(const sockaddr_in &local, const sockaddr_in &remote){
+    static const size_t DROP = 14; //index of the drop instruction below
+    std::vector<sock_filter> code;
+    #define FLOW_STMT(c, k) code.push_back(bpf_insn(c, 0, 0, k))
+    #define FLOW_JEQ(k) code.push_back(bpf_insn(BPF_JMP+BPF_JEQ+BPF_K, 0, DROP-code.size()-1, k))
+    FLOW_STMT(BPF_LD+BPF_B+BPF_ABS, 9);   //ip protocol
+    FLOW_JEQ(IPPROTO_UDP);
+    FLOW_STMT(BPF_LD+BPF_H+BPF_ABS, 6);   //ip flags and fragment offset
+    code.push_back(bpf_insn(BPF_JMP+BPF_JSET+BPF_K, DROP-code.size()-1, 0, 0x3fff));
+    FLOW_STMT(BPF_LD+BPF_W+BPF_ABS, 12);  //ip source
+    FLOW_JEQ(ntohl(remote.sin_addr.s_addr));
+    FLOW_STMT(BPF_LD+BPF_W+BPF_ABS, 16);  //ip destination
+    FLOW_JEQ(ntohl(local.sin_addr.s_addr));
+    FLOW_STMT(BPF_LDX+BPF_B+BPF_MSH, 0);  //ip header length
+    FLOW_STMT(BPF_LD+BPF_H+BPF_IND, 0);   //udp source port
+    FLOW_JEQ(ntohs(remote.sin_port));
+    FLOW_STMT(BPF_LD+BPF_H+BPF_IND, 2);   //udp destination port
+    FLOW_JEQ(ntohs(local.sin_port));
+    FLOW_STMT(BPF_RET+BPF_K, 0x40000);    //accept
+    FLOW_STMT(BPF_RET+BPF_K, 0);          //drop
+    #undef FLOW_STMT
+    #undef FLOW_JEQ
+    UHD_ASSERT_THROW(code.size() == DROP+1);
+    return code;
+}
+
+static std::vector<sock_filter> make_drop_filter(void){
+    return std::vector<sock_filter>(1, bpf_insn(BPF_RET+BPF_K, 0, 0, 0));
+}
+
+/***********************************************************************
+ * Find the index of the interface which holds the local address
+ **********************************************************************/
+static int get_ifindex(const sockaddr_in &local){
+    ifaddrs *ifap = NULL;
+    if (::getifaddrs(&ifap) < 0){
+        throw uhd::os_error(errno_str("udp_packet_ring: cannot list interfaces"));
+    }
+    int ifindex = 0;
+    for (ifaddrs *ifa = ifap; ifa != NULL; ifa = ifa->ifa_next){
+        if (ifa->ifa_addr == NULL or ifa->ifa_addr->sa_family != AF_INET) continue;
+        if (reinterpret_cast<sockaddr_in *>(ifa->ifa_addr)->sin_addr.s_addr != local.sin_addr.s_addr) continue;
+        ifindex = ::if_nametoindex(ifa->ifa_name);
+        break;
+    }
+    ::freeifaddrs(ifap);
+    if (ifindex == 0) throw uhd::os_error("udp_packet_ring: no interface for the local address");
+    return ifindex;
+}
+
+class udp_packet_ring_impl; //forward declaration
+
+/***********************************************************************
+ * Reusable managed receiver buffer:
+ *  - Points at a datagram payload inside of a ring block.
+ *  - Release gives the block back to the kernel when
+ *    it was the last outstanding datagram of the block.
+ *  - Release may come from any thread (recv_direct),
+ *    the ring serializes it under the block mutex.
+ **********************************************************************/
+class udp_packet_ring_mrb : public managed_recv_buffer{
+public:
+    udp_packet_ring_mrb(udp_packet_ring_impl &ring):
+        _ring(ring), _mem(NULL), _len(0), _block(0){/* NOP */}
+
+    void release(void);
+
+    sptr get_new(const void *mem, size_t len, size_t block){
+        _mem = mem;
+        _len = len;
+        _block = block;
+        return make_managed_buffer(this);
+    }
+
+private:
+    const void *get_buff(void) const{return _mem;}
+    size_t get_size(void) const{return _len;}
+
+    udp_packet_ring_impl &_ring;
+    const void *_mem;
+    size_t _len;
+    size_t _block;
+};
+
+/***********************************************************************
+ * TPACKET_V3 receive ring implementation:
+ *   The kernel fills blocks of datagrams and hands each block to user
+ *   space by setting TP_STATUS_USER in the block descriptor.
+ *   The datagrams of a block are handed out in order, and the block
+ *   is returned to the kernel once all of its datagrams were released.
+ **********************************************************************/
+class udp_packet_ring_impl : public udp_packet_ring{
+public:
+    udp_packet_ring_impl(int sock_fd, const size_t frame_size, const device_addr_t &hints):
+        _udp_fd(sock_fd), _frame_size(frame_size),
+        _block_size(size_t(hints.cast<double>("recv_ring_block_size", DEFAULT_RING_BLOCK_SIZE))),
+        _num_blocks(size_t(hints.cast<double>("recv_ring_num_blocks", DEFAULT_RING_NUM_BLOCKS))),
+        _num_frames(size_t(hints.cast<double>("num_recv_frames", DEFAULT_NUM_FRAMES))),
+        _retire_timeout(hints.cast<double>("recv_ring_timeout", 1e-3)),
+        _spin_time(hints.cast<double>("recv_spin_time", 0.0)*1e-6), //hint in us
+        _pending_mrbs(_num_frames),
+        _block_refs(_num_blocks, 0), _block_done(_num_blocks, false),
+        _stashed_mrb(NULL), _block_index(0), _block_open(false), _pkt(NULL), _pkts_left(0),
+        _fd(-1), _ring(NULL)
+    {
+        //the flow of the connected udp socket
+        sockaddr_in local, remote;
+        socklen_t local_len = sizeof(local), remote_len = sizeof(remote);
+        if (::getsockname(_udp_fd, reinterpret_cast<sockaddr *>(&local), &local_len) < 0 or
+            ::getpeername(_udp_fd, reinterpret_cast<sockaddr *>(&remote), &remote_len) < 0){
+            throw uhd::os_error(errno_str("udp_packet_ring: cannot get the socket addresses"));
+        }
+        const int ifindex = get_ifindex(local);
+
+        //open the packet socket without a protocol so nothing arrives before the filter
+        _fd = ::socket(AF_PACKET, SOCK_DGRAM, 0);
+        if (_fd < 0) throw uhd::os_error(errno_str("udp_packet_ring: cannot open packet socket"));
+
+        try{
+            std::vector<sock_filter> flow_filter = make_flow_filter(local, remote);
+            attach_filter(_fd, flow_filter);
+
+            int version = TPACKET_V3;
+            if (::setsockopt(_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0){
+                throw uhd::os_error(errno_str("udp_packet_ring: TPACKET_V3 not supported"));
+            }
+
+            tpacket_req3 req;
+            std::memset(&req, 0, sizeof(req));
+            req.tp_block_size = _block_size;
+            req.tp_block_nr = _num_blocks;
+            req.tp_frame_size = RING_FRAME_SIZE;
+            req.tp_frame_nr = (_block_size/RING_FRAME_SIZE)*_num_blocks;
+            req.tp_retire_blk_tov = unsigned(std::ceil(_retire_timeout*1e3));
+            if (::setsockopt(_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0){
+                throw uhd::os_error(errno_str("udp_packet_ring: cannot create the ring"));
+            }
+
+            void *ring = ::mmap(NULL, _block_size*_num_blocks, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+            if (ring == MAP_FAILED) throw uhd::os_error(errno_str("udp_packet_ring: cannot map the ring"));
+            _ring = static_cast<char *>(ring);
+
+            sockaddr_ll sll;
+            std::memset(&sll, 0, sizeof(sll));
+            sll.sll_family = AF_PACKET;
+            sll.sll_protocol = htons(ETH_P_IP);
+            sll.sll_ifindex = ifindex;
+            if (::bind(_fd, reinterpret_cast<sockaddr *>(&sll), sizeof(sll)) < 0){
+                throw uhd::os_error(errno_str("udp_packet_ring: cannot bind the packet socket"));
+            }
+
+            //the ring now receives the flow: stop the udp socket from queuing it too
+            std::vector<sock_filter> drop_filter = make_drop_filter();
+            attach_filter(_udp_fd, drop_filter);
+        }
+        catch(...){
+            this->cleanup();
+            throw;
+        }
+
+        //allocate re-usable managed receive buffers
+        for (size_t i = 0; i < _num_frames; i++){
+            _mrb_pool.push_back(udp_packet_ring_mrb(*this));
+            _pending_mrbs.push_with_haste(&_mrb_pool.back());
+        }
+
+        UHD_LOG << boost::format(
+            "Created packet ring on interface %d: %u blocks of %u bytes"
+        ) % ifindex % _num_blocks % _block_size << std::endl;
+    }
+
+    ~udp_packet_ring_impl(void){
+        ::setsockopt(_udp_fd, SOL_SOCKET, SO_DETACH_FILTER, NULL, 0);
+        this->cleanup();
+    }
+
+    /*******************************************************************
+     * Receive implementation:
+     *
+     * Get a free managed buffer, then point it at the next datagram.
+     * Blocks are opened in ring order once the kernel hands them over.
+     * When no block is ready, wait on the packet socket with timeout.
+     * A managed buffer left over from a timeout is used first,
+     * the queue only takes the buffers released by the caller.
+     ******************************************************************/
+    managed_recv_buffer::sptr get_recv_buff(double timeout){
+        udp_packet_ring_mrb *mrb = _stashed_mrb;
+        _stashed_mrb = NULL;
+        if (mrb == NULL and not _pending_mrbs.pop_with_timed_wait(mrb, timeout)){
+            return managed_recv_buffer::sptr();
+        }
+
+        //poll also reports readable while the block before the kernel's
+        //current block is held by user space: after the first wakeup,
+        //check again at the block retire period until the deadline
+        const boost::system_time deadline = boost::get_system_time() + to_time_dur(timeout);
+        bool woken = false, spun = false;
+        while (true){
+            //finished with the current block -> move onto the next
+            if (_block_open and _pkts_left == 0){
+                this->close_block(_block_index);
+                _block_index = (_block_index + 1) % _num_blocks;
+                _block_open = false;
+            }
+
+            //open the next block when the kernel has handed it over
+            if (not _block_open){
+                tpacket_block_desc *desc = this->get_block(_block_index);
+                __sync_synchronize();
+                if ((desc->hdr.bh1.block_status & TP_STATUS_USER) == 0){
+                    const double remaining = double((deadline - boost::get_system_time()).total_microseconds())/1e6;
+                    if (remaining <= 0.0) break;
+                    if (not spun and _spin_time > 0.0){
+                        spun = true;
+                        if (this->spin_for_block(desc, std::min(remaining, _spin_time))){
+                            _num_spin_hits.inc();
+                            continue;
+                        }
+                        _num_spin_misses.inc();
+                    }
+                    if (woken) boost::this_thread::sleep(to_time_dur(std::min(remaining, _retire_timeout)));
+                    else if (not this->wait_for_block(remaining)) break;
+                    woken = true;
+                    continue;
+                }
+                _block_open = true;
+                _pkts_left = desc->hdr.bh1.num_pkts;
+                _pkt = reinterpret_cast<char *>(desc) + desc->hdr.bh1.offset_to_first_pkt;
+                continue;
+            }
+
+            //take the next datagram from the block
+            tpacket3_hdr *hdr = reinterpret_cast<tpacket3_hdr *>(_pkt);
+            _pkt += hdr->tp_next_offset;
+            _pkts_left--;
+
+            //loopback interfaces also report the outgoing copy
+            const sockaddr_ll *sll = reinterpret_cast<const sockaddr_ll *>(
+                reinterpret_cast<const char *>(hdr) + TPACKET_ALIGN(sizeof(tpacket3_hdr))
+            );
+            if (sll->sll_pkttype == PACKET_OUTGOING) continue;
+
+            const unsigned char *ip = reinterpret_cast<const unsigned char *>(hdr) + hdr->tp_net;
+            const size_t ip_hdr_len = (ip[0] & 0xf)*4;
+            const unsigned char *udp = ip + ip_hdr_len;
+            if (hdr->tp_snaplen < ip_hdr_len + 8) continue;
+            const size_t udp_len = std::min((size_t(udp[4]) << 8) | udp[5], size_t(hdr->tp_snaplen - ip_hdr_len));
+            if (udp_len < 8) continue;
+            const size_t len = std::min(udp_len - 8, _frame_size);
+
+            {
+                boost::mutex::scoped_lock lock(_block_mutex);
+                _block_refs[_block_index]++;
+            }
+            _num_packets.inc();
+            return mrb->get_new(udp + 8, len, _block_index);
+        }
+
+        _stashed_mrb = mrb; //timeout: keep the managed buffer for the next call
+        return managed_recv_buffer::sptr();
+    }
+
+    //! Called by the managed buffer when its datagram was released, from any thread
+    void release_mrb(udp_packet_ring_mrb *mrb, size_t index){
+        boost::mutex::scoped_lock lock(_block_mutex);
+        if (--_block_refs[index] == 0 and _block_done[index]) this->return_block(index);
+        _pending_mrbs.push_with_haste(mrb); //one producer at a time
+    }
+
+    size_t get_num_recv_frames(void) const {return _num_frames;}
+
+    size_t get_num_recv_syscalls(void) const {return _num_syscalls.read();}
+    size_t get_num_recv_packets(void) const {return _num_packets.read();}
+
+    size_t get_num_recv_spin_hits(void) const {return _num_spin_hits.read();}
+    size_t get_num_recv_spin_misses(void) const {return _num_spin_misses.read();}
+
+private:
+    tpacket_block_desc *get_block(size_t index){
+        return reinterpret_cast<tpacket_block_desc *>(_ring + index*_block_size);
+    }
+
+    //all datagrams were handed out: return the block unless some are still held
+    void close_block(size_t index){
+        boost::mutex::scoped_lock lock(_block_mutex);
+        if (_block_refs[index] == 0) this->return_block(index);
+        else _block_done[index] = true;
+    }
+
+    //call with the block mutex held
+    void return_block(size_t index){
+        _block_done[index] = false;
+        __sync_synchronize();
+        this->get_block(index)->hdr.bh1.block_status = TP_STATUS_KERNEL;
+        __sync_synchronize();
+    }
+
+    static UHD_INLINE boost::posix_time::time_duration to_time_dur(double timeout){
+        return boost::posix_time::microseconds(long(timeout*1e6));
+    }
+
+    //low latency mode: watch the block status before blocking in poll
+    bool spin_for_block(tpacket_block_desc *desc, double spin_time){
+        const boost::system_time spin_deadline = boost::get_system_time() + to_time_dur(spin_time);
+        do{
+            __sync_synchronize();
+            if ((desc->hdr.bh1.block_status & TP_STATUS_USER) != 0) return true;
+        } while (boost::get_system_time() < spin_deadline);
+        return false;
+    }
+
+    bool wait_for_block(double timeout){
+        pollfd pfd;
+        pfd.fd = _fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        _num_syscalls.inc();
+        return ::poll(&pfd, 1, int(std::ceil(timeout*1e3))) > 0;
+    }
+
+    void cleanup(void){
+        if (_ring != NULL) ::munmap(_ring, _block_size*_num_blocks);
+        if (_fd >= 0) ::close(_fd);
+        _ring = NULL;
+        _fd = -1;
+    }
+
+    const int _udp_fd;
+    const size_t _frame_size;
+    const size_t _block_size, _num_blocks, _num_frames;
+    const double _retire_timeout;
+    const double _spin_time;
+
+    //managed buffers -> one per datagram held by the caller
+    bounded_spsc_buffer<udp_packet_ring_mrb *> _pending_mrbs;
+    std::list<udp_packet_ring_mrb> _mrb_pool;
+
+    //block ownership -> outstanding datagrams per block
+    boost::mutex _block_mutex;
+    std::vector<size_t> _block_refs;
+    std::vector<bool> _block_done;
+
+    //iteration state -> only touched by the receiving thread
+    udp_packet_ring_mrb *_stashed_mrb;
+    size_t _block_index;
+    bool _block_open;
+    char *_pkt;
+    size_t _pkts_left;
+
+    //statistics -> syscalls per packet
+    mutable atomic_uint32_t _num_syscalls, _num_packets;
+    mutable atomic_uint32_t _num_spin_hits, _num_spin_misses;
+
+    //the packet socket and its mapped ring
+    int _fd;
+    char *_ring;
+};
+
+void udp_packet_ring_mrb::release(void){
+    if (_mem == NULL) return;
+    _mem = NULL;
+    _ring.release_mrb(this, _block);
+}
+
+/***********************************************************************
+ * UDP packet ring make function
+ **********************************************************************/
+udp_packet_ring::sptr udp_packet_ring::make(int sock_fd, const size_t frame_size, const device_addr_t &hints){
+    return sptr(new udp_packet_ring_impl(sock_fd, frame_size, hints));
+}
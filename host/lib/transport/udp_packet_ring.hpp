@@ -0,0 +1,73 @@
+//
+// Copyright 2013 Fairwaves LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_TRANSPORT_UDP_PACKET_RING_HPP
+#define INCLUDED_LIBUHD_TRANSPORT_UDP_PACKET_RING_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/transport/zero_copy.hpp>
+#include <uhd/types/device_addr.hpp>
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace uhd{ namespace transport{
+
+/*!
+ * A receive ring for the datagrams of a connected UDP socket (linux only).
+ *
+ * The ring is a PACKET_MMAP memory region shared with the kernel (TPACKET_V3).
+ * A socket filter only lets through the datagrams of the socket's flow.
+ * The managed receive buffers point straight into the ring,
+ * so the payload is never copied into user memory.
+ * The UDP socket itself stays open for sending and to hold the port,
+ * but it is given a filter which drops everything it would receive.
+ */
+class udp_packet_ring : boost::noncopyable{
+public:
+    typedef boost::shared_ptr<udp_packet_ring> sptr;
+
+    /*!
+     * Make a new packet ring for a connected UDP socket.
+     * Throws when the ring cannot be created (ex: missing CAP_NET_RAW).
+     * \param sock_fd the connected UDP socket
+     * \param frame_size the maximum payload size of a datagram
+     * \param hints ring parameters (recv_ring_block_size, recv_ring_num_blocks, ...)
+     */
+    static sptr make(int sock_fd, const size_t frame_size, const device_addr_t &hints);
+
+    //! Get the payload of the next datagram (see zero_copy_if)
+    virtual managed_recv_buffer::sptr get_recv_buff(double timeout) = 0;
+
+    //! Get the number of datagrams which may be held at once
+    virtual size_t get_num_recv_frames(void) const = 0;
+
+    //! Get the number of syscalls made to wait on the ring
+    virtual size_t get_num_recv_syscalls(void) const = 0;
+
+    //! Get the number of datagrams received from the ring
+    virtual size_t get_num_recv_packets(void) const = 0;
+
+    //! Get the number of waits where spinning found a ready block (recv_spin_time)
+    virtual size_t get_num_recv_spin_hits(void) const = 0;
+
+    //! Get the number of waits where spinning ran out and blocked
+    virtual size_t get_num_recv_spin_misses(void) const = 0;
+};
+
+}} //namespace
+
+#endif /* INCLUDED_LIBUHD_TRANSPORT_UDP_PACKET_RING_HPP */
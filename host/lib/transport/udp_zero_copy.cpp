@@ -16,14 +16,30 @@
 //
 
 #include "udp_common.hpp"
+#ifdef HAVE_TPACKET_V3
+#include "udp_packet_ring.hpp"
+#endif /*HAVE_TPACKET_V3*/
 #include <uhd/transport/udp_zero_copy.hpp>
 #include <uhd/transport/udp_simple.hpp> //mtu
-#include <uhd/transport/bounded_buffer.hpp>
+#include <uhd/transport/bounded_spsc_buffer.hpp>
 #include <uhd/transport/buffer_pool.hpp>
+#include <uhd/utils/atomic.hpp>
 #include <uhd/utils/msg.hpp>
+#include <uhd/utils/tasks.hpp>
 #include <uhd/utils/log.hpp>
+#include <boost/bind.hpp>
 #include <boost/format.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread_time.hpp>
+#include <algorithm>
+#include <cstring>
 #include <list>
+#include <vector>
+#if defined(HAVE_RECVMMSG) || defined(HAVE_SENDMMSG)
+#include <sys/socket.h>
+#endif
 
 using namespace uhd;
 using namespace uhd::transport;
@@ -32,6 +48,10 @@ namespace asio = boost::asio;
 //A reasonable number of frames for send/recv and async/sync
 static const size_t DEFAULT_NUM_FRAMES = 32;
 
+static UHD_INLINE boost::posix_time::time_duration to_time_dur(double timeout){
+    return boost::posix_time::microseconds(long(timeout*1e6));
+}
+
 /***********************************************************************
  * Check registry for correct fast-path setting (windows only)
  **********************************************************************/
@@ -62,16 +82,21 @@ static void check_registry_for_fast_send_threshold(const size_t mtu){
  * Reusable managed receiver buffer:
  *  - Initialize with memory and a release callback.
  *  - Call get new with a length in bytes to re-use.
+ *  - Released buffers may come from several threads (recv_direct),
+ *    the pushes are serialized so the queue sees one producer.
  **********************************************************************/
 class udp_zero_copy_asio_mrb : public managed_recv_buffer{
 public:
-    udp_zero_copy_asio_mrb(void *mem, bounded_buffer<udp_zero_copy_asio_mrb *> &pending):
-        _mem(mem), _len(0), _pending(pending){/* NOP */}
+    udp_zero_copy_asio_mrb(
+        void *mem, bounded_spsc_buffer<udp_zero_copy_asio_mrb *> &pending, boost::mutex &release_mutex
+    ):
+        _mem(mem), _len(0), _pending(pending), _release_mutex(release_mutex){/* NOP */}
 
     void release(void){
         if (_len == 0) return;
-        _pending.push_with_haste(this);
         _len = 0;
+        boost::mutex::scoped_lock lock(_release_mutex);
+        _pending.push_with_haste(this);
     }
 
     sptr get_new(size_t len){
@@ -87,7 +112,151 @@ private:
 
     void *_mem;
     size_t _len;
-    bounded_buffer<udp_zero_copy_asio_mrb *> &_pending;
+    bounded_spsc_buffer<udp_zero_copy_asio_mrb *> &_pending;
+    boost::mutex &_release_mutex;
+};
+
+class udp_zero_copy_asio_msb; //forward declaration
+
+/***********************************************************************
+ * Send committer:
+ *  - Performs the send for a committed managed send buffer.
+ *  - When batching, committed buffers are queued and sent
+ *    together with one sendmmsg() when the batch fills,
+ *    when the batch deadline passes, or when flushed.
+ *  - A flusher task sends the batch at its deadline
+ *    when no more commits come to do it.
+ *  - A buffer goes back into the pending queue once it was sent.
+ **********************************************************************/
+class udp_zero_copy_asio_sender : boost::noncopyable{
+public:
+    udp_zero_copy_asio_sender(
+        int sock_fd,
+        bounded_spsc_buffer<udp_zero_copy_asio_msb *> &pending,
+        const size_t batch_size,
+        const double batch_timeout
+    ):
+        _sock_fd(sock_fd), _pending(pending),
+        _batch_size(batch_size), _batch_timeout(batch_timeout),
+        _num_queued(0)
+    {
+        #ifdef HAVE_SENDMMSG
+        _batch_msbs.resize(_batch_size);
+        _batch_iovs.resize(_batch_size);
+        _batch_msgs.resize(_batch_size);
+        for (size_t i = 0; i < _batch_size; i++){
+            std::memset(&_batch_msgs[i], 0, sizeof(_batch_msgs[i]));
+            _batch_msgs[i].msg_hdr.msg_iov = &_batch_iovs[i];
+            _batch_msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        if (_batch_size > 1) _flusher = task::make(
+            boost::bind(&udp_zero_copy_asio_sender::flush_on_deadline, this)
+        );
+        #endif /*HAVE_SENDMMSG*/
+    }
+
+    ~udp_zero_copy_asio_sender(void){
+        #ifdef HAVE_SENDMMSG
+        _flusher.reset(); //stop the flusher before its members go away
+        #endif /*HAVE_SENDMMSG*/
+    }
+
+    //! Send or queue a committed buffer
+    UHD_INLINE void send(udp_zero_copy_asio_msb *msb, const void *mem, size_t len){
+        #ifdef HAVE_SENDMMSG
+        if (_batch_size > 1){
+            boost::mutex::scoped_lock lock(_mutex);
+            if (_num_queued == 0){ //a new batch: start its deadline
+                _batch_deadline = boost::get_system_time() + to_time_dur(_batch_timeout);
+                _batch_cond.notify_one();
+            }
+            _batch_msbs[_num_queued] = msb;
+            _batch_iovs[_num_queued].iov_base = const_cast<void *>(mem);
+            _batch_iovs[_num_queued].iov_len = len;
+            _num_queued++;
+            if (_num_queued == _batch_size or boost::get_system_time() >= _batch_deadline){
+                this->flush_locked();
+            }
+            return;
+        }
+        #endif /*HAVE_SENDMMSG*/
+        ::send(_sock_fd, static_cast<const char *>(mem), len, 0);
+        _num_syscalls.inc();
+        _num_packets.inc();
+        _pending.push_with_haste(msb);
+    }
+
+    //! Send all queued buffers now
+    void flush(void){
+        #ifdef HAVE_SENDMMSG
+        if (_batch_size <= 1) return;
+        boost::mutex::scoped_lock lock(_mutex);
+        this->flush_locked();
+        #endif /*HAVE_SENDMMSG*/
+    }
+
+    //! Send all queued buffers if the batch deadline passed
+    void flush_expired(void){
+        #ifdef HAVE_SENDMMSG
+        if (_batch_size <= 1) return;
+        boost::mutex::scoped_lock lock(_mutex);
+        if (_num_queued != 0 and boost::get_system_time() >= _batch_deadline){
+            this->flush_locked();
+        }
+        #endif /*HAVE_SENDMMSG*/
+    }
+
+    size_t get_num_syscalls(void) const{return _num_syscalls.read();}
+    size_t get_num_packets(void) const{return _num_packets.read();}
+
+private:
+    const int _sock_fd;
+    bounded_spsc_buffer<udp_zero_copy_asio_msb *> &_pending;
+    const size_t _batch_size;
+    const double _batch_timeout;
+    size_t _num_queued;
+    mutable atomic_uint32_t _num_syscalls, _num_packets;
+
+    #ifdef HAVE_SENDMMSG
+    boost::mutex _mutex;
+    boost::system_time _batch_deadline;
+    std::vector<udp_zero_copy_asio_msb *> _batch_msbs;
+    std::vector<iovec> _batch_iovs;
+    std::vector<mmsghdr> _batch_msgs;
+    boost::condition_variable _batch_cond;
+    task::sptr _flusher;
+
+    /*!
+     * The flusher task: wait for a batch, then for its deadline.
+     * The batch may have been sent meanwhile, or a new one started,
+     * so the deadline is checked again under the lock.
+     */
+    void flush_on_deadline(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        while (_num_queued == 0) _batch_cond.wait(lock);
+        _batch_cond.timed_wait(lock, _batch_deadline);
+        if (_num_queued != 0 and boost::get_system_time() >= _batch_deadline){
+            this->flush_locked();
+        }
+    }
+
+    void flush_locked(void){
+        size_t num_sent = 0;
+        while (num_sent < _num_queued){
+            const int ret = ::sendmmsg(_sock_fd, &_batch_msgs[num_sent], _num_queued - num_sent, 0);
+            _num_syscalls.inc();
+            if (ret <= 0) break; //error: like send(), drop the rest of the batch
+            num_sent += ret;
+        }
+        _num_packets.add(boost::uint32_t(num_sent));
+
+        //the memory is no longer in use: return the buffers to the queue
+        for (size_t i = 0; i < _num_queued; i++){
+            _pending.push_with_haste(_batch_msbs[i]);
+        }
+        _num_queued = 0;
+    }
+    #endif /*HAVE_SENDMMSG*/
 };
 
 /***********************************************************************
@@ -97,14 +266,13 @@ private:
  **********************************************************************/
 class udp_zero_copy_asio_msb : public managed_send_buffer{
 public:
-    udp_zero_copy_asio_msb(void *mem, bounded_buffer<udp_zero_copy_asio_msb *> &pending, int sock_fd):
-        _mem(mem), _len(0), _pending(pending), _sock_fd(sock_fd){/* NOP */}
+    udp_zero_copy_asio_msb(void *mem, udp_zero_copy_asio_sender &sender):
+        _mem(mem), _len(0), _sender(sender){/* NOP */}
 
     void commit(size_t len){
         if (_len == 0) return;
-        ::send(_sock_fd, this->cast<const char *>(), len, 0);
-        _pending.push_with_haste(this);
         _len = 0;
+        _sender.send(this, _mem, len);
     }
 
     sptr get_new(size_t len){
@@ -118,8 +286,7 @@ private:
 
     void *_mem;
     size_t _len;
-    bounded_buffer<udp_zero_copy_asio_msb *> &_pending;
-    int _sock_fd;
+    udp_zero_copy_asio_sender &_sender;
 };
 
 /***********************************************************************
@@ -145,7 +312,11 @@ public:
         _recv_buffer_pool(buffer_pool::make(_num_recv_frames, _recv_frame_size)),
         _send_buffer_pool(buffer_pool::make(_num_send_frames, _send_frame_size)),
         _pending_recv_buffs(_num_recv_frames),
-        _pending_send_buffs(_num_send_frames)
+        _pending_send_buffs(_num_send_frames),
+        _recv_batch(std::min(size_t(hints.cast<double>("recv_batch", 1)), _num_recv_frames)),
+        _send_batch(std::min(size_t(hints.cast<double>("send_batch", 1)), _num_send_frames)),
+        _recv_spin_time(hints.cast<double>("recv_spin_time", 0.0)*1e-6), //hint in us, like recv_busy_poll
+        _recv_busy_poll(false)
     {
         UHD_LOG << boost::format("Creating udp transport for %s %s") % addr % port << std::endl;
 
@@ -164,21 +335,95 @@ public:
         _socket->connect(receiver_endpoint);
         _sock_fd = _socket->native();
 
+        //optionally let the kernel busy poll the device queue on receive
+        const int busy_poll = int(hints.cast<double>("recv_busy_poll", 0.0));
+        if (busy_poll > 0){
+            #ifdef SO_BUSY_POLL
+            if (::setsockopt(_sock_fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll, sizeof(busy_poll)) == 0){
+                _recv_busy_poll = true;
+            }
+            else UHD_MSG(warning) << boost::format(
+                "Cannot set the socket busy poll time (recv_busy_poll) to %d us.\n"
+                "Raising it above net.core.busy_read needs the CAP_NET_ADMIN capability."
+            ) % busy_poll << std::endl;
+            #else
+            UHD_MSG(warning) << "Socket busy poll (recv_busy_poll) is not supported on this platform." << std::endl;
+            #endif /*SO_BUSY_POLL*/
+        }
+
+        //optionally receive through a memory mapped packet ring
+        if (hints.cast<double>("recv_ring", 0.0) != 0.0){
+            #ifdef HAVE_TPACKET_V3
+            try{
+                _recv_ring = udp_packet_ring::make(_sock_fd, _recv_frame_size, hints);
+                UHD_LOG << "Receiving through a packet ring" << std::endl;
+            }
+            catch(const std::exception &e){
+                UHD_MSG(warning) << boost::format(
+                    "Cannot create the receive packet ring (recv_ring):\n%s\n"
+                    "Falling back to socket receive. See the transport application notes."
+                ) % e.what() << std::endl;
+            }
+            #else
+            UHD_MSG(warning) << "Packet ring receive (recv_ring) is not supported on this platform." << std::endl;
+            #endif /*HAVE_TPACKET_V3*/
+        }
+
+        //create the send committer (optionally batched)
+        #ifndef HAVE_SENDMMSG
+        if (_send_batch > 1){
+            UHD_MSG(warning) << "Batched send (send_batch) is not supported on this platform." << std::endl;
+            _send_batch = 1;
+        }
+        #endif /*HAVE_SENDMMSG*/
+        _sender.reset(new udp_zero_copy_asio_sender(
+            _sock_fd, _pending_send_buffs, _send_batch, hints.cast<double>("send_batch_timeout", 100e-6)
+        ));
+        if (_send_batch > 1){
+            UHD_LOG << boost::format("Batching up to %u frames per send") % _send_batch << std::endl;
+        }
+
         //allocate re-usable managed receive buffers
         for (size_t i = 0; i < get_num_recv_frames(); i++){
             _mrb_pool.push_back(udp_zero_copy_asio_mrb(
-                _recv_buffer_pool->at(i), _pending_recv_buffs
+                _recv_buffer_pool->at(i), _pending_recv_buffs, _release_recv_mutex
             ));
             _pending_recv_buffs.push_with_haste(&_mrb_pool.back());
         }
+        _stashed_recv_buffs.reserve(_num_recv_frames);
 
         //allocate re-usable managed send buffers
         for (size_t i = 0; i < get_num_send_frames(); i++){
             _msb_pool.push_back(udp_zero_copy_asio_msb(
-                _send_buffer_pool->at(i), _pending_send_buffs, _sock_fd
+                _send_buffer_pool->at(i), *_sender
             ));
             _pending_send_buffs.push_with_haste(&_msb_pool.back());
         }
+
+        //setup the message headers for batched receive
+        #ifdef HAVE_RECVMMSG
+        if (_recv_batch > 1){
+            _batch_mrbs.resize(_recv_batch);
+            _batch_iovs.resize(_recv_batch);
+            _batch_msgs.resize(_recv_batch);
+            for (size_t i = 0; i < _recv_batch; i++){
+                std::memset(&_batch_msgs[i], 0, sizeof(_batch_msgs[i]));
+                _batch_msgs[i].msg_hdr.msg_iov = &_batch_iovs[i];
+                _batch_msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            _batch_index = _batch_count = 0;
+            UHD_LOG << boost::format("Batching up to %u frames per recv") % _recv_batch << std::endl;
+        }
+        #else
+        if (_recv_batch > 1){
+            UHD_MSG(warning) << "Batched receive (recv_batch) is not supported on this platform." << std::endl;
+            _recv_batch = 1;
+        }
+        #endif /*HAVE_RECVMMSG*/
+    }
+
+    ~udp_zero_copy_asio_impl(void){
+        _sender->flush(); //send anything left in the batch
     }
 
     //get size for internal socket buffer
@@ -203,28 +448,167 @@ public:
      * Return the managed receive buffer with the new length.
      * When the caller is finished with the managed buffer,
      * the managed receive buffer is released back into the queue.
+     * The release may come from any thread and takes a mutex,
+     * a buffer that was not filled is stashed for the next call instead.
      ******************************************************************/
     managed_recv_buffer::sptr get_recv_buff(double timeout){
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) return _recv_ring->get_recv_buff(timeout);
+        #endif /*HAVE_TPACKET_V3*/
+
+        #ifdef HAVE_RECVMMSG
+        if (_recv_batch > 1) return this->get_recv_buff_batch(timeout);
+        #endif /*HAVE_RECVMMSG*/
+
         udp_zero_copy_asio_mrb *mrb = NULL;
-        if (_pending_recv_buffs.pop_with_timed_wait(mrb, timeout)){
+        if (this->pop_stashed(mrb) or _pending_recv_buffs.pop_with_timed_wait(mrb, timeout)){
 
             #ifdef MSG_DONTWAIT //try a non-blocking recv() if supported
             ssize_t ret = ::recv(_sock_fd, mrb->cast<char *>(), _recv_frame_size, MSG_DONTWAIT);
-            if (ret > 0) return mrb->get_new(ret);
+            _num_recv_syscalls.inc();
+            if (ret > 0){
+                _num_recv_packets.inc();
+                return mrb->get_new(ret);
+            }
+
+            //low latency mode: retry the non-blocking recv() before blocking
+            if (_recv_spin_time > 0.0){
+                const boost::system_time spin_deadline = get_spin_deadline(timeout);
+                do{
+                    ret = ::recv(_sock_fd, mrb->cast<char *>(), _recv_frame_size, MSG_DONTWAIT);
+                    _num_recv_syscalls.inc();
+                    if (ret > 0){
+                        _num_recv_spin_hits.inc();
+                        _num_recv_packets.inc();
+                        return mrb->get_new(ret);
+                    }
+                } while (boost::get_system_time() < spin_deadline);
+                _num_recv_spin_misses.inc();
+            }
             #endif
 
-            if (wait_for_recv_ready(_sock_fd, timeout)) return mrb->get_new(
-                ::recv(_sock_fd, mrb->cast<char *>(), _recv_frame_size, 0)
-            );
+            _num_recv_syscalls.inc();
+            if (wait_for_recv_ready(_sock_fd, timeout)){
+                _num_recv_syscalls.inc();
+                _num_recv_packets.inc();
+                return mrb->get_new(
+                    ::recv(_sock_fd, mrb->cast<char *>(), _recv_frame_size, 0)
+                );
+            }
 
-            _pending_recv_buffs.push_with_haste(mrb); //timeout: return the managed buffer to the queue
+            _stashed_recv_buffs.push_back(mrb); //timeout: keep the managed buffer for the next call
         }
         return managed_recv_buffer::sptr();
     }
 
-    size_t get_num_recv_frames(void) const {return _num_recv_frames;}
+    #ifdef HAVE_RECVMMSG
+    /*******************************************************************
+     * Batched receive implementation:
+     *
+     * Hand out frames left over from the last batch first.
+     * Otherwise, gather up to recv_batch pending frames,
+     * and fill as many as possible with a single recvmmsg().
+     * Frames that were not filled are stashed for the next call.
+     ******************************************************************/
+    managed_recv_buffer::sptr get_recv_buff_batch(double timeout){
+        if (_batch_index < _batch_count){
+            const size_t i = _batch_index++;
+            return _batch_mrbs[i]->get_new(_batch_msgs[i].msg_len);
+        }
+
+        //wait for at least one frame, then take whatever else is available
+        if (not this->pop_stashed(_batch_mrbs[0]) and
+            not _pending_recv_buffs.pop_with_timed_wait(_batch_mrbs[0], timeout)
+        ) return managed_recv_buffer::sptr();
+        size_t num_mrbs = 1;
+        while (num_mrbs < _recv_batch and (
+            this->pop_stashed(_batch_mrbs[num_mrbs]) or
+            _pending_recv_buffs.pop_with_haste(_batch_mrbs[num_mrbs])
+        )) num_mrbs++;
+        for (size_t i = 0; i < num_mrbs; i++){
+            _batch_iovs[i].iov_base = _batch_mrbs[i]->cast<char *>();
+            _batch_iovs[i].iov_len = _recv_frame_size;
+        }
+
+        //try a non-blocking recvmmsg() and fall back to waiting with timeout
+        int ret = ::recvmmsg(_sock_fd, &_batch_msgs.front(), num_mrbs, MSG_DONTWAIT, NULL);
+        _num_recv_syscalls.inc();
+        if (ret <= 0 and _recv_spin_time > 0.0){
+            const boost::system_time spin_deadline = get_spin_deadline(timeout);
+            do{
+                ret = ::recvmmsg(_sock_fd, &_batch_msgs.front(), num_mrbs, MSG_DONTWAIT, NULL);
+                _num_recv_syscalls.inc();
+            } while (ret <= 0 and boost::get_system_time() < spin_deadline);
+            if (ret > 0) _num_recv_spin_hits.inc();
+            else _num_recv_spin_misses.inc();
+        }
+        if (ret <= 0){
+            _num_recv_syscalls.inc();
+            if (wait_for_recv_ready(_sock_fd, timeout)){
+                ret = ::recvmmsg(_sock_fd, &_batch_msgs.front(), num_mrbs, MSG_DONTWAIT, NULL);
+                _num_recv_syscalls.inc();
+            }
+        }
+
+        //keep the unfilled frames for the next call
+        const size_t num_filled = (ret > 0)? size_t(ret) : 0;
+        for (size_t i = num_filled; i < num_mrbs; i++){
+            _stashed_recv_buffs.push_back(_batch_mrbs[i]);
+        }
+        if (num_filled == 0) return managed_recv_buffer::sptr();
+
+        _num_recv_packets.add(boost::uint32_t(num_filled));
+        _batch_count = num_filled;
+        _batch_index = 1;
+        return _batch_mrbs[0]->get_new(_batch_msgs[0].msg_len);
+    }
+    #endif /*HAVE_RECVMMSG*/
+
+    size_t get_num_recv_frames(void) const {
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) return _recv_ring->get_num_recv_frames();
+        #endif /*HAVE_TPACKET_V3*/
+        return _num_recv_frames;
+    }
     size_t get_recv_frame_size(void) const {return _recv_frame_size;}
 
+    std::string get_recv_mode(void) const {
+        std::string mode = "socket";
+        if (_recv_batch > 1) mode = "batch";
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) mode = "ring";
+        #endif /*HAVE_TPACKET_V3*/
+        if (_recv_spin_time > 0.0) mode += "+spin";
+        if (_recv_busy_poll) mode += "+busy_poll";
+        return mode;
+    }
+
+    size_t get_num_recv_spin_hits(void) const {
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) return _recv_ring->get_num_recv_spin_hits();
+        #endif /*HAVE_TPACKET_V3*/
+        return _num_recv_spin_hits.read();
+    }
+    size_t get_num_recv_spin_misses(void) const {
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) return _recv_ring->get_num_recv_spin_misses();
+        #endif /*HAVE_TPACKET_V3*/
+        return _num_recv_spin_misses.read();
+    }
+
+    size_t get_num_recv_syscalls(void) const {
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) return _recv_ring->get_num_recv_syscalls();
+        #endif /*HAVE_TPACKET_V3*/
+        return _num_recv_syscalls.read();
+    }
+    size_t get_num_recv_packets(void) const {
+        #ifdef HAVE_TPACKET_V3
+        if (_recv_ring) return _recv_ring->get_num_recv_packets();
+        #endif /*HAVE_TPACKET_V3*/
+        return _num_recv_packets.read();
+    }
+
     /*******************************************************************
      * Send implementation:
      *
@@ -232,28 +616,88 @@ public:
      * The caller will fill the buffer and commit it when finished.
      * The commit routine will perform a blocking send operation,
      * and push the managed send buffer back into the queue.
+     *
+     * When batching, the commit routine queues the buffer instead.
+     * Queued buffers are only free once sent, so flush the batch
+     * before waiting on the queue of pending buffers.
      ******************************************************************/
     managed_send_buffer::sptr get_send_buff(double timeout){
         udp_zero_copy_asio_msb *msb = NULL;
+        if (_send_batch > 1){
+            _sender->flush_expired();
+            if (_pending_send_buffs.pop_with_haste(msb)){
+                return msb->get_new(_send_frame_size);
+            }
+            _sender->flush();
+        }
         if (_pending_send_buffs.pop_with_timed_wait(msb, timeout)){
             return msb->get_new(_send_frame_size);
         }
         return managed_send_buffer::sptr();
     }
 
+    void flush_send(void){
+        _sender->flush();
+    }
+
     size_t get_num_send_frames(void) const {return _num_send_frames;}
     size_t get_send_frame_size(void) const {return _send_frame_size;}
 
+    size_t get_num_send_syscalls(void) const {return _sender->get_num_syscalls();}
+    size_t get_num_send_packets(void) const {return _sender->get_num_packets();}
+
 private:
     //memory management -> buffers and fifos
     const size_t _recv_frame_size, _num_recv_frames;
     const size_t _send_frame_size, _num_send_frames;
     buffer_pool::sptr _recv_buffer_pool, _send_buffer_pool;
-    bounded_buffer<udp_zero_copy_asio_mrb *> _pending_recv_buffs;
-    bounded_buffer<udp_zero_copy_asio_msb *> _pending_send_buffs;
+    bounded_spsc_buffer<udp_zero_copy_asio_mrb *> _pending_recv_buffs;
+    boost::mutex _release_recv_mutex; //serializes the producers of the pending receive buffers
+    bounded_spsc_buffer<udp_zero_copy_asio_msb *> _pending_send_buffs;
     std::list<udp_zero_copy_asio_msb> _msb_pool;
     std::list<udp_zero_copy_asio_mrb> _mrb_pool;
 
+    //unfilled receive buffers -> only touched by the receiving thread
+    std::vector<udp_zero_copy_asio_mrb *> _stashed_recv_buffs;
+
+    UHD_INLINE bool pop_stashed(udp_zero_copy_asio_mrb *&mrb){
+        if (_stashed_recv_buffs.empty()) return false;
+        mrb = _stashed_recv_buffs.back();
+        _stashed_recv_buffs.pop_back();
+        return true;
+    }
+
+    //batched receive -> frames and headers for recvmmsg
+    size_t _recv_batch;
+    #ifdef HAVE_RECVMMSG
+    std::vector<udp_zero_copy_asio_mrb *> _batch_mrbs;
+    std::vector<iovec> _batch_iovs;
+    std::vector<mmsghdr> _batch_msgs;
+    size_t _batch_index, _batch_count;
+    #endif /*HAVE_RECVMMSG*/
+
+    #ifdef HAVE_TPACKET_V3
+    //packet ring -> zero copy receive (linux only)
+    udp_packet_ring::sptr _recv_ring;
+    #endif /*HAVE_TPACKET_V3*/
+
+    //send committer -> immediate or batched sends
+    size_t _send_batch;
+    boost::scoped_ptr<udp_zero_copy_asio_sender> _sender;
+
+    //low latency receive -> spin before blocking
+    const double _recv_spin_time;
+    bool _recv_busy_poll;
+
+    //the spin ends after the budget or the timeout, whichever is first
+    UHD_INLINE boost::system_time get_spin_deadline(double timeout) const{
+        return boost::get_system_time() + to_time_dur(std::min(_recv_spin_time, timeout));
+    }
+
+    //statistics -> syscalls per packet, spin outcomes
+    mutable atomic_uint32_t _num_recv_syscalls, _num_recv_packets;
+    mutable atomic_uint32_t _num_recv_spin_hits, _num_recv_spin_misses;
+
     //asio guts -> socket and service
     asio::io_service        _io_service;
     socket_sptr             _socket;
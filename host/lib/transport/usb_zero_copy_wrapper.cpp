@@ -16,7 +16,7 @@
 //
 
 #include <uhd/transport/usb_zero_copy.hpp>
-#include <uhd/transport/bounded_buffer.hpp>
+#include <uhd/transport/bounded_spsc_buffer.hpp>
 #include <uhd/transport/buffer_pool.hpp>
 #include <boost/foreach.hpp>
 #include <vector>
@@ -35,7 +35,7 @@ static inline size_t next_boundary(size_t length, size_t boundary){
  **********************************************************************/
 class usb_zero_copy_wrapper_mrb : public managed_recv_buffer{
 public:
-    usb_zero_copy_wrapper_mrb(bounded_buffer<usb_zero_copy_wrapper_mrb *> &queue):
+    usb_zero_copy_wrapper_mrb(bounded_spsc_buffer<usb_zero_copy_wrapper_mrb *> &queue):
         _queue(queue){/*NOP*/}
 
     void release(void){
@@ -56,7 +56,7 @@ private:
     const void *get_buff(void) const{return _mem;}
     size_t get_size(void) const{return _len;}
 
-    bounded_buffer<usb_zero_copy_wrapper_mrb *> &_queue;
+    bounded_spsc_buffer<usb_zero_copy_wrapper_mrb *> &_queue;
     const void *_mem;
     size_t _len;
     managed_recv_buffer::sptr _mrb;
@@ -67,7 +67,7 @@ private:
  **********************************************************************/
 class usb_zero_copy_wrapper_msb : public managed_send_buffer{
 public:
-    usb_zero_copy_wrapper_msb(bounded_buffer<usb_zero_copy_wrapper_msb *> &queue, size_t boundary):
+    usb_zero_copy_wrapper_msb(bounded_spsc_buffer<usb_zero_copy_wrapper_msb *> &queue, size_t boundary):
         _queue(queue), _boundary(boundary){/*NOP*/}
 
     void commit(size_t len){
@@ -86,7 +86,7 @@ private:
     void *get_buff(void) const{return _msb->cast<void *>();}
     size_t get_size(void) const{return _msb->size();}
 
-    bounded_buffer<usb_zero_copy_wrapper_msb *> &_queue;
+    bounded_spsc_buffer<usb_zero_copy_wrapper_msb *> &_queue;
     size_t _boundary;
     managed_send_buffer::sptr _msb;
 };
@@ -179,8 +179,8 @@ public:
 private:
     sptr _internal_zc;
     size_t _usb_frame_boundary;
-    bounded_buffer<usb_zero_copy_wrapper_mrb *> _available_recv_buffs;
-    bounded_buffer<usb_zero_copy_wrapper_msb *> _available_send_buffs;
+    bounded_spsc_buffer<usb_zero_copy_wrapper_mrb *> _available_recv_buffs;
+    bounded_spsc_buffer<usb_zero_copy_wrapper_msb *> _available_send_buffs;
     std::vector<usb_zero_copy_wrapper_mrb> _mrb_pool;
     std::vector<usb_zero_copy_wrapper_msb> _msb_pool;
     
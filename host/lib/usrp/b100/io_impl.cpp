@@ -97,14 +97,14 @@ void b100_impl::handle_async_message(managed_recv_buffer::sptr rbuf){
         if (metadata.event_code &
             ( async_metadata_t::EVENT_CODE_UNDERFLOW
             | async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET)
-        ) UHD_MSG(fastpath) << "U";
+        ) uhd::msg::post_fastpath('U');
         else if (metadata.event_code &
             ( async_metadata_t::EVENT_CODE_SEQ_ERROR
             | async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST)
-        ) UHD_MSG(fastpath) << "S";
+        ) uhd::msg::post_fastpath('S');
         else if (metadata.event_code &
             async_metadata_t::EVENT_CODE_TIME_ERROR
-        ) UHD_MSG(fastpath) << "L";
+        ) uhd::msg::post_fastpath('L');
     }
     else UHD_MSG(error) << "Unknown async packet" << std::endl;
 }
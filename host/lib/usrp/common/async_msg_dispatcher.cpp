@@ -0,0 +1,128 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "async_msg_dispatcher.hpp"
+#include <uhd/transport/bounded_buffer.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/exception.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <vector>
+
+using namespace uhd;
+using namespace uhd::usrp;
+using namespace uhd::transport;
+
+//the event code bits, in bit order
+static const char *event_names[async_msg_dispatcher::num_events] = {
+    "burst_ack", "underflow", "seq_error", "time_error", "underflow_in_packet", "seq_error_in_burst"
+};
+
+std::string async_msg_dispatcher::get_event_name(const size_t which){
+    return event_names[which];
+}
+
+class async_msg_dispatcher_impl : public async_msg_dispatcher{
+public:
+    async_msg_dispatcher_impl(const size_t num_chans, const size_t depth):
+        _fifo(depth),
+        _callbacks(new callbacks_type())
+    {
+        for (size_t i = 0; i < num_chans; i++){
+            _chans.push_back(boost::shared_ptr<chan_type>(new chan_type(depth)));
+        }
+    }
+
+    void post(const async_metadata_t &metadata){
+        chan_type &chan = this->get_chan(metadata.channel);
+
+        //the counters never lose a message
+        for (size_t i = 0; i < num_events; i++){
+            if (metadata.event_code & (1 << i)) chan.events[i].inc();
+        }
+
+        if (chan.queue_enabled.read() != 0 and not chan.queue.push_with_pop_on_full(metadata)){
+            chan.queue_drops.inc();
+        }
+        _fifo.push_with_pop_on_full(metadata);
+
+        //call without the lock so a callback may register another one
+        boost::shared_ptr<const callbacks_type> callbacks;
+        {
+            boost::mutex::scoped_lock lock(_callbacks_mutex);
+            callbacks = _callbacks;
+        }
+        BOOST_FOREACH(const device::async_msg_callback_t &callback, *callbacks){
+            callback(metadata);
+        }
+    }
+
+    bool recv(async_metadata_t &metadata, const double timeout){
+        boost::this_thread::disable_interruption di; //disable because the wait can throw
+        return _fifo.pop_with_timed_wait(metadata, timeout);
+    }
+
+    bool recv_chan(const size_t chan_i, async_metadata_t &metadata, const double timeout){
+        chan_type &chan = this->get_chan(chan_i);
+        chan.queue_enabled.write(1); //from now on the channel is queued
+        boost::this_thread::disable_interruption di; //disable because the wait can throw
+        return chan.queue.pop_with_timed_wait(metadata, timeout);
+    }
+
+    void register_callback(const device::async_msg_callback_t &callback){
+        //copy on write, a post in progress keeps the list it started with
+        boost::mutex::scoped_lock lock(_callbacks_mutex);
+        boost::shared_ptr<callbacks_type> callbacks(new callbacks_type(*_callbacks));
+        callbacks->push_back(callback);
+        _callbacks = callbacks;
+    }
+
+    size_t get_event_count(const size_t chan, const size_t which){
+        return this->get_chan(chan).events[which].read();
+    }
+
+    size_t get_queue_drops(const size_t chan){
+        return this->get_chan(chan).queue_drops.read();
+    }
+
+private:
+    struct chan_type{
+        chan_type(const size_t depth): queue(depth){}
+        atomic_uint32_t events[num_events];
+        atomic_uint32_t queue_enabled, queue_drops;
+        bounded_buffer<async_metadata_t> queue;
+    };
+
+    chan_type &get_chan(const size_t chan){
+        if (chan >= _chans.size()) throw uhd::index_error(str(
+            boost::format("async message channel %u out of range") % chan
+        ));
+        return *_chans[chan];
+    }
+
+    std::vector<boost::shared_ptr<chan_type> > _chans;
+    bounded_buffer<async_metadata_t> _fifo;
+    typedef std::vector<device::async_msg_callback_t> callbacks_type;
+    boost::mutex _callbacks_mutex;
+    boost::shared_ptr<const callbacks_type> _callbacks;
+};
+
+async_msg_dispatcher::sptr async_msg_dispatcher::make(const size_t num_chans, const size_t depth){
+    return sptr(new async_msg_dispatcher_impl(num_chans, depth));
+}
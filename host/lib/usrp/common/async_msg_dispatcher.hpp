@@ -0,0 +1,68 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_USRP_COMMON_ASYNC_MSG_DISPATCHER_HPP
+#define INCLUDED_LIBUHD_USRP_COMMON_ASYNC_MSG_DISPATCHER_HPP
+
+#include <uhd/config.hpp>
+#include <uhd/device.hpp>
+#include <uhd/types/metadata.hpp>
+#include <boost/shared_ptr.hpp>
+#include <string>
+
+namespace uhd{ namespace usrp{
+
+    /*!
+     * Hands out the async messages of a device:
+     * every message is counted per channel and event, goes into the common fifo,
+     * into the queue of its channel once that one is read, and to the callbacks.
+     */
+    class async_msg_dispatcher{
+    public:
+        typedef boost::shared_ptr<async_msg_dispatcher> sptr;
+
+        //! The number of event codes counted per channel
+        static const size_t num_events = 6;
+
+        //! Make a new dispatcher for a number of channels and queue depth
+        static sptr make(const size_t num_chans, const size_t depth);
+
+        //! The tree name of an event code counter by bit number
+        static std::string get_event_name(const size_t which);
+
+        //! Deliver a message from the device, called by the receiving thread
+        virtual void post(const async_metadata_t &metadata) = 0;
+
+        //! Pop a message of any channel, see device::recv_async_msg()
+        virtual bool recv(async_metadata_t &metadata, const double timeout) = 0;
+
+        //! Pop a message of one channel, see device::recv_chan_async_msg()
+        virtual bool recv_chan(const size_t chan, async_metadata_t &metadata, const double timeout) = 0;
+
+        //! Add a callback, see device::register_async_msg_callback()
+        virtual void register_callback(const device::async_msg_callback_t &callback) = 0;
+
+        //! The number of messages with an event code bit of a channel
+        virtual size_t get_event_count(const size_t chan, const size_t which) = 0;
+
+        //! The number of messages a full channel queue dropped
+        virtual size_t get_queue_drops(const size_t chan) = 0;
+    };
+
+}} //namespace uhd::usrp
+
+#endif /* INCLUDED_LIBUHD_USRP_COMMON_ASYNC_MSG_DISPATCHER_HPP */
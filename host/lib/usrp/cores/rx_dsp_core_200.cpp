@@ -184,7 +184,7 @@ public:
         return _scaling_adjustment/_fxpt_scale_adj;
     }
 
-    double set_freq(const double freq_){
+    double get_freq_word(const double freq_, boost::uint32_t &freq_word_){
         //correct for outside of rate (wrap around)
         double freq = std::fmod(freq_, _tick_rate);
         if (std::abs(freq) > _tick_rate/2.0)
@@ -198,8 +198,18 @@ public:
         //update the actual frequency
         const double actual_freq = (double(freq_word) / scale_factor) * _tick_rate;
 
-        _iface->poke32(REG_DSP_RX_FREQ, boost::uint32_t(freq_word));
+        freq_word_ = boost::uint32_t(freq_word);
+        return actual_freq;
+    }
 
+    void set_freq_word(const boost::uint32_t freq_word){
+        _iface->poke32(REG_DSP_RX_FREQ, freq_word);
+    }
+
+    double set_freq(const double freq){
+        boost::uint32_t freq_word;
+        const double actual_freq = this->get_freq_word(freq, freq_word);
+        this->set_freq_word(freq_word);
         return actual_freq;
     }
 
@@ -217,6 +227,10 @@ public:
             format_word = 0;
             _fxpt_scale_adj = 32767.;
         }
+        else if (format == "sc12"){
+            format_word = (1 << 19);
+            _fxpt_scale_adj = 32767.; //engine 16to12 drops lower 4 bits
+        }
         else if (format == "sc8"){
             format_word = (1 << 18);
             _fxpt_scale_adj = 127. * scale;
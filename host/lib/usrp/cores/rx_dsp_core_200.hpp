@@ -58,6 +58,12 @@ public:
 
     virtual double set_freq(const double freq) = 0;
 
+    //! Compute the CORDIC word for a freq without applying it, returns the actual freq
+    virtual double get_freq_word(const double freq, boost::uint32_t &freq_word) = 0;
+
+    //! Apply a CORDIC word computed by get_freq_word()
+    virtual void set_freq_word(const boost::uint32_t freq_word) = 0;
+
     virtual void handle_overflow(void) = 0;
 
     virtual void set_format(const std::string &format, const unsigned scale) = 0;
@@ -35,6 +35,7 @@
 #define REG_TX_CTRL_POLICY          _ctrl_base + 12
 #define REG_TX_CTRL_CYCLES_PER_UP   _ctrl_base + 16
 #define REG_TX_CTRL_PACKETS_PER_UP  _ctrl_base + 20
+#define REG_TX_CTRL_FORMAT          _ctrl_base + 24
 
 #define FLAG_TX_CTRL_POLICY_WAIT          (0x1 << 0)
 #define FLAG_TX_CTRL_POLICY_NEXT_PACKET   (0x1 << 1)
@@ -128,7 +129,7 @@ public:
         return _tick_rate/interp_rate;
     }
 
-    double set_freq(const double freq_){
+    double get_freq_word(const double freq_, boost::uint32_t &freq_word_){
         //correct for outside of rate (wrap around)
         double freq = std::fmod(freq_, _tick_rate);
         if (std::abs(freq) > _tick_rate/2.0)
@@ -142,8 +143,18 @@ public:
         //update the actual frequency
         const double actual_freq = (double(freq_word) / scale_factor) * _tick_rate;
 
-        _iface->poke32(REG_DSP_TX_FREQ, boost::uint32_t(freq_word));
+        freq_word_ = boost::uint32_t(freq_word);
+        return actual_freq;
+    }
+
+    void set_freq_word(const boost::uint32_t freq_word){
+        _iface->poke32(REG_DSP_TX_FREQ, freq_word);
+    }
 
+    double set_freq(const double freq){
+        boost::uint32_t freq_word;
+        const double actual_freq = this->get_freq_word(freq, freq_word);
+        this->set_freq_word(freq_word);
         return actual_freq;
     }
 
@@ -151,6 +162,16 @@ public:
         return uhd::meta_range_t(-_tick_rate/2, +_tick_rate/2, _tick_rate/std::pow(2.0, 32));
     }
 
+    void set_format(const std::string &format){
+        boost::uint32_t format_word = 0;
+        if (format == "sc16") format_word = 0;
+        else if (format == "sc12") format_word = (1 << 19);
+        else throw uhd::value_error("USRP TX cannot handle requested wire format: " + format);
+
+        //always written, a previous session may have left another format
+        _iface->poke32(REG_TX_CTRL_FORMAT, format_word);
+    }
+
     void set_updates(const size_t cycles_per_up, const size_t packets_per_up){
         _iface->poke32(REG_TX_CTRL_CYCLES_PER_UP,  (cycles_per_up  == 0)? 0 : (FLAG_TX_CTRL_UP_ENB | cycles_per_up));
         _iface->poke32(REG_TX_CTRL_PACKETS_PER_UP, (packets_per_up == 0)? 0 : (FLAG_TX_CTRL_UP_ENB | packets_per_up));
@@ -48,10 +48,19 @@ public:
 
     virtual double set_freq(const double freq) = 0;
 
+    //! Compute the CORDIC word for a freq without applying it, returns the actual freq
+    virtual double get_freq_word(const double freq, boost::uint32_t &freq_word) = 0;
+
+    //! Apply a CORDIC word computed by get_freq_word()
+    virtual void set_freq_word(const boost::uint32_t freq_word) = 0;
+
     virtual void set_updates(const size_t cycles_per_up, const size_t packets_per_up) = 0;
 
     virtual void set_underflow_policy(const std::string &policy) = 0;
 
+    //! Set the wire format of the samples, sc16 or sc12 (only on images with the unpacker)
+    virtual void set_format(const std::string &format) = 0;
+
 };
 
 #endif /* INCLUDED_LIBUHD_USRP_TX_DSP_CORE_200_HPP */
@@ -0,0 +1,154 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "wb_shadow_iface.hpp"
+#include <boost/thread/mutex.hpp>
+#include <boost/foreach.hpp>
+#include <utility>
+#include <vector>
+#include <map>
+
+class wb_shadow_iface_impl : public wb_shadow_iface{
+public:
+    wb_shadow_iface_impl(wb_iface::sptr iface, const is_async_type &is_async):
+        _iface(iface), _is_async(is_async), _hits(0), _misses(0)
+    {
+        //NOP
+    }
+
+    void poke32(wb_addr_type addr, boost::uint32_t data){
+        //decide under the lock, the device is accessed outside of it
+        size_t start_num = 0;
+        bool shadow_after = false;
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            if (not this->is_shadowed(addr)) lock.unlock();
+            else if (_is_async and _is_async()){
+                _shadow.erase(addr); //the result of the write is not known yet
+                _pokes[addr].num_started++;
+            }
+            else{
+                std::map<wb_addr_type, boost::uint32_t>::const_iterator it = _shadow.find(addr);
+                if (it != _shadow.end() and it->second == data){
+                    _hits++;
+                    return;
+                }
+                _misses++;
+
+                //forget the value until the write is done, and when it fails
+                _shadow.erase(addr);
+                poke_state_type &state = _pokes[addr];
+                shadow_after = (state.num_in_flight == 0);
+                start_num = ++state.num_started;
+                state.num_in_flight++;
+            }
+        }
+        if (not shadow_after) return _iface->poke32(addr, data);
+
+        try{
+            _iface->poke32(addr, data);
+        }
+        catch(...){
+            boost::mutex::scoped_lock lock(_mutex);
+            _pokes[addr].num_in_flight--;
+            throw;
+        }
+
+        //a poke to the same address that overlapped leaves the value unknown
+        boost::mutex::scoped_lock lock(_mutex);
+        poke_state_type &state = _pokes[addr];
+        state.num_in_flight--;
+        if (state.num_started == start_num) _shadow[addr] = data;
+    }
+
+    boost::uint32_t peek32(wb_addr_type addr){
+        return _iface->peek32(addr);
+    }
+
+    void poke16(wb_addr_type addr, boost::uint16_t data){
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _shadow.erase(addr & ~0x3); //a partial write makes the 32 bit value stale
+            _pokes[addr & ~0x3].num_started++;
+        }
+        _iface->poke16(addr, data);
+    }
+
+    boost::uint16_t peek16(wb_addr_type addr){
+        return _iface->peek16(addr);
+    }
+
+    void add_shadow_range(wb_addr_type begin, wb_addr_type end){
+        boost::mutex::scoped_lock lock(_mutex);
+        _ranges.push_back(std::make_pair(begin, end));
+    }
+
+    void invalidate(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        _shadow.clear();
+    }
+
+    void invalidate(wb_addr_type addr){
+        boost::mutex::scoped_lock lock(_mutex);
+        _shadow.erase(addr);
+    }
+
+    void flush(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        const std::map<wb_addr_type, boost::uint32_t> shadow = _shadow;
+        lock.unlock();
+        typedef std::pair<wb_addr_type, boost::uint32_t> reg_pair_type;
+        BOOST_FOREACH(const reg_pair_type &reg, shadow){
+            _iface->poke32(reg.first, reg.second);
+        }
+    }
+
+    size_t get_hits(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        return _hits;
+    }
+
+    size_t get_misses(void){
+        boost::mutex::scoped_lock lock(_mutex);
+        return _misses;
+    }
+
+private:
+    bool is_shadowed(wb_addr_type addr) const{
+        typedef std::pair<wb_addr_type, wb_addr_type> range_type;
+        BOOST_FOREACH(const range_type &range, _ranges){
+            if (addr >= range.first and addr < range.second) return true;
+        }
+        return false;
+    }
+
+    wb_iface::sptr _iface;
+    const is_async_type _is_async;
+    boost::mutex _mutex;
+    struct poke_state_type{
+        poke_state_type(void): num_started(0), num_in_flight(0){}
+        size_t num_started, num_in_flight;
+    };
+    std::map<wb_addr_type, poke_state_type> _pokes;
+    std::vector<std::pair<wb_addr_type, wb_addr_type> > _ranges;
+    std::map<wb_addr_type, boost::uint32_t> _shadow;
+    size_t _hits, _misses;
+};
+
+wb_shadow_iface::sptr wb_shadow_iface::make(wb_iface::sptr iface, const is_async_type &is_async){
+    return sptr(new wb_shadow_iface_impl(iface, is_async));
+}
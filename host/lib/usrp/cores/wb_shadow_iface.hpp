@@ -0,0 +1,72 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#ifndef INCLUDED_LIBUHD_USRP_WB_SHADOW_IFACE_HPP
+#define INCLUDED_LIBUHD_USRP_WB_SHADOW_IFACE_HPP
+
+#include <uhd/config.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include "wb_iface.hpp"
+
+/*!
+ * A wb_iface decorator that shadows settings registers:
+ * a poke32 of the value the register already holds is dropped.
+ * Only the addresses in the shadow ranges are cached,
+ * registers with side effects on write must stay out of them.
+ * Peeks and 16 bit accesses always go to the device.
+ * A poke that is not acked when it returns (ex: a pipelined write)
+ * is not shadowed, as its failure is only reported later.
+ */
+class wb_shadow_iface : public wb_iface, boost::noncopyable{
+public:
+    typedef boost::shared_ptr<wb_shadow_iface> sptr;
+    typedef boost::function<bool(void)> is_async_type;
+
+    /*!
+     * Make a new shadow cache in front of iface
+     * \param iface the device registers
+     * \param is_async true while the pokes of the calling thread are not acked
+     */
+    static sptr make(wb_iface::sptr iface, const is_async_type &is_async = is_async_type());
+
+    /*!
+     * Shadow the 32 bit registers in [begin, end).
+     * \param begin the first address of the range
+     * \param end the address after the last register
+     */
+    virtual void add_shadow_range(wb_addr_type begin, wb_addr_type end) = 0;
+
+    //! Forget all shadowed values, the next pokes go to the device
+    virtual void invalidate(void) = 0;
+
+    //! Forget the shadowed value of one register
+    virtual void invalidate(wb_addr_type addr) = 0;
+
+    //! Write all shadowed values to the device again (ex: after a reset)
+    virtual void flush(void) = 0;
+
+    //! The number of pokes that were dropped
+    virtual size_t get_hits(void) = 0;
+
+    //! The number of shadowed pokes that went to the device
+    virtual size_t get_misses(void) = 0;
+};
+
+#endif /* INCLUDED_LIBUHD_USRP_WB_SHADOW_IFACE_HPP */
@@ -3,6 +3,7 @@
 #include <uhd/utils/assert_has.hpp>
 #include <uhd/utils/algorithm.hpp>
 #include <uhd/utils/msg.hpp>
+#include <uhd/exception.hpp>
 #include <uhd/types/ranges.hpp>
 #include <uhd/types/sensors.hpp>
 #include <uhd/types/dict.hpp>
@@ -123,6 +124,34 @@ public:
         return actual_freq;
     }
 
+    std::vector<double> set_hop_table(dboard_iface::unit_t unit, const std::vector<double> &freqs) {
+        if (verbosity>0) printf("db_lms6002d::set_hop_table(%d entries)\n", int(freqs.size()));
+        std::vector<lms6002d_dev::pll_image> &hops = (unit==dboard_iface::UNIT_RX)? _rx_hops : _tx_hops;
+
+        // Only compute the register images, the LO stays where it is.
+        // The VCOCAP of an entry is searched on its first hop.
+        std::vector<lms6002d_dev::pll_image> images(freqs.size());
+        std::vector<double> actual_freqs;
+        for (size_t i = 0; i < freqs.size(); i++) {
+            const double actual_freq = lms6002d_dev::pll_image_calc(26e6, freqs[i], images[i]);
+            if (actual_freq <= 0)
+                throw uhd::value_error(str(boost::format("LMS6002D can't tune to hop frequency %f") % freqs[i]));
+            actual_freqs.push_back(actual_freq);
+        }
+        hops.swap(images);
+        return actual_freqs;
+    }
+
+    void set_hop(dboard_iface::unit_t unit, size_t index) {
+        std::vector<lms6002d_dev::pll_image> &hops = (unit==dboard_iface::UNIT_RX)? _rx_hops : _tx_hops;
+        if (index >= hops.size())
+            throw uhd::index_error(str(boost::format("LMS6002D hop index %u is out of the hop table (%u entries)") % index % hops.size()));
+        const bool locked = (unit==dboard_iface::UNIT_RX)
+                            ? lms.set_rx_pll_image(hops[index]) : lms.set_tx_pll_image(hops[index]);
+        if (not locked)
+            throw uhd::runtime_error(str(boost::format("LMS6002D can't find a VCOCAP for hop index %u") % index));
+    }
+
     bool set_enabled(dboard_iface::unit_t unit, bool en) {
         if (verbosity>0) printf("db_lms6002d::set_enabled(%d)\n", en);
         if (unit==dboard_iface::UNIT_RX) {
@@ -269,6 +298,7 @@ private:
     umtrx_lms6002d_dev lms;        // Interface to the LMS chip.
     int tx_vga1gain, tx_vga2gain;  // Stored values of Tx VGA1 and VGA2 gains.
     bool rf_loopback_enabled;      // Whether RF loopback is enabled.
+    std::vector<lms6002d_dev::pll_image> _rx_hops, _tx_hops; // Precomputed hop tables.
 };
 
 // Register the LMS dboards
@@ -322,6 +352,12 @@ db_lms6002d::db_lms6002d(ctor_args_t args) : xcvr_dboard_base(args),
         .coerce(boost::bind(&db_lms6002d::set_freq, this, dboard_iface::UNIT_RX, _1));
     this->get_rx_subtree()->create<meta_range_t>("freq/range")
         .set(lms_freq_range);
+    this->get_rx_subtree()->create<double>("lms6002d/tune_time")
+        .publish(boost::bind(&umtrx_lms6002d_dev::get_rx_tune_time, &lms));
+    this->get_rx_subtree()->create<std::vector<double> >("lms6002d/hop/table")
+        .coerce(boost::bind(&db_lms6002d::set_hop_table, this, dboard_iface::UNIT_RX, _1));
+    this->get_rx_subtree()->create<size_t>("lms6002d/hop/index")
+        .subscribe(boost::bind(&db_lms6002d::set_hop, this, dboard_iface::UNIT_RX, _1));
 
     this->get_rx_subtree()->create<std::string>("antenna/value")
         .subscribe(boost::bind(&db_lms6002d::set_rx_ant, this, _1))
@@ -360,6 +396,12 @@ db_lms6002d::db_lms6002d(ctor_args_t args) : xcvr_dboard_base(args),
         .coerce(boost::bind(&db_lms6002d::set_freq, this, dboard_iface::UNIT_TX, _1));
     this->get_tx_subtree()->create<meta_range_t>("freq/range")
         .set(lms_freq_range);
+    this->get_tx_subtree()->create<double>("lms6002d/tune_time")
+        .publish(boost::bind(&umtrx_lms6002d_dev::get_tx_tune_time, &lms));
+    this->get_tx_subtree()->create<std::vector<double> >("lms6002d/hop/table")
+        .coerce(boost::bind(&db_lms6002d::set_hop_table, this, dboard_iface::UNIT_TX, _1));
+    this->get_tx_subtree()->create<size_t>("lms6002d/hop/index")
+        .subscribe(boost::bind(&db_lms6002d::set_hop, this, dboard_iface::UNIT_TX, _1));
 
     this->get_tx_subtree()->create<std::string>("antenna/value")
         .subscribe(boost::bind(&db_lms6002d::set_tx_ant, this, _1))
@@ -69,6 +69,7 @@ public:
 
     void write_spi(unit_t, const spi_config_t &config, boost::uint32_t data, size_t num_bits) {
         // HACK: We ignore SPI device address and always write to our LMS.
+        // Pipelined only inside an async_writes_scope of the calling thread.
         _iface->write_spi(_lms_spi_number, config, data, num_bits);
     }
 
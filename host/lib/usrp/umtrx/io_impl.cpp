@@ -17,8 +17,11 @@
 //
 
 #include "validate_subdev_spec.hpp"
+#include "async_msg_dispatcher.hpp"
 #include "../../transport/super_recv_packet_handler.hpp"
 #include "../../transport/super_send_packet_handler.hpp"
+#include "../../transport/super_recv_capture_streamer.hpp"
+#include "../../transport/super_send_thread_streamer.hpp"
 #include "umtrx_impl.hpp"
 #include "umtrx_regs.hpp"
 #include <uhd/utils/log.hpp>
@@ -33,7 +36,9 @@
 #include <boost/bind.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/make_shared.hpp>
+#include <algorithm>
 #include <iostream>
+#include <cmath>
 
 using namespace uhd;
 using namespace uhd::usrp;
@@ -55,9 +60,7 @@ static const size_t vrt_send_header_offset_words32 = 1;
  **********************************************************************/
 struct umtrx_impl::io_impl {
 
-    io_impl(void):
-        async_msg_fifo(100/*messages deep*/)
-    {
+    io_impl(void){
         /* NOP */
     }
 
@@ -70,25 +73,52 @@ struct umtrx_impl::io_impl {
         flow_control_monitor &fc_mon = *fc_mons[chan];
 
         //wait on flow control w/ timeout
-        if (not fc_mon.check_fc_condition(timeout)) return managed_send_buffer::sptr();
+        //(the acks can only come back once the queued frames are sent)
+        if (not fc_mon.check_fc_condition(0.0)){
+            this->flush_send_buffs(chan);
+            if (not fc_mon.check_fc_condition(timeout)){
+                tx_events[chan]->inc(sph::stream_event_counters::EVENT_TIMEOUT);
+                return managed_send_buffer::sptr();
+            }
+        }
 
         //get a buffer from the transport w/ timeout
         managed_send_buffer::sptr buff = tx_xports[chan]->get_send_buff(timeout);
 
         //write the flow control word into the buffer
         if (buff.get()) buff->cast<boost::uint32_t *>()[0] = uhd::htonx(fc_mon.get_curr_seq_out());
+        else tx_events[chan]->inc(sph::stream_event_counters::EVENT_TIMEOUT);
 
         return buff;
     }
 
+    void flush_send_buffs(size_t chan){
+        udp_zero_copy *udp_xport = dynamic_cast<udp_zero_copy *>(tx_xports[chan].get());
+        if (udp_xport != NULL) udp_xport->flush_send();
+    }
+
+    //the window is the device sram, or the packets of the latency at this rate
+    void update_fc_window(size_t chan, double samp_rate){
+        size_t max_seqs_out = fc_sram_seqs[chan];
+        if (fc_latencies[chan] > 0.0 and fc_spps[chan] != 0) max_seqs_out = std::min(max_seqs_out, std::max<size_t>(1,
+            size_t(std::ceil(fc_latencies[chan]*samp_rate/fc_spps[chan]))
+        ));
+        fc_mons[chan]->set_max_seqs_out(flow_control_monitor::seq_type(max_seqs_out));
+    }
+
     //tx dsp: xports and flow control monitors
     std::vector<zero_copy_if::sptr> tx_xports;
     std::vector<flow_control_monitor::sptr> fc_mons;
+    std::vector<size_t> fc_sram_seqs, fc_spps;
+    std::vector<double> fc_latencies;
+
+    //host side stream events of the rx and tx dsps
+    std::vector<sph::stream_event_counters::sptr> rx_events, tx_events;
 
     //methods and variables for the pirate crew
     void recv_pirate_loop(zero_copy_if::sptr, size_t);
     std::list<task::sptr> pirate_tasks;
-    bounded_buffer<async_metadata_t> async_msg_fifo;
+    async_msg_dispatcher::sptr async_msgs;
     double tick_rate;
 };
 
@@ -137,19 +167,19 @@ void umtrx_impl::io_impl::recv_pirate_loop(
                     continue;
                 }
                 //else UHD_MSG(often) << "metadata.event_code " << metadata.event_code << std::endl;
-                async_msg_fifo.push_with_pop_on_full(metadata);
+                async_msgs->post(metadata);
 
                 if (metadata.event_code &
                     ( async_metadata_t::EVENT_CODE_UNDERFLOW
                     | async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET)
-                ) UHD_MSG(fastpath) << "U";
+                ) uhd::msg::post_fastpath('U');
                 else if (metadata.event_code &
                     ( async_metadata_t::EVENT_CODE_SEQ_ERROR
                     | async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST)
-                ) UHD_MSG(fastpath) << "S";
+                ) uhd::msg::post_fastpath('S');
                 else if (metadata.event_code &
                     async_metadata_t::EVENT_CODE_TIME_ERROR
-                ) UHD_MSG(fastpath) << "L";
+                ) uhd::msg::post_fastpath('L');
             }
             else{
                 //TODO unknown received packet, may want to print error...
@@ -172,17 +202,51 @@ void umtrx_impl::io_init(void) {
         //init the tx xport and flow control monitor
         _io_impl->tx_xports.push_back(_mbc[mb].tx_dsp_xports[0]);
         _io_impl->tx_xports.push_back(_mbc[mb].tx_dsp_xports[1]);
-        _io_impl->fc_mons.push_back(flow_control_monitor::sptr(new flow_control_monitor(
-            UMTRX_SRAM_BYTES/_mbc[mb].tx_dsp_xports[0]->get_send_frame_size()
-        )));
-        _io_impl->fc_mons.push_back(flow_control_monitor::sptr(new flow_control_monitor(
-            UMTRX_SRAM_BYTES/_mbc[mb].tx_dsp_xports[1]->get_send_frame_size()
-        )));
+        for (size_t dsp = 0; dsp < 2; dsp++){
+            const size_t sram_seqs = UMTRX_SRAM_BYTES/_mbc[mb].tx_dsp_xports[dsp]->get_send_frame_size();
+            _io_impl->fc_mons.push_back(flow_control_monitor::sptr(new flow_control_monitor(sram_seqs)));
+            _io_impl->fc_sram_seqs.push_back(sram_seqs);
+            _io_impl->fc_spps.push_back(0);
+            _io_impl->fc_latencies.push_back(0.0);
+        }
+    }
+
+    //async messages of every tx dsp, counted in the tree
+    _io_impl->async_msgs = async_msg_dispatcher::make(_io_impl->fc_mons.size(), 100/*messages deep*/);
+    size_t chan = 0;
+    BOOST_FOREACH(const std::string &mb, _mbc.keys()){
+        for (size_t dsp = 0; dsp < 2; dsp++, chan++){
+            const fs_path events_path = "/mboards/" + mb + str(boost::format("/tx_dsps/%u/events") % dsp);
+            for (size_t i = 0; i < async_msg_dispatcher::num_events; i++){
+                _tree->create<size_t>(events_path / async_msg_dispatcher::get_event_name(i))
+                    .publish(boost::bind(&async_msg_dispatcher::get_event_count, _io_impl->async_msgs, chan, i));
+            }
+            _tree->create<size_t>(events_path / "queue_drops")
+                .publish(boost::bind(&async_msg_dispatcher::get_queue_drops, _io_impl->async_msgs, chan));
+            _io_impl->tx_events.push_back(sph::stream_event_counters::sptr(new sph::stream_event_counters()));
+            _tree->create<size_t>(events_path / "timeout").publish(boost::bind(
+                &sph::stream_event_counters::get, _io_impl->tx_events.back(), sph::stream_event_counters::EVENT_TIMEOUT
+            ));
+        }
+    }
+
+    //host side events of every rx dsp, counted in the tree
+    BOOST_FOREACH(const std::string &mb, _mbc.keys()){
+        for (size_t dsp = 0; dsp < _mbc[mb].rx_dsps.size(); dsp++){
+            const fs_path events_path = "/mboards/" + mb + str(boost::format("/rx_dsps/%u/events") % dsp);
+            _io_impl->rx_events.push_back(sph::stream_event_counters::sptr(new sph::stream_event_counters()));
+            for (size_t i = 0; i < sph::stream_event_counters::NUM_EVENTS; i++){
+                const sph::stream_event_counters::event_type event = sph::stream_event_counters::event_type(i);
+                _tree->create<size_t>(events_path / sph::stream_event_counters::get_name(event))
+                    .publish(boost::bind(&sph::stream_event_counters::get, _io_impl->rx_events.back(), event));
+            }
+        }
     }
 
     //allocate streamer weak ptrs containers
     BOOST_FOREACH(const std::string &mb, _mbc.keys()){
         _mbc[mb].rx_streamers.resize(_mbc[mb].rx_dsps.size());
+        _mbc[mb].rx_streamer_chans.resize(_mbc[mb].rx_dsps.size());
         _mbc[mb].tx_streamers.resize(_mbc[mb].tx_dsps.size());
     }
 
@@ -231,11 +295,40 @@ void umtrx_impl::update_rx_samp_rate(const std::string &mb, const size_t dsp, co
     my_streamer->set_scale_factor(adj);
 }
 
+void umtrx_impl::update_rx_correction(const std::string &mb, const size_t dsp){
+    boost::shared_ptr<sph::recv_packet_streamer> my_streamer =
+        boost::dynamic_pointer_cast<sph::recv_packet_streamer>(_mbc[mb].rx_streamers[dsp].lock());
+    if (my_streamer.get() == NULL) return;
+
+    const size_t chan = _mbc[mb].rx_streamer_chans[dsp];
+    const fs_path corr_path = "/mboards/" + mb + str(boost::format("/rx_dsps/%u/correction") % dsp);
+    if (not _tree->access<bool>(corr_path / "enabled").get()){
+        my_streamer->clear_correction(chan);
+        return;
+    }
+
+    convert::correction_type correction;
+    correction.dc_offset = _tree->access<std::complex<double> >(corr_path / "dc_offset/value").get();
+    const std::vector<double> matrix = _tree->access<std::vector<double> >(corr_path / "iq_matrix/value").get();
+    correction.matrix[0][0] = matrix[0]; correction.matrix[0][1] = matrix[1];
+    correction.matrix[1][0] = matrix[2]; correction.matrix[1][1] = matrix[3];
+    correction.gain = _tree->access<double>(corr_path / "gain/value").get();
+    my_streamer->set_correction(chan, correction);
+}
+
 void umtrx_impl::update_tx_samp_rate(const std::string &mb, const size_t dsp, const double rate){
     boost::shared_ptr<sph::send_packet_streamer> my_streamer =
         boost::dynamic_pointer_cast<sph::send_packet_streamer>(_mbc[mb].tx_streamers[dsp].lock());
     if (my_streamer.get() == NULL) return;
 
+    //a latency window follows the rate
+    size_t abs = 0;
+    BOOST_FOREACH(const std::string &key, _mbc.keys()){
+        if (key == mb) break;
+        abs += 2; //assume 2 tx dsp
+    }
+    _io_impl->update_fc_window(abs+dsp, rate);
+
     my_streamer->set_samp_rate(rate);
 }
 
@@ -272,10 +365,10 @@ void umtrx_impl::update_rx_subdev_spec(const std::string &which_mb, const subdev
     //set DSPs to frontends mapping
     if (spec[0].db_name == "A") {
         //default: DSP0<-frontend0, DSP1<-frontend1
-        _mbc[which_mb].iface->poke32(U2_REG_SR_ADDR(SR_RX_FRONT_SW), 0);
+        _mbc[which_mb].shadow->poke32(U2_REG_SR_ADDR(SR_RX_FRONT_SW), 0);
     } else {
         //swapped: DSP0<-frontend1, DSP1<-frontend0
-        _mbc[which_mb].iface->poke32(U2_REG_SR_ADDR(SR_RX_FRONT_SW), 1);
+        _mbc[which_mb].shadow->poke32(U2_REG_SR_ADDR(SR_RX_FRONT_SW), 1);
     }
 
     //compute the new occupancy and resize
@@ -298,10 +391,10 @@ void umtrx_impl::update_tx_subdev_spec(const std::string &which_mb, const subdev
     //set DSPs to frontends mapping
     if (spec[0].db_name == "A") {
         //default: DSP0->frontend0, DSP1->frontend1
-        _mbc[which_mb].iface->poke32(U2_REG_SR_ADDR(SR_TX_FRONT_SW), 0);
+        _mbc[which_mb].shadow->poke32(U2_REG_SR_ADDR(SR_TX_FRONT_SW), 0);
     } else {
         //swapped: DSP0->frontend1, DSP1->frontend0
-        _mbc[which_mb].iface->poke32(U2_REG_SR_ADDR(SR_TX_FRONT_SW), 1);
+        _mbc[which_mb].shadow->poke32(U2_REG_SR_ADDR(SR_TX_FRONT_SW), 1);
     }
 
     //compute the new occupancy and resize
@@ -316,8 +409,32 @@ void umtrx_impl::update_tx_subdev_spec(const std::string &which_mb, const subdev
 bool umtrx_impl::recv_async_msg(
     async_metadata_t &async_metadata, double timeout
 ){
-    boost::this_thread::disable_interruption di; //disable because the wait can throw
-    return _io_impl->async_msg_fifo.pop_with_timed_wait(async_metadata, timeout);
+    return _io_impl->async_msgs->recv(async_metadata, timeout);
+}
+
+bool umtrx_impl::recv_chan_async_msg(
+    size_t channel, async_metadata_t &async_metadata, double timeout
+){
+    return _io_impl->async_msgs->recv_chan(channel, async_metadata, timeout);
+}
+
+void umtrx_impl::register_async_msg_callback(const async_msg_callback_t &callback){
+    _io_impl->async_msgs->register_callback(callback);
+}
+
+/***********************************************************************
+ * Wire format support of the FPGA images
+ **********************************************************************/
+void umtrx_impl::check_otw_format(const std::string &otw_format){
+    if (otw_format != "sc12") return;
+    BOOST_FOREACH(const std::string &mb, _mbc.keys()){
+        if (_mbc[mb].has_sc12) continue;
+        throw uhd::runtime_error(str(boost::format(
+            "The FPGA image of mboard %s (version %s) cannot pack sc12 samples.\n"
+            "Please update to an FPGA image with compatibility number %u.%u or newer."
+        ) % mb % _tree->access<std::string>("/mboards/" + mb + "/fpga_version").get()
+          % int(USRP2_FPGA_COMPAT_NUM) % int(UMTRX_FPGA_SC12_MINOR)));
+    }
 }
 
 /***********************************************************************
@@ -330,6 +447,7 @@ rx_streamer::sptr umtrx_impl::get_rx_stream(const uhd::stream_args_t &args_){
     args.otw_format = args.otw_format.empty()? "sc16" : args.otw_format;
     args.channels = args.channels.empty()? std::vector<size_t>(1, 0) : args.channels;
     const unsigned sc8_scalar = unsigned(args.args.cast<double>("scalar", 0x400));
+    this->check_otw_format(args.otw_format);
 
     //calculate packet size
     static const size_t hdr_size = 0
@@ -338,7 +456,8 @@ rx_streamer::sptr umtrx_impl::get_rx_stream(const uhd::stream_args_t &args_){
         - sizeof(vrt::if_packet_info_t().cid) //no class id ever used
     ;
     const size_t bpp = _mbc[_mbc.keys().front()].rx_dsp_xports[0]->get_recv_frame_size() - hdr_size;
-    const size_t spp = bpp/convert::get_bytes_per_item(args.otw_format);
+    //whole words of payload, sc12 may leave the last one partly filled
+    const size_t spp = (bpp & ~size_t(0x3))/convert::get_bytes_per_item(args.otw_format);
 
     //make the new streamer given the samples per packet
     boost::shared_ptr<sph::recv_packet_streamer> my_streamer = boost::make_shared<sph::recv_packet_streamer>(spp);
@@ -346,6 +465,7 @@ rx_streamer::sptr umtrx_impl::get_rx_stream(const uhd::stream_args_t &args_){
     //init some streamer stuff
     my_streamer->resize(args.channels.size());
     my_streamer->set_vrt_unpacker(&vrt::if_hdr_unpack_be);
+    my_streamer->set_convert_threads(args.args.cast<size_t>("convert_threads", 1));
 
     //set the converter
     uhd::convert::id_type id;
@@ -359,6 +479,7 @@ rx_streamer::sptr umtrx_impl::get_rx_stream(const uhd::stream_args_t &args_){
     for (size_t chan_i = 0; chan_i < args.channels.size(); chan_i++){
         const size_t chan = args.channels[chan_i];
         size_t num_chan_so_far = 0;
+        size_t abs = 0;
         BOOST_FOREACH(const std::string &mb, _mbc.keys()){
             num_chan_so_far += _mbc[mb].rx_chan_occ;
             if (chan < num_chan_so_far){
@@ -369,9 +490,13 @@ rx_streamer::sptr umtrx_impl::get_rx_stream(const uhd::stream_args_t &args_){
                 my_streamer->set_xport_chan_get_buff(chan_i, boost::bind(
                     &zero_copy_if::get_recv_buff, _mbc[mb].rx_dsp_xports[dsp], _1
                 ), true /*flush*/);
+                my_streamer->set_event_counters(chan_i, _io_impl->rx_events[abs+dsp]);
                 _mbc[mb].rx_streamers[dsp] = my_streamer; //store weak pointer
+                _mbc[mb].rx_streamer_chans[dsp] = chan_i;
+                this->update_rx_correction(mb, dsp);
                 break;
             }
+            abs += _mbc[mb].rx_dsps.size();
         }
     }
 
@@ -382,6 +507,13 @@ rx_streamer::sptr umtrx_impl::get_rx_stream(const uhd::stream_args_t &args_){
     //sets all tick and samp rates on this streamer
     this->update_rates();
 
+    //capture into rings in the background when asked for
+    if (args.args.has_key("capture_samps")) return boost::make_shared<sph::recv_capture_streamer>(
+        my_streamer, convert::get_bytes_per_item(args.cpu_format),
+        size_t(args.args.cast<double>("capture_samps", 0)), args.args.cast<int>("capture_cpu", -1),
+        args.args.has_key("capture_huge_pages")
+    );
+
     return my_streamer;
 }
 
@@ -395,18 +527,23 @@ tx_streamer::sptr umtrx_impl::get_tx_stream(const uhd::stream_args_t &args_){
     args.otw_format = args.otw_format.empty()? "sc16" : args.otw_format;
     args.channels = args.channels.empty()? std::vector<size_t>(1, 0) : args.channels;
 
-    if (args.otw_format != "sc16"){
+    if (args.otw_format != "sc16" and args.otw_format != "sc12"){
         throw uhd::value_error("USRP TX cannot handle requested wire format: " + args.otw_format);
     }
+    this->check_otw_format(args.otw_format);
+
+    //sc12 packets can end in a partly filled word, the trailer tells the dsp how much of it
+    const bool has_tlr = (args.otw_format == "sc12");
 
     //calculate packet size
-    static const size_t hdr_size = 0
+    const size_t hdr_size = 0
         + vrt::max_if_hdr_words32*sizeof(boost::uint32_t)
         + vrt_send_header_offset_words32*sizeof(boost::uint32_t)
+        + ((has_tlr)? sizeof(vrt::if_packet_info_t().tlr) : 0)
         - sizeof(vrt::if_packet_info_t().cid) //no class id ever used
     ;
     const size_t bpp = _mbc[_mbc.keys().front()].tx_dsp_xports[0]->get_send_frame_size() - hdr_size;
-    const size_t spp = bpp/convert::get_bytes_per_item(args.otw_format);
+    const size_t spp = (bpp & ~size_t(0x3))/convert::get_bytes_per_item(args.otw_format);
 
     //make the new streamer given the samples per packet
     boost::shared_ptr<sph::send_packet_streamer> my_streamer = boost::make_shared<sph::send_packet_streamer>(spp);
@@ -414,6 +551,8 @@ tx_streamer::sptr umtrx_impl::get_tx_stream(const uhd::stream_args_t &args_){
     //init some streamer stuff
     my_streamer->resize(args.channels.size());
     my_streamer->set_vrt_packer(&vrt::if_hdr_pack_be, vrt_send_header_offset_words32);
+    my_streamer->set_enable_trailer(has_tlr);
+    my_streamer->set_convert_threads(args.args.cast<size_t>("convert_threads", 1));
 
     //set the converter
     uhd::convert::id_type id;
@@ -437,9 +576,16 @@ tx_streamer::sptr umtrx_impl::get_tx_stream(const uhd::stream_args_t &args_){
                     _io_impl->fc_mons[abs+dsp]->clear();
                 }
                 if (args.args.has_key("underflow_policy")) _mbc[mb].tx_dsps[dsp]->set_underflow_policy(args.args["underflow_policy"]);
+                _io_impl->fc_spps[abs+dsp] = spp;
+                _io_impl->fc_latencies[abs+dsp] = args.args.cast<double>("latency_us", 0.0)*1e-6;
+                //only images with the unpacker have the format register
+                if (_mbc[mb].has_sc12) _mbc[mb].tx_dsps[dsp]->set_format(args.otw_format);
                 my_streamer->set_xport_chan_get_buff(chan_i, boost::bind(
                     &umtrx_impl::io_impl::get_send_buff, _io_impl.get(), abs+dsp, _1
                 ));
+                my_streamer->set_xport_chan_flush(chan_i, boost::bind(
+                    &umtrx_impl::io_impl::flush_send_buffs, _io_impl.get(), abs+dsp
+                ));
                 _mbc[mb].tx_streamers[dsp] = my_streamer; //store weak pointer
                 break;
             }
@@ -450,5 +596,11 @@ tx_streamer::sptr umtrx_impl::get_tx_stream(const uhd::stream_args_t &args_){
     //sets all tick and samp rates on this streamer
     this->update_rates();
 
+    //send from a background thread when asked for
+    if (args.args.has_key("sender_samps")) return boost::make_shared<sph::send_thread_streamer>(
+        my_streamer, convert::get_bytes_per_item(args.cpu_format),
+        size_t(args.args.cast<double>("sender_samps", 0)), args.args.cast<int>("sender_cpu", -1)
+    );
+
     return my_streamer;
 }
@@ -15,6 +15,7 @@
 //
 
 #include "lms6002d.hpp"
+#include <uhd/types/time_spec.hpp>
 
 static int verbosity = 0;
 
@@ -46,7 +47,7 @@ void lms6002d_dev::dump()
     }
 }
 
-double lms6002d_dev::txrx_pll_tune(uint8_t reg, double ref_clock, double out_freq)
+double lms6002d_dev::pll_image_calc(double ref_clock, double out_freq, pll_image &image)
 {
     // Supported frequency ranges and corresponding FREQSEL values.
     static const struct vco_sel { int64_t fmin; int64_t fmax; int8_t value; } freqsel[] = {
@@ -68,8 +69,6 @@ double lms6002d_dev::txrx_pll_tune(uint8_t reg, double ref_clock, double out_fre
         { 3.24e9,     3.72e9,     0x3c },
     };
 
-    if (verbosity>0) printf("lms6002d_dev::txrx_pll_tune(ref_clock=%f, out_freq=%f)\n", ref_clock, out_freq);
-
     // Find frequency range and FREQSEL for the given frequency
     int8_t found_freqsel = -1;
     for (unsigned i = 0; i < (int)sizeof(freqsel) / sizeof(freqsel[0]); i++) {
@@ -92,59 +91,124 @@ double lms6002d_dev::txrx_pll_tune(uint8_t reg, double ref_clock, double out_fre
     // DEBUG
     if (verbosity>0) printf("FREQSEL=%d VCO_X=%d NINT=%d  NFRAC=%d ACTUAL_FREQ=%f\n\n", (int)found_freqsel, (int)vco_x, (int)nint, (int)nfrac, actual_freq);
 
+    image.nint_nfrac[0] = (nint >> 1) & 0xff;    // NINT[8:1]
+    image.nint_nfrac[1] = ((nfrac >> 16) & 0x7f) | ((nint & 0x1) << 7); //NINT[0] nfrac[22:16]
+    image.nint_nfrac[2] = (nfrac >> 8) & 0xff;  // NFRAC[15:8]
+    image.nint_nfrac[3] = (nfrac) & 0xff;     // NFRAC[7:0]
+    image.freqsel = found_freqsel;
+    image.vcocap = VCOCAP_UNKNOWN;
+    return actual_freq;
+}
+
+double lms6002d_dev::txrx_pll_tune(uint8_t reg, double ref_clock, double out_freq)
+{
+    if (verbosity>0) printf("lms6002d_dev::txrx_pll_tune(ref_clock=%f, out_freq=%f)\n", ref_clock, out_freq);
+    const uhd::time_spec_t start_time = uhd::time_spec_t::get_system_time();
+
+    pll_image image;
+    const double actual_freq = pll_image_calc(ref_clock, out_freq, image);
+    if (actual_freq < 0 or not txrx_pll_apply(reg, image))
+        return -1;
+
+    const double tune_time = (uhd::time_spec_t::get_system_time() - start_time).get_real_secs();
+    if (reg == 0x10) _tx_tune_time = tune_time;
+    else             _rx_tune_time = tune_time;
+    if (verbosity>0) printf("PLL tune took %f ms\n", tune_time*1e3);
+
+    // Return actual frequency we've tuned to
+    return actual_freq;
+}
+
+bool lms6002d_dev::txrx_pll_apply(uint8_t reg, pll_image &image)
+{
     // Write NINT, NFRAC
-    write_reg(reg + 0x0, (nint >> 1) & 0xff);    // NINT[8:1]
-    write_reg(reg + 0x1, ((nfrac >> 16) & 0x7f) | ((nint & 0x1) << 7)); //NINT[0] nfrac[22:16]
-    write_reg(reg + 0x2, (nfrac >> 8) & 0xff);  // NFRAC[15:8]
-    write_reg(reg + 0x3, (nfrac) & 0xff);     // NFRAC[7:0]
+    for (int i = 0; i < 4; i++)
+        lms_write(reg + i, image.nint_nfrac[i]);
     // Write FREQSEL
-    lms_write_bits(reg + 0x5, (0x3f << 2), (found_freqsel << 2)); // FREQSEL[5:0]
+    lms_write_bits(reg + 0x5, (0x3f << 2), (image.freqsel << 2)); // FREQSEL[5:0]
     // Reset VOVCOREG, OFFDOWN to default
     // -- I think this is not needed here, as it changes settings which
     //    we may want to set beforehand.
-//    write_reg(reg + 0x8, 0x40); // VOVCOREG[3:1] OFFDOWN[4:0]
-//    write_reg(reg + 0x9, 0x94); // VOVCOREG[0] VCOCAP[5:0]
+//    lms_write(reg + 0x8, 0x40); // VOVCOREG[3:1] OFFDOWN[4:0]
+//    lms_write(reg + 0x9, 0x94); // VOVCOREG[0] VCOCAP[5:0]
 
-    // DEBUG
-    //reg_dump();
-
-    // Poll VOVCO
-    int start_i = -1;
-    int stop_i = -1;
-    enum State { VCO_HIGH, VCO_NORM, VCO_LOW } state = VCO_HIGH;
-    for (int i = 0; i < 64; i++) {
-        // Update VCOCAP
-        lms_write_bits(reg + 0x9, 0x3f, i);
-        //usleep(50);
-
-        int comp = read_reg(reg + 0x0a);
-        switch (comp >> 6) {
-        case 0x02: //HIGH
-            break;
-        case 0x01: //LOW
-            if (state == VCO_NORM) {
-                stop_i = i - 1;
-                state = VCO_LOW;
-                if (verbosity>1) printf("Low\n");
-            }
-            break;
-        case 0x00: //NORMAL
-            if (state == VCO_HIGH) {
-                start_i = i;
-                state = VCO_NORM;
-                if (verbosity>1) printf("Norm\n");
-            }
-            break;
-        default: //ERROR
+    if (image.vcocap != VCOCAP_UNKNOWN) {
+        lms_write_bits(reg + 0x9, 0x3f, image.vcocap);
+        return true;
+    }
+
+    // Pick VCOCAP. A cached value is trusted after a single comparator
+    // readback, otherwise the window is searched again.
+    const uint64_t cache_key = (uint64_t(reg) << 40)
+                             | (uint64_t(image.freqsel & 0x3f) << 32)
+                             | (uint64_t(image.nint_nfrac[0]) << 24)
+                             | (uint64_t(image.nint_nfrac[1]) << 16)
+                             | (uint64_t(image.nint_nfrac[2]) << 8)
+                             | uint64_t(image.nint_nfrac[3]);
+    std::map<uint64_t, uint8_t>::const_iterator cached = _vcocap_cache.find(cache_key);
+    if (cached != _vcocap_cache.end() and vco_comparator(reg, cached->second) == VCO_NORM) {
+        if (verbosity>0) printf("VCOCAP=%d (cached)\n", (int)cached->second);
+        image.vcocap = cached->second;
+    } else {
+        const int vcocap = vcocap_search(reg);
+        if (vcocap < 0) {
+            _vcocap_cache.erase(cache_key);
+            return false;
+        }
+        _vcocap_cache[cache_key] = vcocap;
+        image.vcocap = vcocap;
+    }
+    return true;
+}
+
+lms6002d_dev::vco_state lms6002d_dev::vco_comparator(uint8_t reg, int vcocap)
+{
+    // Update VCOCAP
+    lms_write_bits(reg + 0x9, 0x3f, vcocap);
+    //usleep(50);
+
+    int comp = lms_read(reg + 0x0a);
+    if (verbosity>1) printf("VOVCO[%d]=%x\n", vcocap, (comp>>6));
+    switch (comp >> 6) {
+    case 0x02: return VCO_HIGH;
+    case 0x00: return VCO_NORM;
+    case 0x01: return VCO_LOW;
+    default:   return VCO_ERROR;
+    }
+}
+
+int lms6002d_dev::vcocap_search(uint8_t reg)
+{
+    // The comparator reads HIGH, then NORMAL, then LOW as VCOCAP grows,
+    // so both edges of the NORMAL window are found by bisection instead
+    // of sweeping all 64 values.
+    int lo = 0, hi = 64;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        const vco_state state = vco_comparator(reg, mid);
+        if (state == VCO_ERROR) {
             printf("ERROR: Incorrect VCOCAP reading while tuning\n");
             return -1;
         }
-        if (verbosity>1) printf("VOVCO[%d]=%x\n", i, (comp>>6));
+        if (state == VCO_HIGH) lo = mid + 1;
+        else                   hi = mid;
     }
-    if (VCO_NORM == state)
-        stop_i = 63;
+    const int start_i = lo; // first value that is not HIGH
 
-    if (start_i == -1 || stop_i == -1) {
+    hi = 64;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        const vco_state state = vco_comparator(reg, mid);
+        if (state == VCO_ERROR) {
+            printf("ERROR: Incorrect VCOCAP reading while tuning\n");
+            return -1;
+        }
+        if (state == VCO_LOW) hi = mid;
+        else                  lo = mid + 1;
+    }
+    const int stop_i = lo - 1; // last value that is not LOW
+
+    if (start_i > 63 || stop_i < start_i) {
         printf("ERROR: Can't find VCOCAP value while tuning\n");
         return -1;
     }
@@ -153,22 +217,20 @@ double lms6002d_dev::txrx_pll_tune(uint8_t reg, double ref_clock, double out_fre
     int avg_i = (start_i + stop_i) / 2;
     if (verbosity>0) printf("START=%d STOP=%d SET=%d\n", start_i, stop_i, avg_i);
     lms_write_bits(reg + 0x09, 0x3f, avg_i);
-
-    // Return actual frequency we've tuned to
-    return actual_freq;
+    return avg_i;
 }
 
 void lms6002d_dev::init()
 {
     if (verbosity>0) printf("lms6002d_dev::init()\n");
-    write_reg(0x09, 0x00); // RXOUTSW (disabled), CLK_EN (all disabled)
-    write_reg(0x17, 0xE0);
-    write_reg(0x27, 0xE3);
-    write_reg(0x64, 0x32);
-    write_reg(0x70, 0x01);
-    write_reg(0x79, 0x37);
-    write_reg(0x59, 0x09);
-    write_reg(0x47, 0x40);
+    lms_write(0x09, 0x00); // RXOUTSW (disabled), CLK_EN (all disabled)
+    lms_write(0x17, 0xE0);
+    lms_write(0x27, 0xE3);
+    lms_write(0x64, 0x32);
+    lms_write(0x70, 0x01);
+    lms_write(0x79, 0x37);
+    lms_write(0x59, 0x09);
+    lms_write(0x47, 0x40);
 
     // Disable AUX PA
     // PA_EN[0]:AUXPA = 0 (powered up) - for mask set v1
@@ -195,16 +257,16 @@ int lms6002d_dev::general_dc_calibration_loop(uint8_t dc_addr, uint8_t calibrati
     uint8_t DC_REGVAL = 0;
 
     if (verbosity > 0) printf("DC Offset Calibration for addr %d:\n", dc_addr);
-    reg_val = read_reg(calibration_reg_base+0x03);
+    reg_val = lms_read(calibration_reg_base+0x03);
     // DC_ADDR := ADDR
     reg_val = (reg_val & 0xf8) | dc_addr;
-    write_reg(calibration_reg_base+0x03, reg_val);
+    lms_write(calibration_reg_base+0x03, reg_val);
     // DC_START_CLBR := 1
     reg_val = reg_val | (1 << 5);
-    write_reg(calibration_reg_base+0x03, reg_val);
+    lms_write(calibration_reg_base+0x03, reg_val);
     // DC_START_CLBR := 0
     reg_val = reg_val ^ (1 << 5);
-    write_reg(calibration_reg_base+0x03, reg_val);
+    lms_write(calibration_reg_base+0x03, reg_val);
 
     while (try_cnt_limit--)
     {
@@ -214,7 +276,7 @@ int lms6002d_dev::general_dc_calibration_loop(uint8_t dc_addr, uint8_t calibrati
         //usleep(6.4);
 
         // Read DC_CLBR_DONE
-        reg_val  = read_reg(calibration_reg_base+0x01);
+        reg_val  = lms_read(calibration_reg_base+0x01);
         int DC_CLBR_DONE = (reg_val >> 1) & 0x1;
         if (verbosity > 1) printf(" DC_CLBR_DONE=%d\n", DC_CLBR_DONE);
 
@@ -223,12 +285,12 @@ int lms6002d_dev::general_dc_calibration_loop(uint8_t dc_addr, uint8_t calibrati
             continue;
 
         // Read DC_LOCK
-        reg_val  = read_reg(calibration_reg_base+0x01);
+        reg_val  = lms_read(calibration_reg_base+0x01);
         int DC_LOCK = (reg_val >> 2) & 0x7;
         if (verbosity > 1) printf(" DC_LOCK=%d\n", DC_LOCK);
 
         // Read DC_REGVAL
-        DC_REGVAL = read_reg(calibration_reg_base+0x00);
+        DC_REGVAL = lms_read(calibration_reg_base+0x00);
         if (verbosity > 1) printf("DC_REGVAL = %d\n", DC_REGVAL);
 
         // DC_LOCK != 0 or 7? We're done.
@@ -242,7 +304,7 @@ int lms6002d_dev::general_dc_calibration_loop(uint8_t dc_addr, uint8_t calibrati
 int lms6002d_dev::general_dc_calibration(uint8_t dc_addr, uint8_t calibration_reg_base)
 {
     // Set DC_REGVAL to 31
-    write_reg(calibration_reg_base+0x00, 31);
+    lms_write(calibration_reg_base+0x00, 31);
     // Run the calibration first time
     int DC_REGVAL = general_dc_calibration_loop(dc_addr, calibration_reg_base);
     // Unchanged DC_REGVAL may mean either calibration failure or that '31' is
@@ -250,7 +312,7 @@ int lms6002d_dev::general_dc_calibration(uint8_t dc_addr, uint8_t calibration_re
     if (31 == DC_REGVAL)
     {
         // Set DC_REGVAL to a value other then 31, e.g. 0
-        write_reg(calibration_reg_base+0x00, 0);
+        lms_write(calibration_reg_base+0x00, 0);
         // Retry the calibration
         DC_REGVAL = general_dc_calibration_loop(dc_addr, calibration_reg_base);
         // If DC_REGVAL has been changed, then calibration succeeded.
@@ -274,7 +336,7 @@ bool lms6002d_dev::lpf_tuning_dc_calibration()
     bool result = false;
     // Save TopSPI::CLK_EN[5] Register
     // TopSPI::CLK_EN[5] := 1
-    uint8_t clk_en_save = read_reg(0x09);
+    uint8_t clk_en_save = lms_read(0x09);
     lms_set_bits(0x09, (1 << 5));
 
     // Perform DC Calibration Procedure in TopSPI with ADDR := 0 and get Result
@@ -291,7 +353,7 @@ bool lms6002d_dev::lpf_tuning_dc_calibration()
     }
 
     // Restore TopSPI::CLK_EN[5] Register
-    write_reg(0x09, clk_en_save);
+    lms_write(0x09, clk_en_save);
 
     return result;
 }
@@ -305,7 +367,7 @@ bool lms6002d_dev::txrx_lpf_dc_calibration(bool is_tx)
 
     // Save TopSPI::CLK_EN Register
     // TopSPI::CLK_EN := 1
-    uint8_t clk_en_save = read_reg(0x09);
+    uint8_t clk_en_save = lms_read(0x09);
     lms_set_bits(0x09, (is_tx)?(1 << 1):(1 << 3));
 
     // Perform DC Calibration Procedure in LPFSPI with ADDR := 0 (For channel I)
@@ -314,7 +376,7 @@ bool lms6002d_dev::txrx_lpf_dc_calibration(bool is_tx)
     result = general_dc_calibration(1, control_reg_base) >= 0 && result;
 
     // Restore TopSPI::CLK_EN Register
-    write_reg(0x09, clk_en_save);
+    lms_write(0x09, clk_en_save);
 
     return result;
 }
@@ -328,7 +390,7 @@ int lms6002d_dev::rxvga2_dc_calibration()
 
     // Save TopSPI::CLK_EN Register
     // TopSPI::CLK_EN := 1
-    uint8_t clk_en_save = read_reg(0x09);
+    uint8_t clk_en_save = lms_read(0x09);
     lms_set_bits(0x09, (1 << 4));
 
     // Perform DC Calibration Procedure in RxVGA2SPI with ADDR := 0 (For DC Reference channel)
@@ -343,7 +405,7 @@ int lms6002d_dev::rxvga2_dc_calibration()
     result = general_dc_calibration(4, control_reg_base) >= 0 && result;
 
     // Restore TopSPI::CLK_EN Register
-    write_reg(0x09, clk_en_save);
+    lms_write(0x09, clk_en_save);
 
     return result;
 }
@@ -351,8 +413,8 @@ int lms6002d_dev::rxvga2_dc_calibration()
 void lms6002d_dev::lpf_bandwidth_tuning(int ref_clock, uint8_t lpf_bandwidth_code)
 {
     // Save registers 0x05 and 0x09, because we will modify them during tx_enable()
-    uint8_t reg_save_05 = read_reg(0x05);
-    uint8_t reg_save_09 = read_reg(0x09);
+    uint8_t reg_save_05 = lms_read(0x05);
+    uint8_t reg_save_09 = lms_read(0x09);
 
     // Enable TxPLL and tune it to 320MHz
     tx_enable();
@@ -360,20 +422,20 @@ void lms6002d_dev::lpf_bandwidth_tuning(int ref_clock, uint8_t lpf_bandwidth_cod
 
     // Use 40MHz generatedFrom TxPLL: TopSPI::CLKSEL_LPFCAL := 0
     // Power Up LPF tuning clock generation block: TopSPI::PD_CLKLPFCAL := 0
-    uint8_t reg_save_06 = read_reg(0x06);
+    uint8_t reg_save_06 = lms_read(0x06);
     lms_clear_bits(0x06, (1 << 3) | (1 << 2));
 
     // Set TopSPI::BWC_LPFCAL
     // Set EN_CAL_LPFCAL := 1 (Block enabled)
     uint8_t t = lms_write_bits(0x07, 0x8f, (1<<7)|lpf_bandwidth_code);
-    if (verbosity >= 3) printf("code = %x %x %x\n", lpf_bandwidth_code, t, read_reg(0x07));
+    if (verbosity >= 3) printf("code = %x %x %x\n", lpf_bandwidth_code, t, lms_read(0x07));
     // TopSPI::RST_CAL_LPFCAL := 1 (Rst Active)
     lms_set_bits(0x06, 0x01);
     // ...Delay 100ns...
     // TopSPI::RST_CAL_LPFCAL := 0 (Rst Inactive)
     lms_clear_bits(0x06, 0x01);
     // RCCAL := TopSPI::RCCAL_LPFCAL
-    _lpf_rccal = read_reg(0x01) >> 5;
+    _lpf_rccal = lms_read(0x01) >> 5;
     if (verbosity >= 3) printf("RCCAL = %d\n", _lpf_rccal);
     // RxLPFSPI::RCCAL_LPF := RCCAL
     lms_write_bits(0x56, (7 << 4), (_lpf_rccal << 4));
@@ -387,9 +449,9 @@ void lms6002d_dev::lpf_bandwidth_tuning(int ref_clock, uint8_t lpf_bandwidth_cod
     lms_clear_bits(0x07, (1 << 7));
 
     // Restore registers 0x05, 0x06 and 0x09
-    write_reg(0x06, reg_save_06);
-    write_reg(0x05, reg_save_05);
-    write_reg(0x09, reg_save_09);
+    lms_write(0x06, reg_save_06);
+    lms_write(0x05, reg_save_05);
+    lms_write(0x09, reg_save_09);
 }
 
 void lms6002d_dev::auto_calibration(int ref_clock, int lpf_bandwidth_code)
@@ -414,11 +476,11 @@ void lms6002d_dev::auto_calibration(int ref_clock, int lpf_bandwidth_code)
     set_rx_lna(1);
     //   2. Connect LNA to external inputs.
     //      IN1SEL_MIX_RXFE: Selects the input to the mixer
-    uint8_t reg_save_71 = read_reg(0x71);
+    uint8_t reg_save_71 = lms_read(0x71);
     lms_clear_bits(0x71, (1 << 7));
     //   3. Enable internal termination resistor.
     //      RINEN_MIX_RXFE: Termination resistor on external mixer input enable
-    uint8_t reg_save_7C = read_reg(0x7C);
+    uint8_t reg_save_7C = lms_read(0x7C);
     lms_set_bits(0x7C, (1 << 2));
     // Set RxVGA2 gain to max
     uint8_t rx_vga2gain = set_rx_vga2gain(30);
@@ -430,7 +492,7 @@ void lms6002d_dev::auto_calibration(int ref_clock, int lpf_bandwidth_code)
 
     // Restore saved values
     set_rx_vga2gain(rx_vga2gain);
-    write_reg(0x71, reg_save_71);
-    write_reg(0x7C, reg_save_7C);
+    lms_write(0x71, reg_save_71);
+    lms_write(0x7C, reg_save_7C);
     set_rx_lna(lna);
 }
@@ -19,8 +19,10 @@
 #define INCLUDED_LMS6002D_HPP
 
 #include <stdio.h>
+#include <string.h>
 #include <inttypes.h>
 #include <assert.h>
+#include <map>
 
 /*!
  * LMS6002D control class
@@ -35,9 +37,19 @@ public:
 
     lms6002d_dev()
         :_lpf_rccal(3) // Value recommended by LimeMicro
-    {}
+        ,_tx_tune_time(0)
+        ,_rx_tune_time(0)
+    {
+        invalidate_shadow();
+    }
     ~lms6002d_dev() {}
 
+    /** Forget the shadow register file, e.g. after a chip reset or
+        when the registers were written by someone else */
+    void invalidate_shadow() {
+        memset(_shadow_valid, 0, sizeof(_shadow_valid));
+    }
+
     /** Dump chip registers to console (for debug use only) */
     void dump();
 
@@ -55,6 +67,22 @@ public:
     /** Read through SPI */
     virtual uint8_t read_reg(uint8_t addr) = 0;
 
+    /** Write a register, skipped if the shadow already holds the value */
+    void lms_write(uint8_t addr, uint8_t val) {
+        if (not is_volatile_reg(addr) and _shadow_valid[addr] and _shadow[addr] == val)
+            return;
+        write_reg(addr, val);
+        lms_shadow(addr, val);
+    }
+    /** Read a register from the shadow, falls back to SPI */
+    uint8_t lms_read(uint8_t addr) {
+        if (is_volatile_reg(addr))
+            return read_reg(addr);
+        if (not _shadow_valid[addr])
+            lms_shadow(addr, read_reg(addr));
+        return _shadow[addr];
+    }
+
     /** Tune TX PLL to a given frequency. */
     double tx_pll_tune(double ref_clock, double out_freq) {
         return txrx_pll_tune(0x10, ref_clock, out_freq);
@@ -64,6 +92,38 @@ public:
         return txrx_pll_tune(0x20, ref_clock, out_freq);
     }
 
+    /** Register image of a tuned PLL, enough to come back to the
+        same frequency without recomputing it or searching VCOCAP */
+    struct pll_image {
+        uint8_t nint_nfrac[4];  // NINT[8:0], NFRAC[22:0]
+        uint8_t freqsel;        // FREQSEL[5:0]
+        uint8_t vcocap;         // VCOCAP[5:0], VCOCAP_UNKNOWN until searched
+    };
+    enum { VCOCAP_UNKNOWN = 0xff };
+
+    /** Compute the PLL registers of a frequency without touching the chip.
+        Returns the actual frequency, -1 when it is out of range */
+    static double pll_image_calc(double ref_clock, double out_freq, pll_image &image);
+
+    /** Capture the current TX PLL registers */
+    pll_image get_tx_pll_image() { return txrx_pll_image(0x10); }
+    /** Capture the current RX PLL registers */
+    pll_image get_rx_pll_image() { return txrx_pll_image(0x20); }
+    /** Restore TX PLL registers, only changed registers are written.
+        An unknown VCOCAP is searched and kept in the image, false when none locks */
+    bool set_tx_pll_image(pll_image &image) { return txrx_pll_apply(0x10, image); }
+    /** Restore RX PLL registers, only changed registers are written.
+        An unknown VCOCAP is searched and kept in the image, false when none locks */
+    bool set_rx_pll_image(pll_image &image) { return txrx_pll_apply(0x20, image); }
+
+    /** Duration of the last TX PLL tune in seconds */
+    double get_tx_tune_time() const { return _tx_tune_time; }
+    /** Duration of the last RX PLL tune in seconds */
+    double get_rx_tune_time() const { return _rx_tune_time; }
+
+    /** Forget the VCOCAP values found by previous tunes */
+    void clear_vcocap_cache() { _vcocap_cache.clear(); }
+
     void tx_enable() {
         // STXEN: Soft transmit enable
         lms_set_bits(0x05, (1 << 3));
@@ -454,23 +514,68 @@ public:
 protected:
     double txrx_pll_tune(uint8_t reg, double ref_clock, double out_freq);
 
+    pll_image txrx_pll_image(uint8_t reg) {
+        pll_image image;
+        for (int i = 0; i < 4; i++)
+            image.nint_nfrac[i] = lms_read(reg + i);
+        image.freqsel = lms_read_shift(reg + 0x5, (0x3f << 2), 2);
+        image.vcocap = lms_read_shift(reg + 0x9, 0x3f, 0);
+        return image;
+    }
+    bool txrx_pll_apply(uint8_t reg, pll_image &image);
+
+    enum vco_state { VCO_HIGH, VCO_NORM, VCO_LOW, VCO_ERROR };
+    /** Set VCOCAP and read back the VTUNE comparator */
+    vco_state vco_comparator(uint8_t reg, int vcocap);
+    /** Find the middle of the VCOCAP window, -1 when there is none */
+    int vcocap_search(uint8_t reg);
+
     void lms_set_bits(uint8_t address, uint8_t mask) {
-        write_reg(address, read_reg(address) | (mask));
+        lms_write(address, lms_read(address) | (mask));
     }
     void lms_clear_bits(uint8_t address, uint8_t mask) {
-        write_reg(address, read_reg(address) & (~mask));
+        lms_write(address, lms_read(address) & (~mask));
     }
 
     uint8_t lms_write_bits(uint8_t address, uint8_t mask, uint8_t bits) {
-        uint8_t reg = read_reg(address);
-        write_reg(address,  (reg & (~mask)) | bits);
+        uint8_t reg = lms_read(address);
+        lms_write(address,  (reg & (~mask)) | bits);
         return reg;
     }
     uint8_t lms_read_shift(uint8_t address, uint8_t mask, uint8_t shift) {
-        return (read_reg(address) & mask) >> shift;
+        return (lms_read(address) & mask) >> shift;
+    }
+
+    /** Status registers change under our feet and some addresses read back
+        something else than was written (DC_REGVAL vs DC_CNTVAL), so these
+        always go to the chip */
+    static bool is_volatile_reg(uint8_t addr) {
+        switch (addr) {
+        case 0x00: case 0x01: // TopSPI DC_REGVAL, RCCAL_LPFCAL, DC_LOCK, DC_CLBR_DONE
+        case 0x1a: case 0x2a: // TX/RX PLL VTUNE comparators
+        case 0x30: case 0x31: // TxLPF DC calibration
+        case 0x50: case 0x51: // RxLPF DC calibration
+        case 0x60: case 0x61: // RxVGA2 DC calibration
+            return true;
+        }
+        return addr > 127;
+    }
+
+    void lms_shadow(uint8_t addr, uint8_t val) {
+        if (is_volatile_reg(addr)) return;
+        _shadow[addr] = val;
+        _shadow_valid[addr] = true;
     }
 
     uint8_t _lpf_rccal;  // Saved value for RCCAL_LPFCAL
+    uint8_t _shadow[128];      // Host copy of the chip registers
+    bool _shadow_valid[128];   // Whether the _shadow entry is known
+
+    /** VCOCAP found for a PLL configuration, keyed by
+        (PLL base, FREQSEL, NINT, NFRAC) packed into 64 bits */
+    std::map<uint64_t, uint8_t> _vcocap_cache;
+    double _tx_tune_time;
+    double _rx_tune_time;
 
 };
 
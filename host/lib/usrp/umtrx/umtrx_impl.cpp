@@ -69,6 +69,18 @@ UHD_STATIC_BLOCK(register_umtrx_device){
  * Helpers
  **********************************************************************/
 
+//the rx correction iq matrix is 2x2 in row-major order
+static std::vector<double> identity_correction_matrix(void){
+    return boost::assign::list_of(1.0)(0.0)(0.0)(1.0);
+}
+
+static std::vector<double> check_correction_matrix(const std::vector<double> &matrix){
+    if (matrix.size() != 4) throw uhd::value_error(str(boost::format(
+        "The RX correction IQ matrix needs 4 elements (row-major 2x2), got %u"
+    ) % matrix.size()));
+    return matrix;
+}
+
 static zero_copy_if::sptr make_xport(
     const std::string &addr,
     const std::string &port,
@@ -188,10 +200,38 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
             ) % int(USRP2_FPGA_COMPAT_NUM) % fpga_major));
         }
         _tree->create<std::string>(mb_path / "fpga_version").set(str(boost::format("%u.%u") % fpga_major % fpga_minor));
+        _mbc[mb].has_sc12 = (fpga_minor >= UMTRX_FPGA_SC12_MINOR);
 
         //lock the device/motherboard to this process
         _mbc[mb].iface->lock_device(true);
 
+        ////////////////////////////////////////////////////////////////
+        // shadow the settings registers to drop redundant pokes
+        ////////////////////////////////////////////////////////////////
+        _mbc[mb].shadow = wb_shadow_iface::make(
+            _mbc[mb].iface, boost::bind(&usrp2_iface::async_writes, _mbc[mb].iface)
+        );
+        for (size_t i = 0; i < 2; i++){
+            const boost::uint32_t rx_dsp_base = U2_REG_SR_ADDR((i == 0)? SR_RX_DSP0 : SR_RX_DSP1);
+            const boost::uint32_t rx_ctrl_base = U2_REG_SR_ADDR((i == 0)? SR_RX_CTRL0 : SR_RX_CTRL1);
+            const boost::uint32_t tx_dsp_base = U2_REG_SR_ADDR((i == 0)? SR_TX_DSP0 : SR_TX_DSP1);
+            const boost::uint32_t tx_ctrl_base = U2_REG_SR_ADDR((i == 0)? SR_TX_CTRL0 : SR_TX_CTRL1);
+            const boost::uint32_t rx_fe_base = U2_REG_SR_ADDR((i == 0)? SR_RX_FRONT0 : SR_RX_FRONT1);
+            const boost::uint32_t tx_fe_base = U2_REG_SR_ADDR((i == 0)? SR_TX_FRONT0 : SR_TX_FRONT1);
+            _mbc[mb].shadow->add_shadow_range(rx_dsp_base, rx_dsp_base + 16);      //freq, scale, decim, mux
+            _mbc[mb].shadow->add_shadow_range(rx_ctrl_base + 16, rx_ctrl_base + 40); //vrt setup, nsamps, format
+            _mbc[mb].shadow->add_shadow_range(tx_dsp_base, tx_dsp_base + 12);      //freq, scale, interp
+            _mbc[mb].shadow->add_shadow_range(tx_ctrl_base, tx_ctrl_base + 4);     //num chan
+            _mbc[mb].shadow->add_shadow_range(tx_ctrl_base + 8, tx_ctrl_base + 24);  //sid, policy, updates
+            _mbc[mb].shadow->add_shadow_range(rx_fe_base, rx_fe_base + 12);        //swap, iq balance
+            _mbc[mb].shadow->add_shadow_range(tx_fe_base, tx_fe_base + 20);        //dc offset, iq balance, mux
+        }
+        _mbc[mb].shadow->add_shadow_range(U2_REG_SR_ADDR(SR_RX_FRONT_SW), U2_REG_SR_ADDR(SR_TX_FRONT_SW) + 4);
+        _tree->create<size_t>(mb_path / "wb_shadow/hits")
+            .publish(boost::bind(&wb_shadow_iface::get_hits, _mbc[mb].shadow));
+        _tree->create<size_t>(mb_path / "wb_shadow/misses")
+            .publish(boost::bind(&wb_shadow_iface::get_misses, _mbc[mb].shadow));
+
         ////////////////////////////////////////////////////////////////
         // construct transports for RX and TX DSPs
         ////////////////////////////////////////////////////////////////
@@ -285,16 +325,16 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
         // create frontend control objects
         ////////////////////////////////////////////////////////////////
         _mbc[mb].rx_fes.push_back(rx_frontend_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_RX_FRONT0)
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_RX_FRONT0)
         ));
         _mbc[mb].tx_fes.push_back(tx_frontend_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_TX_FRONT0)
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_TX_FRONT0)
         ));
         _mbc[mb].rx_fes.push_back(rx_frontend_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_RX_FRONT1)
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_RX_FRONT1)
         ));
         _mbc[mb].tx_fes.push_back(tx_frontend_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_TX_FRONT1)
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_TX_FRONT1)
         ));
 
         _tree->create<subdev_spec_t>(mb_path / "rx_subdev_spec")
@@ -329,11 +369,12 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
         // create rx dsp control objects
         ////////////////////////////////////////////////////////////////
         _mbc[mb].rx_dsps.push_back(rx_dsp_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_RX_DSP0), U2_REG_SR_ADDR(SR_RX_CTRL0), USRP2_RX_SID_BASE + 0, true
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_RX_DSP0), U2_REG_SR_ADDR(SR_RX_CTRL0), USRP2_RX_SID_BASE + 0, true
         ));
         _mbc[mb].rx_dsps.push_back(rx_dsp_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_RX_DSP1), U2_REG_SR_ADDR(SR_RX_CTRL1), USRP2_RX_SID_BASE + 1, true
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_RX_DSP1), U2_REG_SR_ADDR(SR_RX_CTRL1), USRP2_RX_SID_BASE + 1, true
         ));
+        _mbc[mb].rx_hops.resize(_mbc[mb].rx_dsps.size());
         for (size_t dspno = 0; dspno < _mbc[mb].rx_dsps.size(); dspno++){
             _mbc[mb].rx_dsps[dspno]->set_link_rate(USRP2_LINK_RATE_BPS);
             _tree->access<double>(mb_path / "tick_rate")
@@ -349,19 +390,51 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
                 .coerce(boost::bind(&rx_dsp_core_200::set_freq, _mbc[mb].rx_dsps[dspno], _1));
             _tree->create<meta_range_t>(rx_dsp_path / "freq/range")
                 .publish(boost::bind(&rx_dsp_core_200::get_freq_range, _mbc[mb].rx_dsps[dspno]));
+            _tree->create<std::vector<double> >(rx_dsp_path / "hop/table")
+                .coerce(boost::bind(&umtrx_impl::set_rx_hop_table, this, mb, dspno, _1));
+            _tree->create<size_t>(rx_dsp_path / "hop/index")
+                .subscribe(boost::bind(&umtrx_impl::set_rx_hop, this, mb, dspno, _1));
             _tree->create<stream_cmd_t>(rx_dsp_path / "stream_cmd")
                 .subscribe(boost::bind(&rx_dsp_core_200::issue_stream_command, _mbc[mb].rx_dsps[dspno], _1));
+            //software correction applied by the streamer while converting sc16 to fc32
+            _tree->create<std::complex<double> >(rx_dsp_path / "correction/dc_offset/value")
+                .set(std::complex<double>(0.0, 0.0))
+                .subscribe(boost::bind(&umtrx_impl::update_rx_correction, this, mb, dspno));
+            _tree->create<std::vector<double> >(rx_dsp_path / "correction/iq_matrix/value")
+                .coerce(&check_correction_matrix)
+                .set(identity_correction_matrix())
+                .subscribe(boost::bind(&umtrx_impl::update_rx_correction, this, mb, dspno));
+            _tree->create<double>(rx_dsp_path / "correction/gain/value")
+                .set(1.0)
+                .subscribe(boost::bind(&umtrx_impl::update_rx_correction, this, mb, dspno));
+            _tree->create<bool>(rx_dsp_path / "correction/enabled")
+                .set(false)
+                .subscribe(boost::bind(&umtrx_impl::update_rx_correction, this, mb, dspno));
+            udp_zero_copy::sptr rx_udp_xport = boost::dynamic_pointer_cast<udp_zero_copy>(_mbc[mb].rx_dsp_xports[dspno]);
+            if (rx_udp_xport.get() != NULL){
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_syscalls")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_syscalls, rx_udp_xport));
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_packets")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_packets, rx_udp_xport));
+                _tree->create<std::string>(rx_dsp_path / "xport/recv_mode")
+                    .publish(boost::bind(&udp_zero_copy::get_recv_mode, rx_udp_xport));
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_spin_hits")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_spin_hits, rx_udp_xport));
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_spin_misses")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_spin_misses, rx_udp_xport));
+            }
         }
 
         ////////////////////////////////////////////////////////////////
         // create tx dsp control objects
         ////////////////////////////////////////////////////////////////
         _mbc[mb].tx_dsps.push_back(tx_dsp_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_TX_DSP0), U2_REG_SR_ADDR(SR_TX_CTRL0), USRP2_TX_ASYNC_SID_BASE+0
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_TX_DSP0), U2_REG_SR_ADDR(SR_TX_CTRL0), USRP2_TX_ASYNC_SID_BASE+0
         ));
         _mbc[mb].tx_dsps.push_back(tx_dsp_core_200::make(
-            _mbc[mb].iface, U2_REG_SR_ADDR(SR_TX_DSP1), U2_REG_SR_ADDR(SR_TX_CTRL1), USRP2_TX_ASYNC_SID_BASE+1
+            _mbc[mb].shadow, U2_REG_SR_ADDR(SR_TX_DSP1), U2_REG_SR_ADDR(SR_TX_CTRL1), USRP2_TX_ASYNC_SID_BASE+1
         ));
+        _mbc[mb].tx_hops.resize(_mbc[mb].tx_dsps.size());
         for (size_t dspno = 0; dspno < _mbc[mb].tx_dsps.size(); dspno++){
             _mbc[mb].tx_dsps[dspno]->set_link_rate(USRP2_LINK_RATE_BPS);
             _tree->access<double>(mb_path / "tick_rate")
@@ -377,6 +450,17 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
                 .coerce(boost::bind(&tx_dsp_core_200::set_freq, _mbc[mb].tx_dsps[dspno], _1));
             _tree->create<meta_range_t>(tx_dsp_path / "freq/range")
                 .publish(boost::bind(&tx_dsp_core_200::get_freq_range, _mbc[mb].tx_dsps[dspno]));
+            _tree->create<std::vector<double> >(tx_dsp_path / "hop/table")
+                .coerce(boost::bind(&umtrx_impl::set_tx_hop_table, this, mb, dspno, _1));
+            _tree->create<size_t>(tx_dsp_path / "hop/index")
+                .subscribe(boost::bind(&umtrx_impl::set_tx_hop, this, mb, dspno, _1));
+            udp_zero_copy::sptr tx_udp_xport = boost::dynamic_pointer_cast<udp_zero_copy>(_mbc[mb].tx_dsp_xports[dspno]);
+            if (tx_udp_xport.get() != NULL){
+                _tree->create<size_t>(tx_dsp_path / "xport/send_syscalls")
+                    .publish(boost::bind(&udp_zero_copy::get_num_send_syscalls, tx_udp_xport));
+                _tree->create<size_t>(tx_dsp_path / "xport/send_packets")
+                    .publish(boost::bind(&udp_zero_copy::get_num_send_packets, tx_udp_xport));
+            }
         }
 
         //setup dsp flow control
@@ -436,6 +520,9 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
         //gdb_eeprom.id = 0x0000;
 
         BOOST_FOREACH(const std::string &board, _mbc[mb].dbc.keys()){
+            //pipeline the register and SPI writes of the LMS init, synced at the end of the board
+            usrp2_iface::async_writes_scope async_writes(*_mbc[mb].iface);
+
             // Different serial numbers for each LMS on a UmTRX.
             // This is required to properly correlate calibration files to LMS chips.
             rx_db_eeprom.serial = _mbc[mb].iface->mb_eeprom["serial"] + "." + board;
@@ -485,6 +572,7 @@ umtrx_impl::umtrx_impl(const device_addr_t &_device_addr)
                         .set(boost::lexical_cast<int>(_mbc[mb].iface->mb_eeprom["tx-vga1-dc-q"]));
                 }
             }
+            _mbc[mb].iface->ctrl_sync();
         }
 
         //set TCXO DAC calibration value, which is read from mboard EEPROM
@@ -538,6 +626,112 @@ void umtrx_impl::set_tx_fe_corrections(const std::string &mb, const std::string
     apply_tx_fe_corrections(this->get_tree()->subtree("/mboards/" + mb), board, lo_freq);
 }
 
+/***********************************************************************
+ * Frequency hopping
+ *
+ * A hop table is computed once: the LMS PLL registers for every entry
+ * are computed by the dboard without tuning and the DSP CORDIC word
+ * covering the residual offset is kept here. A hop then pushes only the
+ * changed LMS registers and the CORDIC word as one pipelined batch of
+ * writes, bypassing the tune logic and the freq/value properties.
+ * The VCOCAP of an entry is searched on its first hop.
+ **********************************************************************/
+static fs_path hop_frontend_path(
+    property_tree::sptr tree, const std::string &mb, const std::string &xx, const size_t dspno
+){
+    const fs_path mb_path = "/mboards/" + mb;
+    const subdev_spec_t spec = tree->access<subdev_spec_t>(mb_path / (xx + "_subdev_spec")).get();
+    if (dspno >= spec.size()) throw uhd::index_error(str(boost::format(
+        "No %s frontend is mapped to DSP %u with the current subdev spec"
+    ) % xx % dspno));
+    return mb_path / "dboards" / spec[dspno].db_name / (xx + "_frontends") / spec[dspno].sd_name;
+}
+
+/*!
+ * Load the LO images of a DSP's hop table into its frontend.
+ * The images are kept per frontend, so a DSP sharing the frontend
+ * with another DSP's table must use the same frequencies.
+ * Nothing is tuned here, the LO moves on the first hop.
+ */
+std::vector<double> umtrx_impl::load_hop_lo_table(
+    const std::string &mb, const std::string &xx, const size_t dspno, const std::vector<double> &freqs
+){
+    std::vector<mb_container_type::hop_table_type> &tables = (xx == "rx")? _mbc[mb].rx_hops : _mbc[mb].tx_hops;
+    mb_container_type::hop_table_type &table = tables[dspno];
+    table.fe_path = hop_frontend_path(_tree, mb, xx, dspno);
+    table.freqs.clear();
+    table.lo_freqs.clear();
+    table.dsp_words.clear();
+
+    for (size_t i = 0; i < tables.size(); i++){
+        if (i == dspno or tables[i].fe_path != table.fe_path or tables[i].freqs.empty()) continue;
+        if (freqs.empty()) return table.lo_freqs; //the other table keeps the frontend
+        if (tables[i].freqs != freqs) throw uhd::value_error(str(boost::format(
+            "The %s hop table of DSP %u differs from the one of DSP %u on the same frontend %s"
+        ) % xx % dspno % i % table.fe_path));
+        table.freqs = freqs;
+        table.lo_freqs = tables[i].lo_freqs;
+        return table.lo_freqs;
+    }
+
+    table.lo_freqs = _tree->access<std::vector<double> >(table.fe_path / "lms6002d/hop/table").set(freqs).get();
+    table.freqs = freqs;
+    return table.lo_freqs;
+}
+
+std::vector<double> umtrx_impl::set_rx_hop_table(const std::string &mb, const size_t dspno, const std::vector<double> &freqs){
+    const std::vector<double> lo_freqs = this->load_hop_lo_table(mb, "rx", dspno, freqs);
+    mb_container_type::hop_table_type &table = _mbc[mb].rx_hops[dspno];
+    std::vector<double> actual_freqs;
+    for (size_t i = 0; i < freqs.size(); i++){
+        boost::uint32_t freq_word;
+        const double dsp_freq = _mbc[mb].rx_dsps[dspno]->get_freq_word(lo_freqs[i] - freqs[i], freq_word);
+        table.dsp_words.push_back(freq_word);
+        actual_freqs.push_back(lo_freqs[i] - dsp_freq);
+    }
+    return actual_freqs;
+}
+
+std::vector<double> umtrx_impl::set_tx_hop_table(const std::string &mb, const size_t dspno, const std::vector<double> &freqs){
+    const std::vector<double> lo_freqs = this->load_hop_lo_table(mb, "tx", dspno, freqs);
+    mb_container_type::hop_table_type &table = _mbc[mb].tx_hops[dspno];
+    std::vector<double> actual_freqs;
+    for (size_t i = 0; i < freqs.size(); i++){
+        //the dsp freq sign is inverted for transmit
+        boost::uint32_t freq_word;
+        const double dsp_freq = _mbc[mb].tx_dsps[dspno]->get_freq_word(freqs[i] - lo_freqs[i], freq_word);
+        table.dsp_words.push_back(freq_word);
+        actual_freqs.push_back(lo_freqs[i] + dsp_freq);
+    }
+    return actual_freqs;
+}
+
+void umtrx_impl::set_rx_hop(const std::string &mb, const size_t dspno, const size_t index){
+    const mb_container_type::hop_table_type &table = _mbc[mb].rx_hops[dspno];
+    if (index >= table.dsp_words.size()) throw uhd::index_error(str(boost::format(
+        "RX hop index %u is out of the hop table (%u entries)"
+    ) % index % table.dsp_words.size()));
+
+    //only the writes of this thread are async, a concurrent hop or tune keeps its own mode
+    usrp2_iface::async_writes_scope async_writes(*_mbc[mb].iface);
+    _tree->access<size_t>(table.fe_path / "lms6002d/hop/index").set(index);
+    _mbc[mb].rx_dsps[dspno]->set_freq_word(table.dsp_words[index]);
+    _mbc[mb].iface->ctrl_sync();
+}
+
+void umtrx_impl::set_tx_hop(const std::string &mb, const size_t dspno, const size_t index){
+    const mb_container_type::hop_table_type &table = _mbc[mb].tx_hops[dspno];
+    if (index >= table.dsp_words.size()) throw uhd::index_error(str(boost::format(
+        "TX hop index %u is out of the hop table (%u entries)"
+    ) % index % table.dsp_words.size()));
+
+    //only the writes of this thread are async, a concurrent hop or tune keeps its own mode
+    usrp2_iface::async_writes_scope async_writes(*_mbc[mb].iface);
+    _tree->access<size_t>(table.fe_path / "lms6002d/hop/index").set(index);
+    _mbc[mb].tx_dsps[dspno]->set_freq_word(table.dsp_words[index]);
+    _mbc[mb].iface->ctrl_sync();
+}
+
 void umtrx_impl::set_tcxo_dac(const std::string &mb, const uint16_t val){
     if (verbosity>0) printf("umtrx_impl::set_tcxo_dac(%d)\n", val);
     _mbc[mb].iface->write_spi(4, spi_config_t::EDGE_FALL, val, 16);
@@ -27,6 +27,7 @@
 #include "rx_dsp_core_200.hpp"
 #include "tx_dsp_core_200.hpp"
 #include "time64_core_200.hpp"
+#include "wb_shadow_iface.hpp"
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/msg.hpp>
 #include <uhd/property_tree.hpp>
@@ -78,6 +79,8 @@ public:
     uhd::rx_streamer::sptr get_rx_stream(const uhd::stream_args_t &args);
     uhd::tx_streamer::sptr get_tx_stream(const uhd::stream_args_t &args);
     bool recv_async_msg(uhd::async_metadata_t &, double);
+    bool recv_chan_async_msg(size_t, uhd::async_metadata_t &, double);
+    void register_async_msg_callback(const async_msg_callback_t &);
 
     // LMS-specific functions
     void reg_dump();
@@ -88,11 +91,13 @@ private:
     uhd::property_tree::sptr _tree;
     struct mb_container_type{
         usrp2_iface::sptr iface;
+        wb_shadow_iface::sptr shadow;
         uhd::gps_ctrl::sptr gps;
         std::vector<rx_frontend_core_200::sptr> rx_fes;
         std::vector<tx_frontend_core_200::sptr> tx_fes;
         std::vector<rx_dsp_core_200::sptr> rx_dsps;
         std::vector<boost::weak_ptr<uhd::rx_streamer> > rx_streamers;
+        std::vector<size_t> rx_streamer_chans; //streamer channel of each dsp
         std::vector<boost::weak_ptr<uhd::tx_streamer> > tx_streamers;
         std::vector<tx_dsp_core_200::sptr> tx_dsps;
         time64_core_200::sptr time64;
@@ -103,8 +108,15 @@ private:
             uhd::usrp::dboard_manager::sptr dboard_manager;
         };
         uhd::dict<std::string, db_container_type> dbc;
+        struct hop_table_type{
+            uhd::fs_path fe_path; //dboard frontend the LO images belong to
+            std::vector<double> freqs, lo_freqs; //the same for all DSPs on the frontend
+            std::vector<boost::uint32_t> dsp_words;
+        };
+        std::vector<hop_table_type> rx_hops, tx_hops;
         size_t rx_chan_occ, tx_chan_occ;
-        mb_container_type(void): rx_chan_occ(0), tx_chan_occ(0){}
+        bool has_sc12; //the FPGA image packs and unpacks sc12
+        mb_container_type(void): rx_chan_occ(0), tx_chan_occ(0), has_sc12(false){}
     };
     uhd::dict<std::string, mb_container_type> _mbc;
 
@@ -117,6 +129,11 @@ private:
     void set_rx_fe_corrections(const std::string &mb, const std::string &board, const double);
     void set_tx_fe_corrections(const std::string &mb, const std::string &board, const double);
     void set_tcxo_dac(const std::string &mb, const uint16_t val);
+    std::vector<double> load_hop_lo_table(const std::string &mb, const std::string &xx, const size_t dspno, const std::vector<double> &);
+    std::vector<double> set_rx_hop_table(const std::string &mb, const size_t dspno, const std::vector<double> &);
+    std::vector<double> set_tx_hop_table(const std::string &mb, const size_t dspno, const std::vector<double> &);
+    void set_rx_hop(const std::string &mb, const size_t dspno, const size_t index);
+    void set_tx_hop(const std::string &mb, const size_t dspno, const size_t index);
 
     double get_master_clock_rate() const { return 13e6; }
 
@@ -130,6 +147,8 @@ private:
     void io_init(void);
     void update_tick_rate(const double rate);
     void update_rx_samp_rate(const std::string &, const size_t, const double rate);
+    void update_rx_correction(const std::string &, const size_t);
+    void check_otw_format(const std::string &otw_format);
     void update_tx_samp_rate(const std::string &, const size_t, const double rate);
     void update_rates(void);
     //update spec methods are coercers until we only accept db_name == A
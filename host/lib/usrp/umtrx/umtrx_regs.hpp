@@ -50,10 +50,10 @@
 #define SR_RX_DSP1   96   // 7
 
 #define SR_TX_FRONT0 110   // ?
-#define SR_TX_CTRL0  126   // 6
+#define SR_TX_CTRL0  126   // 7
 #define SR_TX_DSP0   135   // 5
 #define SR_TX_FRONT1 145   // ?
-#define SR_TX_CTRL1  161   // 6
+#define SR_TX_CTRL1  161   // 7
 #define SR_TX_DSP1   170   // 5
 
 // DSPs to frontends mapping controls
@@ -117,4 +117,7 @@
 #define U2_REG_TIME64_SECS_RB_PPS READBACK_BASE + 4*14
 #define U2_REG_TIME64_TICKS_RB_PPS READBACK_BASE + 4*15
 
+//the minor number in U2_REG_COMPAT_NUM_RB from which on the FPGA packs and unpacks sc12
+#define UMTRX_FPGA_SC12_MINOR 1
+
 #endif
@@ -288,12 +288,12 @@ void usrp1_impl::vandal_conquest_loop(void){
         if (_tx_enabled and underflow){
             async_metadata.time_spec = _soft_time_ctrl->get_time();
             _soft_time_ctrl->get_async_queue().push_with_pop_on_full(async_metadata);
-            UHD_MSG(fastpath) << "U";
+            uhd::msg::post_fastpath('U');
         }
         if (_rx_enabled and overflow){
             inline_metadata.time_spec = _soft_time_ctrl->get_time();
             _soft_time_ctrl->get_inline_queue().push_with_pop_on_full(inline_metadata);
-            UHD_MSG(fastpath) << "O";
+            uhd::msg::post_fastpath('O');
         }
 
         boost::this_thread::sleep(boost::posix_time::milliseconds(50));
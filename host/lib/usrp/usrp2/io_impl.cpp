@@ -16,6 +16,7 @@
 //
 
 #include "validate_subdev_spec.hpp"
+#include "async_msg_dispatcher.hpp"
 #include "../../transport/super_recv_packet_handler.hpp"
 #include "../../transport/super_send_packet_handler.hpp"
 #include "usrp2_impl.hpp"
@@ -54,9 +55,7 @@ static const size_t vrt_send_header_offset_words32 = 1;
  **********************************************************************/
 struct usrp2_impl::io_impl{
 
-    io_impl(void):
-        async_msg_fifo(100/*messages deep*/)
-    {
+    io_impl(void){
         /* NOP */
     }
 
@@ -69,25 +68,41 @@ struct usrp2_impl::io_impl{
         flow_control_monitor &fc_mon = *fc_mons[chan];
 
         //wait on flow control w/ timeout
-        if (not fc_mon.check_fc_condition(timeout)) return managed_send_buffer::sptr();
+        //(the acks can only come back once the queued frames are sent)
+        if (not fc_mon.check_fc_condition(0.0)){
+            this->flush_send_buffs(chan);
+            if (not fc_mon.check_fc_condition(timeout)){
+                tx_events[chan]->inc(sph::stream_event_counters::EVENT_TIMEOUT);
+                return managed_send_buffer::sptr();
+            }
+        }
 
         //get a buffer from the transport w/ timeout
         managed_send_buffer::sptr buff = tx_xports[chan]->get_send_buff(timeout);
 
         //write the flow control word into the buffer
         if (buff.get()) buff->cast<boost::uint32_t *>()[0] = uhd::htonx(fc_mon.get_curr_seq_out());
+        else tx_events[chan]->inc(sph::stream_event_counters::EVENT_TIMEOUT);
 
         return buff;
     }
 
+    void flush_send_buffs(size_t chan){
+        udp_zero_copy *udp_xport = dynamic_cast<udp_zero_copy *>(tx_xports[chan].get());
+        if (udp_xport != NULL) udp_xport->flush_send();
+    }
+
     //tx dsp: xports and flow control monitors
     std::vector<zero_copy_if::sptr> tx_xports;
     std::vector<flow_control_monitor::sptr> fc_mons;
 
+    //host side stream events of the rx and tx dsps
+    std::vector<sph::stream_event_counters::sptr> rx_events, tx_events;
+
     //methods and variables for the pirate crew
     void recv_pirate_loop(zero_copy_if::sptr, size_t);
     std::list<task::sptr> pirate_tasks;
-    bounded_buffer<async_metadata_t> async_msg_fifo;
+    async_msg_dispatcher::sptr async_msgs;
     double tick_rate;
 };
 
@@ -135,19 +150,19 @@ void usrp2_impl::io_impl::recv_pirate_loop(
                     continue;
                 }
                 //else UHD_MSG(often) << "metadata.event_code " << metadata.event_code << std::endl;
-                async_msg_fifo.push_with_pop_on_full(metadata);
+                async_msgs->post(metadata);
 
                 if (metadata.event_code &
                     ( async_metadata_t::EVENT_CODE_UNDERFLOW
                     | async_metadata_t::EVENT_CODE_UNDERFLOW_IN_PACKET)
-                ) UHD_MSG(fastpath) << "U";
+                ) uhd::msg::post_fastpath('U');
                 else if (metadata.event_code &
                     ( async_metadata_t::EVENT_CODE_SEQ_ERROR
                     | async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST)
-                ) UHD_MSG(fastpath) << "S";
+                ) uhd::msg::post_fastpath('S');
                 else if (metadata.event_code &
                     async_metadata_t::EVENT_CODE_TIME_ERROR
-                ) UHD_MSG(fastpath) << "L";
+                ) uhd::msg::post_fastpath('L');
             }
             else{
                 //TODO unknown received packet, may want to print error...
@@ -174,6 +189,37 @@ void usrp2_impl::io_init(void){
         )));
     }
 
+    //async messages of every tx dsp, counted in the tree
+    _io_impl->async_msgs = async_msg_dispatcher::make(_io_impl->fc_mons.size(), 100/*messages deep*/);
+    size_t chan = 0;
+    BOOST_FOREACH(const std::string &mb, _mbc.keys()){
+        const fs_path events_path = "/mboards/" + mb + "/tx_dsps/0/events";
+        for (size_t i = 0; i < async_msg_dispatcher::num_events; i++){
+            _tree->create<size_t>(events_path / async_msg_dispatcher::get_event_name(i))
+                .publish(boost::bind(&async_msg_dispatcher::get_event_count, _io_impl->async_msgs, chan, i));
+        }
+        _tree->create<size_t>(events_path / "queue_drops")
+            .publish(boost::bind(&async_msg_dispatcher::get_queue_drops, _io_impl->async_msgs, chan));
+        _io_impl->tx_events.push_back(sph::stream_event_counters::sptr(new sph::stream_event_counters()));
+        _tree->create<size_t>(events_path / "timeout").publish(boost::bind(
+            &sph::stream_event_counters::get, _io_impl->tx_events.back(), sph::stream_event_counters::EVENT_TIMEOUT
+        ));
+        chan++;
+    }
+
+    //host side events of every rx dsp, counted in the tree
+    BOOST_FOREACH(const std::string &mb, _mbc.keys()){
+        for (size_t dsp = 0; dsp < _mbc[mb].rx_dsps.size(); dsp++){
+            const fs_path events_path = "/mboards/" + mb + str(boost::format("/rx_dsps/%u/events") % dsp);
+            _io_impl->rx_events.push_back(sph::stream_event_counters::sptr(new sph::stream_event_counters()));
+            for (size_t i = 0; i < sph::stream_event_counters::NUM_EVENTS; i++){
+                const sph::stream_event_counters::event_type event = sph::stream_event_counters::event_type(i);
+                _tree->create<size_t>(events_path / sph::stream_event_counters::get_name(event))
+                    .publish(boost::bind(&sph::stream_event_counters::get, _io_impl->rx_events.back(), event));
+            }
+        }
+    }
+
     //allocate streamer weak ptrs containers
     BOOST_FOREACH(const std::string &mb, _mbc.keys()){
         _mbc[mb].rx_streamers.resize(_mbc[mb].rx_dsps.size());
@@ -287,8 +333,17 @@ void usrp2_impl::update_tx_subdev_spec(const std::string &which_mb, const subdev
 bool usrp2_impl::recv_async_msg(
     async_metadata_t &async_metadata, double timeout
 ){
-    boost::this_thread::disable_interruption di; //disable because the wait can throw
-    return _io_impl->async_msg_fifo.pop_with_timed_wait(async_metadata, timeout);
+    return _io_impl->async_msgs->recv(async_metadata, timeout);
+}
+
+bool usrp2_impl::recv_chan_async_msg(
+    size_t channel, async_metadata_t &async_metadata, double timeout
+){
+    return _io_impl->async_msgs->recv_chan(channel, async_metadata, timeout);
+}
+
+void usrp2_impl::register_async_msg_callback(const async_msg_callback_t &callback){
+    _io_impl->async_msgs->register_callback(callback);
 }
 
 /***********************************************************************
@@ -302,6 +357,11 @@ rx_streamer::sptr usrp2_impl::get_rx_stream(const uhd::stream_args_t &args_){
     args.channels = args.channels.empty()? std::vector<size_t>(1, 0) : args.channels;
     const unsigned sc8_scalar = unsigned(args.args.cast<double>("scalar", 0x400));
 
+    //the usrp2 images have no 12-bit packer
+    if (args.otw_format == "sc12"){
+        throw uhd::value_error("USRP RX cannot handle requested wire format: " + args.otw_format);
+    }
+
     //calculate packet size
     static const size_t hdr_size = 0
         + vrt::max_if_hdr_words32*sizeof(boost::uint32_t)
@@ -330,6 +390,7 @@ rx_streamer::sptr usrp2_impl::get_rx_stream(const uhd::stream_args_t &args_){
     for (size_t chan_i = 0; chan_i < args.channels.size(); chan_i++){
         const size_t chan = args.channels[chan_i];
         size_t num_chan_so_far = 0;
+        size_t abs = 0;
         BOOST_FOREACH(const std::string &mb, _mbc.keys()){
             num_chan_so_far += _mbc[mb].rx_chan_occ;
             if (chan < num_chan_so_far){
@@ -340,9 +401,11 @@ rx_streamer::sptr usrp2_impl::get_rx_stream(const uhd::stream_args_t &args_){
                 my_streamer->set_xport_chan_get_buff(chan_i, boost::bind(
                     &zero_copy_if::get_recv_buff, _mbc[mb].rx_dsp_xports[dsp], _1
                 ), true /*flush*/);
+                my_streamer->set_event_counters(chan_i, _io_impl->rx_events[abs+dsp]);
                 _mbc[mb].rx_streamers[dsp] = my_streamer; //store weak pointer
                 break;
             }
+            abs += _mbc[mb].rx_dsps.size();
         }
     }
 
@@ -411,6 +474,9 @@ tx_streamer::sptr usrp2_impl::get_tx_stream(const uhd::stream_args_t &args_){
                 my_streamer->set_xport_chan_get_buff(chan_i, boost::bind(
                     &usrp2_impl::io_impl::get_send_buff, _io_impl.get(), abs, _1
                 ));
+                my_streamer->set_xport_chan_flush(chan_i, boost::bind(
+                    &usrp2_impl::io_impl::flush_send_buffs, _io_impl.get(), abs
+                ));
                 _mbc[mb].tx_streamers[dsp] = my_streamer; //store weak pointer
                 break;
             }
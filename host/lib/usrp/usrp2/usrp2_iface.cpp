@@ -24,6 +24,8 @@
 #include <uhd/utils/safe_call.hpp>
 #include <uhd/types/dict.hpp>
 #include <boost/thread.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/tss.hpp>
 #include <boost/foreach.hpp>
 #include <boost/asio.hpp> //used for htonl and ntohl
 #include <boost/assign/list_of.hpp>
@@ -33,6 +35,7 @@
 #include <boost/functional/hash.hpp>
 #include <algorithm>
 #include <iostream>
+#include <map>
 #undef NDEBUG //evil hack for debug
 #include <cassert>
 
@@ -42,6 +45,10 @@ using namespace uhd::transport;
 
 static const double CTRL_RECV_TIMEOUT = 1.0;
 
+//Maximum number of control requests in flight at once.
+//The packet router queues the requests while the firmware handles one.
+static const size_t CTRL_WINDOW_SIZE = 8;
+
 static const boost::uint32_t MIN_PROTO_COMPAT_SPI = 7;
 static const boost::uint32_t MIN_PROTO_COMPAT_I2C = 7;
 // The register compat number must reflect the protocol compatibility
@@ -84,6 +91,7 @@ public:
     usrp2_iface_impl(udp_simple::sptr ctrl_transport):
         _ctrl_transport(ctrl_transport),
         _ctrl_seq_num(0),
+        _ctrl_receiving(false),
         _protocol_compat(0) //initialized below...
     {
         bool is_umtrx = false;
@@ -161,9 +169,18 @@ public:
  * Peek and Poke
  **********************************************************************/
     void poke32(wb_addr_type addr, boost::uint32_t data){
+        if (this->async_writes()) return this->poke32_async(addr, data);
         this->get_reg<boost::uint32_t, USRP2_REG_ACTION_FPGA_POKE32>(addr, data);
     }
 
+    void poke32_async(wb_addr_type addr, boost::uint32_t data){
+        boost::mutex::scoped_lock lock(_ctrl_mutex);
+        this->ctrl_post(
+            lock, make_reg_data(addr, data, USRP2_REG_ACTION_FPGA_POKE32),
+            MIN_PROTO_COMPAT_REG, USRP2_FW_COMPAT_NUM, USRP2_CTRL_ID_OMG_GOT_REGISTER_SO_BAD_DUDE
+        );
+    }
+
     boost::uint32_t peek32(wb_addr_type addr){
         return this->get_reg<boost::uint32_t, USRP2_REG_ACTION_FPGA_PEEK32>(addr);
     }
@@ -176,14 +193,19 @@ public:
         return this->get_reg<boost::uint16_t, USRP2_REG_ACTION_FPGA_PEEK16>(addr);
     }
 
-    template <class T, usrp2_reg_action_t action>
-    T get_reg(wb_addr_type addr, T data = 0){
-        //setup the out data
+    static usrp2_ctrl_data_t make_reg_data(wb_addr_type addr, boost::uint32_t data, usrp2_reg_action_t action){
         usrp2_ctrl_data_t out_data = usrp2_ctrl_data_t();
         out_data.id = htonl(USRP2_CTRL_ID_GET_THIS_REGISTER_FOR_ME_BRO);
         out_data.data.reg_args.addr = htonl(addr);
-        out_data.data.reg_args.data = htonl(boost::uint32_t(data));
+        out_data.data.reg_args.data = htonl(data);
         out_data.data.reg_args.action = action;
+        return out_data;
+    }
+
+    template <class T, usrp2_reg_action_t action>
+    T get_reg(wb_addr_type addr, T data = 0){
+        //setup the out data
+        const usrp2_ctrl_data_t out_data = make_reg_data(addr, boost::uint32_t(data), action);
 
         //send and recv
         usrp2_ctrl_data_t in_data = this->ctrl_send_and_recv(out_data, MIN_PROTO_COMPAT_REG);
@@ -194,7 +216,7 @@ public:
 /***********************************************************************
  * SPI
  **********************************************************************/
-    boost::uint32_t transact_spi(
+    static usrp2_ctrl_data_t make_spi_data(
         int which_slave,
         const spi_config_t &config,
         boost::uint32_t data,
@@ -206,7 +228,6 @@ public:
             (spi_config_t::EDGE_FALL, USRP2_CLK_EDGE_FALL)
         ;
 
-        //setup the out data
         usrp2_ctrl_data_t out_data = usrp2_ctrl_data_t();
         out_data.id = htonl(USRP2_CTRL_ID_TRANSACT_ME_SOME_SPI_BRO);
         out_data.data.spi_args.dev = htonl(which_slave);
@@ -215,6 +236,23 @@ public:
         out_data.data.spi_args.readback = (readback)? 1 : 0;
         out_data.data.spi_args.num_bits = num_bits;
         out_data.data.spi_args.data = htonl(data);
+        return out_data;
+    }
+
+    boost::uint32_t transact_spi(
+        int which_slave,
+        const spi_config_t &config,
+        boost::uint32_t data,
+        size_t num_bits,
+        bool readback
+    ){
+        if (not readback and this->async_writes()){
+            this->write_spi_async(which_slave, config, data, num_bits);
+            return 0;
+        }
+
+        //setup the out data
+        const usrp2_ctrl_data_t out_data = make_spi_data(which_slave, config, data, num_bits, readback);
 
         //send and recv
         usrp2_ctrl_data_t in_data = this->ctrl_send_and_recv(out_data, MIN_PROTO_COMPAT_SPI);
@@ -223,6 +261,19 @@ public:
         return ntohl(in_data.data.spi_args.data);
     }
 
+    void write_spi_async(
+        int which_slave,
+        const spi_config_t &config,
+        boost::uint32_t data,
+        size_t num_bits
+    ){
+        boost::mutex::scoped_lock lock(_ctrl_mutex);
+        this->ctrl_post(
+            lock, make_spi_data(which_slave, config, data, num_bits, false),
+            MIN_PROTO_COMPAT_SPI, USRP2_FW_COMPAT_NUM, USRP2_CTRL_ID_OMG_TRANSACTED_SPI_DUDE
+        );
+    }
+
 /***********************************************************************
  * I2C
  **********************************************************************/
@@ -267,6 +318,11 @@ public:
 
 /***********************************************************************
  * Send/Recv over control
+ *
+ * Up to CTRL_WINDOW_SIZE requests may be in flight at once,
+ * the responses are matched to the requests by the seq number.
+ * One waiting thread at a time reads the transport and hands out
+ * the responses to the other waiters through the condition.
  **********************************************************************/
     usrp2_ctrl_data_t ctrl_send_and_recv(
         const usrp2_ctrl_data_t &out_data,
@@ -275,35 +331,175 @@ public:
     ){
         boost::mutex::scoped_lock lock(_ctrl_mutex);
 
+        const boost::uint32_t seq = this->ctrl_post(lock, out_data, lo, hi, 0);
+        this->ctrl_wait(lock, seq);
+
+        const ctrl_result_t result = _ctrl_results[seq];
+        _ctrl_results.erase(seq);
+        if (not result.error.empty()) throw uhd::runtime_error(result.error);
+        return result.data;
+    }
+
+    void set_async_writes(bool enb){
+        //the mode is per thread so a batch never captures the writes of other threads
+        if (_async_writes.get() == NULL) _async_writes.reset(new size_t(0));
+        if (enb) ++*_async_writes;
+        else if (*_async_writes != 0) --*_async_writes;
+    }
+
+    bool async_writes(void){
+        return _async_writes.get() != NULL and *_async_writes != 0;
+    }
+
+    void ctrl_sync(void){
+        boost::mutex::scoped_lock lock(_ctrl_mutex);
+
+        //wait on everything that was posted before this call
+        const boost::uint32_t last_seq = _ctrl_seq_num;
+        while (not _ctrl_pending.empty() and seq_before_eq(_ctrl_pending.begin()->first, last_seq)){
+            this->ctrl_wait(lock, _ctrl_pending.begin()->first);
+        }
+
+        if (_ctrl_async_errors.empty()) return;
+        const std::string error = str(boost::format(
+            "%u asynchronous control request(s) failed, the first with: %s"
+        ) % _ctrl_async_errors.size() % _ctrl_async_errors.front());
+        _ctrl_async_errors.clear();
+        throw uhd::runtime_error(error);
+    }
+
+private:
+    struct ctrl_pending_t{
+        boost::uint32_t lo, hi;
+        boost::uint32_t async_id; //expected response of an async request, 0 when a caller waits for it
+        boost::uint32_t target; //register address or spi slave, for the error of an async request
+        boost::system_time deadline;
+    };
+
+    struct ctrl_result_t{
+        usrp2_ctrl_data_t data;
+        std::string error;
+    };
+
+    static bool seq_before_eq(boost::uint32_t a, boost::uint32_t b){
+        return boost::int32_t(a - b) <= 0;
+    }
+
+    //! Send a request once there is room in the window, return its seq number
+    boost::uint32_t ctrl_post(
+        boost::mutex::scoped_lock &lock,
+        const usrp2_ctrl_data_t &out_data,
+        boost::uint32_t lo, boost::uint32_t hi,
+        boost::uint32_t async_id
+    ){
+        while (_ctrl_pending.size() >= CTRL_WINDOW_SIZE){
+            this->ctrl_wait(lock, _ctrl_pending.begin()->first);
+        }
+
         //fill in the seq number and send
         usrp2_ctrl_data_t out_copy = out_data;
         out_copy.proto_ver = htonl(_protocol_compat);
         out_copy.seq = htonl(++_ctrl_seq_num);
+
+        ctrl_pending_t &pending = _ctrl_pending[_ctrl_seq_num];
+        pending.lo = lo;
+        pending.hi = hi;
+        pending.async_id = async_id;
+        pending.target = ntohl((async_id == USRP2_CTRL_ID_OMG_TRANSACTED_SPI_DUDE)?
+            out_data.data.spi_args.dev : out_data.data.reg_args.addr);
+        pending.deadline = boost::get_system_time() + boost::posix_time::microseconds(long(CTRL_RECV_TIMEOUT*1e6));
+
         _ctrl_transport->send(boost::asio::buffer(&out_copy, sizeof(usrp2_ctrl_data_t)));
+        return _ctrl_seq_num;
+    }
 
-        //loop until we get the packet or timeout
+    //! Receive responses until the request with this seq number is done
+    void ctrl_wait(boost::mutex::scoped_lock &lock, boost::uint32_t seq){
         boost::uint8_t usrp2_ctrl_data_in_mem[udp_simple::mtu]; //allocate max bytes for recv
-        const usrp2_ctrl_data_t *ctrl_data_in = reinterpret_cast<const usrp2_ctrl_data_t *>(usrp2_ctrl_data_in_mem);
-        while(true){
-            size_t len = _ctrl_transport->recv(boost::asio::buffer(usrp2_ctrl_data_in_mem), CTRL_RECV_TIMEOUT);
-            boost::uint32_t compat = ntohl(ctrl_data_in->proto_ver);
-            if(len >= sizeof(boost::uint32_t) and (hi < compat or lo > compat)){
-                throw uhd::runtime_error(str(boost::format(
-                    "\nPlease update the firmware and FPGA images for your device.\n"
-                    "See the application notes for USRP2/N-Series for instructions.\n"
-                    "Expected protocol compatibility number %s, but got %d:\n"
-                    "The firmware build is not compatible with the host code build."
-                ) % ((lo == hi)? (boost::format("%d") % hi) : (boost::format("[%d to %d]") % lo % hi)) % compat));
+        while (_ctrl_pending.count(seq) != 0){
+            //another thread is reading the transport
+            if (_ctrl_receiving){
+                _ctrl_cond.wait(lock);
+                continue;
             }
-            if (len >= sizeof(usrp2_ctrl_data_t) and ntohl(ctrl_data_in->seq) == _ctrl_seq_num){
-                return *ctrl_data_in;
+
+            //the oldest request times out first
+            const double timeout = std::max(0.0, 1e-6*(
+                _ctrl_pending.begin()->second.deadline - boost::get_system_time()
+            ).total_microseconds());
+
+            _ctrl_receiving = true;
+            lock.unlock();
+            size_t len = 0;
+            try{
+                len = _ctrl_transport->recv(boost::asio::buffer(usrp2_ctrl_data_in_mem), timeout);
             }
-            if (len == 0) break; //timeout
-            //didnt get seq or bad packet, continue looking...
+            catch(...){
+                lock.lock();
+                _ctrl_receiving = false;
+                _ctrl_cond.notify_all();
+                throw;
+            }
+            lock.lock();
+            _ctrl_receiving = false;
+
+            if (len >= sizeof(usrp2_ctrl_data_t)){
+                this->ctrl_handle_response(*reinterpret_cast<const usrp2_ctrl_data_t *>(usrp2_ctrl_data_in_mem));
+            }
+            this->ctrl_expire();
+            _ctrl_cond.notify_all();
+        }
+    }
+
+    void ctrl_handle_response(const usrp2_ctrl_data_t &in_data){
+        const boost::uint32_t seq = ntohl(in_data.seq);
+        if (_ctrl_pending.count(seq) == 0) return; //didnt get seq, a late or stray packet
+
+        const ctrl_pending_t &pending = _ctrl_pending[seq];
+        const boost::uint32_t compat = ntohl(in_data.proto_ver);
+        if (pending.hi < compat or pending.lo > compat){
+            this->ctrl_complete(seq, in_data, str(boost::format(
+                "\nPlease update the firmware and FPGA images for your device.\n"
+                "See the application notes for USRP2/N-Series for instructions.\n"
+                "Expected protocol compatibility number %s, but got %d:\n"
+                "The firmware build is not compatible with the host code build."
+            ) % ((pending.lo == pending.hi)? (boost::format("%d") % pending.hi) : (boost::format("[%d to %d]") % pending.lo % pending.hi)) % compat));
+            return;
         }
-        throw uhd::runtime_error("no control response");
+        this->ctrl_complete(seq, in_data, "");
     }
 
+    //! Fail the requests that got no response in time
+    void ctrl_expire(void){
+        const boost::system_time now = boost::get_system_time();
+        while (not _ctrl_pending.empty() and _ctrl_pending.begin()->second.deadline <= now){
+            this->ctrl_complete(_ctrl_pending.begin()->first, usrp2_ctrl_data_t(), "no control response");
+        }
+    }
+
+    void ctrl_complete(boost::uint32_t seq, const usrp2_ctrl_data_t &in_data, std::string error){
+        const boost::uint32_t async_id = _ctrl_pending[seq].async_id;
+        const boost::uint32_t target = _ctrl_pending[seq].target;
+        _ctrl_pending.erase(seq);
+
+        //a caller is waiting for this response
+        if (async_id == 0){
+            ctrl_result_t &result = _ctrl_results[seq];
+            result.data = in_data;
+            result.error = error;
+            return;
+        }
+
+        if (error.empty() and ntohl(in_data.id) != async_id){
+            error = str(boost::format("unexpected control response: -->%c<--") % char(ntohl(in_data.id)));
+        }
+        if (not error.empty()) _ctrl_async_errors.push_back(str(boost::format(
+            (async_id == USRP2_CTRL_ID_OMG_TRANSACTED_SPI_DUDE)?
+                "spi write to slave %u (seq %u): %s" : "poke32 to 0x%08x (seq %u): %s"
+        ) % target % seq % error));
+    }
+
+public:
     rev_type get_rev(void){
         std::string hw = mb_eeprom["hardware"];
         if (hw.empty()) return USRP_NXXX;
@@ -345,7 +541,13 @@ private:
 
     //used in send/recv
     boost::mutex _ctrl_mutex;
+    boost::condition _ctrl_cond;
     boost::uint32_t _ctrl_seq_num;
+    bool _ctrl_receiving;
+    std::map<boost::uint32_t, ctrl_pending_t> _ctrl_pending;
+    std::map<boost::uint32_t, ctrl_result_t> _ctrl_results;
+    std::vector<std::string> _ctrl_async_errors;
+    boost::thread_specific_ptr<size_t> _async_writes;
     boost::uint32_t _protocol_compat;
 
     //lock thread stuff
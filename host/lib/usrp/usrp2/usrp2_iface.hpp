@@ -69,6 +69,57 @@ public:
     //! A version string for firmware
     virtual const std::string get_fw_version_string(void) = 0;
 
+    /*!
+     * Write a register without waiting for the ack.
+     * The ack and any error are collected by ctrl_sync().
+     * \param addr the address
+     * \param data the 32bit data
+     */
+    virtual void poke32_async(wb_addr_type addr, boost::uint32_t data) = 0;
+
+    /*!
+     * Write to a SPI slave without waiting for the ack.
+     * The ack and any error are collected by ctrl_sync().
+     */
+    virtual void write_spi_async(
+        int which_slave,
+        const uhd::spi_config_t &config,
+        boost::uint32_t data,
+        size_t num_bits
+    ) = 0;
+
+    /*!
+     * Make poke32() and SPI writes of the calling thread asynchronous
+     * (see poke32_async) until the matching call with false; calls nest.
+     * Reads and other threads are unaffected; the device handles
+     * requests in order. Prefer an async_writes_scope.
+     * \param enb true to stop waiting on the write acks
+     */
+    virtual void set_async_writes(bool enb) = 0;
+
+    //! True while the writes of the calling thread are asynchronous
+    virtual bool async_writes(void) = 0;
+
+    //! Makes the writes of the calling thread asynchronous while in scope
+    class async_writes_scope : boost::noncopyable{
+    public:
+        async_writes_scope(usrp2_iface &iface): _iface(iface){
+            _iface.set_async_writes(true);
+        }
+        ~async_writes_scope(void){
+            _iface.set_async_writes(false);
+        }
+    private:
+        usrp2_iface &_iface;
+    };
+
+    /*!
+     * Wait for the acks of all outstanding control requests.
+     * Throws on the first asynchronous request that failed,
+     * naming its address or spi slave and its seq number.
+     */
+    virtual void ctrl_sync(void) = 0;
+
     //motherboard eeprom map structure
     uhd::usrp::mboard_eeprom_t mb_eeprom;
 };
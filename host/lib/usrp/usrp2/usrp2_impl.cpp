@@ -332,6 +332,19 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
                 .publish(boost::bind(&rx_dsp_core_200::get_freq_range, _mbc[mb].rx_dsps[dspno]));
             _tree->create<stream_cmd_t>(rx_dsp_path / "stream_cmd")
                 .subscribe(boost::bind(&rx_dsp_core_200::issue_stream_command, _mbc[mb].rx_dsps[dspno], _1));
+            udp_zero_copy::sptr rx_udp_xport = boost::dynamic_pointer_cast<udp_zero_copy>(_mbc[mb].rx_dsp_xports[dspno]);
+            if (rx_udp_xport.get() != NULL){
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_syscalls")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_syscalls, rx_udp_xport));
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_packets")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_packets, rx_udp_xport));
+                _tree->create<std::string>(rx_dsp_path / "xport/recv_mode")
+                    .publish(boost::bind(&udp_zero_copy::get_recv_mode, rx_udp_xport));
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_spin_hits")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_spin_hits, rx_udp_xport));
+                _tree->create<size_t>(rx_dsp_path / "xport/recv_spin_misses")
+                    .publish(boost::bind(&udp_zero_copy::get_num_recv_spin_misses, rx_udp_xport));
+            }
         }
 
         ////////////////////////////////////////////////////////////////
@@ -353,6 +366,13 @@ usrp2_impl::usrp2_impl(const device_addr_t &_device_addr){
             .coerce(boost::bind(&usrp2_impl::set_tx_dsp_freq, this, mb, _1));
         _tree->create<meta_range_t>(mb_path / "tx_dsps/0/freq/range")
             .publish(boost::bind(&usrp2_impl::get_tx_dsp_freq_range, this, mb));
+        udp_zero_copy::sptr tx_udp_xport = boost::dynamic_pointer_cast<udp_zero_copy>(_mbc[mb].tx_dsp_xport);
+        if (tx_udp_xport.get() != NULL){
+            _tree->create<size_t>(mb_path / "tx_dsps/0/xport/send_syscalls")
+                .publish(boost::bind(&udp_zero_copy::get_num_send_syscalls, tx_udp_xport));
+            _tree->create<size_t>(mb_path / "tx_dsps/0/xport/send_packets")
+                .publish(boost::bind(&udp_zero_copy::get_num_send_packets, tx_udp_xport));
+        }
 
         //setup dsp flow control
         const double ups_per_sec = device_args_i.cast<double>("ups_per_sec", 20);
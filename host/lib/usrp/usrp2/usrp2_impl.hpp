@@ -49,6 +49,7 @@
 #include <uhd/utils/static.hpp>
 #include <uhd/utils/byteswap.hpp>
 #include <uhd/utils/safe_call.hpp>
+#include <uhd/utils/atomic.hpp>
 #include <uhd/usrp/dboard_manager.hpp>
 #include <uhd/usrp/subdev_spec.hpp>
 #include <boost/weak_ptr.hpp>
@@ -105,6 +106,8 @@ public:
     uhd::rx_streamer::sptr get_rx_stream(const uhd::stream_args_t &args);
     uhd::tx_streamer::sptr get_tx_stream(const uhd::stream_args_t &args);
     bool recv_async_msg(uhd::async_metadata_t &, double);
+    bool recv_chan_async_msg(size_t, uhd::async_metadata_t &, double);
+    void register_async_msg_callback(const async_msg_callback_t &);
 
 private:
     uhd::property_tree::sptr _tree;
@@ -353,6 +356,8 @@ static device_addrs_t usrp2_find_generic(const device_addr_t &hint_, const char
  * flow control monitor for a single tx channel
  *  - the pirate thread calls update
  *  - the get send buffer calls check
+ * The sequences are atomic, a check with room takes no lock,
+ * the mutex is only for a sender that has to wait on an ack.
  **********************************************************************/
 class flow_control_monitor{
 public:
@@ -363,15 +368,26 @@ public:
      * Make a new flow control monitor.
      * \param max_seqs_out num seqs before throttling
      */
-    flow_control_monitor(seq_type max_seqs_out):_max_seqs_out(max_seqs_out){
+    flow_control_monitor(seq_type max_seqs_out){
         this->clear();
+        this->set_max_seqs_out(max_seqs_out);
         _ready_fcn = boost::bind(&flow_control_monitor::ready, this);
     }
 
     //! Clear the monitor, Ex: when a streamer is created
     void clear(void){
-        _last_seq_out = 0;
-        _last_seq_ack = 0;
+        _last_seq_out.write(0);
+        _last_seq_ack.write(0);
+    }
+
+    /*!
+     * Change the number of seqs before throttling.
+     * A larger window wakes up a waiting sender.
+     * \param max_seqs_out num seqs before throttling
+     */
+    void set_max_seqs_out(seq_type max_seqs_out){
+        _max_seqs_out.swp(max_seqs_out);
+        this->notify();
     }
 
     /*!
@@ -380,7 +396,7 @@ public:
      * \return the sequence to be sent to the dsp
      */
     UHD_INLINE seq_type get_curr_seq_out(void){
-        return _last_seq_out++;
+        return _last_seq_out.inc();
     }
 
     /*!
@@ -389,10 +405,15 @@ public:
      * \return false on timeout
      */
     UHD_INLINE bool check_fc_condition(double timeout){
-        boost::mutex::scoped_lock lock(_fc_mutex);
         if (this->ready()) return true;
+
+        //count as a waiter before the last look, so an ack from now on notifies
+        boost::mutex::scoped_lock lock(_fc_mutex);
+        _num_waiters.inc();
         boost::this_thread::disable_interruption di; //disable because the wait can throw
-        return _fc_cond.timed_wait(lock, to_time_dur(timeout), _ready_fcn);
+        const bool ready = _fc_cond.timed_wait(lock, to_time_dur(timeout), _ready_fcn);
+        _num_waiters.dec();
+        return ready;
     }
 
     /*!
@@ -400,21 +421,26 @@ public:
      * \param seq the last sequence number to be ACK'd
      */
     UHD_INLINE void update_fc_condition(seq_type seq){
-        boost::mutex::scoped_lock lock(_fc_mutex);
-        _last_seq_ack = seq;
-        lock.unlock();
-        _fc_cond.notify_one();
+        _last_seq_ack.swp(seq); //a full barrier before looking for waiters
+        this->notify();
     }
 
 private:
     bool ready(void){
-        return seq_type(_last_seq_out -_last_seq_ack) < _max_seqs_out;
+        return seq_type(_last_seq_out.read() - _last_seq_ack.read()) < _max_seqs_out.read();
+    }
+
+    void notify(void){
+        if (_num_waiters.read() == 0) return;
+        //the waiter holds the lock until it waits, so it cannot miss this
+        boost::mutex::scoped_lock lock(_fc_mutex);
+        lock.unlock();
+        _fc_cond.notify_one();
     }
 
     boost::mutex _fc_mutex;
     boost::condition _fc_cond;
-    seq_type _last_seq_out, _last_seq_ack;
-    const seq_type _max_seqs_out;
+    uhd::atomic_uint32_t _last_seq_out, _last_seq_ack, _max_seqs_out, _num_waiters;
     boost::function<bool(void)> _ready_fcn;
 };
 
@@ -18,7 +18,12 @@
 #include <uhd/utils/msg.hpp>
 #include <uhd/utils/log.hpp>
 #include <uhd/utils/static.hpp>
+#include <uhd/utils/atomic.hpp>
+#include <uhd/utils/tasks.hpp>
+#include <uhd/utils/thread_priority.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
 #include <sstream>
@@ -105,6 +110,64 @@ UHD_STATIC_BLOCK(msg_register_default_handler){
     uhd::msg::register_handler(&default_msg_handler);
 }
 
+/***********************************************************************
+ * The fast-path reporter
+ **********************************************************************/
+struct fastpath_resource_type{
+    fastpath_resource_type(void){
+        enabled.write(1);
+    }
+
+    ~fastpath_resource_type(void){
+        reporter.reset();
+        this->report(); //the characters posted since the last report
+    }
+
+    //hand the counted characters to the handler, in character order
+    void report(void){
+        std::string msg;
+        for (size_t ch = 0; ch < num_chars; ch++){
+            const size_t count = counts[ch].swp(0);
+            if (count != 0) msg.append(count, char(ch));
+        }
+        if (msg.empty()) return;
+        boost::mutex::scoped_lock lock(msg_rs().mutex);
+        msg_rs().handler(uhd::msg::fastpath, msg);
+    }
+
+    void reporter_loop(void){
+        if (started.read() == 1){
+            //drop the realtime priority of the streaming thread that started it
+            try{uhd::set_thread_priority(0.0, false);}catch(...){}
+            started.write(2);
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(50));
+        this->report();
+    }
+
+    static const size_t num_chars = 128;
+    uhd::atomic_uint32_t counts[num_chars];
+    uhd::atomic_uint32_t enabled, started;
+    uhd::task::sptr reporter;
+};
+
+UHD_SINGLETON_FCN(fastpath_resource_type, fastpath_rs);
+
+void uhd::msg::post_fastpath(const char ch){
+    fastpath_resource_type &rs = fastpath_rs();
+    if (rs.enabled.read() == 0) return;
+    rs.counts[size_t(ch) % fastpath_resource_type::num_chars].inc();
+
+    //the first post starts the reporter
+    if (rs.started.read() == 0 and rs.started.cas(1, 0) == 0){
+        rs.reporter = task::make(boost::bind(&fastpath_resource_type::reporter_loop, &rs));
+    }
+}
+
+void uhd::msg::set_fastpath_enabled(const bool enb){
+    fastpath_rs().enabled.write(enb? 1 : 0);
+}
+
 /***********************************************************************
  * The message object implementation
  **********************************************************************/
@@ -35,6 +35,19 @@ bool uhd::set_thread_priority_safe(float priority, bool realtime){
     }
 }
 
+bool uhd::set_thread_affinity_safe(size_t cpu){
+    try{
+        set_thread_affinity(cpu);
+        return true;
+    }catch(const std::exception &e){
+        UHD_MSG(warning) << boost::format(
+            "Unable to pin the thread to core %u. Performance may be negatively affected.\n"
+            "%s\n"
+        ) % cpu % e.what();
+        return false;
+    }
+}
+
 static void check_priority_range(float priority){
     if (priority > +1.0 or priority < -1.0)
         throw uhd::value_error("priority out of range [-1.0, +1.0]");
@@ -104,3 +117,44 @@ static void check_priority_range(float priority){
     }
 
 #endif /* HAVE_THREAD_PRIO_DUMMY */
+
+/***********************************************************************
+ * Pthread API to set affinity
+ **********************************************************************/
+#ifdef HAVE_PTHREAD_SETAFFINITY_NP
+    #include <pthread.h>
+
+    void uhd::set_thread_affinity(size_t cpu){
+        if (cpu >= CPU_SETSIZE) throw uhd::value_error("cpu index out of range");
+
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (ret != 0) throw uhd::os_error("error in pthread_setaffinity_np");
+    }
+#endif /* HAVE_PTHREAD_SETAFFINITY_NP */
+
+/***********************************************************************
+ * Windows API to set affinity
+ **********************************************************************/
+#ifdef HAVE_WIN_SETTHREADAFFINITYMASK
+    #include <windows.h>
+
+    void uhd::set_thread_affinity(size_t cpu){
+        if (cpu >= sizeof(DWORD_PTR)*8) throw uhd::value_error("cpu index out of range");
+
+        if (SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) == 0)
+            throw uhd::os_error("error in SetThreadAffinityMask");
+    }
+#endif /* HAVE_WIN_SETTHREADAFFINITYMASK */
+
+/***********************************************************************
+ * Unimplemented API to set affinity
+ **********************************************************************/
+#ifdef HAVE_THREAD_AFFINITY_DUMMY
+    void uhd::set_thread_affinity(size_t){
+        throw uhd::not_implemented_error("set thread affinity not implemented");
+    }
+
+#endif /* HAVE_THREAD_AFFINITY_DUMMY */
@@ -0,0 +1,125 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/usrp/common/async_msg_dispatcher.hpp"
+#include <uhd/exception.hpp>
+#include <boost/bind.hpp>
+#include <vector>
+
+using namespace uhd;
+using namespace uhd::usrp;
+
+static const double timeout = 0.01/*secs*/;
+
+static async_metadata_t make_msg(const size_t chan, const async_metadata_t::event_code_t event_code){
+    async_metadata_t metadata;
+    metadata.channel = chan;
+    metadata.has_time_spec = false;
+    metadata.event_code = event_code;
+    return metadata;
+}
+
+BOOST_AUTO_TEST_CASE(test_async_msg_dispatcher_counters){
+    async_msg_dispatcher::sptr dispatcher = async_msg_dispatcher::make(2, 3);
+    BOOST_CHECK_EQUAL(async_msg_dispatcher::get_event_name(1), "underflow");
+
+    //many more messages than the fifo holds, the counters never lose one
+    for (size_t i = 0; i < 10; i++){
+        dispatcher->post(make_msg(0, async_metadata_t::EVENT_CODE_UNDERFLOW));
+    }
+    dispatcher->post(make_msg(1, async_metadata_t::event_code_t(
+        async_metadata_t::EVENT_CODE_BURST_ACK | async_metadata_t::EVENT_CODE_SEQ_ERROR
+    )));
+
+    BOOST_CHECK_EQUAL(dispatcher->get_event_count(0, 1), size_t(10));
+    BOOST_CHECK_EQUAL(dispatcher->get_event_count(0, 0), size_t(0));
+    BOOST_CHECK_EQUAL(dispatcher->get_event_count(1, 0), size_t(1));
+    BOOST_CHECK_EQUAL(dispatcher->get_event_count(1, 1), size_t(0));
+    BOOST_CHECK_EQUAL(dispatcher->get_event_count(1, 2), size_t(1));
+
+    //the common fifo keeps the newest messages
+    async_metadata_t metadata;
+    BOOST_CHECK(dispatcher->recv(metadata, timeout));
+    BOOST_CHECK_EQUAL(metadata.channel, size_t(0));
+    BOOST_CHECK(dispatcher->recv(metadata, timeout));
+    BOOST_CHECK(dispatcher->recv(metadata, timeout));
+    BOOST_CHECK_EQUAL(metadata.channel, size_t(1));
+    BOOST_CHECK(not dispatcher->recv(metadata, timeout));
+
+    BOOST_CHECK_THROW(dispatcher->post(make_msg(2, async_metadata_t::EVENT_CODE_UNDERFLOW)), uhd::index_error);
+    BOOST_CHECK_THROW(dispatcher->get_event_count(2, 0), uhd::index_error);
+}
+
+BOOST_AUTO_TEST_CASE(test_async_msg_dispatcher_queue_drops){
+    async_msg_dispatcher::sptr dispatcher = async_msg_dispatcher::make(2, 3);
+
+    //a channel is not queued until it is read
+    async_metadata_t metadata;
+    dispatcher->post(make_msg(0, async_metadata_t::EVENT_CODE_UNDERFLOW));
+    BOOST_CHECK(not dispatcher->recv_chan(0, metadata, timeout));
+    BOOST_CHECK_EQUAL(dispatcher->get_queue_drops(0), size_t(0));
+
+    //a full queue drops its oldest message and counts it
+    for (size_t i = 0; i < 5; i++){
+        dispatcher->post(make_msg(0, async_metadata_t::EVENT_CODE_UNDERFLOW));
+    }
+    dispatcher->post(make_msg(1, async_metadata_t::EVENT_CODE_UNDERFLOW));
+    BOOST_CHECK_EQUAL(dispatcher->get_queue_drops(0), size_t(2));
+    BOOST_CHECK_EQUAL(dispatcher->get_queue_drops(1), size_t(0));
+    BOOST_CHECK_EQUAL(dispatcher->get_event_count(0, 1), size_t(6));
+
+    for (size_t i = 0; i < 3; i++){
+        BOOST_CHECK(dispatcher->recv_chan(0, metadata, timeout));
+        BOOST_CHECK_EQUAL(metadata.channel, size_t(0));
+    }
+    BOOST_CHECK(not dispatcher->recv_chan(0, metadata, timeout));
+    BOOST_CHECK(not dispatcher->recv_chan(1, metadata, timeout));
+}
+
+static void count_msg(std::vector<size_t> &counts, const async_metadata_t &metadata){
+    counts.at(metadata.channel)++;
+}
+
+static void register_on_msg(
+    async_msg_dispatcher::sptr dispatcher, std::vector<size_t> &counts, const async_metadata_t &
+){
+    //register once, from within a callback
+    if (not counts.empty()) return;
+    counts.resize(2, 0);
+    dispatcher->register_callback(boost::bind(&count_msg, boost::ref(counts), _1));
+}
+
+BOOST_AUTO_TEST_CASE(test_async_msg_dispatcher_callbacks){
+    async_msg_dispatcher::sptr dispatcher = async_msg_dispatcher::make(2, 3);
+
+    std::vector<size_t> counts(2, 0), late_counts;
+    dispatcher->register_callback(boost::bind(&count_msg, boost::ref(counts), _1));
+    dispatcher->register_callback(boost::bind(&register_on_msg, dispatcher, boost::ref(late_counts), _1));
+
+    //every callback gets every message, one registered during a post gets the next ones
+    dispatcher->post(make_msg(1, async_metadata_t::EVENT_CODE_BURST_ACK));
+    BOOST_REQUIRE_EQUAL(late_counts.size(), size_t(2));
+    BOOST_CHECK_EQUAL(late_counts[1], size_t(0));
+    dispatcher->post(make_msg(0, async_metadata_t::EVENT_CODE_BURST_ACK));
+    dispatcher->post(make_msg(1, async_metadata_t::EVENT_CODE_BURST_ACK));
+
+    BOOST_CHECK_EQUAL(counts[0], size_t(1));
+    BOOST_CHECK_EQUAL(counts[1], size_t(2));
+    BOOST_CHECK_EQUAL(late_counts[0], size_t(1));
+    BOOST_CHECK_EQUAL(late_counts[1], size_t(1));
+}
@@ -17,7 +17,12 @@
 
 #include <boost/test/unit_test.hpp>
 #include <uhd/transport/bounded_buffer.hpp>
+#include <uhd/transport/bounded_spsc_buffer.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/bind.hpp>
+#include <iostream>
+#include <cstdlib>
 
 using namespace boost::assign;
 using namespace uhd::transport;
@@ -62,3 +67,61 @@ BOOST_AUTO_TEST_CASE(test_bounded_buffer_with_pop_on_full){
     BOOST_CHECK(bb.pop_with_timed_wait(val, timeout));
     BOOST_CHECK_EQUAL(val, 3);
 }
+
+BOOST_AUTO_TEST_CASE(test_bounded_spsc_buffer_with_timed_wait){
+    bounded_spsc_buffer<int> bb(3);
+
+    //push elements, check for timeout
+    BOOST_CHECK(bb.push_with_timed_wait(0, timeout));
+    BOOST_CHECK(bb.push_with_timed_wait(1, timeout));
+    BOOST_CHECK(bb.push_with_timed_wait(2, timeout));
+    BOOST_CHECK(not bb.push_with_timed_wait(3, timeout));
+
+    int val;
+    //pop elements, check for timeout and check values
+    BOOST_CHECK(bb.pop_with_timed_wait(val, timeout));
+    BOOST_CHECK_EQUAL(val, 0);
+    BOOST_CHECK(bb.pop_with_timed_wait(val, timeout));
+    BOOST_CHECK_EQUAL(val, 1);
+    BOOST_CHECK(bb.pop_with_timed_wait(val, timeout));
+    BOOST_CHECK_EQUAL(val, 2);
+    BOOST_CHECK(not bb.pop_with_timed_wait(val, timeout));
+}
+
+/***********************************************************************
+ * Contention benchmark:
+ *  - A producer thread pushes a sequence of integers,
+ *    and the consumer checks that they arrive in order.
+ *  - A small capacity makes both sides wait on each other.
+ *  - The rates are printed when UHD_TEST_BENCH is set.
+ **********************************************************************/
+static const size_t num_bench_elems = 100000;
+static const size_t bench_capacity = 4;
+
+template <typename buffer_type> static void bench_producer(buffer_type *bb){
+    for (size_t i = 0; i < num_bench_elems; i++) bb->push_with_wait(i);
+}
+
+template <typename buffer_type> static double bench_contention(void){
+    buffer_type bb(bench_capacity);
+    const boost::system_time start = boost::get_system_time();
+    boost::thread producer(boost::bind(&bench_producer<buffer_type>, &bb));
+
+    size_t val = 0, num_errors = 0;
+    for (size_t i = 0; i < num_bench_elems; i++){
+        bb.pop_with_wait(val);
+        if (val != i) num_errors++;
+    }
+    producer.join();
+    BOOST_CHECK_EQUAL(num_errors, size_t(0));
+    return double((boost::get_system_time() - start).total_microseconds())/1e6;
+}
+
+BOOST_AUTO_TEST_CASE(test_bounded_buffer_contention){
+    const double locked = bench_contention<bounded_buffer<size_t> >();
+    const double spsc = bench_contention<bounded_spsc_buffer<size_t> >();
+    if (std::getenv("UHD_TEST_BENCH") == NULL) return;
+    std::cout << "Contention benchmark (" << num_bench_elems << " elements):" << std::endl;
+    std::cout << "  bounded_buffer:      " << (num_bench_elems/locked)/1e6 << " Melems/sec" << std::endl;
+    std::cout << "  bounded_spsc_buffer: " << (num_bench_elems/spsc)/1e6 << " Melems/sec" << std::endl;
+}
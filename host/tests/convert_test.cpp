@@ -16,6 +16,7 @@
 //
 
 #include <uhd/convert.hpp>
+#include <uhd/utils/byteswap.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/foreach.hpp>
 #include <boost/cstdint.hpp>
@@ -280,3 +281,414 @@ BOOST_AUTO_TEST_CASE(test_convert_types_sc16_to_fc32){
         MY_CHECK_CLOSE(input[i].imag()/float(32767), output[i].imag(), float(0.01));
     }
 }
+
+/***********************************************************************
+ * Test every registered implementation against the general one
+ *    Lengths cover the tails of the widest SIMD loops and the
+ *    buffers are shifted by whole samples to break their alignment.
+ **********************************************************************/
+static const convert::priority_type general_prio = 0;
+
+static convert::id_type make_id(const std::string &in, const std::string &out){
+    convert::id_type id;
+    id.input_format = in;
+    id.num_inputs = 1;
+    id.output_format = out;
+    id.num_outputs = 1;
+    return id;
+}
+
+//one component of a sample in a buffer of sc16 or sc8 items
+static int item32_sample_part(
+    const std::vector<boost::uint32_t> &buff, const size_t index,
+    const bool is_sc8, const bool is_be, const int which
+){
+    boost::uint32_t item = buff[is_sc8? index/2 : index];
+    if (is_be) item = uhd::ntohx(item);
+    else       item = uhd::wtohx(item);
+    if (not is_sc8) return boost::int16_t(item >> (which? 0 : 16));
+    return boost::int8_t(item >> ((index % 2)*16 + (which? 0 : 8)));
+}
+
+template <typename data_type>
+static void test_convert_impls_to_item32(const std::string &in_format, const std::string &out_format){
+    typedef typename data_type::value_type value_type;
+    const convert::id_type id = make_id(in_format, out_format);
+    const bool is_be = out_format.find("_be") != std::string::npos;
+    const bool is_sc8 = out_format.find("sc8") == 0;
+    const size_t bytes_per_samp = is_sc8? 2 : 4;
+    const double scalar = is_sc8? 127. : 32767.;
+
+    BOOST_FOREACH(const convert::priority_type prio, convert::get_converter_priorities(id)){
+        if (prio == general_prio) continue;
+        for (size_t nsamps = 1; nsamps < 70; nsamps++){
+        for (size_t in_off = 0; in_off < 4; in_off++){
+        for (size_t out_off = 0; out_off < (is_sc8? 8 : 4); out_off++){
+            std::vector<data_type> input(nsamps+in_off);
+            BOOST_FOREACH(data_type &in, input) in = data_type(
+                (std::rand()/value_type(RAND_MAX/2)) - 1,
+                (std::rand()/value_type(RAND_MAX/2)) - 1
+            );
+            //whole items, so sc8 may write the padding of an odd tail
+            const size_t num_items = (nsamps+out_off)*bytes_per_samp/4 + 1;
+            std::vector<boost::uint32_t> expected(num_items), output(num_items);
+
+            //odd sc8 offsets start at the second sample of an item
+            std::vector<const void *> in_buffs(1, &input[in_off]);
+            std::vector<void *> out_buffs(1, reinterpret_cast<char *>(&expected[0]) + out_off*bytes_per_samp);
+            convert::converter::sptr c0 = convert::get_converter(id, general_prio)();
+            c0->set_scalar(scalar);
+            c0->conv(in_buffs, out_buffs, nsamps);
+
+            out_buffs[0] = reinterpret_cast<char *>(&output[0]) + out_off*bytes_per_samp;
+            convert::converter::sptr c1 = convert::get_converter(id, prio)();
+            c1->set_scalar(scalar);
+            c1->conv(in_buffs, out_buffs, nsamps);
+
+            //simd rounds where the general converter truncates, allow one lsb,
+            //the samples around the converted ones must be left alone
+            for (size_t i = 0; i < num_items*4/bytes_per_samp; i++){
+                for (int which = 0; which < 2; which++){
+                    const int diff = item32_sample_part(expected, i, is_sc8, is_be, which)
+                                   - item32_sample_part(output, i, is_sc8, is_be, which);
+                    if (std::abs(diff) > 1) BOOST_ERROR(
+                        id.to_pp_string() << "prio " << prio << " nsamps " << nsamps
+                        << " offsets " << in_off << "/" << out_off << " sample " << i
+                    );
+                }
+            }
+        }}}
+    }
+}
+
+template <typename data_type>
+static void test_convert_impls_from_item32(
+    const std::string &in_format, const std::string &out_format, const double scalar
+){
+    const convert::id_type id = make_id(in_format, out_format);
+    const bool is_sc8 = in_format.find("sc8") == 0;
+
+    BOOST_FOREACH(const convert::priority_type prio, convert::get_converter_priorities(id)){
+        if (prio == general_prio) continue;
+        for (size_t nsamps = 1; nsamps < 70; nsamps++){
+        for (size_t in_off = 0; in_off < (is_sc8? 8 : 4); in_off++){
+        for (size_t out_off = 0; out_off < 4; out_off++){
+            std::vector<boost::uint32_t> input(nsamps+in_off+1);
+            BOOST_FOREACH(boost::uint32_t &in, input) in = (boost::uint32_t(std::rand()) << 16) ^ boost::uint32_t(std::rand());
+            std::vector<data_type> expected(nsamps+out_off), output(nsamps+out_off);
+
+            //odd sc8 offsets start at the second sample of an item
+            const char *in_ptr = reinterpret_cast<const char *>(&input[is_sc8? in_off/2 : in_off]);
+            if (is_sc8 and in_off % 2) in_ptr += 2;
+
+            std::vector<const void *> in_buffs(1, in_ptr);
+            std::vector<void *> out_buffs(1, &expected[out_off]);
+            convert::converter::sptr c0 = convert::get_converter(id, general_prio)();
+            c0->set_scalar(scalar);
+            c0->conv(in_buffs, out_buffs, nsamps);
+
+            out_buffs[0] = &output[out_off];
+            convert::converter::sptr c1 = convert::get_converter(id, prio)();
+            c1->set_scalar(scalar);
+            c1->conv(in_buffs, out_buffs, nsamps);
+
+            for (size_t i = 0; i < nsamps; i++){
+                const data_type &e = expected[out_off+i], &o = output[out_off+i];
+                if (std::abs(e.real() - o.real()) > 1e-6 or std::abs(e.imag() - o.imag()) > 1e-6) BOOST_ERROR(
+                    id.to_pp_string() << "prio " << prio << " nsamps " << nsamps
+                    << " offsets " << in_off << "/" << out_off << " sample " << i
+                    << " expected " << e << " got " << o
+                );
+            }
+        }}}
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_fc32_to_sc16){
+    test_convert_impls_to_item32<fc32_t>("fc32", "sc16_item32_le");
+    test_convert_impls_to_item32<fc32_t>("fc32", "sc16_item32_be");
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_fc64_to_sc16){
+    test_convert_impls_to_item32<fc64_t>("fc64", "sc16_item32_le");
+    test_convert_impls_to_item32<fc64_t>("fc64", "sc16_item32_be");
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_sc16_to_fc32){
+    test_convert_impls_from_item32<fc32_t>("sc16_item32_le", "fc32", 1/32767.);
+    test_convert_impls_from_item32<fc32_t>("sc16_item32_be", "fc32", 1/32767.);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_sc16_to_fc64){
+    test_convert_impls_from_item32<fc64_t>("sc16_item32_le", "fc64", 1/32767.);
+    test_convert_impls_from_item32<fc64_t>("sc16_item32_be", "fc64", 1/32767.);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_sc8_to_fc32){
+    test_convert_impls_from_item32<fc32_t>("sc8_item32_le", "fc32", 1/127.);
+    test_convert_impls_from_item32<fc32_t>("sc8_item32_be", "fc32", 1/127.);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_sc8_to_fc64){
+    test_convert_impls_from_item32<fc64_t>("sc8_item32_le", "fc64", 1/127.);
+    test_convert_impls_from_item32<fc64_t>("sc8_item32_be", "fc64", 1/127.);
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_fc32_to_sc8){
+    test_convert_impls_to_item32<fc32_t>("fc32", "sc8_item32_le");
+    test_convert_impls_to_item32<fc32_t>("fc32", "sc8_item32_be");
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_fc64_to_sc8){
+    test_convert_impls_to_item32<fc64_t>("fc64", "sc8_item32_le");
+    test_convert_impls_to_item32<fc64_t>("fc64", "sc8_item32_be");
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_sc8_to_sc16){
+    test_convert_impls_from_item32<sc16_t>("sc8_item32_le", "sc16", 1.);
+    test_convert_impls_from_item32<sc16_t>("sc8_item32_be", "sc16", 1.);
+}
+
+/***********************************************************************
+ * Test the sc8 wire format loopback for every host type
+ **********************************************************************/
+template <typename data_type>
+static void test_convert_sc8_loopback(const std::string &cpu_format, const std::string &otw_format){
+    typedef typename data_type::value_type value_type;
+    const double scalar = (cpu_format == "sc16")? 1. : 127.;
+    const value_type lsb = value_type(1/scalar);
+
+    for (size_t nsamps = 1; nsamps < 16; nsamps++){
+        std::vector<data_type> input(nsamps), output(nsamps);
+        BOOST_FOREACH(data_type &in, input) in = data_type(
+            value_type((std::rand() % 255) - 127)*lsb,
+            value_type((std::rand() % 255) - 127)*lsb
+        );
+        std::vector<boost::uint32_t> interm(nsamps/2 + 1);
+
+        std::vector<const void *> input0(1, &input[0]), input1(1, &interm[0]);
+        std::vector<void *> output0(1, &interm[0]), output1(1, &output[0]);
+
+        convert::converter::sptr c0 = convert::get_converter(make_id(cpu_format, otw_format))();
+        c0->set_scalar(scalar);
+        c0->conv(input0, output0, nsamps);
+
+        convert::converter::sptr c1 = convert::get_converter(make_id(otw_format, cpu_format))();
+        c1->set_scalar(1/scalar);
+        c1->conv(input1, output1, nsamps);
+
+        //the float to char conversion truncates
+        for (size_t i = 0; i < nsamps; i++){
+            BOOST_CHECK(std::abs(input[i].real() - output[i].real()) <= lsb);
+            BOOST_CHECK(std::abs(input[i].imag() - output[i].imag()) <= lsb);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_types_sc8){
+    test_convert_sc8_loopback<fc32_t>("fc32", "sc8_item32_le");
+    test_convert_sc8_loopback<fc32_t>("fc32", "sc8_item32_be");
+    test_convert_sc8_loopback<fc64_t>("fc64", "sc8_item32_le");
+    test_convert_sc8_loopback<fc64_t>("fc64", "sc8_item32_be");
+    test_convert_sc8_loopback<sc16_t>("sc16", "sc8_item32_le");
+    test_convert_sc8_loopback<sc16_t>("sc16", "sc8_item32_be");
+}
+
+/***********************************************************************
+ * Test the sc12 wire format: 4 samples packed in 3 items
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_convert_sc12_layout){
+    const boost::int16_t iq[8] = {
+        0x1230, 0x4560, 0x7890, boost::int16_t(0xabc0),
+        boost::int16_t(0xdef0), 0x0120, 0x3450, 0x6780
+    };
+    std::vector<sc16_t> input(4), output(4);
+    for (size_t i = 0; i < 4; i++) input[i] = sc16_t(iq[2*i], iq[2*i+1]);
+    std::vector<boost::uint32_t> interm(3);
+
+    std::vector<const void *> input0(1, &input[0]), input1(1, &interm[0]);
+    std::vector<void *> output0(1, &interm[0]), output1(1, &output[0]);
+
+    convert::converter::sptr c0 = convert::get_converter(make_id("sc16", "sc12_item32_be"))();
+    c0->set_scalar(1.);
+    c0->conv(input0, output0, 4);
+    BOOST_CHECK_EQUAL(uhd::ntohx(interm[0]), boost::uint32_t(0x12345678));
+    BOOST_CHECK_EQUAL(uhd::ntohx(interm[1]), boost::uint32_t(0x9abcdef0));
+    BOOST_CHECK_EQUAL(uhd::ntohx(interm[2]), boost::uint32_t(0x12345678));
+
+    convert::converter::sptr c1 = convert::get_converter(make_id("sc12_item32_be", "sc16"))();
+    c1->set_scalar(1.);
+    c1->conv(input1, output1, 4);
+    BOOST_CHECK_EQUAL_COLLECTIONS(input.begin(), input.end(), output.begin(), output.end());
+}
+
+//the bytes of a buffer of sc12 items in bit stream order
+static std::vector<boost::uint8_t> sc12_stream_bytes(const std::vector<boost::uint32_t> &buff, const bool is_be){
+    std::vector<boost::uint8_t> bytes;
+    BOOST_FOREACH(boost::uint32_t item, buff){
+        item = is_be? uhd::ntohx(item) : uhd::wtohx(item);
+        for (int shift = 24; shift >= 0; shift -= 8) bytes.push_back(boost::uint8_t(item >> shift));
+    }
+    return bytes;
+}
+
+//samples start 3 bytes apart, offsets 1 to 3 start inside a group
+template <typename data_type>
+static void test_convert_sc12_impls(const std::string &cpu_format, const std::string &otw_format, const double scalar){
+    typedef typename data_type::value_type value_type;
+    const convert::id_type to_id = make_id(cpu_format, otw_format), from_id = make_id(otw_format, cpu_format);
+
+    for (size_t nsamps = 1; nsamps < 70; nsamps++){
+    for (size_t off = 0; off < 4; off++){
+        std::vector<data_type> input(nsamps);
+        BOOST_FOREACH(data_type &in, input) in = data_type(
+            value_type(((std::rand()/value_type(RAND_MAX/2)) - 1)*value_type(1/scalar)),
+            value_type(((std::rand()/value_type(RAND_MAX/2)) - 1)*value_type(1/scalar))
+        );
+        const size_t num_items = (3*(nsamps+off))/4 + 2;
+        std::vector<boost::uint32_t> expected(num_items), wire(num_items);
+        BOOST_FOREACH(boost::uint32_t &w, expected) w = (boost::uint32_t(std::rand()) << 16) ^ boost::uint32_t(std::rand());
+        wire = expected;
+
+        std::vector<const void *> in_buffs(1, &input[0]);
+        std::vector<void *> out_buffs(1, reinterpret_cast<char *>(&expected[0]) + 3*off);
+        convert::converter::sptr c0 = convert::get_converter(to_id, general_prio)();
+        c0->set_scalar(scalar);
+        c0->conv(in_buffs, out_buffs, nsamps);
+
+        //the samples around the converted ones are left alone
+        const bool is_be = otw_format.find("_be") != std::string::npos;
+        const std::vector<boost::uint8_t> before = sc12_stream_bytes(wire, is_be), after = sc12_stream_bytes(expected, is_be);
+        for (size_t i = 0; i < before.size(); i++){
+            if (i >= 3*off and i < 3*(off+nsamps)) continue;
+            if (before[i] != after[i]) BOOST_ERROR(
+                to_id.to_pp_string() << "nsamps " << nsamps << " offset " << off << " byte " << i
+            );
+        }
+
+        //every implementation writes the same items
+        BOOST_FOREACH(const convert::priority_type prio, convert::get_converter_priorities(to_id)){
+            std::vector<boost::uint32_t> output = wire;
+            out_buffs[0] = reinterpret_cast<char *>(&output[0]) + 3*off;
+            convert::converter::sptr c1 = convert::get_converter(to_id, prio)();
+            c1->set_scalar(scalar);
+            c1->conv(in_buffs, out_buffs, nsamps);
+            if (output != expected) BOOST_ERROR(
+                to_id.to_pp_string() << "prio " << prio << " nsamps " << nsamps << " offset " << off
+            );
+        }
+
+        //every implementation reads back the same samples
+        std::vector<data_type> back(nsamps);
+        in_buffs[0] = reinterpret_cast<const char *>(&expected[0]) + 3*off;
+        out_buffs[0] = &back[0];
+        convert::converter::sptr c2 = convert::get_converter(from_id, general_prio)();
+        c2->set_scalar(1/scalar);
+        c2->conv(in_buffs, out_buffs, nsamps);
+
+        //truncated to 12 bits, so the loopback is within one 12-bit lsb
+        const value_type lsb = value_type(16/scalar);
+        for (size_t i = 0; i < nsamps; i++){
+            BOOST_CHECK(std::abs(value_type(input[i].real() - back[i].real())) <= lsb);
+            BOOST_CHECK(std::abs(value_type(input[i].imag() - back[i].imag())) <= lsb);
+        }
+
+        BOOST_FOREACH(const convert::priority_type prio, convert::get_converter_priorities(from_id)){
+            std::vector<data_type> output(nsamps);
+            out_buffs[0] = &output[0];
+            convert::converter::sptr c3 = convert::get_converter(from_id, prio)();
+            c3->set_scalar(1/scalar);
+            c3->conv(in_buffs, out_buffs, nsamps);
+            if (output != back) BOOST_ERROR(
+                from_id.to_pp_string() << "prio " << prio << " nsamps " << nsamps << " offset " << off
+            );
+        }
+    }}
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_impls_sc12){
+    test_convert_sc12_impls<fc32_t>("fc32", "sc12_item32_le", 32767.);
+    test_convert_sc12_impls<fc32_t>("fc32", "sc12_item32_be", 32767.);
+    test_convert_sc12_impls<fc64_t>("fc64", "sc12_item32_le", 32767.);
+    test_convert_sc12_impls<fc64_t>("fc64", "sc12_item32_be", 32767.);
+    test_convert_sc12_impls<sc16_t>("sc16", "sc12_item32_le", 1.);
+    test_convert_sc12_impls<sc16_t>("sc16", "sc12_item32_be", 1.);
+}
+
+/***********************************************************************
+ * Test the correcting converters against a double precision reference
+ **********************************************************************/
+static void test_convert_correcting_impls(const std::string &in_format){
+    const convert::id_type id = make_id(in_format, "fc32");
+    const bool is_be = in_format.find("_be") != std::string::npos;
+    const double scalar = 1/32767.;
+
+    convert::correction_type corr;
+    corr.dc_offset = std::complex<double>(0.01, -0.02);
+    corr.matrix[0][0] = 1.02; corr.matrix[0][1] = -0.03;
+    corr.matrix[1][0] = 0.05; corr.matrix[1][1] = 0.97;
+    corr.gain = 1.5;
+
+    BOOST_REQUIRE(not convert::get_correcting_converter_priorities(id).empty());
+    BOOST_FOREACH(const convert::priority_type prio, convert::get_correcting_converter_priorities(id)){
+        for (size_t nsamps = 1; nsamps < 70; nsamps++){
+        for (size_t out_off = 0; out_off < 4; out_off++){
+            std::vector<boost::uint32_t> input(nsamps);
+            BOOST_FOREACH(boost::uint32_t &in, input) in = (boost::uint32_t(std::rand()) << 16) ^ boost::uint32_t(std::rand());
+            std::vector<fc32_t> output(nsamps+out_off);
+
+            std::vector<const void *> in_buffs(1, &input[0]);
+            std::vector<void *> out_buffs(1, &output[out_off]);
+            convert::converter::sptr c = convert::get_correcting_converter(id, prio)();
+            c->set_scalar(scalar);
+            BOOST_REQUIRE(c->set_correction(corr));
+            c->conv(in_buffs, out_buffs, nsamps);
+
+            for (size_t i = 0; i < nsamps; i++){
+                const boost::uint32_t item = is_be? uhd::ntohx(input[i]) : uhd::wtohx(input[i]);
+                const std::complex<double> x = std::complex<double>(
+                    boost::int16_t(item >> 16), boost::int16_t(item >> 0))*scalar - corr.dc_offset;
+                const std::complex<double> e = corr.gain*std::complex<double>(
+                    corr.matrix[0][0]*x.real() + corr.matrix[0][1]*x.imag(),
+                    corr.matrix[1][0]*x.real() + corr.matrix[1][1]*x.imag());
+                const fc32_t &o = output[out_off+i];
+                if (std::abs(e.real() - o.real()) > 1e-5 or std::abs(e.imag() - o.imag()) > 1e-5) BOOST_ERROR(
+                    id.to_pp_string() << "prio " << prio << " nsamps " << nsamps
+                    << " offset " << out_off << " sample " << i
+                    << " expected " << e << " got " << o
+                );
+            }
+        }}
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_correcting_sc16_to_fc32){
+    test_convert_correcting_impls("sc16_item32_le");
+    test_convert_correcting_impls("sc16_item32_be");
+}
+
+BOOST_AUTO_TEST_CASE(test_convert_correcting_identity){
+    const convert::id_type id = make_id("sc16_item32_le", "fc32");
+    std::vector<boost::uint32_t> input(33);
+    BOOST_FOREACH(boost::uint32_t &in, input) in = (boost::uint32_t(std::rand()) << 16) ^ boost::uint32_t(std::rand());
+    std::vector<fc32_t> expected(input.size()), output(input.size());
+
+    std::vector<const void *> in_buffs(1, &input[0]);
+    std::vector<void *> out_buffs(1, &expected[0]);
+    convert::converter::sptr c0 = convert::get_converter(id)();
+    c0->set_scalar(1/32767.);
+    c0->conv(in_buffs, out_buffs, input.size());
+
+    //without a correction the result is that of the regular converter
+    out_buffs[0] = &output[0];
+    convert::converter::sptr c1 = convert::get_correcting_converter(id)();
+    c1->set_scalar(1/32767.);
+    c1->conv(in_buffs, out_buffs, input.size());
+    for (size_t i = 0; i < input.size(); i++){
+        BOOST_CHECK_CLOSE_FRACTION(expected[i].real(), output[i].real(), 1e-6);
+        BOOST_CHECK_CLOSE_FRACTION(expected[i].imag(), output[i].imag(), 1e-6);
+    }
+
+    //the regular converters do not correct
+    BOOST_CHECK(not c0->set_correction(convert::correction_type()));
+}
@@ -17,7 +17,10 @@
 
 #include <boost/test/unit_test.hpp>
 #include <uhd/utils/msg.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 #include <iostream>
+#include <string>
 
 BOOST_AUTO_TEST_CASE(test_messages){
     std::cerr << "---begin print test ---" << std::endl;
@@ -38,3 +41,36 @@ BOOST_AUTO_TEST_CASE(test_messages){
     UHD_VAR(x);
     std::cerr << "---end print test ---" << std::endl;
 }
+
+static boost::mutex fastpath_mutex;
+static std::string fastpath_msgs;
+
+static void fastpath_handler(uhd::msg::type_t type, const std::string &msg){
+    boost::mutex::scoped_lock lock(fastpath_mutex);
+    if (type == uhd::msg::fastpath) fastpath_msgs += msg;
+}
+
+static std::string get_fastpath_msgs(void){
+    boost::mutex::scoped_lock lock(fastpath_mutex);
+    return fastpath_msgs;
+}
+
+BOOST_AUTO_TEST_CASE(test_fastpath_messages){
+    uhd::msg::register_handler(&fastpath_handler);
+
+    //the characters come from the reporter thread, in character order
+    uhd::msg::post_fastpath('U');
+    uhd::msg::post_fastpath('O');
+    uhd::msg::post_fastpath('O');
+    for (size_t i = 0; i < 100 and get_fastpath_msgs().size() < 3; i++){
+        boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+    }
+    BOOST_CHECK_EQUAL(get_fastpath_msgs(), "OOU");
+
+    //disabled, nothing is reported
+    uhd::msg::set_fastpath_enabled(false);
+    uhd::msg::post_fastpath('L');
+    boost::this_thread::sleep(boost::posix_time::milliseconds(200));
+    BOOST_CHECK_EQUAL(get_fastpath_msgs(), "OOU");
+    uhd::msg::set_fastpath_enabled(true);
+}
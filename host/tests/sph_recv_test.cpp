@@ -17,11 +17,14 @@
 
 #include <boost/test/unit_test.hpp>
 #include "../lib/transport/super_recv_packet_handler.hpp"
+#include "../lib/transport/super_recv_capture_streamer.hpp"
 #include <boost/shared_array.hpp>
 #include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <complex>
 #include <vector>
 #include <list>
+#include <cstdlib>
 
 #define BOOST_CHECK_TS_CLOSE(a, b) \
     BOOST_CHECK_CLOSE((a).get_real_secs(), (b).get_real_secs(), 0.001)
@@ -87,6 +90,18 @@ public:
         _lens.push_back(ifpi.num_packet_words32*sizeof(boost::uint32_t));
     }
 
+    //! Push a packet whose payload words count up from the first sample
+    void push_back_counting_packet(
+        uhd::transport::vrt::if_packet_info_t &ifpi,
+        const boost::uint32_t first_samp
+    ){
+        this->push_back_packet(ifpi);
+        boost::uint32_t *payload = reinterpret_cast<boost::uint32_t *>(_mems.back().get()) + ifpi.num_header_words32;
+        for (size_t i = 0; i < ifpi.num_payload_words32; i++){
+            payload[i] = (_end == "big")? uhd::htonx(boost::uint32_t(first_samp + i)) : uhd::htowx(boost::uint32_t(first_samp + i));
+        }
+    }
+
     uhd::transport::managed_recv_buffer::sptr get_recv_buff(double){
         if (_mems.empty()) return uhd::transport::managed_recv_buffer::sptr(); //timeout
         _mrbs.push_back(dummy_mrb());
@@ -347,6 +362,90 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_inline_message){
     }
 }
 
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_event_counters){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    dummy_recv_xport_class dummy_recv_xport("big");
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+
+    //generate a bunch of packets with an overflow message and a lost packet
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+        ifpi.num_payload_words32 = 10;
+        if (i != 2*NUM_PKTS_TO_TEST/3){
+            dummy_recv_xport.push_back_packet(ifpi);
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
+
+        if (i == NUM_PKTS_TO_TEST/3){
+            ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_EXTENSION;
+            ifpi.num_payload_words32 = 1;
+            dummy_recv_xport.push_back_packet(ifpi, uhd::rx_metadata_t::ERROR_CODE_OVERFLOW);
+        }
+    }
+
+    //create the super receive packet handler
+    uhd::transport::sph::recv_packet_handler handler(1);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xport, _1));
+    handler.set_converter(id);
+
+    //count the events of the channel
+    typedef uhd::transport::sph::stream_event_counters events_type;
+    events_type::sptr events(new events_type());
+    handler.set_event_counters(0, events);
+
+    //receive everything, each event is counted once
+    std::vector<std::complex<float> > buff(20);
+    uhd::rx_metadata_t metadata;
+    size_t num_overflows = 0;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST + 1; i++){
+        handler.recv(&buff.front(), buff.size(), metadata, 1.0, true);
+        BOOST_CHECK(metadata.error_code != uhd::rx_metadata_t::ERROR_CODE_TIMEOUT);
+        if (metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW) num_overflows++;
+    }
+    BOOST_CHECK_EQUAL(num_overflows, size_t(2));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_OVERFLOW), size_t(1));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_SEQ_ERROR), size_t(1));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_TIMEOUT), size_t(0));
+
+    //subsequent receives are timeouts
+    for (size_t i = 0; i < 3; i++){
+        handler.recv(&buff.front(), buff.size(), metadata, 1.0, true);
+        BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_TIMEOUT);
+    }
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_OVERFLOW), size_t(1));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_SEQ_ERROR), size_t(1));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_TIMEOUT), size_t(3));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_LATE_PACKET), size_t(0));
+    BOOST_CHECK_EQUAL(events->get(events_type::EVENT_ALIGNMENT), size_t(0));
+}
+
 ////////////////////////////////////////////////////////////////////////
 BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_normal){
 ////////////////////////////////////////////////////////////////////////
@@ -705,3 +804,628 @@ BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_fragment){
     }
 
 }
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_one_channel_sc12_sequence_error){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc12_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    dummy_recv_xport_class dummy_recv_xport("big");
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = true; //holds the occupancy of the last word
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t LOST_PKT = 16; //after 15 samples, 11.25 words
+
+    //generate a bunch of packets, most end in a partly filled word
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        const size_t nsamps = 10 + i%10;
+        ifpi.num_payload_bytes = nsamps*3;
+        ifpi.num_payload_words32 = (ifpi.num_payload_bytes + 3)/4;
+        ifpi.tlr = 0;
+        if (i != LOST_PKT){ //simulate a lost packet
+            dummy_recv_xport.push_back_packet(ifpi);
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += nsamps*size_t(TICK_RATE/SAMP_RATE);
+    }
+
+    //create the super receive packet handler
+    uhd::transport::sph::recv_packet_handler handler(1);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xport, _1));
+    handler.set_converter(id);
+
+    //check the received packets
+    size_t num_accum_samps = 0;
+    std::vector<std::complex<float> > buff(20);
+    uhd::rx_metadata_t metadata;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        size_t num_samps_ret = handler.recv(
+            &buff.front(), buff.size(), metadata, 1.0, true
+        );
+        if (i == LOST_PKT){
+            //the overflow time comes from the bytes in the previous packet
+            BOOST_REQUIRE(metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW);
+            BOOST_CHECK_TS_CLOSE(metadata.time_spec, uhd::time_spec_t(0, num_accum_samps, SAMP_RATE));
+            num_accum_samps += 10 + i%10;
+        }
+        else{
+            BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+            BOOST_CHECK(metadata.has_time_spec);
+            BOOST_CHECK_TS_CLOSE(metadata.time_spec, uhd::time_spec_t(0, num_accum_samps, SAMP_RATE));
+            BOOST_CHECK_EQUAL(num_samps_ret, 10 + i%10);
+            num_accum_samps += num_samps_ret;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_correction){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 10;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const size_t NUM_PKTS_TO_TEST = 4;
+    static const size_t NCHANNELS = 2;
+    static const boost::uint32_t SAMP_WORD = 0x01010101; //I = Q = 257 in any byte order
+    static const double SCALE = 1/32767.;
+
+    std::vector<dummy_recv_xport_class> dummy_recv_xports(NCHANNELS, dummy_recv_xport_class("big"));
+
+    //generate a bunch of packets, the first sample of each is known
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            dummy_recv_xports[ch].push_back_packet(ifpi, SAMP_WORD);
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*10;
+    }
+
+    //create the super receive packet handler
+    uhd::transport::sph::recv_packet_handler handler(NCHANNELS);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(100e6);
+    handler.set_samp_rate(10e6);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xports[ch], _1));
+    }
+    handler.set_converter(id);
+    handler.set_scale_factor(SCALE);
+
+    //only the second channel is corrected
+    uhd::convert::correction_type corr;
+    corr.dc_offset = std::complex<double>(0.001, 0.002);
+    corr.matrix[0][0] = 1.0; corr.matrix[0][1] = 0.1;
+    corr.matrix[1][0] = -0.2; corr.matrix[1][1] = 0.9;
+    corr.gain = 2.0;
+    handler.set_correction(1, corr);
+
+    const double x = 257*SCALE;
+    const std::complex<float> plain = std::complex<float>(float(x), float(x));
+    const std::complex<float> corrected(
+        float(2.0*(1.0*(x - 0.001) + 0.1*(x - 0.002))),
+        float(2.0*(-0.2*(x - 0.001) + 0.9*(x - 0.002)))
+    );
+
+    std::vector<std::complex<float> > mem(10*NCHANNELS);
+    std::vector<std::complex<float> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        buffs[ch] = &mem[ch*10];
+    }
+    uhd::rx_metadata_t metadata;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        //the correction is removed half way through
+        if (i == NUM_PKTS_TO_TEST/2) handler.clear_correction(1);
+        const bool is_corrected = i < NUM_PKTS_TO_TEST/2;
+
+        BOOST_CHECK_EQUAL(handler.recv(buffs, 10, metadata, 1.0, true), size_t(10));
+        BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK_CLOSE_FRACTION(buffs[0][0].real(), plain.real(), 1e-5);
+        BOOST_CHECK_CLOSE_FRACTION(buffs[0][0].imag(), plain.imag(), 1e-5);
+        const std::complex<float> &expected = is_corrected? corrected : plain;
+        BOOST_CHECK_CLOSE_FRACTION(buffs[1][0].real(), expected.real(), 1e-4);
+        BOOST_CHECK_CLOSE_FRACTION(buffs[1][0].imag(), expected.imag(), 1e-4);
+    }
+
+    //formats without a correcting converter cannot be corrected
+    id.output_format = "sc16";
+    handler.set_converter(id);
+    BOOST_CHECK_THROW(handler.set_correction(0, corr), uhd::key_error);
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_direct){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "sc16";
+    id.num_outputs = 1;
+
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t NCHANNELS = 2;
+
+    std::vector<dummy_recv_xport_class> dummy_recv_xports(NCHANNELS, dummy_recv_xport_class("big"));
+
+    //generate a bunch of packets
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.num_payload_words32 = 10 + i%10;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            dummy_recv_xports[ch].push_back_packet(ifpi);
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
+    }
+
+    //create the super receive packet handler
+    uhd::transport::sph::recv_packet_handler handler(NCHANNELS);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xports[ch], _1));
+    }
+    handler.set_converter(id);
+
+    //check the received packets, every third one starts with a copying recv
+    size_t num_accum_samps = 0;
+    std::vector<std::complex<boost::int16_t> > mem(5*NCHANNELS);
+    std::vector<std::complex<boost::int16_t> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        buffs[ch] = &mem[ch*5];
+    }
+    uhd::rx_streamer::direct_buffs_type direct;
+    uhd::rx_metadata_t metadata;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        size_t num_copied = 0;
+        if (i%3 == 0){
+            num_copied = handler.recv(buffs, 5, metadata, 1.0, true);
+            BOOST_CHECK_EQUAL(num_copied, size_t(5));
+            BOOST_CHECK(metadata.more_fragments);
+        }
+        size_t num_samps_ret = handler.recv_direct(direct, metadata, 1.0);
+        BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK(not metadata.more_fragments);
+        BOOST_CHECK_EQUAL(metadata.fragment_offset, num_copied);
+        BOOST_CHECK(metadata.has_time_spec);
+        BOOST_CHECK_TS_CLOSE(metadata.time_spec, uhd::time_spec_t(0, num_accum_samps + num_copied, SAMP_RATE));
+        BOOST_CHECK_EQUAL(num_samps_ret, 10 + i%10 - num_copied);
+        num_accum_samps += num_copied + num_samps_ret;
+
+        //the samples are left in the frames, past the header and the copied ones
+        BOOST_CHECK_EQUAL(direct.nsamps, num_samps_ret);
+        BOOST_CHECK_EQUAL(direct.format, "sc16_item32_be");
+        BOOST_REQUIRE_EQUAL(direct.buffs.size(), NCHANNELS);
+        BOOST_REQUIRE_EQUAL(direct.frames.size(), NCHANNELS);
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            const char *payload = direct.frames[ch]->cast<const char *>() + (ifpi.num_header_words32 + num_copied)*4;
+            BOOST_CHECK(direct.buffs[ch] == payload);
+        }
+    }
+    direct.release();
+    BOOST_CHECK(direct.frames.empty());
+
+    //subsequent receives should be a timeout
+    for (size_t i = 0; i < 3; i++){
+        std::cout << "timeout check " << i << std::endl;
+        BOOST_CHECK_EQUAL(handler.recv_direct(direct, metadata, 1.0), size_t(0));
+        BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_TIMEOUT);
+        BOOST_CHECK(direct.frames.empty());
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_convert_threads){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "sc16";
+    id.num_outputs = 1;
+
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t NUM_SAMPS_PER_BUFF = 20;
+    static const size_t NCHANNELS = 4;
+
+    std::vector<dummy_recv_xport_class> dummy_recv_xports(NCHANNELS, dummy_recv_xport_class("big"));
+
+    //generate a bunch of packets, the first sample tells the channel
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.num_payload_words32 = 10 + i%10;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            dummy_recv_xports[ch].push_back_packet(ifpi, boost::uint32_t(ch+1)*0x01010101);
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
+    }
+
+    //create the super receive packet handler, the 4 channels on 3 threads
+    uhd::transport::sph::recv_packet_handler handler(NCHANNELS);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xports[ch], _1));
+    }
+    handler.set_converter(id);
+    handler.set_convert_threads(3);
+
+    //check the received packets
+    size_t num_accum_samps = 0;
+    std::vector<std::complex<boost::int16_t> > mem(NUM_SAMPS_PER_BUFF*NCHANNELS);
+    std::vector<std::complex<boost::int16_t> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        buffs[ch] = &mem[ch*NUM_SAMPS_PER_BUFF];
+    }
+    uhd::rx_metadata_t metadata;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        size_t num_samps_ret = handler.recv(
+            buffs, NUM_SAMPS_PER_BUFF, metadata, 1.0, true
+        );
+        BOOST_CHECK_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK_TS_CLOSE(metadata.time_spec, uhd::time_spec_t(0, num_accum_samps, SAMP_RATE));
+        BOOST_CHECK_EQUAL(num_samps_ret, 10 + i%10);
+        num_accum_samps += num_samps_ret;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            BOOST_CHECK_EQUAL(buffs[ch][0].real(), boost::int16_t((ch+1)*0x0101));
+            BOOST_CHECK_EQUAL(buffs[ch][0].imag(), boost::int16_t((ch+1)*0x0101));
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_stress){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "item32";
+    id.num_outputs = 1;
+
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.sob = false;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_SAMPS_TO_TEST = 20000;
+    static const size_t NUM_SAMPS_PER_BUFF = 20;
+    static const size_t NCHANNELS = 16; //8 boards with 2 channels each
+
+    std::vector<dummy_recv_xport_class> dummy_recv_xports(NCHANNELS, dummy_recv_xport_class("big"));
+
+    //generate the packets, every sample word holds its own time in samples:
+    //the channels start apart, break packets at different samples
+    //and lose a packet now and then, like after an overflow
+    boost::uint32_t lcg = 1;
+    size_t num_lost = 0;
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        ifpi.packet_count = 0;
+        for (size_t samp = ch*5, i = 0; samp < NUM_SAMPS_TO_TEST; i++){
+            ifpi.num_payload_words32 = 10 + (i*7 + ch*3)%11;
+            ifpi.tsf = samp*size_t(TICK_RATE/SAMP_RATE);
+            lcg = lcg*1103515245 + 12345;
+            if (i != 0 and (lcg >> 16)%200 == 0) num_lost++; //simulates a lost packet
+            else dummy_recv_xports[ch].push_back_counting_packet(ifpi, boost::uint32_t(samp));
+            ifpi.packet_count = (ifpi.packet_count + 1)%16;
+            samp += ifpi.num_payload_words32;
+        }
+    }
+    BOOST_REQUIRE(num_lost > 0);
+
+    //create the super receive packet handler
+    uhd::transport::sph::recv_packet_handler handler(NCHANNELS);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xports[ch], _1));
+    }
+    handler.set_converter(id);
+
+    //receive until the samples run out, every set must line up
+    std::vector<boost::uint32_t> mem(NUM_SAMPS_PER_BUFF*NCHANNELS);
+    std::vector<boost::uint32_t *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        buffs[ch] = &mem[ch*NUM_SAMPS_PER_BUFF];
+    }
+    uhd::rx_metadata_t metadata;
+    size_t num_accum_samps = 0, num_sets = 0, num_overflows = 0;
+    double last_time = -1;
+    const boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+    while (true){
+        size_t num_samps_ret = handler.recv(
+            buffs, NUM_SAMPS_PER_BUFF, metadata, 0.0, true
+        );
+        if (metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT) break;
+        if (metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_OVERFLOW){
+            num_overflows++;
+            continue;
+        }
+        BOOST_REQUIRE_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        if (num_samps_ret == 0) continue;
+        BOOST_REQUIRE(metadata.has_time_spec);
+        const double time = metadata.time_spec.get_real_secs()*SAMP_RATE;
+        BOOST_CHECK(time > last_time);
+        last_time = time;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            BOOST_REQUIRE_EQUAL(buffs[ch][0], boost::uint32_t(time + 0.5));
+            BOOST_REQUIRE_EQUAL(buffs[ch][num_samps_ret-1], buffs[ch][0] + num_samps_ret - 1);
+        }
+        num_accum_samps += num_samps_ret;
+        num_sets++;
+    }
+    const double elapsed = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds()/1e6;
+
+    std::cout << boost::format(
+        "%u channels: %u packets lost, %u overflows, %u samples in %u aligned sets"
+    ) % NCHANNELS % num_lost % num_overflows % num_accum_samps % num_sets << std::endl;
+
+    //wall clock timings vary between runs, print them only when asked to
+    if (std::getenv("UHD_TEST_BENCH") != NULL) std::cout << boost::format(
+        "%.3f us per set, %.3f ns per sample and channel"
+    ) % (elapsed*1e6/num_sets) % (elapsed*1e9/num_accum_samps/NCHANNELS) << std::endl;
+    BOOST_CHECK(num_overflows > 0);
+    BOOST_CHECK(num_accum_samps > NUM_SAMPS_TO_TEST/2);
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_recv_multi_channel_tick_time){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "fc32";
+    id.num_outputs = 1;
+
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.has_tlr = false;
+
+    //the UmTRX GSM rate, a sample is 48 ticks
+    static const double TICK_RATE = 13e6;
+    static const double SAMP_RATE = 13e6/48;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t NUM_SAMPS_PER_BUFF = 7;
+    static const size_t NCHANNELS = 2;
+    static const boost::int64_t START_TICKS = 41*boost::int64_t(TICK_RATE) + boost::int64_t(TICK_RATE) - 48*100;
+
+    std::vector<dummy_recv_xport_class> dummy_recv_xports(NCHANNELS, dummy_recv_xport_class("big"));
+
+    //generate a bunch of packets that cross a second boundary
+    boost::int64_t ticks = START_TICKS;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.num_payload_words32 = 10 + i%10;
+        ifpi.tsi = boost::uint32_t(ticks/boost::int64_t(TICK_RATE));
+        ifpi.tsf = boost::uint64_t(ticks%boost::int64_t(TICK_RATE));
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            dummy_recv_xports[ch].push_back_packet(ifpi);
+        }
+        ifpi.packet_count++;
+        ticks += ifpi.num_payload_words32*48;
+    }
+
+    //create the super receive packet handler
+    uhd::transport::sph::recv_packet_handler handler(NCHANNELS);
+    handler.set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xports[ch], _1));
+    }
+    handler.set_converter(id);
+
+    //every fragment time must be exact to the tick
+    std::vector<std::complex<float> > mem(NUM_SAMPS_PER_BUFF*NCHANNELS);
+    std::vector<std::complex<float> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        buffs[ch] = &mem[ch*NUM_SAMPS_PER_BUFF];
+    }
+    uhd::rx_metadata_t metadata;
+    size_t num_accum_samps = 0;
+    while (true){
+        size_t num_samps_ret = handler.recv(
+            buffs, NUM_SAMPS_PER_BUFF, metadata, 0.0, true
+        );
+        if (metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT) break;
+        BOOST_REQUIRE_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        const boost::int64_t expected = START_TICKS + boost::int64_t(num_accum_samps)*48;
+        BOOST_CHECK_EQUAL(metadata.time_spec.get_full_secs(), time_t(expected/boost::int64_t(TICK_RATE)));
+        BOOST_CHECK_EQUAL(metadata.time_spec.get_tick_count(TICK_RATE), long(expected%boost::int64_t(TICK_RATE)));
+        num_accum_samps += num_samps_ret;
+    }
+    BOOST_CHECK_EQUAL(num_accum_samps, (ticks - START_TICKS)/48);
+}
+
+////////////////////////////////////////////////////////////////////////
+static void test_sph_recv_capture(const size_t ring_samps){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16_item32_be";
+    id.num_inputs = 1;
+    id.output_format = "item32";
+    id.num_outputs = 1;
+
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    ifpi.packet_type = uhd::transport::vrt::if_packet_info_t::PACKET_TYPE_DATA;
+    ifpi.num_payload_words32 = 0;
+    ifpi.packet_count = 0;
+    ifpi.sob = true;
+    ifpi.eob = false;
+    ifpi.has_sid = false;
+    ifpi.has_cid = false;
+    ifpi.has_tsi = true;
+    ifpi.has_tsf = true;
+    ifpi.tsi = 0;
+    ifpi.tsf = 0;
+    ifpi.has_tlr = false;
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 100;
+    static const size_t NUM_SAMPS_PER_BUFF = 25;
+    static const size_t NCHANNELS = 2;
+
+    std::vector<dummy_recv_xport_class> dummy_recv_xports(NCHANNELS, dummy_recv_xport_class("big"));
+
+    //generate a bunch of packets, every sample word holds its own time in samples
+    size_t num_samps_sent = 0;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        ifpi.num_payload_words32 = 10 + i%10;
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            dummy_recv_xports[ch].push_back_counting_packet(ifpi, boost::uint32_t(num_samps_sent));
+        }
+        ifpi.packet_count++;
+        ifpi.tsf += ifpi.num_payload_words32*size_t(TICK_RATE/SAMP_RATE);
+        num_samps_sent += ifpi.num_payload_words32;
+    }
+
+    //create the packet streamer and the capture streamer around it
+    boost::shared_ptr<uhd::transport::sph::recv_packet_streamer> packet_streamer(
+        new uhd::transport::sph::recv_packet_streamer(20)
+    );
+    packet_streamer->resize(NCHANNELS);
+    packet_streamer->set_vrt_unpacker(&uhd::transport::vrt::if_hdr_unpack_be);
+    packet_streamer->set_tick_rate(TICK_RATE);
+    packet_streamer->set_samp_rate(SAMP_RATE);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        packet_streamer->set_xport_chan_get_buff(ch, boost::bind(&dummy_recv_xport_class::get_recv_buff, &dummy_recv_xports[ch], _1));
+    }
+    packet_streamer->set_converter(id);
+    uhd::transport::sph::recv_capture_streamer streamer(packet_streamer, sizeof(boost::uint32_t), ring_samps);
+
+    //let the capture drain the transport before reading
+    boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+
+    //the samples must come in order up to a capture overflow
+    std::vector<boost::uint32_t> mem(NUM_SAMPS_PER_BUFF*NCHANNELS);
+    std::vector<void *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        buffs[ch] = &mem[ch*NUM_SAMPS_PER_BUFF];
+    }
+    uhd::rx_metadata_t metadata;
+    size_t num_accum_samps = 0, num_overflows = 0;
+    while (true){
+        const size_t num_samps_ret = streamer.recv(buffs, NUM_SAMPS_PER_BUFF, metadata, 0.1, false);
+        if (metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_TIMEOUT) break;
+        if (metadata.error_code == uhd::rx_metadata_t::ERROR_CODE_CAPTURE_OVERFLOW){
+            BOOST_CHECK_TS_CLOSE(metadata.time_spec, uhd::time_spec_t(0, num_accum_samps, SAMP_RATE));
+            num_overflows++;
+            continue;
+        }
+        BOOST_REQUIRE_EQUAL(metadata.error_code, uhd::rx_metadata_t::ERROR_CODE_NONE);
+        BOOST_CHECK_TS_CLOSE(metadata.time_spec, uhd::time_spec_t(0, num_accum_samps, SAMP_RATE));
+        for (size_t ch = 0; ch < NCHANNELS; ch++){
+            for (size_t i = 0; i < num_samps_ret; i++){
+                BOOST_REQUIRE_EQUAL(mem[ch*NUM_SAMPS_PER_BUFF + i], boost::uint32_t(num_accum_samps + i));
+            }
+        }
+        num_accum_samps += num_samps_ret;
+    }
+
+    //a ring that holds everything loses nothing, a small one fills once
+    if (ring_samps >= num_samps_sent){
+        BOOST_CHECK_EQUAL(num_overflows, 0);
+        BOOST_CHECK_EQUAL(num_accum_samps, num_samps_sent);
+    }
+    else{
+        BOOST_CHECK_EQUAL(num_overflows, 1);
+        BOOST_CHECK(num_accum_samps <= ring_samps);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_sph_recv_capture_normal){
+    test_sph_recv_capture(4096);
+}
+
+BOOST_AUTO_TEST_CASE(test_sph_recv_capture_overflow){
+    test_sph_recv_capture(100);
+}
@@ -17,7 +17,10 @@
 
 #include <boost/test/unit_test.hpp>
 #include "../lib/transport/super_send_packet_handler.hpp"
+#include "../lib/transport/super_send_thread_streamer.hpp"
 #include <boost/shared_array.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/thread/thread.hpp>
 #include <boost/bind.hpp>
 #include <complex>
 #include <vector>
@@ -60,19 +63,28 @@ public:
     }
 
     void pop_front_packet(
-        uhd::transport::vrt::if_packet_info_t &ifpi
+        uhd::transport::vrt::if_packet_info_t &ifpi,
+        std::vector<boost::uint32_t> *payload = NULL
     ){
         ifpi.num_packet_words32 = _lens.front()/sizeof(boost::uint32_t);
+        const boost::uint32_t *mem = reinterpret_cast<boost::uint32_t *>(_mems.front().get());
         if (_end == "big"){
-            uhd::transport::vrt::if_hdr_unpack_be(reinterpret_cast<boost::uint32_t *>(_mems.front().get()), ifpi);
+            uhd::transport::vrt::if_hdr_unpack_be(mem, ifpi);
         }
         if (_end == "little"){
-            uhd::transport::vrt::if_hdr_unpack_le(reinterpret_cast<boost::uint32_t *>(_mems.front().get()), ifpi);
+            uhd::transport::vrt::if_hdr_unpack_le(mem, ifpi);
         }
+        if (payload != NULL) payload->assign(
+            mem + ifpi.num_header_words32, mem + ifpi.num_header_words32 + ifpi.num_payload_words32
+        );
         _mems.pop_front();
         _lens.pop_front();
     }
 
+    size_t get_num_packets(void) const{
+        return _mems.size();
+    }
+
     uhd::transport::managed_send_buffer::sptr get_send_buff(double){
         _msbs.push_back(dummy_msb());
         _mems.push_back(boost::shared_array<char>(new char[1000]));
@@ -200,3 +212,371 @@ BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_full_buffer_mode){
         num_accum_samps += ifpi.num_payload_words32;
     }
 }
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_sc12_trailer){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16";
+    id.num_inputs = 1;
+    id.output_format = "sc12_item32_be";
+    id.num_outputs = 1;
+
+    dummy_send_xport_class dummy_send_xport("big");
+
+    static const double TICK_RATE = 100e6;
+    static const double SAMP_RATE = 10e6;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const size_t SPP = 19; //57 bytes, the last word is partly filled
+
+    //create the super send packet handler
+    uhd::transport::sph::send_packet_handler handler(1);
+    handler.set_vrt_packer(&uhd::transport::vrt::if_hdr_pack_be);
+    handler.set_enable_trailer(true);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xport, _1));
+    handler.set_converter(id);
+    handler.set_max_samples_per_packet(SPP);
+
+    //allocate metadata and buffer
+    std::vector<std::complex<boost::int16_t> > buff(SPP*NUM_PKTS_TO_TEST);
+    uhd::tx_metadata_t metadata;
+    metadata.start_of_burst = true;
+    metadata.end_of_burst = true;
+    metadata.has_time_spec = true;
+    metadata.time_spec = uhd::time_spec_t(0.0);
+
+    //send the whole buffer, the last packet is short
+    const size_t num_sent = handler.send(&buff.front(), buff.size() - 5, metadata, 1.0);
+    BOOST_CHECK_EQUAL(num_sent, buff.size() - 5);
+
+    //check the sent packets
+    size_t num_accum_samps = 0;
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        dummy_send_xport.pop_front_packet(ifpi);
+        const size_t nsamps = (i == NUM_PKTS_TO_TEST-1)? SPP - 5 : SPP;
+        BOOST_CHECK(ifpi.has_tlr);
+        BOOST_CHECK_EQUAL(ifpi.num_payload_bytes, nsamps*3);
+        BOOST_CHECK_EQUAL(ifpi.num_payload_words32, (nsamps*3 + 3)/4);
+        BOOST_CHECK_EQUAL(ifpi.tsf, num_accum_samps*TICK_RATE/SAMP_RATE);
+        num_accum_samps += ifpi.num_payload_bytes/3;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_multi_channel_convert_threads){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    static const size_t NCHANNELS = 4;
+    static const size_t NUM_SAMPS_PER_PKT = 20;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    std::vector<dummy_send_xport_class> dummy_send_xports(NCHANNELS, dummy_send_xport_class("big"));
+
+    //create the super send packet handler, the 4 channels on 3 threads
+    uhd::transport::sph::send_packet_handler handler(NCHANNELS);
+    handler.set_vrt_packer(&uhd::transport::vrt::if_hdr_pack_be);
+    handler.set_tick_rate(100e6);
+    handler.set_samp_rate(10e6);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xports[ch], _1));
+    }
+    handler.set_converter(id);
+    handler.set_max_samples_per_packet(NUM_SAMPS_PER_PKT);
+    handler.set_convert_threads(3);
+
+    //every sample tells its channel and position
+    std::vector<std::vector<std::complex<boost::int16_t> > > mem(NCHANNELS);
+    std::vector<const std::complex<boost::int16_t> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        for (size_t i = 0; i < NUM_SAMPS_PER_PKT*NUM_PKTS_TO_TEST; i++){
+            mem[ch].push_back(std::complex<boost::int16_t>(boost::int16_t(ch), boost::int16_t(i)));
+        }
+        buffs[ch] = &mem[ch].front();
+    }
+
+    uhd::tx_metadata_t metadata;
+    metadata.has_time_spec = true;
+    metadata.time_spec = uhd::time_spec_t(0.0);
+    const size_t num_sent = handler.send(buffs, mem[0].size(), metadata, 1.0);
+    BOOST_CHECK_EQUAL(num_sent, mem[0].size());
+
+    //check the packets of every channel
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+            uhd::transport::vrt::if_packet_info_t ifpi;
+            std::vector<boost::uint32_t> payload;
+            dummy_send_xports[ch].pop_front_packet(ifpi, &payload);
+            BOOST_CHECK_EQUAL(ifpi.packet_count, i%16);
+            BOOST_REQUIRE_EQUAL(payload.size(), NUM_SAMPS_PER_PKT);
+            for (size_t j = 0; j < NUM_SAMPS_PER_PKT; j++){
+                const boost::uint32_t item = uhd::ntohx(payload[j]);
+                BOOST_CHECK_EQUAL(item >> 16, ch);
+                BOOST_CHECK_EQUAL(item & 0xffff, i*NUM_SAMPS_PER_PKT + j);
+            }
+        }
+    }
+}
+
+static uhd::transport::managed_send_buffer::sptr get_send_buff_or_timeout(
+    dummy_send_xport_class &xport, const bool &timeout_now, double timeout
+){
+    if (timeout_now) return uhd::transport::managed_send_buffer::sptr();
+    return xport.get_send_buff(timeout);
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_multi_channel_convert_threads_timeout){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    static const size_t NCHANNELS = 3;
+    static const size_t NUM_SAMPS_PER_PKT = 20;
+    std::vector<dummy_send_xport_class> dummy_send_xports(NCHANNELS, dummy_send_xport_class("big"));
+
+    //the last channel times out until told otherwise
+    bool timeout_now = true;
+    uhd::transport::sph::send_packet_handler handler(NCHANNELS);
+    handler.set_vrt_packer(&uhd::transport::vrt::if_hdr_pack_be);
+    handler.set_tick_rate(100e6);
+    handler.set_samp_rate(10e6);
+    for (size_t ch = 0; ch < NCHANNELS-1; ch++){
+        handler.set_xport_chan_get_buff(ch, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xports[ch], _1));
+    }
+    handler.set_xport_chan_get_buff(NCHANNELS-1, boost::bind(
+        &get_send_buff_or_timeout, boost::ref(dummy_send_xports[NCHANNELS-1]), boost::cref(timeout_now), _1
+    ));
+    handler.set_converter(id);
+    handler.set_max_samples_per_packet(NUM_SAMPS_PER_PKT);
+    handler.set_convert_threads(2);
+
+    std::vector<std::vector<std::complex<boost::int16_t> > > mem(NCHANNELS);
+    std::vector<const std::complex<boost::int16_t> *> buffs(NCHANNELS);
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        for (size_t i = 0; i < NUM_SAMPS_PER_PKT; i++){
+            mem[ch].push_back(std::complex<boost::int16_t>(boost::int16_t(ch), boost::int16_t(i)));
+        }
+        buffs[ch] = &mem[ch].front();
+    }
+
+    //the timeout sends nothing, the retry reuses the buffers already held
+    uhd::tx_metadata_t metadata;
+    BOOST_CHECK_EQUAL(handler.send(buffs, NUM_SAMPS_PER_PKT, metadata, 0.0), size_t(0));
+    timeout_now = false;
+    BOOST_CHECK_EQUAL(handler.send(buffs, NUM_SAMPS_PER_PKT, metadata, 1.0), NUM_SAMPS_PER_PKT);
+    BOOST_CHECK_EQUAL(handler.send(buffs, NUM_SAMPS_PER_PKT, metadata, 1.0), NUM_SAMPS_PER_PKT);
+
+    for (size_t ch = 0; ch < NCHANNELS; ch++){
+        BOOST_REQUIRE_EQUAL(dummy_send_xports[ch].get_num_packets(), size_t(2));
+        for (size_t i = 0; i < 2; i++){
+            uhd::transport::vrt::if_packet_info_t ifpi;
+            std::vector<boost::uint32_t> payload;
+            dummy_send_xports[ch].pop_front_packet(ifpi, &payload);
+            BOOST_CHECK_EQUAL(ifpi.packet_count, i);
+            BOOST_REQUIRE_EQUAL(payload.size(), NUM_SAMPS_PER_PKT);
+            for (size_t j = 0; j < NUM_SAMPS_PER_PKT; j++){
+                const boost::uint32_t item = uhd::ntohx(payload[j]);
+                BOOST_CHECK_EQUAL(item >> 16, ch);
+                BOOST_CHECK_EQUAL(item & 0xffff, j);
+            }
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_one_channel_tick_time){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "fc32";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    dummy_send_xport_class dummy_send_xport("big");
+
+    //the UmTRX GSM rate, a sample is 48 ticks
+    static const double TICK_RATE = 13e6;
+    static const double SAMP_RATE = 13e6/48;
+    static const size_t NUM_PKTS_TO_TEST = 30;
+    static const boost::int64_t START_TICKS = 41*boost::int64_t(TICK_RATE) + boost::int64_t(TICK_RATE) - 48*100;
+
+    //create the super send packet handler
+    uhd::transport::sph::send_packet_handler handler(1);
+    handler.set_vrt_packer(&uhd::transport::vrt::if_hdr_pack_be);
+    handler.set_tick_rate(TICK_RATE);
+    handler.set_samp_rate(SAMP_RATE);
+    handler.set_xport_chan_get_buff(0, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xport, _1));
+    handler.set_converter(id);
+    handler.set_max_samples_per_packet(20);
+
+    //a burst that crosses a second boundary
+    std::vector<std::complex<float> > buff(20*NUM_PKTS_TO_TEST);
+    uhd::tx_metadata_t metadata;
+    metadata.start_of_burst = true;
+    metadata.end_of_burst = true;
+    metadata.has_time_spec = true;
+    metadata.time_spec = uhd::time_spec_t(time_t(START_TICKS/boost::int64_t(TICK_RATE)), long(START_TICKS%boost::int64_t(TICK_RATE)), TICK_RATE);
+
+    const size_t num_sent = handler.send(
+        &buff.front(), buff.size(), metadata, 1.0
+    );
+    BOOST_CHECK_EQUAL(num_sent, buff.size());
+
+    //every fragment time must be exact to the tick
+    size_t num_accum_samps = 0;
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    for (size_t i = 0; i < NUM_PKTS_TO_TEST; i++){
+        std::cout << "data check " << i << std::endl;
+        dummy_send_xport.pop_front_packet(ifpi);
+        const boost::int64_t ticks = START_TICKS + boost::int64_t(num_accum_samps)*48;
+        BOOST_CHECK_EQUAL(ifpi.tsi, boost::uint32_t(ticks/boost::int64_t(TICK_RATE)));
+        BOOST_CHECK_EQUAL(ifpi.tsf, boost::uint64_t(ticks%boost::int64_t(TICK_RATE)));
+        num_accum_samps += ifpi.num_payload_words32;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+static void send_thread_producer(
+    uhd::tx_streamer::sptr streamer, const size_t producer, const size_t nsamps
+){
+////////////////////////////////////////////////////////////////////////
+    //every sample tells its producer and position
+    std::vector<std::complex<boost::int16_t> > buff(nsamps);
+    for (size_t i = 0; i < nsamps; i++){
+        buff[i] = std::complex<boost::int16_t>(boost::int16_t(producer), boost::int16_t(i));
+    }
+
+    uhd::tx_metadata_t metadata;
+    for (size_t i = 0; i < nsamps;){
+        const size_t nsamps_per_call = std::min<size_t>(nsamps - i, 37);
+        i += streamer->send(&buff[i], nsamps_per_call, metadata, 1.0);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_thread_streamer){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    static const size_t NUM_SAMPS_PER_PKT = 20;
+    static const size_t NUM_PRODUCERS = 3;
+    static const size_t NUM_SAMPS_PER_PRODUCER = 1000;
+    static const size_t RING_SAMPS = 100;
+
+    dummy_send_xport_class dummy_send_xport("big");
+
+    //create the packet streamer, the thread streamer sends with it
+    boost::shared_ptr<uhd::transport::sph::send_packet_streamer> my_streamer =
+        boost::make_shared<uhd::transport::sph::send_packet_streamer>(NUM_SAMPS_PER_PKT);
+    my_streamer->resize(1);
+    my_streamer->set_vrt_packer(&uhd::transport::vrt::if_hdr_pack_be);
+    my_streamer->set_tick_rate(100e6);
+    my_streamer->set_samp_rate(10e6);
+    my_streamer->set_xport_chan_get_buff(0, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xport, _1));
+    my_streamer->set_converter(id);
+    BOOST_CHECK_THROW(my_streamer->get_send_room(), uhd::not_implemented_error);
+
+    uhd::tx_streamer::sptr streamer = boost::make_shared<uhd::transport::sph::send_thread_streamer>(
+        my_streamer, sizeof(std::complex<boost::int16_t>), RING_SAMPS
+    );
+    BOOST_CHECK_EQUAL(streamer->get_send_room(), RING_SAMPS);
+
+    //the producers share the streamer, a full ring holds them back
+    boost::thread_group producers;
+    for (size_t p = 0; p < NUM_PRODUCERS; p++){
+        producers.create_thread(boost::bind(&send_thread_producer, streamer, p, NUM_SAMPS_PER_PRODUCER));
+    }
+    producers.join_all();
+
+    //wait for the sender to drain the ring
+    for (size_t i = 0; i < 1000 and streamer->get_send_room() != RING_SAMPS; i++){
+        boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+    }
+    BOOST_REQUIRE_EQUAL(streamer->get_send_room(), RING_SAMPS);
+
+    //every producer's samples come out whole and in order
+    std::vector<size_t> num_samps(NUM_PRODUCERS, 0);
+    size_t packet_count = 0;
+    while (dummy_send_xport.get_num_packets() != 0){
+        uhd::transport::vrt::if_packet_info_t ifpi;
+        std::vector<boost::uint32_t> payload;
+        dummy_send_xport.pop_front_packet(ifpi, &payload);
+        BOOST_CHECK_EQUAL(ifpi.packet_count, packet_count++%16);
+        BOOST_CHECK(payload.size() <= NUM_SAMPS_PER_PKT);
+        for (size_t j = 0; j < payload.size(); j++){
+            const boost::uint32_t item = uhd::ntohx(payload[j]);
+            const size_t producer = item >> 16;
+            BOOST_REQUIRE(producer < NUM_PRODUCERS);
+            BOOST_CHECK_EQUAL(item & 0xffff, num_samps[producer]++);
+        }
+    }
+    for (size_t p = 0; p < NUM_PRODUCERS; p++){
+        BOOST_CHECK_EQUAL(num_samps[p], NUM_SAMPS_PER_PRODUCER);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////
+BOOST_AUTO_TEST_CASE(test_sph_send_thread_streamer_drain){
+////////////////////////////////////////////////////////////////////////
+    uhd::convert::id_type id;
+    id.input_format = "sc16";
+    id.num_inputs = 1;
+    id.output_format = "sc16_item32_be";
+    id.num_outputs = 1;
+
+    static const size_t NUM_SAMPS_PER_PKT = 20;
+    static const size_t NUM_SAMPS = 1000;
+    static const size_t RING_SAMPS = 1000;
+
+    dummy_send_xport_class dummy_send_xport("big");
+
+    boost::shared_ptr<uhd::transport::sph::send_packet_streamer> my_streamer =
+        boost::make_shared<uhd::transport::sph::send_packet_streamer>(NUM_SAMPS_PER_PKT);
+    my_streamer->resize(1);
+    my_streamer->set_vrt_packer(&uhd::transport::vrt::if_hdr_pack_be);
+    my_streamer->set_tick_rate(100e6);
+    my_streamer->set_samp_rate(10e6);
+    my_streamer->set_xport_chan_get_buff(0, boost::bind(&dummy_send_xport_class::get_send_buff, &dummy_send_xport, _1));
+    my_streamer->set_converter(id);
+
+    //queue a burst without an end and destroy the streamer right away
+    {
+        uhd::tx_streamer::sptr streamer = boost::make_shared<uhd::transport::sph::send_thread_streamer>(
+            my_streamer, sizeof(std::complex<boost::int16_t>), RING_SAMPS
+        );
+        std::vector<std::complex<boost::int16_t> > buff(NUM_SAMPS);
+        uhd::tx_metadata_t metadata;
+        metadata.start_of_burst = true;
+        for (size_t i = 0; i < NUM_SAMPS; i += 10){
+            BOOST_REQUIRE_EQUAL(streamer->send(&buff[i], 10, metadata, 1.0), size_t(10));
+            metadata.start_of_burst = false;
+        }
+    }
+
+    //every queued sample was sent, then a (padded) packet ending the burst
+    size_t num_samps = 0;
+    uhd::transport::vrt::if_packet_info_t ifpi;
+    while (dummy_send_xport.get_num_packets() != 0){
+        dummy_send_xport.pop_front_packet(ifpi);
+        if (ifpi.eob) break;
+        num_samps += ifpi.num_payload_words32;
+    }
+    BOOST_CHECK_EQUAL(dummy_send_xport.get_num_packets(), size_t(0));
+    BOOST_CHECK_EQUAL(num_samps, NUM_SAMPS);
+    BOOST_CHECK(ifpi.eob);
+}
@@ -0,0 +1,120 @@
+//
+// Copyright 2013 Fairwaves LLC
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <boost/test/unit_test.hpp>
+#include "../lib/transport/udp_packet_ring.hpp"
+#include <uhd/exception.hpp>
+#include <boost/cstdint.hpp>
+#include <cstring>
+#include <vector>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+using namespace uhd;
+using namespace uhd::transport;
+
+static const size_t payload_len = 500;
+static const double timeout = 1.0/*secs*/;
+
+/***********************************************************************
+ * A pair of UDP sockets connected to each other over the loopback
+ **********************************************************************/
+static int make_loopback_socket(void){
+    const int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    BOOST_REQUIRE(fd >= 0);
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    BOOST_REQUIRE(::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0);
+    return fd;
+}
+
+static void connect_to(int fd, int peer_fd){
+    sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    BOOST_REQUIRE(::getsockname(peer_fd, reinterpret_cast<sockaddr *>(&addr), &addr_len) == 0);
+    BOOST_REQUIRE(::connect(fd, reinterpret_cast<sockaddr *>(&addr), addr_len) == 0);
+}
+
+static void send_seq(int fd, boost::uint32_t seq){
+    std::vector<boost::uint32_t> payload(payload_len/sizeof(boost::uint32_t), seq);
+    BOOST_REQUIRE_EQUAL(::send(fd, &payload.front(), payload_len, 0), ssize_t(payload_len));
+}
+
+/***********************************************************************
+ * Receive and release across block boundaries:
+ *  - A round of datagrams is larger than a 4096 byte block,
+ *    so every round spans more than one block.
+ *  - All datagrams of a round are held before any is released,
+ *    then they are released newest first.
+ *  - The rounds go around the ring several times,
+ *    which only works when every block went back to the kernel.
+ **********************************************************************/
+BOOST_AUTO_TEST_CASE(test_udp_packet_ring_block_boundary){
+    const size_t num_rounds = 6, num_per_round = 8;
+
+    const int recv_fd = make_loopback_socket();
+    const int send_fd = make_loopback_socket();
+    connect_to(recv_fd, send_fd);
+    connect_to(send_fd, recv_fd);
+
+    device_addr_t hints;
+    hints["recv_ring_block_size"] = "4096";
+    hints["recv_ring_num_blocks"] = "4";
+    hints["num_recv_frames"] = "8";
+    udp_packet_ring::sptr ring;
+    try{
+        ring = udp_packet_ring::make(recv_fd, payload_len, hints);
+    }
+    catch(const uhd::os_error &e){
+        //the ring needs CAP_NET_RAW, without it there is nothing to test
+        BOOST_TEST_MESSAGE("skipping the packet ring test: " << e.what());
+        ::close(send_fd);
+        ::close(recv_fd);
+        return;
+    }
+    BOOST_CHECK_EQUAL(ring->get_num_recv_frames(), size_t(8));
+
+    boost::uint32_t seq = 0;
+    for (size_t round = 0; round < num_rounds; round++){
+        for (size_t i = 0; i < num_per_round; i++) send_seq(send_fd, seq + i);
+
+        std::vector<managed_recv_buffer::sptr> buffs;
+        for (size_t i = 0; i < num_per_round; i++){
+            managed_recv_buffer::sptr buff = ring->get_recv_buff(timeout);
+            BOOST_REQUIRE_MESSAGE(buff.get() != NULL, "no datagram in round " << round);
+            BOOST_REQUIRE_EQUAL(buff->size(), payload_len);
+            BOOST_CHECK_EQUAL(buff->cast<const boost::uint32_t *>()[0], seq + i);
+            BOOST_CHECK_EQUAL(buff->cast<const boost::uint32_t *>()[payload_len/sizeof(boost::uint32_t)-1], seq + i);
+            buffs.push_back(buff);
+        }
+        seq += num_per_round;
+
+        while (not buffs.empty()) buffs.pop_back();
+    }
+    BOOST_CHECK_EQUAL(ring->get_num_recv_packets(), size_t(seq));
+
+    //nothing else arrives: a timeout, not a stale datagram
+    BOOST_CHECK(ring->get_recv_buff(0.01).get() == NULL);
+
+    ring.reset();
+    ::close(send_fd);
+    ::close(recv_fd);
+}
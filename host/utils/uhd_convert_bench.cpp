@@ -0,0 +1,147 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <uhd/utils/safe_main.hpp>
+#include <uhd/convert.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/foreach.hpp>
+#include <boost/format.hpp>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+namespace po = boost::program_options;
+using namespace uhd;
+
+static bool id_less(const convert::id_type &a, const convert::id_type &b){
+    if (a.input_format != b.input_format) return a.input_format < b.input_format;
+    if (a.output_format != b.output_format) return a.output_format < b.output_format;
+    if (a.num_inputs != b.num_inputs) return a.num_inputs < b.num_inputs;
+    return a.num_outputs < b.num_outputs;
+}
+
+/***********************************************************************
+ * Time one converter, the best of several runs in ns/sample
+ **********************************************************************/
+static double time_converter(
+    const convert::id_type &id, const convert::priority_type prio,
+    const size_t nsamps, const size_t total_samps, const size_t runs
+){
+    //interleaved formats hold every channel in one buffer,
+    //plus some slack for converters that read past an odd tail
+    const size_t nchans = std::max(id.num_inputs, id.num_outputs);
+    std::vector<std::vector<char> > in_mem(id.num_inputs, std::vector<char>(
+        convert::get_bytes_per_item(id.input_format)*nsamps*nchans + 16));
+    std::vector<std::vector<char> > out_mem(id.num_outputs, std::vector<char>(
+        convert::get_bytes_per_item(id.output_format)*nsamps*nchans + 16));
+    std::vector<const void *> inputs;
+    std::vector<void *> outputs;
+    for (size_t i = 0; i < id.num_inputs; i++) inputs.push_back(&in_mem[i].front());
+    for (size_t i = 0; i < id.num_outputs; i++) outputs.push_back(&out_mem[i].front());
+
+    convert::converter::sptr c = convert::get_converter(id, prio)();
+    c->set_scalar(1.0);
+    c->conv(inputs, outputs, nsamps); //warm up the caches
+
+    const size_t iterations = std::max<size_t>(1, total_samps/nsamps);
+    double best = 0;
+    for (size_t run = 0; run < runs; run++){
+        const time_spec_t start = time_spec_t::get_system_time();
+        for (size_t i = 0; i < iterations; i++){
+            c->conv(inputs, outputs, nsamps);
+        }
+        const double secs = (time_spec_t::get_system_time() - start).get_real_secs();
+        if (run == 0 or secs < best) best = secs;
+    }
+    return 1e9*best/(iterations*nsamps);
+}
+
+/***********************************************************************
+ * Main
+ **********************************************************************/
+int UHD_SAFE_MAIN(int argc, char *argv[]){
+    std::string in_filter, out_filter, sizes_str;
+    double total_samps;
+    size_t runs;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("in", po::value<std::string>(&in_filter)->default_value(""), "only input formats containing this string")
+        ("out", po::value<std::string>(&out_filter)->default_value(""), "only output formats containing this string")
+        ("sizes", po::value<std::string>(&sizes_str)->default_value("64,1024,16384,262144"), "comma separated buffer sizes in samples")
+        ("samps", po::value<double>(&total_samps)->default_value(4e6), "samples converted per measurement")
+        ("runs", po::value<size_t>(&runs)->default_value(3), "measurements per converter, the best is reported")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or runs == 0){
+        std::cout << boost::format("UHD Converter Benchmark %s") % desc << std::endl;
+        std::cout << "Times every registered implementation of every conversion in ns/sample." << std::endl;
+        return ~0;
+    }
+
+    std::vector<std::string> size_strs;
+    boost::split(size_strs, sizes_str, boost::is_any_of(","));
+    std::vector<size_t> sizes;
+    BOOST_FOREACH(const std::string &s, size_strs){
+        if (not s.empty()) sizes.push_back(boost::lexical_cast<size_t>(boost::trim_copy(s)));
+    }
+
+    std::vector<convert::id_type> ids = convert::get_converter_ids();
+    std::sort(ids.begin(), ids.end(), id_less);
+
+    BOOST_FOREACH(const convert::id_type &id, ids){
+        if (id.input_format.find(in_filter) == std::string::npos) continue;
+        if (id.output_format.find(out_filter) == std::string::npos) continue;
+
+        std::vector<convert::priority_type> prios = convert::get_converter_priorities(id);
+        std::sort(prios.begin(), prios.end());
+
+        std::cout << boost::format("%s x%u -> %s x%u")
+            % id.input_format % id.num_inputs % id.output_format % id.num_outputs << std::endl;
+        std::cout << boost::format("  %10s") % "samps";
+        BOOST_FOREACH(const convert::priority_type p, prios){
+            std::cout << boost::format(" %10s") % str(boost::format("prio %d") % p);
+        }
+        std::cout << std::endl;
+
+        BOOST_FOREACH(const size_t nsamps, sizes){
+            std::vector<double> times;
+            BOOST_FOREACH(const convert::priority_type p, prios){
+                times.push_back(time_converter(id, p, nsamps, size_t(total_samps), runs));
+            }
+            const size_t fastest = std::min_element(times.begin(), times.end()) - times.begin();
+
+            std::cout << boost::format("  %10u") % nsamps;
+            for (size_t i = 0; i < times.size(); i++){
+                std::cout << boost::format(" %9.3f%s") % times[i] % ((i == fastest)? "*" : " ");
+            }
+            std::cout << std::endl;
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "Times in ns/sample, * marks the fastest for a buffer size." << std::endl;
+    std::cout << "Set UHD_CONVERT_AUTOTUNE=1 to pick the fastest converters at runtime." << std::endl;
+    return 0;
+}
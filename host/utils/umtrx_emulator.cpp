@@ -0,0 +1,960 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "../lib/usrp/usrp2/fw_common.h"
+#include "../lib/usrp/umtrx/umtrx_regs.hpp"
+#include "../lib/usrp/umtrx/lms_regs.hpp"
+#include "../lib/transport/udp_common.hpp"
+#include <uhd/utils/safe_main.hpp>
+#include <uhd/utils/byteswap.hpp>
+#include <uhd/types/metadata.hpp>
+#include <uhd/transport/vrt_if_packet.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/math/special_functions/round.hpp>
+#include <boost/asio.hpp>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <complex>
+#include <csignal>
+#include <cstring>
+#include <cmath>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace po = boost::program_options;
+namespace asio = boost::asio;
+namespace pt = boost::posix_time;
+using namespace uhd;
+using namespace uhd::transport;
+
+/***********************************************************************
+ * Register offsets of the DSP cores (mirror the host cores)
+ **********************************************************************/
+//rx_dsp_core_200
+static const boost::uint32_t RX_DSP_DECIM         = 8;
+static const boost::uint32_t RX_CTRL_STREAM_CMD   = 0;
+static const boost::uint32_t RX_CTRL_TIME_SECS    = 4;
+static const boost::uint32_t RX_CTRL_TIME_TICKS   = 8;
+static const boost::uint32_t RX_CTRL_CLEAR        = 12;
+static const boost::uint32_t RX_CTRL_VRT_HDR      = 16;
+static const boost::uint32_t RX_CTRL_VRT_SID      = 20;
+static const boost::uint32_t RX_CTRL_VRT_TLR      = 24;
+static const boost::uint32_t RX_CTRL_NSAMPS_PP    = 28;
+static const boost::uint32_t RX_CTRL_FORMAT       = 36;
+
+//tx_dsp_core_200
+static const boost::uint32_t TX_DSP_INTERP        = 8;
+static const boost::uint32_t TX_CTRL_CLEAR_STATE  = 4;
+static const boost::uint32_t TX_CTRL_REPORT_SID   = 8;
+static const boost::uint32_t TX_CTRL_POLICY       = 12;
+static const boost::uint32_t TX_CTRL_CYCLES_PER_UP  = 16;
+static const boost::uint32_t TX_CTRL_PACKETS_PER_UP = 20;
+static const boost::uint32_t TX_CTRL_FORMAT       = 24;
+
+static const boost::uint32_t FLAG_FORMAT_SC8  = (1 << 18);
+static const boost::uint32_t FLAG_FORMAT_SC12 = (1 << 19);
+
+//time64_core_200
+static const boost::uint32_t TIME64_SECS  = 0;
+static const boost::uint32_t TIME64_TICKS = 4;
+static const boost::uint32_t TIME64_IMM   = 12;
+static const boost::uint32_t TIME64_TPS   = 16;
+
+static const boost::uint32_t FLAG_TX_CTRL_POLICY_NEXT_PACKET = (0x1 << 1);
+static const boost::uint32_t FLAG_TX_CTRL_UP_ENB = (1ul << 31);
+
+static const size_t NUM_DSPS = 2;
+static const size_t LMS_NUM_REGS = 128;
+static const size_t EEPROM_SIZE = 256;
+static const double DEFAULT_TICK_RATE = 13e6;
+
+static const boost::uint32_t rx_dsp_bases[NUM_DSPS] = {U2_REG_SR_ADDR(SR_RX_DSP0), U2_REG_SR_ADDR(SR_RX_DSP1)};
+static const boost::uint32_t rx_ctrl_bases[NUM_DSPS] = {U2_REG_SR_ADDR(SR_RX_CTRL0), U2_REG_SR_ADDR(SR_RX_CTRL1)};
+static const boost::uint32_t tx_dsp_bases[NUM_DSPS] = {U2_REG_SR_ADDR(SR_TX_DSP0), U2_REG_SR_ADDR(SR_TX_DSP1)};
+static const boost::uint32_t tx_ctrl_bases[NUM_DSPS] = {U2_REG_SR_ADDR(SR_TX_CTRL0), U2_REG_SR_ADDR(SR_TX_CTRL1)};
+static const char *rx_ports[NUM_DSPS] = {BOOST_STRINGIZE(USRP2_UDP_RX_DSP0_PORT), BOOST_STRINGIZE(USRP2_UDP_RX_DSP1_PORT)};
+static const char *tx_ports[NUM_DSPS] = {BOOST_STRINGIZE(USRP2_UDP_TX_DSP0_PORT), BOOST_STRINGIZE(USRP2_UDP_TX_DSP1_PORT)};
+
+static bool stop_signal_called = false;
+void sig_int_handler(int){stop_signal_called = true;}
+
+/***********************************************************************
+ * LMS6002D register file
+ *  - plain registers read back what was written
+ *  - the PLL comparators report a NORMAL window in the VCOCAP sweep
+ *  - the DC and LPF calibration blocks always report success
+ **********************************************************************/
+class lms_regfile{
+public:
+    lms_regfile(void){
+        this->reset();
+    }
+
+    void reset(void){
+        std::fill(_regs, _regs + LMS_NUM_REGS, 0);
+        _regs[0x04] = 0x22; //chip version and revision
+    }
+
+    boost::uint8_t read(boost::uint8_t addr){
+        switch(addr){
+        case 0x1a: return vtune_comparator(0x10);
+        case 0x2a: return vtune_comparator(0x20);
+        case 0x00: case 0x30: case 0x50: case 0x60: return dc_regval(addr);
+        case 0x01: return (3 << 5) | dc_status(); //RCCAL_LPFCAL = 3
+        case 0x31: case 0x51: case 0x61: return dc_status();
+        }
+        return _regs[addr & 0x7f];
+    }
+
+    void write(boost::uint8_t addr, boost::uint8_t val){
+        _regs[addr & 0x7f] = val;
+    }
+
+private:
+    //VOVCO[1:0] in bits 7:6: 0x02 high, 0x00 normal, 0x01 low
+    boost::uint8_t vtune_comparator(boost::uint8_t base){
+        const int nint = (int(_regs[base + 0x0]) << 1) | (_regs[base + 0x1] >> 7);
+        const int freqsel = _regs[base + 0x5] >> 2;
+        const int vcocap = _regs[base + 0x9] & 0x3f;
+        const int center = 16 + (nint + freqsel) % 32;
+        if (vcocap < center - 6) return 0x02 << 6;
+        if (vcocap > center + 6) return 0x01 << 6;
+        return 0x00;
+    }
+
+    //DC_CLBR_DONE = 0 (done), DC_LOCK = 2 (locked)
+    boost::uint8_t dc_status(void){
+        return (2 << 2);
+    }
+
+    //a calibrated DC_REGVAL that is neither of the retry markers 0 and 31
+    boost::uint8_t dc_regval(boost::uint8_t base){
+        return 16 + (_regs[base + 0x03] & LMS_DC_ADDR_MASK);
+    }
+
+    boost::uint8_t _regs[LMS_NUM_REGS];
+};
+
+/***********************************************************************
+ * UmTRX emulator
+ *  - control port: firmware protocol from fw_common.h
+ *  - rx dsp ports: VRT data packets paced by the device clock
+ *  - tx dsp ports: flow control acks and async messages
+ **********************************************************************/
+class umtrx_emulator{
+public:
+    umtrx_emulator(const po::variables_map &vm):
+        _addr(vm["addr"].as<std::string>()),
+        _eeprom_file(vm["eeprom"].as<std::string>()),
+        _tone_period(vm["tone-period"].as<size_t>()),
+        _overflow_time(vm["overflow-time"].as<double>()),
+        _verbose(vm.count("verbose") != 0),
+        _tick_rate(DEFAULT_TICK_RATE),
+        _epoch(boost::get_system_time()),
+        _ticks_at_epoch(0.0),
+        _pps_pending(false),
+        _tcxo_dac(0),
+        _i2c_ptr(0)
+    {
+        std::fill(_fw_regs, _fw_regs + 8, 0);
+        _fw_regs[U2_FW_REG_VER_MINOR] = USRP2_FW_VER_MINOR;
+        _fw_regs[U2_FW_REG_LOCK_TIME] = 0xfffffff0; //unlocked
+        this->init_eeprom(vm["serial"].as<std::string>());
+        this->make_tone();
+    }
+
+    void run(void){
+        boost::thread_group threads;
+        threads.create_thread(boost::bind(&umtrx_emulator::ctrl_loop, this, make_socket(BOOST_STRINGIZE(USRP2_UDP_CTRL_PORT))));
+        for (size_t dsp = 0; dsp < NUM_DSPS; dsp++){
+            threads.create_thread(boost::bind(&umtrx_emulator::rx_loop, this, make_socket(rx_ports[dsp]), dsp));
+            threads.create_thread(boost::bind(&umtrx_emulator::tx_loop, this, make_socket(tx_ports[dsp]), dsp));
+        }
+        std::cout << boost::format("Emulating an UmTRX on %s, press Ctrl + C to stop...") % _addr << std::endl;
+        while (not stop_signal_called){
+            boost::this_thread::sleep(pt::milliseconds(100));
+        }
+        threads.interrupt_all();
+        threads.join_all();
+    }
+
+private:
+    typedef boost::shared_ptr<asio::ip::udp::socket> socket_sptr;
+
+    socket_sptr make_socket(const std::string &port){
+        asio::ip::udp::resolver resolver(_io_service);
+        asio::ip::udp::resolver::query query(asio::ip::udp::v4(), _addr, port);
+        socket_sptr socket(new asio::ip::udp::socket(_io_service));
+        socket->open(asio::ip::udp::v4());
+        socket->bind(*resolver.resolve(query));
+        return socket;
+    }
+
+    /*******************************************************************
+     * Device time: the host clock scaled to the tick rate
+     ******************************************************************/
+    double elapsed_secs(void){
+        return 1e-6*(boost::get_system_time() - _epoch).total_microseconds();
+    }
+
+    //! Device time in ticks, applies a pending set_time_next_pps
+    boost::int64_t time_now(void){
+        const double elapsed = this->elapsed_secs();
+        if (_pps_pending and elapsed >= _pps_edge){
+            _ticks_at_epoch = double(_pps_ticks) - _pps_edge*_tick_rate;
+            _pps_pending = false;
+        }
+        return boost::int64_t(_ticks_at_epoch + elapsed*_tick_rate);
+    }
+
+    boost::int64_t time_last_pps(void){
+        this->time_now();
+        return boost::int64_t(_ticks_at_epoch + std::floor(this->elapsed_secs())*_tick_rate);
+    }
+
+    boost::int64_t tps(void) const{
+        return boost::math::llround(_tick_rate);
+    }
+
+    boost::int64_t to_ticks(boost::uint32_t secs, boost::uint32_t ticks) const{
+        return boost::int64_t(secs)*this->tps() + ticks;
+    }
+
+    void latch_time(void){
+        const boost::int64_t ticks = to_ticks(_regs[U2_REG_SR_ADDR(SR_TIME64) + TIME64_SECS], _regs[U2_REG_SR_ADDR(SR_TIME64) + TIME64_TICKS]);
+        if (_regs[U2_REG_SR_ADDR(SR_TIME64) + TIME64_IMM] != 0){
+            _ticks_at_epoch = double(ticks) - this->elapsed_secs()*_tick_rate;
+            _pps_pending = false;
+        }
+        else{
+            _pps_ticks = ticks;
+            _pps_edge = std::floor(this->elapsed_secs()) + 1;
+            _pps_pending = true;
+        }
+    }
+
+    void set_tick_rate(double rate){
+        if (rate <= 0.0) return;
+        const double secs_now = this->time_now()/_tick_rate;
+        _tick_rate = rate;
+        _ticks_at_epoch = (secs_now - this->elapsed_secs())*_tick_rate;
+    }
+
+    /*******************************************************************
+     * Peek and poke of the FPGA registers
+     ******************************************************************/
+    boost::uint32_t peek32(boost::uint32_t addr){
+        switch(addr){
+        case U2_REG_COMPAT_NUM_RB: return (boost::uint32_t(USRP2_FPGA_COMPAT_NUM) << 16) | UMTRX_FPGA_SC12_MINOR;
+        case U2_REG_TIME64_SECS_RB_IMM: return boost::uint32_t(this->time_now()/this->tps());
+        case U2_REG_TIME64_TICKS_RB_IMM: return boost::uint32_t(this->time_now()%this->tps());
+        case U2_REG_TIME64_SECS_RB_PPS: return boost::uint32_t(this->time_last_pps()/this->tps());
+        case U2_REG_TIME64_TICKS_RB_PPS: return boost::uint32_t(this->time_last_pps()%this->tps());
+        }
+        return _regs[addr];
+    }
+
+    void poke32(boost::uint32_t addr, boost::uint32_t data){
+        const boost::uint32_t old = _regs[addr];
+        _regs[addr] = data;
+
+        if (addr == U2_REG_MISC_CTRL_CLOCK){
+            //the reset lines are active low
+            if ((old & LMS1_RESET) and not (data & LMS1_RESET)) _lms[0].reset();
+            if ((old & LMS2_RESET) and not (data & LMS2_RESET)) _lms[1].reset();
+        }
+        if (addr == U2_REG_SR_ADDR(SR_TIME64) + TIME64_SECS) this->latch_time();
+        if (addr == U2_REG_SR_ADDR(SR_TIME64) + TIME64_TPS) this->set_tick_rate(data);
+
+        for (size_t dsp = 0; dsp < NUM_DSPS; dsp++){
+            if (addr == rx_ctrl_bases[dsp] + RX_CTRL_TIME_TICKS) this->issue_stream_cmd(dsp);
+            if (addr == rx_ctrl_bases[dsp] + RX_CTRL_CLEAR) this->clear_rx(dsp);
+            if (addr == tx_ctrl_bases[dsp] + TX_CTRL_CLEAR_STATE) this->clear_tx(dsp);
+        }
+    }
+
+    /*******************************************************************
+     * I2C EEPROM (mboard EEPROM in the UmTRX map)
+     ******************************************************************/
+    void init_eeprom(const std::string &serial){
+        std::fill(_eeprom, _eeprom + EEPROM_SIZE, 0xff);
+        std::ifstream file(_eeprom_file.c_str(), std::ios::binary);
+        if (not _eeprom_file.empty() and file.good()){
+            file.read(reinterpret_cast<char *>(_eeprom), EEPROM_SIZE);
+            return;
+        }
+        static const boost::uint8_t mac_addr[6] = {0x00, 0x50, 0xc2, 0x85, 0x3f, 0xff};
+        const asio::ip::address_v4::bytes_type ip_addr = asio::ip::address_v4::from_string(_addr).to_bytes();
+        _eeprom[0x00] = 0x00; _eeprom[0x01] = 0xfa; //hardware: UMTRX_REV0
+        std::copy(mac_addr, mac_addr + 6, _eeprom + 0x02);
+        std::copy(ip_addr.begin(), ip_addr.end(), _eeprom + 0x0C);
+        _eeprom[0x12] = 0x00; _eeprom[0x13] = 0x00; //revision
+        _eeprom[0x17] = 0x00; //gpsdo: none
+        std::memset(_eeprom + 0x18, 0, 9);
+        std::copy(serial.begin(), serial.begin() + std::min<size_t>(serial.size(), 8), _eeprom + 0x18);
+        _eeprom[0x18 + 9] = 0x00; //empty name
+    }
+
+    void write_i2c(boost::uint8_t addr, const boost::uint8_t *buf, size_t len){
+        if (addr != USRP2_I2C_ADDR_MBOARD or len == 0) return;
+        _i2c_ptr = buf[0];
+        for (size_t i = 1; i < len; i++) _eeprom[_i2c_ptr++] = buf[i];
+        if (len > 1 and not _eeprom_file.empty()){
+            std::ofstream file(_eeprom_file.c_str(), std::ios::binary);
+            file.write(reinterpret_cast<const char *>(_eeprom), EEPROM_SIZE);
+        }
+    }
+
+    void read_i2c(boost::uint8_t addr, boost::uint8_t *buf, size_t len){
+        for (size_t i = 0; i < len; i++){
+            buf[i] = (addr == USRP2_I2C_ADDR_MBOARD)? _eeprom[_i2c_ptr++] : 0xff;
+        }
+    }
+
+    /*******************************************************************
+     * SPI: the two LMS6002D chips and the TCXO DAC
+     ******************************************************************/
+    boost::uint32_t transact_spi(boost::uint32_t dev, boost::uint32_t data, size_t num_bits){
+        boost::uint32_t result = 0;
+        for (size_t i = 0; i < NUM_DSPS; i++){
+            if (not (dev & ((i == 0)? SPI_SS_LMS1 : SPI_SS_LMS2)) or num_bits != 16) continue;
+            const boost::uint8_t reg = (data >> 8) & 0x7f;
+            result = _lms[i].read(reg);
+            if (data & (1 << 15)) _lms[i].write(reg, data & 0xff);
+        }
+        if (dev & SPI_SS_DAC){
+            _tcxo_dac = boost::uint16_t(data);
+            if (_verbose) std::cout << boost::format("TCXO DAC set to %u") % _tcxo_dac << std::endl;
+        }
+        return result;
+    }
+
+    /*******************************************************************
+     * Control port: mirrors handle_udp_ctrl_packet() of the firmware
+     ******************************************************************/
+    void ctrl_loop(socket_sptr socket){
+        std::vector<boost::uint8_t> mem(udp_simple_mtu());
+        std::vector<boost::uint8_t> out_mem(udp_simple_mtu());
+        asio::ip::udp::endpoint ep;
+        while (not boost::this_thread::interruption_requested()){
+            if (not wait_for_recv_ready(socket->native(), 0.1)) continue;
+            const size_t len = socket->receive_from(asio::buffer(mem), ep);
+            usrp2_ctrl_data_t in = usrp2_ctrl_data_t();
+            std::memcpy(&in, &mem.front(), std::min(len, sizeof(in)));
+
+            boost::uint32_t id = ntohl(in.id);
+            if (len >= sizeof(boost::uint32_t) and ntohl(in.proto_ver) != USRP2_FW_COMPAT_NUM){
+                id = UMTRX_CTRL_ID_REQUEST;
+            }
+            if (len < sizeof(usrp2_ctrl_data_t)) id = USRP2_CTRL_ID_HUH_WHAT;
+
+            usrp2_ctrl_data_t out = usrp2_ctrl_data_t();
+            out.proto_ver = htonl(USRP2_FW_COMPAT_NUM);
+            out.id = htonl(USRP2_CTRL_ID_HUH_WHAT);
+            out.seq = in.seq;
+            size_t out_len = sizeof(out);
+
+            boost::mutex::scoped_lock lock(_mutex);
+            switch(id){
+            case UMTRX_CTRL_ID_REQUEST:
+                out.id = htonl(UMTRX_CTRL_ID_RESPONSE);
+                out.data.ip_addr = htonl(asio::ip::address_v4::from_string(_addr).to_ulong());
+                break;
+
+            case USRP2_CTRL_ID_TRANSACT_ME_SOME_SPI_BRO:
+                out.data.spi_args.data = htonl(this->transact_spi(
+                    ntohl(in.data.spi_args.dev), ntohl(in.data.spi_args.data), in.data.spi_args.num_bits
+                ));
+                out.id = htonl(USRP2_CTRL_ID_OMG_TRANSACTED_SPI_DUDE);
+                break;
+
+            case USRP2_CTRL_ID_DO_AN_I2C_READ_FOR_ME_BRO:
+                this->read_i2c(in.data.i2c_args.addr, out.data.i2c_args.data, std::min<size_t>(in.data.i2c_args.bytes, 20));
+                out.data.i2c_args.bytes = in.data.i2c_args.bytes;
+                out.id = htonl(USRP2_CTRL_ID_HERES_THE_I2C_DATA_DUDE);
+                break;
+
+            case USRP2_CTRL_ID_WRITE_THESE_I2C_VALUES_BRO:
+                this->write_i2c(in.data.i2c_args.addr, in.data.i2c_args.data, std::min<size_t>(in.data.i2c_args.bytes, 20));
+                out.data.i2c_args.bytes = in.data.i2c_args.bytes;
+                out.id = htonl(USRP2_CTRL_ID_COOL_IM_DONE_I2C_WRITE_DUDE);
+                break;
+
+            case USRP2_CTRL_ID_GET_THIS_REGISTER_FOR_ME_BRO:{
+                const boost::uint32_t addr = ntohl(in.data.reg_args.addr);
+                const boost::uint32_t data = ntohl(in.data.reg_args.data);
+                switch(in.data.reg_args.action){
+                case USRP2_REG_ACTION_FPGA_PEEK32: out.data.reg_args.data = htonl(this->peek32(addr)); break;
+                case USRP2_REG_ACTION_FPGA_PEEK16: out.data.reg_args.data = htonl(this->peek32(addr) & 0xffff); break;
+                case USRP2_REG_ACTION_FPGA_POKE32: this->poke32(addr, data); break;
+                case USRP2_REG_ACTION_FPGA_POKE16: this->poke32(addr, data & 0xffff); break;
+                case USRP2_REG_ACTION_FW_PEEK32: out.data.reg_args.data = htonl(_fw_regs[addr & 0x7]); break;
+                case USRP2_REG_ACTION_FW_POKE32: _fw_regs[addr & 0x7] = data; break;
+                }
+                out.id = htonl(USRP2_CTRL_ID_OMG_GOT_REGISTER_SO_BAD_DUDE);
+                }
+                break;
+
+            case USRP2_CTRL_ID_HOLLER_AT_ME_BRO:
+                out.data.echo_args.len = htonl(boost::uint32_t(len));
+                out.id = htonl(USRP2_CTRL_ID_HOLLER_BACK_DUDE);
+                out_len = std::min<size_t>(ntohl(in.data.echo_args.len), out_mem.size());
+                break;
+            }
+            lock.unlock();
+
+            std::fill(out_mem.begin(), out_mem.end(), 0);
+            std::memcpy(&out_mem.front(), &out, std::min(out_len, sizeof(out)));
+            boost::system::error_code ec;
+            socket->send_to(asio::buffer(&out_mem.front(), out_len), ep, 0, ec);
+        }
+    }
+
+    static size_t udp_simple_mtu(void){
+        return 8192;
+    }
+
+    /*******************************************************************
+     * RX DSP: stream commands and VRT data packets
+     ******************************************************************/
+    struct stream_cmd_type{
+        bool now, chain, reload, stop;
+        size_t num_samps;
+        boost::int64_t time;
+    };
+
+    struct rx_dsp_type{
+        std::deque<stream_cmd_type> cmds;
+        bool active;
+        stream_cmd_type cmd;
+        size_t samps_left;
+        boost::int64_t next_time;
+        size_t packet_count;
+        size_t phase;
+        asio::ip::udp::endpoint peer;
+        bool has_peer;
+        boost::condition cond;
+        rx_dsp_type(void): active(false), samps_left(0), next_time(0), packet_count(0), phase(0), has_peer(false){}
+    };
+
+    void issue_stream_cmd(size_t dsp){
+        const boost::uint32_t base = rx_ctrl_bases[dsp];
+        const boost::uint32_t word = _regs[base + RX_CTRL_STREAM_CMD];
+        stream_cmd_type cmd;
+        cmd.now    = (word & (1ul << 31)) != 0;
+        cmd.chain  = (word & (1 << 30)) != 0;
+        cmd.reload = (word & (1 << 29)) != 0;
+        cmd.stop   = (word & (1 << 28)) != 0;
+        cmd.num_samps = word & 0x0fffffff;
+        cmd.time = to_ticks(_regs[base + RX_CTRL_TIME_SECS], _regs[base + RX_CTRL_TIME_TICKS]);
+        _rx[dsp].cmds.push_back(cmd);
+        _rx[dsp].cond.notify_one();
+    }
+
+    void clear_rx(size_t dsp){
+        _rx[dsp].cmds.clear();
+        _rx[dsp].active = false;
+        _rx[dsp].packet_count = 0;
+    }
+
+    size_t get_decim(size_t dsp){
+        const boost::uint32_t word = _regs[rx_dsp_bases[dsp] + RX_DSP_DECIM];
+        const size_t cic = std::max<size_t>(word & 0xff, 1);
+        return cic << (((word >> 8) & 0x1) + ((word >> 9) & 0x1));
+    }
+
+    void make_tone(void){
+        _tone.resize(std::max<size_t>(_tone_period, 1));
+        for (size_t i = 0; i < _tone.size(); i++){
+            const double angle = (_tone_period == 0)? 0.0 : 2*M_PI*i/_tone_period;
+            _tone[i] = std::polar(0.5, angle);
+        }
+    }
+
+    vrt::if_packet_info_t make_ifpi(size_t dsp, boost::int64_t time){
+        const boost::uint32_t base = rx_ctrl_bases[dsp];
+        const boost::uint32_t hdr = _regs[base + RX_CTRL_VRT_HDR];
+        vrt::if_packet_info_t ifpi;
+        ifpi.packet_type = vrt::if_packet_info_t::PACKET_TYPE_DATA;
+        ifpi.packet_count = _rx[dsp].packet_count;
+        ifpi.sob = false;
+        ifpi.eob = false;
+        ifpi.has_sid = (hdr & (0x1 << 28)) != 0;
+        ifpi.sid = _regs[base + RX_CTRL_VRT_SID];
+        ifpi.has_cid = false;
+        ifpi.has_tsi = (hdr & (0x3 << 22)) != 0;
+        ifpi.tsi = boost::uint32_t(time/this->tps());
+        ifpi.has_tsf = (hdr & (0x1 << 20)) != 0;
+        ifpi.tsf = boost::uint64_t(time%this->tps());
+        ifpi.has_tlr = (hdr & (0x1 << 26)) != 0;
+        ifpi.tlr = _regs[base + RX_CTRL_VRT_TLR];
+        return ifpi;
+    }
+
+    //! Make an inline message packet with an rx_metadata_t error code
+    std::vector<boost::uint32_t> make_rx_error(size_t dsp, boost::int64_t time, rx_metadata_t::error_code_t code){
+        vrt::if_packet_info_t ifpi = make_ifpi(dsp, time);
+        ifpi.packet_type = vrt::if_packet_info_t::PACKET_TYPE_CONTEXT;
+        ifpi.num_payload_words32 = 1;
+        ifpi.num_payload_bytes = sizeof(boost::uint32_t);
+        std::vector<boost::uint32_t> pkt(vrt::max_if_hdr_words32 + 2);
+        vrt::if_hdr_pack_be(&pkt.front(), ifpi);
+        pkt[ifpi.num_header_words32] = uhd::htonx<boost::uint32_t>(code);
+        pkt.resize(ifpi.num_packet_words32);
+        return pkt;
+    }
+
+    //! Put the 12-bit value at index into a payload of msb first host order words
+    static void put_sc12(boost::uint32_t *payload, size_t index, boost::int16_t value){
+        const boost::uint32_t v = boost::uint16_t(value) >> 4;
+        const size_t bit = 12*index;
+        const size_t off = bit % 32;
+        if (off <= 20) payload[bit/32] |= v << (20 - off);
+        else{
+            payload[bit/32] |= v >> (off - 20);
+            payload[bit/32 + 1] |= v << (52 - off);
+        }
+    }
+
+    std::vector<boost::uint32_t> make_rx_data(size_t dsp, size_t nsamps, bool eob){
+        rx_dsp_type &rx = _rx[dsp];
+        const boost::uint32_t format = _regs[rx_ctrl_bases[dsp] + RX_CTRL_FORMAT];
+        const bool sc8 = (format & FLAG_FORMAT_SC8) != 0;
+        const bool sc12 = not sc8 and (format & FLAG_FORMAT_SC12) != 0;
+        vrt::if_packet_info_t ifpi = make_ifpi(dsp, rx.next_time);
+        ifpi.eob = eob;
+        ifpi.num_payload_bytes = nsamps*((sc8)? 2 : (sc12)? 3 : 4);
+        ifpi.num_payload_words32 = (ifpi.num_payload_bytes + 3)/4;
+        std::vector<boost::uint32_t> pkt(vrt::max_if_hdr_words32 + ifpi.num_payload_words32 + 1);
+        vrt::if_hdr_pack_be(&pkt.front(), ifpi);
+
+        boost::uint32_t *payload = &pkt[ifpi.num_header_words32];
+        for (size_t i = 0; i < nsamps; i++){
+            const std::complex<double> &s = _tone[rx.phase++ % _tone.size()];
+            if (sc12){
+                put_sc12(payload, 2*i+0, boost::int16_t(s.real()*32767));
+                put_sc12(payload, 2*i+1, boost::int16_t(s.imag()*32767));
+            }
+            else if (sc8){
+                const boost::uint32_t item = (boost::uint32_t(boost::uint8_t(boost::int8_t(s.real()*127))) << 8) | boost::uint8_t(boost::int8_t(s.imag()*127));
+                boost::uint32_t &word = payload[i/2];
+                if (i % 2 == 0) word = item;
+                else word = uhd::htonx<boost::uint32_t>(word | (item << 16));
+                if (i % 2 == 0 and i == nsamps - 1) word = uhd::htonx<boost::uint32_t>(word);
+            }
+            else{
+                payload[i] = uhd::htonx<boost::uint32_t>(
+                    (boost::uint32_t(boost::uint16_t(boost::int16_t(s.real()*32767))) << 16) |
+                    boost::uint16_t(boost::int16_t(s.imag()*32767))
+                );
+            }
+        }
+        if (sc12) for (size_t j = 0; j < ifpi.num_payload_words32; j++){
+            payload[j] = uhd::htonx<boost::uint32_t>(payload[j]);
+        }
+
+        rx.packet_count = (rx.packet_count + 1) & 0xf;
+        rx.next_time += boost::int64_t(nsamps*this->get_decim(dsp));
+        pkt.resize(ifpi.num_packet_words32);
+        return pkt;
+    }
+
+    //! Start the next command from the queue, return false when there is none
+    bool start_next_cmd(size_t dsp, std::vector<std::vector<boost::uint32_t> > &pkts){
+        rx_dsp_type &rx = _rx[dsp];
+        const boost::int64_t now = this->time_now();
+        while (not rx.cmds.empty()){
+            const stream_cmd_type cmd = rx.cmds.front();
+            rx.cmds.pop_front();
+            if (cmd.stop) continue;
+            if (not cmd.now and cmd.time < now){
+                pkts.push_back(make_rx_error(dsp, now, rx_metadata_t::ERROR_CODE_LATE_COMMAND));
+                continue;
+            }
+            rx.cmd = cmd;
+            rx.active = true;
+            rx.next_time = (cmd.now)? now : cmd.time;
+            rx.samps_left = cmd.num_samps;
+            return true;
+        }
+        return false;
+    }
+
+    void rx_loop(socket_sptr socket, size_t dsp){
+        rx_dsp_type &rx = _rx[dsp];
+        std::vector<boost::uint8_t> mem(udp_simple_mtu());
+        std::vector<std::vector<boost::uint32_t> > pkts;
+        while (not boost::this_thread::interruption_requested()){
+            //learn the host address from the setup packet
+            asio::ip::udp::endpoint ep;
+            if (wait_for_recv_ready(socket->native(), 0.0)){
+                socket->receive_from(asio::buffer(mem), ep);
+                boost::mutex::scoped_lock lock(_mutex);
+                rx.peer = ep;
+                rx.has_peer = true;
+            }
+
+            boost::mutex::scoped_lock lock(_mutex);
+            pkts.clear();
+            boost::int64_t wait_ticks = boost::int64_t(0.01*_tick_rate);
+
+            //a continuous stream picks up new commands as they come in
+            if (rx.active and rx.cmd.reload and not rx.cmds.empty()){
+                const stream_cmd_type &cmd = rx.cmds.front();
+                if (cmd.now or cmd.time <= rx.next_time){
+                    rx.active = false;
+                    if (not cmd.stop) rx.cmds.front().now = true;
+                }
+            }
+            if (not rx.active) this->start_next_cmd(dsp, pkts);
+
+            const size_t spp = std::max<boost::uint32_t>(_regs[rx_ctrl_bases[dsp] + RX_CTRL_NSAMPS_PP], 1);
+            const size_t decim = this->get_decim(dsp);
+            const boost::int64_t now = this->time_now();
+            while (rx.active){
+                const bool continuous = rx.cmd.chain and rx.cmd.reload;
+                const size_t nsamps = (continuous)? spp : std::min(spp, rx.samps_left);
+                const boost::int64_t due = rx.next_time + boost::int64_t(nsamps*decim);
+                if (due > now){
+                    wait_ticks = due - now;
+                    break;
+                }
+
+                //the device fifo fills up when the stream falls behind
+                if (now - due > boost::int64_t(_overflow_time*_tick_rate)){
+                    pkts.push_back(make_rx_error(dsp, rx.next_time, rx_metadata_t::ERROR_CODE_OVERFLOW));
+                    rx.active = false;
+                    rx.cmds.clear();
+                    break;
+                }
+
+                if (not continuous) rx.samps_left -= nsamps;
+                const bool done = not continuous and rx.samps_left == 0;
+                pkts.push_back(make_rx_data(dsp, nsamps, done and not rx.cmd.chain));
+                if (not done) continue;
+
+                //chain into the next command or report a broken chain
+                rx.active = false;
+                if (not rx.cmd.chain) continue;
+                if (rx.cmds.empty()){
+                    pkts.push_back(make_rx_error(dsp, rx.next_time, rx_metadata_t::ERROR_CODE_BROKEN_CHAIN));
+                    continue;
+                }
+                const boost::int64_t next_time = rx.next_time;
+                rx.cmds.front().now = false;
+                rx.cmds.front().time = next_time;
+                this->start_next_cmd(dsp, pkts);
+            }
+            const asio::ip::udp::endpoint peer = rx.peer;
+            const bool has_peer = rx.has_peer;
+
+            if (pkts.empty()){
+                const double wait_secs = std::min(wait_ticks/_tick_rate, (rx.active)? 0.001 : 0.01);
+                rx.cond.timed_wait(lock, boost::get_system_time() + pt::microseconds(long(wait_secs*1e6)));
+                continue;
+            }
+            lock.unlock();
+
+            if (not has_peer) continue;
+            for (size_t i = 0; i < pkts.size(); i++){
+                boost::system::error_code ec;
+                socket->send_to(asio::buffer(pkts[i]), peer, 0, ec);
+            }
+        }
+    }
+
+    /*******************************************************************
+     * TX DSP: sample consumption, flow control and async messages
+     ******************************************************************/
+    struct tx_pending_type{
+        boost::int64_t done_time;
+        boost::uint32_t seq;
+        bool eob;
+    };
+
+    struct tx_event_type{
+        boost::int64_t time;
+        boost::uint32_t code;
+        boost::uint32_t seq;
+    };
+
+    struct tx_dsp_type{
+        std::deque<tx_pending_type> pending;
+        boost::int64_t buff_end;
+        boost::int64_t last_up_time;
+        size_t packets_since_up;
+        boost::uint32_t last_seq_ack;
+        boost::uint32_t next_seq;
+        bool has_seq, in_burst, underflowed, drop_burst;
+        size_t packet_count;
+        asio::ip::udp::endpoint peer;
+        bool has_peer;
+        tx_dsp_type(void):
+            buff_end(0), last_up_time(0), packets_since_up(0), last_seq_ack(0), next_seq(0),
+            has_seq(false), in_burst(false), underflowed(false), drop_burst(false),
+            packet_count(0), has_peer(false){}
+    };
+
+    void clear_tx(size_t dsp){
+        tx_dsp_type &tx = _tx[dsp];
+        tx.pending.clear();
+        tx.buff_end = 0;
+        tx.packets_since_up = 0;
+        tx.last_seq_ack = 0;
+        tx.has_seq = false;
+        tx.in_burst = false;
+        tx.underflowed = false;
+        tx.drop_burst = false;
+    }
+
+    size_t get_interp(size_t dsp){
+        const boost::uint32_t word = _regs[tx_dsp_bases[dsp] + TX_DSP_INTERP];
+        const size_t cic = std::max<size_t>(word & 0xff, 1);
+        return cic << (((word >> 8) & 0x1) + ((word >> 9) & 0x1));
+    }
+
+    void push_event(std::vector<tx_event_type> &events, boost::int64_t time, boost::uint32_t code, boost::uint32_t seq){
+        tx_event_type event;
+        event.time = time;
+        event.code = code;
+        event.seq = seq;
+        events.push_back(event);
+    }
+
+    //! Consume the samples that were played out by now and do the updates
+    void tx_consume(size_t dsp, std::vector<tx_event_type> &events){
+        tx_dsp_type &tx = _tx[dsp];
+        const boost::uint32_t base = tx_ctrl_bases[dsp];
+        const boost::int64_t now = this->time_now();
+        while (not tx.pending.empty() and tx.pending.front().done_time <= now){
+            const tx_pending_type done = tx.pending.front();
+            tx.pending.pop_front();
+            tx.last_seq_ack = done.seq;
+            tx.packets_since_up++;
+            if (done.eob) push_event(events, done.done_time, async_metadata_t::EVENT_CODE_BURST_ACK, done.seq);
+        }
+
+        //the samples ran out in the middle of a burst
+        if (tx.in_burst and not tx.underflowed and tx.pending.empty() and tx.buff_end < now){
+            push_event(events, tx.buff_end, async_metadata_t::EVENT_CODE_UNDERFLOW, tx.last_seq_ack);
+            tx.underflowed = true;
+        }
+
+        if (not tx.has_seq) return;
+        const boost::uint32_t packets_per_up = _regs[base + TX_CTRL_PACKETS_PER_UP];
+        const boost::uint32_t cycles_per_up = _regs[base + TX_CTRL_CYCLES_PER_UP];
+        const bool packets_up = (packets_per_up & FLAG_TX_CTRL_UP_ENB) and tx.packets_since_up >= (packets_per_up & ~FLAG_TX_CTRL_UP_ENB);
+        const bool cycles_up = (cycles_per_up & FLAG_TX_CTRL_UP_ENB) and now - tx.last_up_time >= boost::int64_t(cycles_per_up & ~FLAG_TX_CTRL_UP_ENB);
+        if (packets_up or cycles_up){
+            push_event(events, now, 0, tx.last_seq_ack);
+            tx.packets_since_up = 0;
+            tx.last_up_time = now;
+        }
+    }
+
+    void tx_handle_packet(size_t dsp, const boost::uint32_t *mem, size_t len, std::vector<tx_event_type> &events){
+        tx_dsp_type &tx = _tx[dsp];
+        const boost::uint32_t seq = uhd::ntohx(mem[0]);
+        vrt::if_packet_info_t ifpi;
+        ifpi.num_packet_words32 = len/sizeof(boost::uint32_t) - 1;
+        try{
+            vrt::if_hdr_unpack_be(mem + 1, ifpi);
+        }
+        catch(const std::exception &){
+            return;
+        }
+        const boost::int64_t now = this->time_now();
+
+        //sequence check on the flow control word
+        if (tx.has_seq and seq != tx.next_seq){
+            push_event(events, now, (tx.in_burst)? async_metadata_t::EVENT_CODE_SEQ_ERROR_IN_BURST : async_metadata_t::EVENT_CODE_SEQ_ERROR, seq);
+        }
+        tx.has_seq = true;
+        tx.next_seq = seq + 1;
+        tx.underflowed = false;
+
+        //drop the rest of a late burst, the packets are consumed at once
+        boost::int64_t start = std::max(now, tx.buff_end);
+        if (not tx.in_burst) tx.drop_burst = false;
+        if (ifpi.has_tsi and ifpi.has_tsf){
+            const boost::int64_t time = to_ticks(ifpi.tsi, boost::uint32_t(ifpi.tsf));
+            if (time < now){
+                push_event(events, now, async_metadata_t::EVENT_CODE_TIME_ERROR, seq);
+                tx.drop_burst = (_regs[tx_ctrl_bases[dsp] + TX_CTRL_POLICY] & FLAG_TX_CTRL_POLICY_NEXT_PACKET) == 0;
+            }
+            else start = std::max(time, tx.buff_end);
+        }
+        tx.in_burst = not ifpi.eob;
+
+        tx_pending_type pending;
+        pending.seq = seq;
+        pending.eob = ifpi.eob;
+        if (tx.drop_burst){
+            pending.done_time = now;
+        }
+        else{
+            //sc12 packets carry a trailer with the occupancy of the last word
+            const bool sc12 = (_regs[tx_ctrl_bases[dsp] + TX_CTRL_FORMAT] & FLAG_FORMAT_SC12) != 0;
+            const size_t nsamps = ifpi.num_payload_bytes/((sc12)? 3 : 4);
+            tx.buff_end = start + boost::int64_t(nsamps*this->get_interp(dsp));
+            pending.done_time = tx.buff_end;
+        }
+        tx.pending.push_back(pending);
+    }
+
+    std::vector<boost::uint32_t> make_tx_event(size_t dsp, const tx_event_type &event){
+        tx_dsp_type &tx = _tx[dsp];
+        vrt::if_packet_info_t ifpi;
+        ifpi.packet_type = vrt::if_packet_info_t::PACKET_TYPE_CONTEXT;
+        ifpi.num_payload_words32 = 2;
+        ifpi.num_payload_bytes = 2*sizeof(boost::uint32_t);
+        ifpi.packet_count = tx.packet_count;
+        ifpi.sob = false;
+        ifpi.eob = false;
+        ifpi.has_sid = true;
+        ifpi.sid = _regs[tx_ctrl_bases[dsp] + TX_CTRL_REPORT_SID];
+        ifpi.has_cid = false;
+        ifpi.has_tsi = true;
+        ifpi.tsi = boost::uint32_t(event.time/this->tps());
+        ifpi.has_tsf = true;
+        ifpi.tsf = boost::uint64_t(event.time%this->tps());
+        ifpi.has_tlr = false;
+        std::vector<boost::uint32_t> pkt(vrt::max_if_hdr_words32 + 2);
+        vrt::if_hdr_pack_be(&pkt.front(), ifpi);
+        pkt[ifpi.num_header_words32 + 0] = uhd::htonx(event.code);
+        pkt[ifpi.num_header_words32 + 1] = uhd::htonx(event.seq);
+        pkt.resize(ifpi.num_packet_words32);
+        tx.packet_count = (tx.packet_count + 1) & 0xf;
+        return pkt;
+    }
+
+    void tx_loop(socket_sptr socket, size_t dsp){
+        tx_dsp_type &tx = _tx[dsp];
+        std::vector<boost::uint32_t> mem(udp_simple_mtu()/sizeof(boost::uint32_t));
+        std::vector<tx_event_type> events;
+        double timeout = 0.001;
+        while (not boost::this_thread::interruption_requested()){
+            events.clear();
+            asio::ip::udp::endpoint ep;
+            size_t len = 0;
+            if (wait_for_recv_ready(socket->native(), timeout)){
+                len = socket->receive_from(asio::buffer(mem), ep);
+            }
+
+            boost::mutex::scoped_lock lock(_mutex);
+            if (len != 0){
+                tx.peer = ep;
+                tx.has_peer = true;
+            }
+            this->tx_consume(dsp, events);
+            //the setup packet has an invalid vrt header
+            if (len > 2*sizeof(boost::uint32_t) or (len == 2*sizeof(boost::uint32_t) and mem[1] != USRP2_INVALID_VRT_HEADER)){
+                this->tx_handle_packet(dsp, &mem.front(), len, events);
+            }
+            timeout = (tx.pending.empty())? 0.001 : std::min(0.001, std::max(0.0, (tx.pending.front().done_time - this->time_now())/_tick_rate));
+
+            std::vector<std::vector<boost::uint32_t> > pkts;
+            for (size_t i = 0; i < events.size(); i++){
+                pkts.push_back(make_tx_event(dsp, events[i]));
+                if (_verbose and events[i].code != 0){
+                    std::cout << boost::format("TX DSP%u event 0x%x at %u") % dsp % events[i].code % events[i].time << std::endl;
+                }
+            }
+            const asio::ip::udp::endpoint peer = tx.peer;
+            const bool has_peer = tx.has_peer;
+            lock.unlock();
+
+            if (not has_peer) continue;
+            for (size_t i = 0; i < pkts.size(); i++){
+                boost::system::error_code ec;
+                socket->send_to(asio::buffer(pkts[i]), peer, 0, ec);
+            }
+        }
+    }
+
+    const std::string _addr, _eeprom_file;
+    const size_t _tone_period;
+    const double _overflow_time;
+    const bool _verbose;
+
+    asio::io_service _io_service;
+    boost::mutex _mutex;
+
+    //device time
+    double _tick_rate;
+    const boost::system_time _epoch;
+    double _ticks_at_epoch;
+    bool _pps_pending;
+    double _pps_edge;
+    boost::int64_t _pps_ticks;
+
+    //registers and peripherals
+    std::map<boost::uint32_t, boost::uint32_t> _regs;
+    boost::uint32_t _fw_regs[8];
+    lms_regfile _lms[NUM_DSPS];
+    boost::uint16_t _tcxo_dac;
+    boost::uint8_t _eeprom[EEPROM_SIZE];
+    boost::uint8_t _i2c_ptr;
+
+    //dsp chains
+    std::vector<std::complex<double> > _tone;
+    rx_dsp_type _rx[NUM_DSPS];
+    tx_dsp_type _tx[NUM_DSPS];
+};
+
+/***********************************************************************
+ * Main
+ **********************************************************************/
+int UHD_SAFE_MAIN(int argc, char *argv[]){
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("addr", po::value<std::string>()->default_value("127.0.0.1"), "local address to serve the device on")
+        ("serial", po::value<std::string>()->default_value("EMU00001"), "serial number in the emulated EEPROM")
+        ("eeprom", po::value<std::string>()->default_value(""), "file to load and store the EEPROM contents")
+        ("tone-period", po::value<size_t>()->default_value(64), "period of the received test tone in samples (0 for DC)")
+        ("overflow-time", po::value<double>()->default_value(0.01), "seconds the receive stream may fall behind before an overflow")
+        ("verbose", "print async events and peripheral writes")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    //print the help message
+    if (vm.count("help")){
+        std::cout << boost::format("UmTRX Emulator %s") % desc << std::endl;
+        std::cout
+            << "Serves the UmTRX control and streaming protocol on the local host." << std::endl
+            << "Open the emulated device with the args \"type=umtrx,addr=127.0.0.1\"." << std::endl
+            << "Run one instance per address (ex: 127.0.0.2) to emulate several boards." << std::endl
+            << std::endl;
+        return ~0;
+    }
+
+    std::signal(SIGINT, &sig_int_handler);
+    umtrx_emulator emulator(vm);
+    emulator.run();
+
+    return 0;
+}
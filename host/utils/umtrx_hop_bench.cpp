@@ -0,0 +1,118 @@
+//
+// Copyright 2013 Fairwaves
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <uhd/utils/safe_main.hpp>
+#include <uhd/usrp/multi_usrp.hpp>
+#include <uhd/property_tree.hpp>
+#include <uhd/types/time_spec.hpp>
+#include <boost/program_options.hpp>
+#include <boost/format.hpp>
+#include <iostream>
+#include <algorithm>
+#include <vector>
+
+namespace po = boost::program_options;
+
+/***********************************************************************
+ * Hop latency statistics
+ **********************************************************************/
+struct hop_stats{
+    double total, min, max;
+    size_t count;
+    hop_stats(void): total(0), min(1e9), max(0), count(0){}
+    void add(const double t){
+        total += t; count++;
+        min = std::min(min, t);
+        max = std::max(max, t);
+    }
+    void print(const std::string &what) const{
+        std::cout << boost::format(
+            "%-12s %6u hops, avg %8.1f us, min %8.1f us, max %8.1f us"
+        ) % what % count % (1e6*total/count) % (1e6*min) % (1e6*max) << std::endl;
+    }
+};
+
+/***********************************************************************
+ * Main
+ **********************************************************************/
+int UHD_SAFE_MAIN(int argc, char *argv[]){
+    std::string args, dir;
+    size_t chan, num_hops;
+    double freq_start, freq_step;
+    size_t num_freqs;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "help message")
+        ("args", po::value<std::string>(&args)->default_value(""), "device address args [default = \"\"]")
+        ("dir", po::value<std::string>(&dir)->default_value("rx"), "hop the rx or tx chain")
+        ("chan", po::value<size_t>(&chan)->default_value(0), "channel (DSP) to hop")
+        ("freq-start", po::value<double>(&freq_start)->default_value(935.2e6), "first hop frequency in Hz")
+        ("freq-step", po::value<double>(&freq_step)->default_value(0.2e6), "spacing of the hop frequencies in Hz")
+        ("num-freqs", po::value<size_t>(&num_freqs)->default_value(64), "number of hop frequencies")
+        ("num-hops", po::value<size_t>(&num_hops)->default_value(1000), "number of hops to time")
+    ;
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help") or (dir != "rx" and dir != "tx") or num_freqs == 0 or num_hops == 0){
+        std::cout << boost::format("UmTRX hop latency benchmark %s") % desc << std::endl;
+        std::cout << "Times hops through a precomputed hop table against regular retunes." << std::endl;
+        return ~0;
+    }
+
+    uhd::usrp::multi_usrp::sptr usrp = uhd::usrp::multi_usrp::make(args);
+    uhd::property_tree::sptr tree = usrp->get_device()->get_tree();
+    const uhd::fs_path hop_path = str(boost::format("/mboards/0/%s_dsps/%u/hop") % dir % chan);
+
+    std::vector<double> freqs;
+    for (size_t i = 0; i < num_freqs; i++) freqs.push_back(freq_start + i*freq_step);
+
+    //precompute the hop table
+    uhd::time_spec_t start = uhd::time_spec_t::get_system_time();
+    const std::vector<double> actual_freqs = tree->access<std::vector<double> >(hop_path / "table").set(freqs).get();
+    std::cout << boost::format("Hop table of %u entries computed in %.1f ms")
+        % actual_freqs.size() % ((uhd::time_spec_t::get_system_time() - start).get_real_secs()*1e3) << std::endl;
+
+    //the first hop to an entry searches its VCOCAP, keep that out of the timing
+    start = uhd::time_spec_t::get_system_time();
+    for (size_t i = 0; i < num_freqs; i++) tree->access<size_t>(hop_path / "index").set(i);
+    std::cout << boost::format("First hop to every entry took %.1f ms")
+        % ((uhd::time_spec_t::get_system_time() - start).get_real_secs()*1e3) << std::endl;
+
+    //hop by table index
+    hop_stats table_stats;
+    for (size_t i = 0; i < num_hops; i++){
+        start = uhd::time_spec_t::get_system_time();
+        tree->access<size_t>(hop_path / "index").set(i % num_freqs);
+        table_stats.add((uhd::time_spec_t::get_system_time() - start).get_real_secs());
+    }
+
+    //hop through the regular tune path for comparison
+    hop_stats tune_stats;
+    for (size_t i = 0; i < num_hops; i++){
+        start = uhd::time_spec_t::get_system_time();
+        if (dir == "rx") usrp->set_rx_freq(freqs[i % num_freqs], chan);
+        else             usrp->set_tx_freq(freqs[i % num_freqs], chan);
+        tune_stats.add((uhd::time_spec_t::get_system_time() - start).get_real_secs());
+    }
+
+    table_stats.print("hop table");
+    tune_stats.print("set_freq");
+    return 0;
+}